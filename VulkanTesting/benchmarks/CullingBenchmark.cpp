@@ -0,0 +1,82 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include "../hello_triangle_app/culling/CpuCuller.hpp"
+
+// Objects culled per millisecond on a single core, for the BVH over static objects and the flat dynamic path.
+// Objects are scattered through a cube the camera sits in the middle of, so about a tenth of them is visible.
+
+static const char* simdName(const CpuCuller::Simd simd) {
+	switch (simd) {
+		case CpuCuller::Simd::Avx2:
+			return "AVX2";
+		case CpuCuller::Simd::Sse:
+			return "SSE";
+		default:
+			return "Scalar";
+	}
+}
+
+static double measureMilliseconds(const CpuCuller& culler, const culling::Frustum& frustum, std::vector<uint32_t>& visible, const int repetitions) {
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < repetitions; i++) {
+		visible.clear();
+		culler.Cull(frustum, visible);
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / repetitions;
+}
+
+int main() {
+	const glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2000.0f);
+	const glm::mat4 view = glm::lookAtRH(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const culling::Frustum frustum = culling::extractFrustum(projection * view);
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> radius(0.5f, 5.0f);
+
+	std::printf("%10s %8s %8s %12s %16s %10s\n", "objects", "layout", "simd", "ms/cull", "objects/ms/core", "visible");
+
+	for (const size_t objectCount : {10'000, 100'000, 1'000'000}) {
+		std::vector<CpuCuller::Object> objects(objectCount);
+		for (size_t i = 0; i < objectCount; i++) {
+			objects[i].boundingSphere = glm::vec4(position(random), position(random), position(random), radius(random));
+			objects[i].id = static_cast<uint32_t>(i);
+		}
+
+		// Enough repetitions for roughly ten million sphere tests per measurement.
+		const int repetitions = static_cast<int>(std::max<size_t>(5, 10'000'000 / objectCount));
+		std::vector<uint32_t> visible;
+		visible.reserve(objectCount);
+
+		for (const bool useBvh : {true, false}) {
+			CpuCuller culler;
+			if (useBvh) {
+				culler.SetStaticObjects(objects);
+			} else {
+				culler.SetDynamicObjects(objects);
+			}
+
+			for (int simd = 0; simd <= static_cast<int>(CpuCuller::GetBestSimd()); simd++) {
+				culler.SetSimd(static_cast<CpuCuller::Simd>(simd));
+				measureMilliseconds(culler, frustum, visible, 1); // Warm up caches.
+
+				const double milliseconds = measureMilliseconds(culler, frustum, visible, repetitions);
+				std::printf("%10zu %8s %8s %12.4f %16.0f %10zu\n", objectCount, useBvh ? "BVH" : "flat",
+				            simdName(culler.GetSimd()), milliseconds, static_cast<double>(objectCount) / milliseconds, visible.size());
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "../hello_triangle_app/gpu/HostAllocator.hpp"
+
+// Cost of an allocation and a free through the callbacks the driver sees, against malloc and free, the system allocator
+// the driver falls back to without them. Object scope allocations of the sizes drivers make for their handles, each
+// thread keeping a window of them alive like a driver creating and destroying objects. Command scope allocations
+// are freed right away, as they are within one call.
+
+namespace
+{
+	constexpr uint32_t ITERATIONS = 2'000'000;
+	constexpr uint32_t LIVE_WINDOW = 64;
+	constexpr size_t SIZES[] = {48, 96, 200, 64, 320, 24, 160, 512};
+
+	struct Allocation {
+		const char* name;
+		void* (*allocate)(const VkAllocationCallbacks* callbacks, size_t size, VkSystemAllocationScope scope);
+		void (*release)(const VkAllocationCallbacks* callbacks, void* memory);
+	};
+
+	const Allocation HOST_ALLOCATOR = {
+		"HostAllocator",
+		[](const VkAllocationCallbacks* callbacks, const size_t size, const VkSystemAllocationScope scope) {
+			return callbacks->pfnAllocation(callbacks->pUserData, size, 8, scope);
+		},
+		[](const VkAllocationCallbacks* callbacks, void* memory) { callbacks->pfnFree(callbacks->pUserData, memory); },
+	};
+
+	const Allocation SYSTEM = {
+		"malloc",
+		[](const VkAllocationCallbacks*, const size_t size, VkSystemAllocationScope) { return std::malloc(size); },
+		[](const VkAllocationCallbacks*, void* memory) { std::free(memory); },
+	};
+
+	void run(const Allocation& allocation, const VkAllocationCallbacks* callbacks, const VkSystemAllocationScope scope) {
+		void* window[LIVE_WINDOW] = {};
+		for (uint32_t i = 0; i < ITERATIONS; i++) {
+			void*& slot = window[i % LIVE_WINDOW];
+			if (slot != nullptr) allocation.release(callbacks, slot);
+			slot = allocation.allocate(callbacks, SIZES[i % std::size(SIZES)], scope);
+			static_cast<volatile char*>(slot)[0] = 1;
+			if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+				allocation.release(callbacks, slot);
+				slot = nullptr;
+			}
+		}
+		for (void* memory : window) {
+			if (memory != nullptr) allocation.release(callbacks, memory);
+		}
+	}
+
+	double nanosecondsPerPair(const Allocation& allocation, const VkAllocationCallbacks* callbacks,
+	                          const VkSystemAllocationScope scope, const uint32_t threadCount) {
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (uint32_t thread = 0; thread < threadCount; thread++) {
+			threads.emplace_back([&] { run(allocation, callbacks, scope); });
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+	}
+}
+
+int main() {
+	gpu::HostAllocator allocator;
+	const VkAllocationCallbacks* callbacks = allocator.GetCallbacks();
+
+	std::printf("%-24s %8s %16s %12s\n", "", "threads", "ns per pair", "vs malloc");
+	for (const VkSystemAllocationScope scope : {VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND}) {
+		const char* scopeName = scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT ? "object" : "command";
+		for (const uint32_t threadCount : {1u, std::max(std::thread::hardware_concurrency(), 1u)}) {
+			// Warms up both, the first run pays for the chunks and arenas.
+			nanosecondsPerPair(HOST_ALLOCATOR, callbacks, scope, threadCount);
+			nanosecondsPerPair(SYSTEM, callbacks, scope, threadCount);
+
+			const double hostAllocator = nanosecondsPerPair(HOST_ALLOCATOR, callbacks, scope, threadCount);
+			const double system = nanosecondsPerPair(SYSTEM, callbacks, scope, threadCount);
+			std::printf("%-8s %-15s %8u %16.2f %11.2fx\n", scopeName, HOST_ALLOCATOR.name, threadCount, hostAllocator,
+			            system / hostAllocator);
+			std::printf("%-8s %-15s %8u %16.2f\n", scopeName, SYSTEM.name, threadCount, system);
+		}
+	}
+
+	allocator.LogStats("after the benchmark");
+	return 0;
+}
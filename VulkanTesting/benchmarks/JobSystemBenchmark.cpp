@@ -0,0 +1,311 @@
+﻿#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../utils/JobSystem.hpp"
+
+// Stress tests the job system first and exits with 1 if any of them fails. Then compares it against std::async and a
+// thread pool around one mutex protected queue: throughput with many tiny jobs, and the latency from submitting a job
+// to it starting, with submissions spaced out so the queues stay short.
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr uint32_t STRESS_ITERATIONS = 50;
+	constexpr uint32_t TINY_JOBS = 200000;
+	// std::async starts a thread per task with common implementations, more would only measure thread creation.
+	constexpr uint32_t ASYNC_JOBS = 2000;
+	constexpr uint32_t LATENCY_SAMPLES = 20000;
+	constexpr auto LATENCY_SPACING = std::chrono::microseconds(20);
+
+	// The simplest pool there is, what the job system has to beat to be worth it.
+	class MutexQueuePool {
+	private:
+		std::mutex mutex;
+		std::condition_variable wakeUp;
+		std::queue<std::function<void()>> jobs;
+		std::vector<std::thread> threads;
+		bool isStopping = false;
+
+	public:
+		explicit MutexQueuePool(const uint32_t threadCount) {
+			for (uint32_t i = 0; i < threadCount; i++) {
+				threads.emplace_back([this] {
+					while (true) {
+						std::function<void()> job;
+						{
+							std::unique_lock lock(mutex);
+							wakeUp.wait(lock, [this] { return isStopping || !jobs.empty(); });
+							if (jobs.empty()) return;
+							job = std::move(jobs.front());
+							jobs.pop();
+						}
+						job();
+					}
+				});
+			}
+		}
+
+		~MutexQueuePool() {
+			{
+				std::lock_guard lock(mutex);
+				isStopping = true;
+			}
+			wakeUp.notify_all();
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+		}
+
+		void Run(std::function<void()> job) {
+			{
+				std::lock_guard lock(mutex);
+				jobs.push(std::move(job));
+			}
+			wakeUp.notify_one();
+		}
+	};
+
+	// A few hundred nanoseconds of work that the compiler cannot drop.
+	void tinyWork(std::atomic<uint64_t>& sink) {
+		uint64_t value = 0x9e3779b97f4a7c15ull;
+		for (uint32_t i = 0; i < 64; i++) {
+			value ^= value << 13;
+			value ^= value >> 7;
+			value ^= value << 17;
+		}
+		sink.fetch_add(value & 1, std::memory_order_relaxed);
+	}
+
+	bool check(const bool condition, const char* name) {
+		if (!condition) std::printf("FAILED: %s\n", name);
+		return condition;
+	}
+
+	bool stressParallelFor(utils::JobSystem& jobSystem) {
+		constexpr uint32_t COUNT = 1000003;
+		std::vector<std::atomic<uint8_t>> hits(COUNT);
+		jobSystem.ParallelFor(COUNT, 97, [&hits](const uint32_t begin, const uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				hits[i].fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+		return check(std::all_of(hits.begin(), hits.end(), [](const std::atomic<uint8_t>& hit) { return hit.load() == 1; }),
+		             "ParallelFor covers every index exactly once");
+	}
+
+	void spawnTree(utils::JobSystem& jobSystem, utils::JobCounter& counter, std::atomic<uint32_t>& visited,
+	               const uint32_t depth) {
+		visited.fetch_add(1, std::memory_order_relaxed);
+		if (depth == 0) return;
+		for (uint32_t child = 0; child < 4; child++) {
+			jobSystem.Run([&jobSystem, &counter, &visited, depth] { spawnTree(jobSystem, counter, visited, depth - 1); },
+			              &counter);
+		}
+	}
+
+	bool stressNestedJobs(utils::JobSystem& jobSystem) {
+		// 1 + 4 + ... + 4^7 nodes, all spawned from inside other jobs.
+		constexpr uint32_t DEPTH = 7;
+		constexpr uint32_t EXPECTED = (1u << (2 * (DEPTH + 1))) / 3;
+
+		utils::JobCounter counter;
+		std::atomic<uint32_t> visited = 0;
+		jobSystem.Run([&] { spawnTree(jobSystem, counter, visited, DEPTH); }, &counter);
+		jobSystem.Wait(counter);
+		return check(visited.load() == EXPECTED, "Jobs spawned by jobs are all waited for");
+	}
+
+	bool stressDependencies(utils::JobSystem& jobSystem) {
+		constexpr uint32_t STAGES = 8;
+		constexpr uint32_t JOBS_PER_STAGE = 64;
+
+		// Every stage is held back until the whole stage before it finished, which each of its jobs checks.
+		std::vector<utils::JobCounter> counters(STAGES);
+		std::vector<std::atomic<uint32_t>> finished(STAGES);
+		std::atomic<bool> isOrdered = true;
+		std::atomic<uint64_t> sink = 0;
+
+		for (uint32_t stage = 0; stage < STAGES; stage++) {
+			for (uint32_t job = 0; job < JOBS_PER_STAGE; job++) {
+				const auto function = [&finished, &isOrdered, &sink, stage] {
+					if (stage > 0 && finished[stage - 1].load() != JOBS_PER_STAGE) isOrdered.store(false);
+					tinyWork(sink);
+					finished[stage].fetch_add(1);
+				};
+
+				if (stage == 0) {
+					jobSystem.Run(function, &counters[stage]);
+				} else {
+					jobSystem.RunAfter(counters[stage - 1], function, &counters[stage]);
+				}
+			}
+		}
+
+		jobSystem.Wait(counters.back());
+		return check(isOrdered.load() && finished.back().load() == JOBS_PER_STAGE, "Dependent jobs wait for their stage");
+	}
+
+	bool stressExceptions(utils::JobSystem& jobSystem) {
+		std::atomic<uint32_t> covered = 0;
+		bool isThrown = false;
+		try {
+			jobSystem.ParallelFor(10000, 10, [&covered](const uint32_t begin, const uint32_t end) {
+				covered.fetch_add(end - begin);
+				if (begin <= 5000 && 5000 < end) throw std::runtime_error("expected");
+			});
+		} catch (const std::runtime_error&) {
+			isThrown = true;
+		}
+		return check(isThrown && covered.load() == 10000, "Exceptions reach the waiting thread after the other jobs");
+	}
+
+	bool stressExternalThreads(utils::JobSystem& jobSystem) {
+		constexpr uint32_t THREADS = 4;
+		constexpr uint32_t COUNT = 100000;
+
+		// Threads that are not workers submit through the shared queue at the same time.
+		std::atomic<uint32_t> covered = 0;
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < THREADS; i++) {
+			threads.emplace_back([&jobSystem, &covered] {
+				jobSystem.ParallelFor(COUNT, 64, [&covered](const uint32_t begin, const uint32_t end) {
+					covered.fetch_add(end - begin);
+				});
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		return check(covered.load() == THREADS * COUNT, "Concurrent submitters each get their own jobs done");
+	}
+
+	double jobsPerSecond(const uint32_t jobCount, const Clock::time_point start) {
+		return jobCount / std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	struct Percentiles {
+		double p50;
+		double p99;
+		double p999;
+		double max;
+	};
+
+	// Submits sampleCount jobs with a sleep of LATENCY_SPACING between them, each writing how long after its submit it started.
+	template<typename Submit>
+	Percentiles measureLatency(const uint32_t sampleCount, const Submit& submit) {
+		std::vector<double> microseconds(sampleCount);
+		std::atomic<uint32_t> done = 0;
+
+		for (uint32_t i = 0; i < sampleCount; i++) {
+			const Clock::time_point submitted = Clock::now();
+			submit([&microseconds, &done, submitted, i] {
+				microseconds[i] = std::chrono::duration<double, std::micro>(Clock::now() - submitted).count();
+				done.fetch_add(1, std::memory_order_release);
+			});
+			std::this_thread::sleep_for(LATENCY_SPACING);
+		}
+		while (done.load(std::memory_order_acquire) != sampleCount) {
+			std::this_thread::yield();
+		}
+
+		std::sort(microseconds.begin(), microseconds.end());
+		const auto at = [&microseconds](const double fraction) {
+			return microseconds[std::min(static_cast<size_t>(fraction * microseconds.size()), microseconds.size() - 1)];
+		};
+		return {at(0.5), at(0.99), at(0.999), microseconds.back()};
+	}
+
+	void printLatency(const char* name, const Percentiles& percentiles) {
+		std::printf("%-24s %10.2f %10.2f %10.2f %10.2f\n", name, percentiles.p50, percentiles.p99, percentiles.p999,
+		            percentiles.max);
+	}
+}
+
+int main() {
+	// A single thread system only runs jobs inside Wait(), the latency test needs a worker to pick them up.
+	const uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 2u);
+	std::printf("%u threads\n\n", threadCount);
+
+	bool isPassing = true;
+	for (const bool pinThreads : {false, true}) {
+		utils::JobSystem jobSystem(threadCount, pinThreads);
+		for (uint32_t iteration = 0; iteration < STRESS_ITERATIONS && isPassing; iteration++) {
+			isPassing = stressParallelFor(jobSystem) && stressNestedJobs(jobSystem) && stressDependencies(jobSystem) &&
+			            stressExceptions(jobSystem) && stressExternalThreads(jobSystem);
+		}
+	}
+	if (!isPassing) return 1;
+	std::printf("stress tests passed, %u iterations unpinned and pinned\n\n", STRESS_ITERATIONS);
+
+	utils::JobSystem jobSystem(threadCount);
+	std::atomic<uint64_t> sink = 0;
+
+	std::printf("%-24s %10s %14s\n", "", "jobs", "jobs/s");
+	{
+		const Clock::time_point start = Clock::now();
+		utils::JobCounter counter;
+		for (uint32_t i = 0; i < TINY_JOBS; i++) {
+			jobSystem.Run([&sink] { tinyWork(sink); }, &counter);
+		}
+		jobSystem.Wait(counter);
+		std::printf("%-24s %10u %14.0f\n", "job system, submitted", TINY_JOBS, jobsPerSecond(TINY_JOBS, start));
+	}
+	{
+		const Clock::time_point start = Clock::now();
+		jobSystem.ParallelFor(TINY_JOBS, 1, [&sink](const uint32_t begin, const uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				tinyWork(sink);
+			}
+		});
+		std::printf("%-24s %10u %14.0f\n", "job system, ParallelFor", TINY_JOBS, jobsPerSecond(TINY_JOBS, start));
+	}
+	{
+		const Clock::time_point start = Clock::now();
+		{
+			MutexQueuePool pool(threadCount);
+			for (uint32_t i = 0; i < TINY_JOBS; i++) {
+				pool.Run([&sink] { tinyWork(sink); });
+			}
+		}
+		std::printf("%-24s %10u %14.0f\n", "mutex queue", TINY_JOBS, jobsPerSecond(TINY_JOBS, start));
+	}
+	{
+		const Clock::time_point start = Clock::now();
+		std::vector<std::future<void>> futures;
+		futures.reserve(ASYNC_JOBS);
+		for (uint32_t i = 0; i < ASYNC_JOBS; i++) {
+			futures.push_back(std::async(std::launch::async, [&sink] { tinyWork(sink); }));
+		}
+		for (std::future<void>& future : futures) {
+			future.get();
+		}
+		std::printf("%-24s %10u %14.0f\n", "std::async", ASYNC_JOBS, jobsPerSecond(ASYNC_JOBS, start));
+	}
+
+	std::printf("\n%-24s %10s %10s %10s %10s\n", "submit to start, us", "p50", "p99", "p99.9", "max");
+	printLatency("job system", measureLatency(LATENCY_SAMPLES, [&jobSystem](auto&& job) { jobSystem.Run(job); }));
+	{
+		MutexQueuePool pool(threadCount);
+		printLatency("mutex queue", measureLatency(LATENCY_SAMPLES, [&pool](auto&& job) { pool.Run(job); }));
+	}
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(ASYNC_JOBS);
+		printLatency("std::async", measureLatency(ASYNC_JOBS, [&futures](auto&& job) {
+			futures.push_back(std::async(std::launch::async, job));
+		}));
+	}
+
+	return 0;
+}
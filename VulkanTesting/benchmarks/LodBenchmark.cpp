@@ -0,0 +1,114 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include "../hello_triangle_app/mesh/LodChain.hpp"
+#include "../hello_triangle_app/mesh/LodSelection.hpp"
+#include "../hello_triangle_app/mesh/VertexCache.hpp"
+
+// LOD chain generation on a bumpy sphere: triangles, error and meshlets per LOD, generation time for a batch of
+// meshes on one thread and on all of them, then which LOD gets picked at growing distances and how much of it
+// survives meshlet culling, as triangles and as the draw calls the merged index ranges take.
+
+static mesh::MeshData makeSphere(const uint32_t rings, const uint32_t segments) {
+	constexpr float PI = 3.14159265f;
+	mesh::MeshData sphere;
+
+	// Poles are rings of their own so every vertex is distinct and only the longitude seam is locked.
+	for (uint32_t ring = 0; ring <= rings; ring++) {
+		const float theta = PI * static_cast<float>(ring) / static_cast<float>(rings);
+		for (uint32_t segment = 0; segment <= segments; segment++) {
+			const float phi = 2.0f * PI * static_cast<float>(segment) / static_cast<float>(segments);
+			const glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			const float bump = 1.0f + 0.02f * std::sin(theta * 24.0f) * std::sin(phi * 24.0f);
+
+			mesh::Vertex vertex{};
+			vertex.position = normal * bump;
+			vertex.normal = normal;
+			vertex.uv = glm::vec2(static_cast<float>(segment) / static_cast<float>(segments),
+			                      static_cast<float>(ring) / static_cast<float>(rings));
+			sphere.vertices.push_back(vertex);
+		}
+	}
+
+	// Counter clockwise seen from outside.
+	for (uint32_t ring = 0; ring < rings; ring++) {
+		for (uint32_t segment = 0; segment < segments; segment++) {
+			const uint32_t a = ring * (segments + 1) + segment;
+			const uint32_t b = a + 1;
+			const uint32_t c = a + segments + 1;
+			const uint32_t d = c + 1;
+			if (ring != 0) sphere.indices.insert(sphere.indices.end(), {a, b, c});
+			if (ring != rings - 1) sphere.indices.insert(sphere.indices.end(), {b, d, c});
+		}
+	}
+
+	mesh::optimizeVertexCache(sphere.indices, sphere.vertices.size());
+	sphere.boundingSphere = mesh::computeBoundingSphere(sphere.vertices);
+	return sphere;
+}
+
+static double secondsSince(const std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+	const mesh::MeshData sphere = makeSphere(512, 1024);
+
+	mesh::MeshData chain = sphere;
+	const auto chainStart = std::chrono::steady_clock::now();
+	mesh::generateLods(chain);
+	std::printf("one mesh of %zu triangles in %.1f ms\n", sphere.indices.size() / 3, secondsSince(chainStart) * 1000.0);
+
+	std::printf("%4s %12s %10s %12s %10s\n", "LOD", "triangles", "meshlets", "error", "ACMR");
+	for (size_t lod = 0; lod < chain.lods.size(); lod++) {
+		const mesh::Lod& range = chain.lods[lod];
+		const std::vector<uint32_t> indices(chain.indices.begin() + range.firstIndex,
+		                                    chain.indices.begin() + range.firstIndex + range.indexCount);
+		std::printf("%4zu %12u %10u %12.6f %10.3f\n", lod, range.indexCount / 3, range.meshletCount, range.error,
+		            mesh::computeAcmr(indices, chain.vertices.size()));
+	}
+
+	constexpr size_t BATCH_SIZE = 16;
+	std::printf("\n%8s %12s\n", "threads", "batch ms");
+	for (const uint32_t threadCount : {1u, std::max(std::thread::hardware_concurrency(), 1u)}) {
+		utils::JobSystem jobSystem(threadCount);
+		std::vector<mesh::MeshData> batch(BATCH_SIZE, makeSphere(128, 256));
+
+		const auto batchStart = std::chrono::steady_clock::now();
+		mesh::generateLods(batch, jobSystem);
+		std::printf("%8u %12.1f\n", threadCount, secondsSince(batchStart) * 1000.0);
+	}
+
+	// The front face is counter clockwise here, the projection flips y the way Vulkan expects.
+	constexpr float VIEWPORT_HEIGHT = 1080.0f;
+	glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 10000.0f);
+	projection[1][1] *= -1.0f;
+
+	std::printf("\n%10s %4s %22s %12s\n", "distance", "LOD", "triangles drawn", "draw calls");
+	for (const float distance : {2.0f, 5.0f, 20.0f, 100.0f, 500.0f, 2000.0f}) {
+		const glm::mat4 view = glm::lookAtRH(glm::vec3(0.0f, 0.0f, distance), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const mesh::LodView lodView = mesh::makeLodView(projection * view, VIEWPORT_HEIGHT, false);
+
+		const uint32_t lod = mesh::selectLod(chain.lods, chain.boundingSphere, lodView, 1.0f);
+
+		std::vector<mesh::IndexRange> draws;
+		mesh::cullMeshlets(chain.lods[lod], chain.meshlets, lodView, draws);
+		uint32_t drawnTriangles = 0;
+		for (const mesh::IndexRange& draw : draws) {
+			drawnTriangles += draw.indexCount / 3;
+		}
+
+		std::printf("%10.0f %4u %10u of %9u %12zu\n", distance, lod, drawnTriangles, chain.lods[lod].indexCount / 3,
+		            draws.size());
+	}
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+﻿#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "../hello_triangle_app/mesh/MeshLoader.hpp"
+
+// Load throughput of the mesh importer, with one thread and with all of them. Takes an .obj or .glb path, without
+// one it writes a 1024x1024 quad grid OBJ with its faces shuffled, so the cache optimizer has something to fix.
+
+static std::string writeGridObj() {
+	constexpr uint32_t GRID_SIZE = 1024;
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "mesh_load_benchmark_grid.obj";
+
+	std::ofstream file(path, std::ios::binary);
+	for (uint32_t y = 0; y <= GRID_SIZE; y++) {
+		for (uint32_t x = 0; x <= GRID_SIZE; x++) {
+			file << "v " << x * 0.01f << ' ' << y * 0.01f << ' ' << (x * y % 7) * 0.001f << '\n';
+			file << "vt " << static_cast<float>(x) / GRID_SIZE << ' ' << static_cast<float>(y) / GRID_SIZE << '\n';
+		}
+	}
+	file << "vn 0 0 1\n";
+
+	// A linear congruential walk over all quads visits each exactly once in scrambled order.
+	constexpr uint64_t QUAD_COUNT = static_cast<uint64_t>(GRID_SIZE) * GRID_SIZE;
+	uint64_t quad = 0;
+	for (uint64_t i = 0; i < QUAD_COUNT; i++) {
+		quad = (quad * 5 + 1) % QUAD_COUNT;
+
+		const uint64_t a = quad / GRID_SIZE * (GRID_SIZE + 1) + quad % GRID_SIZE + 1;
+		const uint64_t b = a + 1;
+		const uint64_t c = a + GRID_SIZE + 1;
+		const uint64_t d = c + 1;
+		file << "f " << a << '/' << a << "/1 " << b << '/' << b << "/1 " << d << '/' << d << "/1 " << c << '/' << c << "/1\n";
+	}
+
+	return path.string();
+}
+
+int main(const int argc, char** argv) {
+	const bool generated = argc < 2;
+	const std::string fileName = generated ? writeGridObj() : argv[1];
+
+	std::printf("%s\n", fileName.c_str());
+	std::printf("%8s %12s %12s %10s %10s %14s %14s %16s %8s %8s\n", "threads", "triangles", "vertices", "parse ms",
+	            "optim. ms", "parse MB/s", "total MB/s", "total tris/s", "ACMR in", "ACMR out");
+
+	for (const uint32_t threadCount : {1u, std::max(std::thread::hardware_concurrency(), 1u)}) {
+		utils::JobSystem jobSystem(threadCount);
+		mesh::LoadStats stats;
+		mesh::loadMesh(fileName, stats, jobSystem);
+
+		const double megabytes = static_cast<double>(stats.fileBytes) / (1024.0 * 1024.0);
+		const double totalSeconds = stats.parseSeconds + stats.optimizeSeconds;
+
+		std::printf("%8u %12zu %12zu %10.1f %10.1f %14.1f %14.1f %16.0f %8.3f %8.3f\n", threadCount, stats.triangleCount,
+		            stats.vertexCount, stats.parseSeconds * 1000.0, stats.optimizeSeconds * 1000.0,
+		            megabytes / stats.parseSeconds, megabytes / totalSeconds,
+		            static_cast<double>(stats.triangleCount) / totalSeconds, stats.acmrBefore, stats.acmrAfter);
+	}
+
+	if (generated) std::filesystem::remove(fileName);
+	return 0;
+}
@@ -0,0 +1,109 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../hello_triangle_app/capture/Qoi.hpp"
+#include "../utils/JobSystem.hpp"
+
+// How fast frame capture can encode a rendered 1080p frame: QOI on one core against copying the pixels unencoded,
+// the size it saves, and the frame rate a few encoder threads keep up with. Frames are BGRA like a swap chain's, with
+// flat clear color, smooth gradients and noisy textured areas.
+
+namespace
+{
+	constexpr uint32_t WIDTH = 1920;
+	constexpr uint32_t HEIGHT = 1080;
+	constexpr int REPETITIONS = 20;
+	constexpr uint32_t ENCODER_THREADS = 2;
+	constexpr uint32_t PARALLEL_FRAMES = 60;
+
+	std::vector<uint8_t> makeFrame() {
+		std::mt19937 random(7);
+		std::uniform_int_distribution<int> noise(-12, 12);
+
+		std::vector<uint8_t> pixels(static_cast<size_t>(WIDTH) * HEIGHT * 4);
+		for (uint32_t y = 0; y < HEIGHT; y++) {
+			for (uint32_t x = 0; x < WIDTH; x++) {
+				uint8_t* pixel = pixels.data() + (static_cast<size_t>(y) * WIDTH + x) * 4;
+				int r = 20, g = 24, b = 32; // Clear color
+
+				if (y < HEIGHT / 3) {
+					// Sky gradient
+					r = 90 + y * 100 / HEIGHT;
+					g = 140 + y * 80 / HEIGHT;
+					b = 220;
+				} else if (std::abs(static_cast<int>(x) - static_cast<int>(WIDTH / 2)) < static_cast<int>(y - HEIGHT / 3)) {
+					// Textured ground in a triangle, lit from the left.
+					const int shade = 60 + static_cast<int>(x * 120 / WIDTH);
+					r = shade + noise(random);
+					g = shade / 2 + 40 + noise(random);
+					b = shade / 3 + noise(random);
+				}
+
+				pixel[0] = static_cast<uint8_t>(std::clamp(b, 0, 255));
+				pixel[1] = static_cast<uint8_t>(std::clamp(g, 0, 255));
+				pixel[2] = static_cast<uint8_t>(std::clamp(r, 0, 255));
+				pixel[3] = 255;
+			}
+		}
+
+		return pixels;
+	}
+}
+
+int main() {
+	const std::vector<uint8_t> frame = makeFrame();
+	const size_t frameSize = frame.size();
+
+	std::vector<uint8_t> encoded = capture::encodeQoi(frame.data(), WIDTH, HEIGHT, WIDTH * 4, capture::PixelOrder::Bgra);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < REPETITIONS; i++) {
+		encoded = capture::encodeQoi(frame.data(), WIDTH, HEIGHT, WIDTH * 4, capture::PixelOrder::Bgra);
+	}
+	const double qoiMilliseconds =
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / REPETITIONS;
+
+	std::vector<uint8_t> copy(frameSize);
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < REPETITIONS; i++) {
+		memcpy(copy.data(), frame.data(), frameSize);
+	}
+	const double copyMilliseconds =
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / REPETITIONS;
+
+	// Lossless after the swizzle back to BGRA.
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> decoded = capture::decodeQoi(encoded, width, height);
+	for (size_t i = 0; i < decoded.size(); i += 4) {
+		std::swap(decoded[i], decoded[i + 2]);
+	}
+	const bool identical = width == WIDTH && height == HEIGHT && decoded == frame;
+
+	// Whole frames per job, the way the capture encoders take them.
+	utils::JobSystem encoders(ENCODER_THREADS + 1);
+	utils::JobCounter counter;
+	start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < PARALLEL_FRAMES; i++) {
+		encoders.Run([&frame] {
+			capture::encodeQoi(frame.data(), WIDTH, HEIGHT, WIDTH * 4, capture::PixelOrder::Bgra);
+		}, &counter);
+	}
+	encoders.Wait(counter);
+	const double parallelMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("%ux%u BGRA frame, %.1f MB raw\n", WIDTH, HEIGHT, frameSize / (1024.0 * 1024.0));
+	std::printf("%8s %12s %12s %10s\n", "output", "ms/frame", "MB", "ratio");
+	std::printf("%8s %12.3f %12.2f %10.2f\n", "raw", copyMilliseconds, frameSize / (1024.0 * 1024.0), 1.0);
+	std::printf("%8s %12.3f %12.2f %10.2f\n", "QOI", qoiMilliseconds, encoded.size() / (1024.0 * 1024.0),
+	            static_cast<double>(frameSize) / encoded.size());
+	std::printf("QOI on one core keeps up with %.0f fps, %u frames on %u encoders (plus the waiting thread): %.0f fps\n",
+	            1000.0 / qoiMilliseconds, PARALLEL_FRAMES, ENCODER_THREADS, PARALLEL_FRAMES * 1000.0 / parallelMilliseconds);
+	std::printf("round trip identical: %s\n", identical ? "yes" : "NO");
+	return identical ? 0 : 1;
+}
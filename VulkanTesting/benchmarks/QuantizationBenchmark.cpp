@@ -0,0 +1,73 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../hello_triangle_app/mesh/Quantization.hpp"
+
+// Vertices quantized per millisecond on a single core with the scalar and the SSE path, the memory saved and the
+// worst error each attribute picks up on the way.
+
+static double measureMilliseconds(const std::vector<mesh::Vertex>& vertices, std::vector<mesh::QuantizedVertex>& quantized,
+                                  const bool useSimd, const int repetitions) {
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < repetitions; i++) {
+		mesh::quantizeVertices(vertices, quantized, useSimd);
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / repetitions;
+}
+
+int main() {
+	constexpr size_t VERTEX_COUNT = 1'000'000;
+	constexpr int REPETITIONS = 20;
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(-8.0f, 8.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> uv(0.0f, 1.0f);
+
+	std::vector<mesh::Vertex> vertices(VERTEX_COUNT);
+	for (mesh::Vertex& vertex : vertices) {
+		vertex.position = glm::vec3(position(random), position(random), position(random));
+		vertex.normal = glm::normalize(glm::vec3(direction(random), direction(random), direction(random)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+		vertex.uv = glm::vec2(uv(random), uv(random));
+	}
+
+	std::vector<mesh::QuantizedVertex> scalar;
+	std::vector<mesh::QuantizedVertex> simd;
+	mesh::quantizeVertices(vertices, scalar, false);
+	mesh::quantizeVertices(vertices, simd, true);
+
+	const double scalarMilliseconds = measureMilliseconds(vertices, scalar, false, REPETITIONS);
+	const double simdMilliseconds = measureMilliseconds(vertices, simd, true, REPETITIONS);
+	const bool identical = memcmp(scalar.data(), simd.data(), scalar.size() * sizeof(mesh::QuantizedVertex)) == 0;
+
+	float positionError = 0.0f;
+	float normalError = 0.0f;
+	float uvError = 0.0f;
+	for (size_t i = 0; i < VERTEX_COUNT; i++) {
+		const mesh::QuantizedVertex& quantized = simd[i];
+		const glm::vec3 decodedPosition(mesh::halfToFloat(quantized.position.values[0]), mesh::halfToFloat(quantized.position.values[1]),
+		                                mesh::halfToFloat(quantized.position.values[2]));
+		const glm::vec2 decodedUv(quantized.uv.values[0] / 65535.0f, quantized.uv.values[1] / 65535.0f);
+
+		positionError = std::max(positionError, glm::length(decodedPosition - vertices[i].position));
+		normalError = std::max(normalError, glm::length(mesh::decodeOctahedral(quantized.normal) - vertices[i].normal));
+		uvError = std::max(uvError, glm::length(decodedUv - vertices[i].uv));
+	}
+
+	std::printf("%zu vertices, %zu -> %zu bytes per vertex (%.1f -> %.1f MB)\n", VERTEX_COUNT, sizeof(mesh::Vertex),
+	            sizeof(mesh::QuantizedVertex), VERTEX_COUNT * sizeof(mesh::Vertex) / (1024.0 * 1024.0),
+	            VERTEX_COUNT * sizeof(mesh::QuantizedVertex) / (1024.0 * 1024.0));
+	std::printf("%8s %12s %18s\n", "path", "ms", "vertices/ms/core");
+	std::printf("%8s %12.3f %18.0f\n", "scalar", scalarMilliseconds, VERTEX_COUNT / scalarMilliseconds);
+	std::printf("%8s %12.3f %18.0f\n", "SIMD", simdMilliseconds, VERTEX_COUNT / simdMilliseconds);
+	std::printf("paths identical: %s\n", identical ? "yes" : "NO");
+	std::printf("max error: position %g (positions within +-8), normal %g, uv %g\n", positionError, normalError, uvError);
+	return identical ? 0 : 1;
+}
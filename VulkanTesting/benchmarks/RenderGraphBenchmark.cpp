@@ -0,0 +1,184 @@
+﻿#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "../hello_triangle_app/render_graph/RenderGraph.hpp"
+
+// Barriers and transient memory of a deferred frame before and after the render graph compiles it: shadow map, depth
+// prepass, G-buffer, SSAO and fog in compute, compute lighting, a bloom chain, tone mapping and FXAA into the swap chain
+// image, plus a debug overlay nothing reads. Depth, normals and the shadow map are read by several passes in a row.
+// Only Compile() runs, which needs a device for the memory requirements but records nothing. It counts what the plan
+// holds, what the barriers cost on the GPU is not measured.
+
+namespace
+{
+	constexpr VkExtent2D EXTENT = {1920, 1080};
+	constexpr VkExtent2D SHADOW_EXTENT = {2048, 2048};
+
+	struct Device {
+		VkInstance instance = VK_NULL_HANDLE;
+		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+		VkDevice device = VK_NULL_HANDLE;
+	};
+
+	// Headless, the first GPU with a graphics queue.
+	bool createDevice(Device& result) {
+		VkApplicationInfo applicationInfo{};
+		applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		applicationInfo.pApplicationName = "RenderGraphBenchmark";
+		applicationInfo.apiVersion = VK_API_VERSION_1_0;
+
+		VkInstanceCreateInfo instanceInfo{};
+		instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceInfo.pApplicationInfo = &applicationInfo;
+		if (vkCreateInstance(&instanceInfo, nullptr, &result.instance) != VK_SUCCESS) return false;
+
+		uint32_t deviceCount = 0;
+		vkEnumeratePhysicalDevices(result.instance, &deviceCount, nullptr);
+		std::vector<VkPhysicalDevice> devices(deviceCount);
+		vkEnumeratePhysicalDevices(result.instance, &deviceCount, devices.data());
+
+		for (const VkPhysicalDevice candidate : devices) {
+			uint32_t familyCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+			std::vector<VkQueueFamilyProperties> families(familyCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+
+			const auto graphics = std::find_if(families.begin(), families.end(), [](const VkQueueFamilyProperties& family) {
+				return (family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+			});
+			if (graphics == families.end()) continue;
+
+			constexpr float QUEUE_PRIORITY = 1.0f;
+			VkDeviceQueueCreateInfo queueInfo{};
+			queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueInfo.queueFamilyIndex = static_cast<uint32_t>(graphics - families.begin());
+			queueInfo.queueCount = 1;
+			queueInfo.pQueuePriorities = &QUEUE_PRIORITY;
+
+			VkDeviceCreateInfo deviceInfo{};
+			deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+			deviceInfo.queueCreateInfoCount = 1;
+			deviceInfo.pQueueCreateInfos = &queueInfo;
+			if (vkCreateDevice(candidate, &deviceInfo, nullptr, &result.device) != VK_SUCCESS) return false;
+
+			result.physicalDevice = candidate;
+			return true;
+		}
+
+		return false;
+	}
+
+	VkExtent2D scaled(const VkExtent2D extent, const uint32_t divisor) {
+		return {std::max(extent.width / divisor, 1u), std::max(extent.height / divisor, 1u)};
+	}
+
+	void buildFrame(RenderGraph& graph) {
+		using Access = RenderGraph::Access;
+		const auto nothing = [](VkCommandBuffer) {};
+
+		const RenderGraph::ResourceId backBuffer = graph.ImportImage(
+			"back buffer", {VK_FORMAT_B8G8R8A8_SRGB, EXTENT}, VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, Access::Present);
+
+		const RenderGraph::ResourceId shadowMap = graph.CreateImage(
+			"shadow map", {VK_FORMAT_D32_SFLOAT, SHADOW_EXTENT, VK_IMAGE_ASPECT_DEPTH_BIT});
+		const RenderGraph::ResourceId depth = graph.CreateImage(
+			"depth", {VK_FORMAT_D32_SFLOAT, EXTENT, VK_IMAGE_ASPECT_DEPTH_BIT});
+		const RenderGraph::ResourceId albedo = graph.CreateImage("albedo", {VK_FORMAT_R8G8B8A8_UNORM, EXTENT});
+		const RenderGraph::ResourceId normals = graph.CreateImage("normals", {VK_FORMAT_R16G16B16A16_SFLOAT, EXTENT});
+		const RenderGraph::ResourceId ambientOcclusion = graph.CreateImage("ssao", {VK_FORMAT_R8G8B8A8_UNORM, EXTENT});
+		const RenderGraph::ResourceId fog = graph.CreateImage("fog", {VK_FORMAT_R16G16B16A16_SFLOAT, scaled(EXTENT, 2)});
+		const RenderGraph::ResourceId hdr = graph.CreateImage("hdr", {VK_FORMAT_R16G16B16A16_SFLOAT, EXTENT});
+		const RenderGraph::ResourceId bloomHalf = graph.CreateImage("bloom 1/2", {VK_FORMAT_R16G16B16A16_SFLOAT, scaled(EXTENT, 2)});
+		const RenderGraph::ResourceId bloomQuarter = graph.CreateImage("bloom 1/4", {VK_FORMAT_R16G16B16A16_SFLOAT, scaled(EXTENT, 4)});
+		const RenderGraph::ResourceId ldr = graph.CreateImage("ldr", {VK_FORMAT_R8G8B8A8_UNORM, EXTENT});
+		const RenderGraph::ResourceId overlay = graph.CreateImage("debug overlay", {VK_FORMAT_R8G8B8A8_UNORM, EXTENT});
+
+		const RenderGraph::PassId shadowPass = graph.AddPass("shadow", nothing);
+		graph.Write(shadowPass, shadowMap, Access::DepthAttachment);
+
+		const RenderGraph::PassId prepass = graph.AddPass("depth prepass", nothing);
+		graph.Write(prepass, depth, Access::DepthAttachment);
+
+		const RenderGraph::PassId gBufferPass = graph.AddPass("g-buffer", nothing);
+		graph.Read(gBufferPass, depth, Access::DepthAttachment);
+		graph.Write(gBufferPass, albedo, Access::ColorAttachment);
+		graph.Write(gBufferPass, normals, Access::ColorAttachment);
+
+		const RenderGraph::PassId ssaoPass = graph.AddPass("ssao", nothing);
+		graph.Read(ssaoPass, depth, Access::ComputeSampled);
+		graph.Read(ssaoPass, normals, Access::ComputeSampled);
+		graph.Write(ssaoPass, ambientOcclusion, Access::ComputeStorage);
+
+		const RenderGraph::PassId fogPass = graph.AddPass("fog", nothing);
+		graph.Read(fogPass, depth, Access::ComputeSampled);
+		graph.Read(fogPass, shadowMap, Access::ComputeSampled);
+		graph.Write(fogPass, fog, Access::ComputeStorage);
+
+		const RenderGraph::PassId lightingPass = graph.AddPass("lighting", nothing);
+		graph.Read(lightingPass, albedo, Access::ComputeSampled);
+		graph.Read(lightingPass, normals, Access::ComputeSampled);
+		graph.Read(lightingPass, depth, Access::ComputeSampled);
+		graph.Read(lightingPass, shadowMap, Access::ComputeSampled);
+		graph.Read(lightingPass, ambientOcclusion, Access::ComputeSampled);
+		graph.Read(lightingPass, fog, Access::ComputeSampled);
+		graph.Write(lightingPass, hdr, Access::ComputeStorage);
+
+		const RenderGraph::PassId bloomHalfPass = graph.AddPass("bloom 1/2", nothing);
+		graph.Read(bloomHalfPass, hdr, Access::ComputeSampled);
+		graph.Write(bloomHalfPass, bloomHalf, Access::ComputeStorage);
+
+		const RenderGraph::PassId bloomQuarterPass = graph.AddPass("bloom 1/4", nothing);
+		graph.Read(bloomQuarterPass, bloomHalf, Access::ComputeSampled);
+		graph.Write(bloomQuarterPass, bloomQuarter, Access::ComputeStorage);
+
+		const RenderGraph::PassId toneMapPass = graph.AddPass("tone map", nothing);
+		graph.Read(toneMapPass, hdr, Access::FragmentSampled);
+		graph.Read(toneMapPass, bloomHalf, Access::FragmentSampled);
+		graph.Read(toneMapPass, bloomQuarter, Access::FragmentSampled);
+		graph.Write(toneMapPass, ldr, Access::ColorAttachment);
+
+		const RenderGraph::PassId overlayPass = graph.AddPass("debug overlay", nothing);
+		graph.Write(overlayPass, overlay, Access::ColorAttachment);
+
+		const RenderGraph::PassId fxaaPass = graph.AddPass("fxaa", nothing);
+		graph.Read(fxaaPass, ldr, Access::FragmentSampled);
+		graph.Write(fxaaPass, backBuffer, Access::ColorAttachment);
+	}
+
+	double toMib(const VkDeviceSize bytes) {
+		return static_cast<double>(bytes) / (1024.0 * 1024.0);
+	}
+}
+
+int main() {
+	Device device;
+	if (!createDevice(device)) {
+		std::fprintf(stderr, "No Vulkan device with a graphics queue\n");
+		return 1;
+	}
+
+	{
+		// Without synchronization2 the planned barriers would be recorded with vkCmdPipelineBarrier, the plan is the same.
+		RenderGraph graph(device.physicalDevice, device.device, nullptr);
+		buildFrame(graph);
+		graph.Compile();
+
+		const RenderGraph::Stats& stats = graph.GetStats();
+		std::printf("Deferred frame at %ux%u, %ux%u shadow map\n", EXTENT.width, EXTENT.height, SHADOW_EXTENT.width,
+		            SHADOW_EXTENT.height);
+		std::printf("%-18s %10s %10s\n", "", "before", "after");
+		std::printf("%-18s %10u %10u\n", "passes", stats.declaredPassCount, stats.declaredPassCount - stats.culledPassCount);
+		std::printf("%-18s %10u %10u\n", "barriers", stats.naiveBarrierCount, stats.barrierCount);
+		std::printf("%-18s %10u %10u\n", "barrier calls", stats.naiveBarrierCallCount, stats.barrierCallCount);
+		std::printf("%-18s %9.1fM %9.1fM\n", "transient memory", toMib(stats.unaliasedTransientMemory),
+		            toMib(stats.transientMemory));
+	}
+
+	vkDestroyDevice(device.device, nullptr);
+	vkDestroyInstance(device.instance, nullptr);
+	return 0;
+}
@@ -0,0 +1,97 @@
+﻿#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "../hello_triangle_app/resolution/ResolutionController.hpp"
+
+// Simulated GPU whose frame time grows with the pixel count, through phases of normal load, a spike and a heavy
+// section, with timings arriving frames late like the profiler's. Compares frames over budget at native resolution
+// against the controller, and how much resolution the controller gives up for it.
+
+namespace
+{
+	constexpr double BUDGET = 12.0; // Milliseconds.
+	constexpr double FIXED_COST = 1.5; // Milliseconds that do not scale with resolution.
+	constexpr double PIXEL_COST = 9.0; // Milliseconds at native resolution and normal load.
+	constexpr uint32_t LATENCY_FRAMES = 3;
+
+	struct Phase {
+		const char* name;
+		uint32_t frameCount;
+		double load;
+	};
+
+	const std::vector<Phase> PHASES = {
+		{"normal", 300, 1.0},
+		{"spike", 120, 1.6},
+		{"normal", 200, 1.0},
+		{"heavy", 300, 2.4},
+		{"normal", 300, 1.0},
+	};
+
+	struct PhaseResult {
+		uint32_t overBudget = 0;
+		double totalScale = 0.0;
+		double worstMilliseconds = 0.0;
+	};
+
+	std::vector<PhaseResult> simulate(ResolutionController* controller) {
+		std::mt19937 random(7);
+		std::normal_distribution<double> noise(1.0, 0.04);
+
+		std::deque<double> pendingTimings;
+		std::vector<PhaseResult> results;
+
+		for (const Phase& phase : PHASES) {
+			PhaseResult& result = results.emplace_back();
+
+			for (uint32_t frame = 0; frame < phase.frameCount; frame++) {
+				float scale = 1.0f;
+				if (controller != nullptr) {
+					// The frame started LATENCY_FRAMES ago is the newest one with timings.
+					if (pendingTimings.size() > LATENCY_FRAMES) {
+						controller->Update(pendingTimings.front());
+						pendingTimings.pop_front();
+					}
+					scale = controller->GetScale();
+				}
+
+				const double milliseconds = (FIXED_COST + PIXEL_COST * phase.load * scale * scale) * noise(random);
+				pendingTimings.push_back(milliseconds);
+
+				result.overBudget += milliseconds > BUDGET ? 1 : 0;
+				result.totalScale += scale;
+				result.worstMilliseconds = std::max(result.worstMilliseconds, milliseconds);
+			}
+		}
+
+		return results;
+	}
+}
+
+int main() {
+	ResolutionController::Settings settings{};
+	settings.targetMilliseconds = BUDGET;
+	settings.minScale = 0.5f;
+	settings.latencyFrames = LATENCY_FRAMES;
+	ResolutionController controller(settings);
+
+	const std::vector<PhaseResult> native = simulate(nullptr);
+	const std::vector<PhaseResult> dynamic = simulate(&controller);
+
+	std::printf("%.1f ms budget, timings %u frames late\n\n", BUDGET, LATENCY_FRAMES);
+	std::printf("%-8s %6s %6s | %14s %10s | %14s %10s %10s\n", "phase", "frames", "load",
+	            "native over", "worst ms", "dynamic over", "worst ms", "avg scale");
+
+	for (size_t i = 0; i < PHASES.size(); i++) {
+		const Phase& phase = PHASES[i];
+		std::printf("%-8s %6u %6.1f | %14u %10.2f | %14u %10.2f %10.3f\n", phase.name, phase.frameCount, phase.load,
+		            native[i].overBudget, native[i].worstMilliseconds,
+		            dynamic[i].overBudget, dynamic[i].worstMilliseconds, dynamic[i].totalScale / phase.frameCount);
+	}
+
+	std::printf("\n%u scale changes\n", controller.GetStats().changeCount);
+	return 0;
+}
@@ -1,5 +1,10 @@
 ﻿#include "HelloTriangleApp.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
 #include <limits>
 #include <map>
@@ -8,6 +13,8 @@
 #include <vector>
 #include <bits/stl_algo.h>
 
+#include "mesh/LodChain.hpp"
+#include "mesh/MeshLoader.hpp"
 #include "../utils/IO.hpp"
 #include "../utils/log.hpp"
 
@@ -79,47 +86,119 @@ HelloTriangleApp::HelloTriangleApp() {
 	createSurface();
 	pickPhysicalDevice();
 	createLogicalDevice();
+	createCommandCapture();
 	createSwapChain();
 	createImageViews();
 	createRenderPass();
 	createGraphicsPipeline();
 	createFramebuffers();
 	createCommandPool();
-	createCommandBuffer();
+	loadMeshes();
+	createInstanceBuffer();
+	createComputePipeline();
+	createSceneObjects();
+	createRenderGraph();
+	createCommandBuffers();
+	createStaticCommandBuffers();
+	createProfiler();
+	createResolutionController();
+	createFrameCapture();
+	createTextureStreamer();
+	createTextureDescriptorSets();
+	createSyncObjects();
+	createTimelineSemaphores();
+
+	if (ENABLE_HOST_ALLOCATOR) {
+		hostAllocator.LogStats("after setup");
+	}
 }
 
 HelloTriangleApp::~HelloTriangleApp() {
-	vkDestroyCommandPool(device, commandPool, nullptr);
-
-	for (const auto& framebuffer : swapChainFramebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	// Run() left the device idle, so every copy still in a slot is complete.
+	if (frameCapture) {
+		frameCapture->Collect(frameNumber);
+		frameCapture.reset();
 	}
+	vkDestroyDescriptorPool(device, textureDescriptorPool, allocator);
+	texture::destroyPlaceholder(getGpuContext(), texturePlaceholder);
+	textureStreamer.reset();
 
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyRenderPass(device, renderPass, nullptr);
+	destroyTimelineSemaphores();
+	destroySyncObjects();
 
-	for (const auto& imageView : swapChainImageViews) {
-		vkDestroyImageView(device, imageView, nullptr);
-	}
+	queueOverlap.reset();
+	computeProfiler.reset();
+	gpuProfiler.reset();
+	deviceClock.reset();
+	renderGraph.reset();
+	gpuCuller.reset();
+	gpu::destroyBuffer(getGpuContext(), instanceBuffer);
+	mesh::destroyMesh(getGpuContext(), sceneMesh);
+
+	vkDestroyCommandPool(device, computeCommandPool, allocator);
+	vkDestroyCommandPool(device, commandPool, allocator);
+	cleanupSwapChain();
+
+	vkDestroyPipeline(device, graphicsPipeline, allocator);
+	vkDestroyPipelineLayout(device, pipelineLayout, allocator);
+	vkDestroyDescriptorSetLayout(device, textureSetLayout, allocator);
+	vkDestroyRenderPass(device, renderPass, allocator);
 
-	vkDestroySwapchainKHR(device, swapChain, nullptr);
-	vkDestroyDevice(device, nullptr);
+	vkDestroyDevice(device, allocator);
 
 	if (ENABLE_VALIDATION_LAYERS) {
-		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, allocator);
 	}
 
-	vkDestroySurfaceKHR(instance, surface, nullptr);
-	vkDestroyInstance(instance, nullptr);
+	vkDestroySurfaceKHR(instance, surface, allocator);
+	vkDestroyInstance(instance, allocator);
 	glfwDestroyWindow(windowHandle);
 	glfwTerminate();
+
+	// Whatever is still live now was leaked, by us or the driver.
+	if (ENABLE_HOST_ALLOCATOR) {
+		hostAllocator.LogStats("after shutdown");
+	}
 }
 
 void HelloTriangleApp::Run() {
 	while (!glfwWindowShouldClose(windowHandle)) {
 		glfwPollEvents();
+		drawFrame();
+
+		const auto now = std::chrono::steady_clock::now();
+		if (now - lastProfilerLog >= PROFILER_LOG_INTERVAL) {
+			// Printed as one write, logging line by line would hitch the frame this lands in.
+			std::string report;
+			const auto append = [&report](const std::string& line) {
+				if (!line.empty()) report += line + "\n";
+			};
+
+			append(gpuProfiler->ReportAverages());
+			if (computeProfiler) {
+				append(computeProfiler->ReportAverages());
+				append(queueOverlap->ReportAverages());
+			}
+			if (resolutionController) {
+				append(resolutionController->ReportStats());
+			}
+			if (frameCapture) {
+				append(frameCapture->ReportStats());
+			}
+			if (textureStreamer) {
+				append(textureStreamer->ReportStats());
+			}
+			append(reportCommandBufferStats());
+
+			if (!report.empty()) {
+				report.pop_back();
+				UTIL_REPORT(report);
+			}
+			lastProfilerLog = now;
+		}
 	}
+
+	vkDeviceWaitIdle(device);
 }
 
 void HelloTriangleApp::createWindow() {
@@ -133,6 +212,32 @@ void HelloTriangleApp::createWindow() {
 
 	glfwMakeContextCurrent(windowHandle);
 	glfwSwapInterval(1);
+
+	glfwSetWindowUserPointer(windowHandle, this);
+	glfwSetKeyCallback(windowHandle, keyCallback);
+}
+
+void HelloTriangleApp::keyCallback(GLFWwindow* window, const int key, int scancode, const int action, int mods) {
+	auto* app = static_cast<HelloTriangleApp*>(glfwGetWindowUserPointer(window));
+	if (action != GLFW_PRESS) return;
+
+	if (key == GLFW_KEY_F8 && !app->staticCommandBuffers.empty()) {
+		app->reuseCommandBuffers = !app->reuseCommandBuffers;
+		// Frames recorded in between may write draws the kept command buffers would put back.
+		app->invalidateStaticCommandBuffers();
+		UTIL_LOG(std::string(app->reuseCommandBuffers ? "Reusing" : "Recording") + " command buffers every frame");
+		return;
+	}
+
+	if (!app->frameCapture) return;
+
+	if (key == GLFW_KEY_F12) {
+		app->captureNextFrame = true;
+	} else if (key == GLFW_KEY_F11) {
+		app->captureContinuously = !app->captureContinuously;
+		UTIL_LOG(std::string(app->captureContinuously ? "Started" : "Stopped") + " capturing every frame to " +
+			app->CAPTURE_DIRECTORY);
+	}
 }
 
 std::vector<const char*> HelloTriangleApp::getRequiredExtensions() const {
@@ -223,7 +328,8 @@ VkApplicationInfo HelloTriangleApp::createApplicationInfo() const {
 	applicationInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	applicationInfo.pEngineName = "No Engine";
 	applicationInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	applicationInfo.apiVersion = VK_MAKE_VERSION(1, 0, 0);
+	// Highest version we know how to use, devices reporting less are still accepted and limited to their own version.
+	applicationInfo.apiVersion = VK_API_VERSION_1_3;
 	return applicationInfo;
 }
 
@@ -255,7 +361,7 @@ void HelloTriangleApp::createVKInstance() {
 		createInfo.pNext = nullptr;
 	}
 
-	const auto vkCreateResult = vkCreateInstance(&createInfo, nullptr, &instance);
+	const auto vkCreateResult = vkCreateInstance(&createInfo, allocator, &instance);
 
 	if (vkCreateResult != VK_SUCCESS) {
 		UTIL_THROW("Failed to create Vulkan instance!");
@@ -276,13 +382,13 @@ void HelloTriangleApp::createDebugMessenger() {
 	VkDebugUtilsMessengerCreateInfoEXT createInfo{};
 	populateDebugMessengerCreateInfo(&createInfo);
 
-	if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+	if (CreateDebugUtilsMessengerEXT(instance, &createInfo, allocator, &debugMessenger) != VK_SUCCESS) {
 		UTIL_THROW("Failed to create debug messenger!");
 	}
 }
 
 void HelloTriangleApp::createSurface() {
-	const VkResult result = glfwCreateWindowSurface(instance, windowHandle, nullptr, &surface);
+	const VkResult result = glfwCreateWindowSurface(instance, windowHandle, allocator, &surface);
 	if (result != VK_SUCCESS) {
 		UTIL_THROW("Failed to create window surface!");
 	}
@@ -333,6 +439,15 @@ HelloTriangleApp::QueueFamilyIndices HelloTriangleApp::findQueueFamilies(const V
 		i++;
 	}
 
+	// Dedicated compute families are usually backed by the hardware's async compute engines.
+	for (uint32_t family = 0; family < queueFamilyCount; family++) {
+		const VkQueueFlags flags = queueFamilies[family].queueFlags;
+		if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+			indices.computeFamily = family;
+			break;
+		}
+	}
+
 	return indices;
 }
 
@@ -387,6 +502,112 @@ int32_t HelloTriangleApp::rateDeviceSuitability(const VkPhysicalDevice device) {
 	return score;
 }
 
+bool HelloTriangleApp::hasDeviceExtension(const VkPhysicalDevice device, const char* extensionName) const {
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	return std::any_of(availableExtensions.begin(), availableExtensions.end(), [extensionName](const VkExtensionProperties& extension) {
+		return strcmp(extension.extensionName, extensionName) == 0;
+	});
+}
+
+HelloTriangleApp::OptionalFeatures HelloTriangleApp::queryOptionalFeatures(const VkPhysicalDevice device) const {
+	OptionalFeatures features;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+	// The extensions used here depend on create_renderpass2 and depth_stencil_resolve, which are only core from 1.2 onwards.
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+		return features;
+	}
+
+	// Both structures were promoted to 1.3 unchanged, so the same query works for the core and the extension path.
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+	synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+	dynamicRenderingFeatures.pNext = &synchronization2Features;
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.pNext = &dynamicRenderingFeatures;
+
+	VkPhysicalDeviceFeatures2 deviceFeatures{};
+	deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	deviceFeatures.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(device, &deviceFeatures);
+
+	const auto getSupport = [&](const VkBool32 supported, const uint32_t coreVersion, const char* extensionName) {
+		if (!supported) return FeatureSupport::Unsupported;
+		if (deviceProperties.apiVersion >= coreVersion) return FeatureSupport::Core;
+		return hasDeviceExtension(device, extensionName) ? FeatureSupport::Extension : FeatureSupport::Unsupported;
+	};
+
+	features.dynamicRendering = getSupport(dynamicRenderingFeatures.dynamicRendering, VK_API_VERSION_1_3, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+	features.synchronization2 = getSupport(synchronization2Features.synchronization2, VK_API_VERSION_1_3, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+
+	// Optional even in 1.2, where the extension has no feature bit of its own.
+	if (vulkan12Features.drawIndirectCount) {
+		features.drawIndirectCount = FeatureSupport::Core;
+	} else if (hasDeviceExtension(device, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+		features.drawIndirectCount = FeatureSupport::Extension;
+	}
+
+	// VK_KHR_timeline_semaphore is core since 1.2, which is already the minimum here.
+	if (vulkan12Features.timelineSemaphore) {
+		features.timelineSemaphore = FeatureSupport::Core;
+	}
+
+	// Queue timestamps are comparable with the device domain only, a device without it gains nothing from the extension.
+	if (hasDeviceExtension(device, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+		const auto getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+			vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+
+		uint32_t domainCount = 0;
+		if (getTimeDomains != nullptr && getTimeDomains(device, &domainCount, nullptr) == VK_SUCCESS) {
+			std::vector<VkTimeDomainEXT> domains(domainCount);
+			getTimeDomains(device, &domainCount, domains.data());
+
+			if (std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end()) {
+				features.calibratedTimestamps = FeatureSupport::Extension;
+			}
+		}
+	}
+
+	if (hasDeviceExtension(device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+		features.memoryBudget = FeatureSupport::Extension;
+	}
+
+	return features;
+}
+
+bool HelloTriangleApp::useDynamicRendering() const {
+	return optionalFeatures.dynamicRendering != FeatureSupport::Unsupported;
+}
+
+bool HelloTriangleApp::useAsyncCompute() const {
+	return asyncComputeFamily.has_value();
+}
+
+bool HelloTriangleApp::useDynamicResolution() const {
+	return ENABLE_DYNAMIC_RESOLUTION && useDynamicRendering() && swapChainBlittable;
+}
+
+bool HelloTriangleApp::useFrameCapture() const {
+	return ENABLE_FRAME_CAPTURE && useDynamicRendering() && swapChainReadable &&
+		FrameCapture::IsFormatSupported(swapChainImageFormat);
+}
+
+std::vector<uint32_t> HelloTriangleApp::getSharedQueueFamilies() {
+	if (!useAsyncCompute()) return {};
+	return {findQueueFamilies(physicalDevice).graphicsFamily.value(), asyncComputeFamily.value()};
+}
+
 VkSurfaceFormatKHR HelloTriangleApp::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
 	for (const auto& availableFormat : availableFormats) {
 		if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
@@ -457,6 +678,14 @@ void HelloTriangleApp::pickPhysicalDevice() {
 
 void HelloTriangleApp::createLogicalDevice() {
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	optionalFeatures = queryOptionalFeatures(physicalDevice);
+
+	// Culling is the only compute work so far, it needs the render graph (dynamic rendering) and indirect count draws.
+	const bool cullsOnGpu = optionalFeatures.dynamicRendering != FeatureSupport::Unsupported &&
+		optionalFeatures.drawIndirectCount != FeatureSupport::Unsupported;
+	if (cullsOnGpu && indices.computeFamily.has_value() && optionalFeatures.timelineSemaphore != FeatureSupport::Unsupported) {
+		asyncComputeFamily = indices.computeFamily;
+	}
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<uint32_t> uniqueQueueFamilies = {
@@ -464,6 +693,10 @@ void HelloTriangleApp::createLogicalDevice() {
 		indices.presentFamily.value()
 	};
 
+	if (useAsyncCompute()) {
+		uniqueQueueFamilies.insert(asyncComputeFamily.value());
+	}
+
 	queueCreateInfos.reserve(uniqueQueueFamilies.size());
 
 	float queuePriority = 1.0f;
@@ -479,13 +712,61 @@ void HelloTriangleApp::createLogicalDevice() {
 
 	VkPhysicalDeviceFeatures deviceFeatures{};
 
+	std::vector<const char*> deviceExtensions = DEVICE_EXTENSIONS;
+	void* featureChain = nullptr;
+
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+	dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+	if (optionalFeatures.dynamicRendering != FeatureSupport::Unsupported) {
+		dynamicRenderingFeatures.pNext = featureChain;
+		featureChain = &dynamicRenderingFeatures;
+	}
+	if (optionalFeatures.dynamicRendering == FeatureSupport::Extension) {
+		deviceExtensions.emplace_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+	}
+
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+	synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+	synchronization2Features.synchronization2 = VK_TRUE;
+
+	if (optionalFeatures.synchronization2 != FeatureSupport::Unsupported) {
+		synchronization2Features.pNext = featureChain;
+		featureChain = &synchronization2Features;
+	}
+	if (optionalFeatures.synchronization2 == FeatureSupport::Extension) {
+		deviceExtensions.emplace_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+	}
+
+	// Everything promoted in 1.2 is enabled through this one structure.
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.drawIndirectCount = optionalFeatures.drawIndirectCount == FeatureSupport::Core;
+	vulkan12Features.timelineSemaphore = useAsyncCompute();
+
+	if (vulkan12Features.drawIndirectCount || vulkan12Features.timelineSemaphore) {
+		vulkan12Features.pNext = featureChain;
+		featureChain = &vulkan12Features;
+	}
+	if (optionalFeatures.drawIndirectCount == FeatureSupport::Extension) {
+		deviceExtensions.emplace_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
+	if (optionalFeatures.calibratedTimestamps == FeatureSupport::Extension) {
+		deviceExtensions.emplace_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+	}
+	if (optionalFeatures.memoryBudget == FeatureSupport::Extension) {
+		deviceExtensions.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = featureChain;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(DEVICE_EXTENSIONS.size());
-	createInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
 	if (ENABLE_VALIDATION_LAYERS) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
@@ -494,13 +775,66 @@ void HelloTriangleApp::createLogicalDevice() {
 		createInfo.enabledLayerCount = 0;
 	}
 
-	const VkResult result = vkCreateDevice(physicalDevice, &createInfo, nullptr, &device);
+	const VkResult result = vkCreateDevice(physicalDevice, &createInfo, allocator, &device);
 	if (result != VK_SUCCESS) {
 		UTIL_THROW("Failed to create logical device!");
 	}
 
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+	if (useAsyncCompute()) {
+		vkGetDeviceQueue(device, asyncComputeFamily.value(), 0, &computeQueue);
+
+		waitTimelineSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphores"));
+		if (waitTimelineSemaphores == nullptr) {
+			UTIL_THROW("Failed to load timeline semaphore functions!");
+		}
+	}
+
+	if (optionalFeatures.dynamicRendering == FeatureSupport::Core) {
+		cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdBeginRendering"));
+		cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdEndRendering"));
+	} else if (optionalFeatures.dynamicRendering == FeatureSupport::Extension) {
+		cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR"));
+		cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR"));
+	}
+
+	if (useDynamicRendering() && (cmdBeginRendering == nullptr || cmdEndRendering == nullptr)) {
+		UTIL_THROW("Failed to load dynamic rendering functions!");
+	}
+
+	if (optionalFeatures.synchronization2 == FeatureSupport::Core) {
+		cmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2"));
+	} else if (optionalFeatures.synchronization2 == FeatureSupport::Extension) {
+		cmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR"));
+	}
+
+	if (optionalFeatures.drawIndirectCount == FeatureSupport::Core) {
+		cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCount"));
+	} else if (optionalFeatures.drawIndirectCount == FeatureSupport::Extension) {
+		cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+	}
+
+	if (optionalFeatures.calibratedTimestamps == FeatureSupport::Extension) {
+		getCalibratedTimestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT"));
+	}
+
+	UTIL_LOG(std::string("Rendering path: ") + (useDynamicRendering() ? "dynamic rendering" : "render pass") +
+		(cmdPipelineBarrier2 != nullptr ? ", synchronization2" : "") +
+		(cmdDrawIndexedIndirectCount != nullptr ? ", indirect count" : "") +
+		(getCalibratedTimestamps != nullptr ? ", calibrated timestamps" : "") +
+		(useAsyncCompute() ? ", async compute on queue family " + std::to_string(asyncComputeFamily.value()) : std::string()));
+}
+
+void HelloTriangleApp::createCommandCapture() {
+	if (COMMAND_CAPTURE_FRAMES == 0) return;
+
+	// Before anything is uploaded, the capture has to see every buffer's contents.
+	const std::string directory = std::string(BINARY_DIR) + "/" + CAPTURE_DIRECTORY;
+	std::filesystem::create_directories(directory);
+	commandCapture = std::make_unique<replay::CommandStreamWriter>(directory + "/" + COMMAND_CAPTURE_FILE,
+	                                                               MAX_FRAMES_IN_FLIGHT, COMMAND_CAPTURE_FRAMES);
 }
 
 void HelloTriangleApp::createSwapChain() {
@@ -544,6 +878,25 @@ void HelloTriangleApp::createSwapChain() {
 	//In that case you may use a value like VK_IMAGE_USAGE_TRANSFER_DST_BIT instead and use a memory operation to transfer the rendered image to a swap chain image.
 	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+	// Dynamic resolution blits its offscreen target into the images, with a linear filter.
+	constexpr VkFormatFeatureFlags BLIT_FEATURES =
+		VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, surfaceFormat.format, &formatProperties);
+
+	swapChainBlittable = (swapChainSupportDetails.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+		(formatProperties.optimalTilingFeatures & BLIT_FEATURES) == BLIT_FEATURES;
+	if (swapChainBlittable) {
+		createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+
+	// Frame capture copies out of the images.
+	swapChainReadable = ENABLE_FRAME_CAPTURE &&
+		(swapChainSupportDetails.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+	if (swapChainReadable) {
+		createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 	const uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
 
@@ -558,7 +911,7 @@ void HelloTriangleApp::createSwapChain() {
 		createInfo.pQueueFamilyIndices = nullptr; // Optional
 	}
 
-	const VkResult result = vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain);
+	const VkResult result = vkCreateSwapchainKHR(device, &createInfo, allocator, &swapChain);
 	if (result != VK_SUCCESS) {
 		UTIL_THROW("Failed to create swap chain!");
 	}
@@ -569,6 +922,7 @@ void HelloTriangleApp::createSwapChain() {
 
 	swapChainImageFormat = surfaceFormat.format;
 	swapChainExtent = extent;
+	renderExtent = extent;
 }
 
 void HelloTriangleApp::createImageViews() {
@@ -595,14 +949,57 @@ void HelloTriangleApp::createImageViews() {
 		createInfo.subresourceRange.baseArrayLayer = 0;
 		createInfo.subresourceRange.layerCount = 1;
 
-		const VkResult result = vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]);
+		const VkResult result = vkCreateImageView(device, &createInfo, allocator, &swapChainImageViews[i]);
 		if (result != VK_SUCCESS) {
 			UTIL_THROW("Failed to create image view for swapChainImage " + std::to_string(i) + " !");
 		}
 	}
 }
 
+void HelloTriangleApp::cleanupSwapChain() {
+	for (const auto& framebuffer : swapChainFramebuffers) {
+		vkDestroyFramebuffer(device, framebuffer, allocator);
+	}
+	swapChainFramebuffers.clear();
+
+	for (const auto& imageView : swapChainImageViews) {
+		vkDestroyImageView(device, imageView, allocator);
+	}
+	swapChainImageViews.clear();
+
+	vkDestroySwapchainKHR(device, swapChain, allocator);
+}
+
+void HelloTriangleApp::recreateSwapChain() {
+	int32_t width = 0;
+	int32_t height = 0;
+	glfwGetFramebufferSize(windowHandle, &width, &height);
+
+	// Minimized, nothing to present to until the window comes back.
+	while (width == 0 || height == 0) {
+		glfwGetFramebufferSize(windowHandle, &width, &height);
+		glfwWaitEvents();
+	}
+
+	vkDeviceWaitIdle(device);
+
+	// The per image semaphores have to follow the image count, which may change.
+	destroySyncObjects();
+	cleanupSwapChain();
+
+	createSwapChain();
+	createImageViews();
+
+	// With dynamic rendering the image views are all there is to rebuild, plus the graph's transients at the new extent.
+	createFramebuffers();
+	createRenderGraph();
+	createSyncObjects();
+	createStaticCommandBuffers();
+}
+
 void HelloTriangleApp::createRenderPass() {
+	if (useDynamicRendering()) return;
+
 	VkAttachmentDescription colorAttachment{};
 	colorAttachment.format = swapChainImageFormat;
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -622,14 +1019,25 @@ void HelloTriangleApp::createRenderPass() {
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &colorAttachmentRef;
 
+	// Wait for the acquired image before the implicit layout transition writes to it.
+	VkSubpassDependency dependency{};
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.srcAccessMask = 0;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
 	VkRenderPassCreateInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 	renderPassInfo.attachmentCount = 1;
 	renderPassInfo.pAttachments = &colorAttachment;
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 1;
+	renderPassInfo.pDependencies = &dependency;
 
-	const VkResult result = vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+	const VkResult result = vkCreateRenderPass(device, &renderPassInfo, allocator, &renderPass);
 
 	if (result != VK_SUCCESS) {
 		UTIL_THROW("Failed to create render pass!");
@@ -644,7 +1052,7 @@ VkShaderModule HelloTriangleApp::createShaderModule(const std::vector<char>& cod
 
 	VkShaderModule shaderModule;
 
-	const VkResult result = vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule);
+	const VkResult result = vkCreateShaderModule(device, &createInfo, allocator, &shaderModule);
 	if (result != VK_SUCCESS) {
 		UTIL_THROW("Failed to create shader module for shader with name: " + shaderName);
 	}
@@ -653,8 +1061,8 @@ VkShaderModule HelloTriangleApp::createShaderModule(const std::vector<char>& cod
 }
 
 void HelloTriangleApp::createGraphicsPipeline() {
-	const std::vector<char> vertShaderCode = utils::io::readToBytes(utils::io::path + "shaders/shader.vert");
-	const std::vector<char> fragShaderCode = utils::io::readToBytes(utils::io::path + "shaders/shader.frag");
+	const std::vector<char> vertShaderCode = utils::io::readToBytes(utils::io::shaderPath + "shader.vert");
+	const std::vector<char> fragShaderCode = utils::io::readToBytes(utils::io::shaderPath + "shader.frag");
 
 	const VkShaderModule vertShaderModule = createShaderModule(vertShaderCode, "shader");
 	const VkShaderModule fragShaderModule = createShaderModule(fragShaderCode, "fragment");
@@ -675,8 +1083,21 @@ void HelloTriangleApp::createGraphicsPipeline() {
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
+	constexpr std::array bindingDescriptions = {
+		mesh::makeBindingDescription<mesh::QuantizedVertex>(0),
+		mesh::makeBindingDescription<Scene::Instance>(1, VK_VERTEX_INPUT_RATE_INSTANCE),
+	};
+	constexpr auto vertexAttributes = mesh::makeAttributeDescriptions<mesh::QuantizedVertex>(0);
+	constexpr auto instanceAttributes = mesh::makeAttributeDescriptions<Scene::Instance>(1, vertexAttributes.size());
+
+	std::array<VkVertexInputAttributeDescription, vertexAttributes.size() + instanceAttributes.size()> attributeDescriptions{};
+	std::copy(vertexAttributes.begin(), vertexAttributes.end(), attributeDescriptions.begin());
+	std::copy(instanceAttributes.begin(), instanceAttributes.end(), attributeDescriptions.begin() + vertexAttributes.size());
+
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -695,7 +1116,7 @@ void HelloTriangleApp::createGraphicsPipeline() {
 	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
 	rasterizer.lineWidth = 1.0f;
 	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizer.frontFace = FRONT_FACE;
 	rasterizer.depthBiasEnable = VK_FALSE;
 
 	VkPipelineMultisampleStateCreateInfo multisampling{};
@@ -723,16 +1144,49 @@ void HelloTriangleApp::createGraphicsPipeline() {
 	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
 	dynamicState.pDynamicStates = dynamicStates.data();
 
+	// The view projection matrix.
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(glm::mat4);
+
+	// The streamed texture, see createTextureDescriptorSets().
+	VkDescriptorSetLayoutBinding textureBinding{};
+	textureBinding.binding = 0;
+	textureBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	textureBinding.descriptorCount = 1;
+	textureBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo textureSetLayoutInfo{};
+	textureSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	textureSetLayoutInfo.bindingCount = 1;
+	textureSetLayoutInfo.pBindings = &textureBinding;
+
+	if (vkCreateDescriptorSetLayout(device, &textureSetLayoutInfo, allocator, &textureSetLayout) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create texture descriptor set layout!");
+	}
+
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &textureSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
-	const VkResult pipelineLayoutResult = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout);
+	const VkResult pipelineLayoutResult = vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipelineLayout);
 	if (pipelineLayoutResult != VK_SUCCESS) {
 		UTIL_THROW("Failed to create pipeline layout!");
 	}
 
+	// Without a render pass the attachment formats are given to the pipeline directly.
+	VkPipelineRenderingCreateInfoKHR renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &swapChainImageFormat;
+
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = useDynamicRendering() ? &renderingInfo : nullptr;
 	pipelineInfo.stageCount = 2;
 	pipelineInfo.pStages = shaderStages;
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -747,16 +1201,94 @@ void HelloTriangleApp::createGraphicsPipeline() {
 	pipelineInfo.renderPass = renderPass;
 	pipelineInfo.subpass = 0;
 
-	const VkResult pipelinesResult = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline);
+	const VkResult pipelinesResult = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, allocator, &graphicsPipeline);
 	if (pipelinesResult != VK_SUCCESS) {
 		UTIL_THROW("Failed to create graphics pipeline!");
 	}
 
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
-	vkDestroyShaderModule(device, vertShaderModule, nullptr);
+	vkDestroyShaderModule(device, fragShaderModule, allocator);
+	vkDestroyShaderModule(device, vertShaderModule, allocator);
+
+	if (commandCapture) {
+		replay::PipelineDesc desc;
+		desc.vertexShader = vertShaderCode;
+		desc.fragmentShader = fragShaderCode;
+		desc.colorFormat = swapChainImageFormat;
+		desc.topology = inputAssembly.topology;
+		desc.cullMode = rasterizer.cullMode;
+		desc.frontFace = rasterizer.frontFace;
+		desc.pushConstantStages = pushConstantRange.stageFlags;
+		desc.pushConstantSize = pushConstantRange.size;
+		desc.textureStages = textureBinding.stageFlags;
+		desc.bindings.assign(bindingDescriptions.begin(), bindingDescriptions.end());
+		desc.attributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+		commandCapture->AddPipeline(graphicsPipeline, desc);
+	}
+
+	invalidateStaticCommandBuffers();
+}
+
+void HelloTriangleApp::createComputePipeline() {
+	// Culling and drawing are ordered by the render graph, which only exists alongside dynamic rendering.
+	if (!useDynamicRendering() || cmdDrawIndexedIndirectCount == nullptr) return;
+
+	const std::vector<char> cullShaderCode = utils::io::readToBytes(utils::io::shaderPath + "cull.comp");
+	const VkShaderModule cullShaderModule = createShaderModule(cullShaderCode, "cull");
+
+	gpuCuller = std::make_unique<GpuCuller>(getGpuContext(), cullShaderModule, MAX_CULLED_OBJECTS, instanceBuffer.buffer,
+	                                        MAX_FRAMES_IN_FLIGHT, getSharedQueueFamilies());
+
+	vkDestroyShaderModule(device, cullShaderModule, allocator);
+}
+
+void HelloTriangleApp::createInstanceBuffer() {
+	instanceBuffer = gpu::createBuffer(getGpuContext(), MAX_FRAMES_IN_FLIGHT * MAX_SCENE_NODES * sizeof(Scene::Instance),
+	                                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+	                                   getSharedQueueFamilies());
+}
+
+void HelloTriangleApp::createSceneObjects() {
+	constexpr uint32_t ORBIT_COUNT = 3;
+	constexpr float ORBIT_RADIUS = 0.75f;
+	constexpr float ORBIT_SCALE = 0.25f;
+
+	sceneRoot = scene.CreateNode({}, {}, 0, sceneMesh.boundingSphere);
+	for (uint32_t i = 0; i < ORBIT_COUNT; i++) {
+		const float angle = 6.2831853f * static_cast<float>(i) / ORBIT_COUNT;
+
+		Scene::Transform transform;
+		transform.position = glm::vec3(std::cos(angle), std::sin(angle), 0.0f) * ORBIT_RADIUS;
+		transform.scale = glm::vec3(ORBIT_SCALE);
+		scene.CreateNode(transform, sceneRoot, 0, sceneMesh.boundingSphere);
+	}
+
+	if (scene.GetNodeCount() > MAX_SCENE_NODES) {
+		UTIL_THROW("The scene has " + std::to_string(scene.GetNodeCount()) + " nodes, the instance buffer holds " +
+			std::to_string(MAX_SCENE_NODES));
+	}
+	sceneStart = std::chrono::steady_clock::now();
+	invalidateStaticCommandBuffers();
+
+	if (gpuCuller) {
+		// One object per instance, LOD selection rewrites the draws of those that change every frame.
+		const std::vector<uint32_t>& meshes = scene.GetMeshes();
+		std::vector<VkDrawIndexedIndirectCommand> draws(meshes.size(), VkDrawIndexedIndirectCommand{});
+		for (uint32_t instance = 0; instance < meshes.size(); instance++) {
+			if (meshes[instance] == Scene::NO_MESH) continue;
+			draws[instance] = {sceneMesh.lods[0].indexCount, 1, sceneMesh.lods[0].firstIndex, 0, instance};
+		}
+		gpuCuller->SetObjects(draws);
+	} else {
+		const CpuCuller::Simd simd = cpuCuller.GetSimd();
+		UTIL_LOG(std::string("Culling on the CPU with ") +
+			(simd == CpuCuller::Simd::Avx2 ? "AVX2" : simd == CpuCuller::Simd::Sse ? "SSE" : "scalar") + " code.");
+	}
 }
 
 void HelloTriangleApp::createFramebuffers() {
+	if (useDynamicRendering()) return;
+
 	swapChainFramebuffers.resize(swapChainImageViews.size());
 
 	for (size_t i = 0; i < swapChainImageViews.size(); i++) {
@@ -773,7 +1305,7 @@ void HelloTriangleApp::createFramebuffers() {
 		framebufferInfo.height = swapChainExtent.height;
 		framebufferInfo.layers = 1;
 
-		const VkResult result = vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]);
+		const VkResult result = vkCreateFramebuffer(device, &framebufferInfo, allocator, &swapChainFramebuffers[i]);
 
 		if (result != VK_SUCCESS) {
 			UTIL_THROW("Failed to create framebuffer!");
@@ -781,6 +1313,140 @@ void HelloTriangleApp::createFramebuffers() {
 	}
 }
 
+void HelloTriangleApp::createRenderGraph() {
+	if (!useDynamicRendering()) return;
+
+	renderGraph = std::make_unique<RenderGraph>(physicalDevice, device, cmdPipelineBarrier2, allocator);
+
+	// Culling moves to the compute queue, the graph transfers its outputs over to the draw.
+	const RenderGraph::Queue cullQueue = useAsyncCompute() ? RenderGraph::Queue::AsyncCompute : RenderGraph::Queue::Graphics;
+	if (useAsyncCompute()) {
+		renderGraph->SetQueueFamilies(findQueueFamilies(physicalDevice).graphicsFamily.value(), asyncComputeFamily.value());
+	}
+
+	RenderGraph::ImageDesc backBufferDesc{};
+	backBufferDesc.format = swapChainImageFormat;
+	backBufferDesc.extent = swapChainExtent;
+
+	// Contents are cleared anyway, so every frame starts undefined, waited on at the stage the acquire semaphore blocks.
+	backBufferResource = renderGraph->ImportImage("BackBuffer", backBufferDesc, VK_IMAGE_LAYOUT_UNDEFINED,
+	                                              VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+	                                              RenderGraph::Access::Present);
+
+	// Sized for the full swap chain extent, so scale changes only change the part that is rendered to and blitted from.
+	sceneColorResource = backBufferResource;
+	if (useDynamicResolution()) {
+		sceneColorResource = renderGraph->CreateImage("SceneColor", backBufferDesc);
+	}
+
+	if (gpuCuller) {
+		// One set per frame in flight, bound every frame before the graph executes.
+		RenderGraph::BufferDesc visibleDrawsDesc{};
+		visibleDrawsDesc.size = MAX_CULLED_OBJECTS * sizeof(VkDrawIndexedIndirectCommand);
+		visibleDrawsDesc.isPerFrame = true;
+		visibleDrawsResource = renderGraph->ImportBuffer("VisibleDraws", visibleDrawsDesc);
+
+		RenderGraph::BufferDesc drawCountDesc{};
+		drawCountDesc.size = sizeof(uint32_t);
+		drawCountDesc.isPerFrame = true;
+		drawCountResource = renderGraph->ImportBuffer("DrawCount", drawCountDesc);
+
+		RenderGraph::BufferDesc objectDrawsDesc{};
+		objectDrawsDesc.size = MAX_CULLED_OBJECTS * sizeof(VkDrawIndexedIndirectCommand);
+		objectDrawsDesc.isConcurrent = useAsyncCompute();
+		objectDrawsResource = renderGraph->ImportBuffer("ObjectDraws", objectDrawsDesc);
+		renderGraph->SetBuffer(objectDrawsResource, gpuCuller->GetObjectDrawBuffer());
+
+		// Resets the counter and writes the draws of objects that switched LOD since the last frame.
+		const RenderGraph::PassId clearPass = renderGraph->AddPass("PrepareCull", [this](const VkCommandBuffer commandBuffer) {
+			gpuCuller->RecordClear(commandBuffer, currentFrame);
+			gpuCuller->RecordUpdates(commandBuffer);
+		}, false, cullQueue);
+		renderGraph->Write(clearPass, drawCountResource, RenderGraph::Access::TransferDst);
+		renderGraph->Write(clearPass, objectDrawsResource, RenderGraph::Access::TransferDst);
+
+		const RenderGraph::PassId cullPass = renderGraph->AddPass("CullObjects", [this](const VkCommandBuffer commandBuffer) {
+			gpu::GpuProfiler& profiler = useAsyncCompute() ? *computeProfiler : *gpuProfiler;
+			profiler.BeginScope(commandBuffer, "Cull");
+			gpuCuller->RecordCull(commandBuffer, viewProjection, currentFrame * MAX_SCENE_NODES, currentFrame);
+			profiler.EndScope(commandBuffer);
+		}, false, cullQueue);
+		renderGraph->Read(cullPass, objectDrawsResource, RenderGraph::Access::ComputeStorage);
+		renderGraph->Read(cullPass, drawCountResource, RenderGraph::Access::ComputeStorage);
+		renderGraph->Write(cullPass, drawCountResource, RenderGraph::Access::ComputeStorage);
+		renderGraph->Write(cullPass, visibleDrawsResource, RenderGraph::Access::ComputeStorage);
+	}
+
+	const RenderGraph::PassId trianglePass = renderGraph->AddPass("Triangle", [this](const VkCommandBuffer commandBuffer) {
+		constexpr VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+
+		VkRenderingAttachmentInfoKHR colorAttachment{};
+		colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		colorAttachment.imageView = renderGraph->GetImageView(sceneColorResource);
+		colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.clearValue = clearColor;
+
+		VkRenderingInfoKHR renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderingInfo.renderArea.offset = {0, 0};
+		renderingInfo.renderArea.extent = renderExtent;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachments = &colorAttachment;
+
+		cmdBeginRendering(commandBuffer, &renderingInfo);
+		recordDrawCommands(commandBuffer);
+		cmdEndRendering(commandBuffer);
+	});
+	renderGraph->Write(trianglePass, sceneColorResource, RenderGraph::Access::ColorAttachment);
+
+	if (gpuCuller) {
+		renderGraph->Read(trianglePass, visibleDrawsResource, RenderGraph::Access::IndirectBuffer);
+		renderGraph->Read(trianglePass, drawCountResource, RenderGraph::Access::IndirectBuffer);
+	}
+
+	if (useDynamicResolution()) {
+		const RenderGraph::PassId upscalePass = renderGraph->AddPass("Upscale", [this](const VkCommandBuffer commandBuffer) {
+			VkImageBlit region{};
+			region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.srcSubresource.layerCount = 1;
+			region.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1};
+			region.dstSubresource = region.srcSubresource;
+			region.dstOffsets[1] = {static_cast<int32_t>(swapChainExtent.width), static_cast<int32_t>(swapChainExtent.height), 1};
+
+			gpuProfiler->BeginScope(commandBuffer, "Upscale");
+			vkCmdBlitImage(commandBuffer,
+			               renderGraph->GetImage(sceneColorResource), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			               renderGraph->GetImage(backBufferResource), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			               1, &region, VK_FILTER_LINEAR);
+			gpuProfiler->EndScope(commandBuffer);
+		});
+		renderGraph->Read(upscalePass, sceneColorResource, RenderGraph::Access::TransferSrc);
+		renderGraph->Write(upscalePass, backBufferResource, RenderGraph::Access::TransferDst);
+	}
+
+	if (useFrameCapture()) {
+		// Part of every frame so the graph stays the same, only frames that are captured record a copy. A dropped
+		// screenshot is retried on the next frame.
+		const RenderGraph::PassId capturePass = renderGraph->AddPass("Capture", [this](const VkCommandBuffer commandBuffer) {
+			if (!captureNextFrame && !captureContinuously) return;
+
+			const FrameCapture::Output output = captureNextFrame ? FrameCapture::Output::Qoi : FrameCapture::Output::RawStream;
+			if (frameCapture->RecordCopy(commandBuffer, renderGraph->GetImage(backBufferResource), swapChainImageFormat,
+			                             swapChainExtent, frameNumber, output)) {
+				captureNextFrame = false;
+			}
+		}, true);
+		renderGraph->Read(capturePass, backBufferResource, RenderGraph::Access::TransferSrc);
+	}
+
+	renderGraph->Compile();
+	renderGraph->LogStats();
+	invalidateStaticCommandBuffers();
+}
+
 void HelloTriangleApp::createCommandPool() {
 	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
 
@@ -789,68 +1455,814 @@ void HelloTriangleApp::createCommandPool() {
 	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
 
-	const VkResult commandPoolResult = vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool);
+	const VkResult commandPoolResult = vkCreateCommandPool(device, &poolInfo, allocator, &commandPool);
 	if (commandPoolResult != VK_SUCCESS) {
 		UTIL_THROW("Failed to create command pool!");
 	}
+
+	if (!useAsyncCompute()) return;
+
+	poolInfo.queueFamilyIndex = asyncComputeFamily.value();
+	if (vkCreateCommandPool(device, &poolInfo, allocator, &computeCommandPool) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create compute command pool!");
+	}
 }
 
-void HelloTriangleApp::createCommandBuffer() {
+gpu::Context HelloTriangleApp::getGpuContext() const {
+	gpu::Context context = {physicalDevice, device, commandPool, graphicsQueue, allocator};
+
+	if (commandCapture) {
+		replay::CommandStreamWriter* capture = commandCapture.get();
+		context.uploadObserver = [capture](const VkBuffer destination, const VkDeviceSize destinationSize, const void* data,
+		                                   const VkDeviceSize size, const VkDeviceSize offset) {
+			capture->WriteBufferData(destination, destinationSize, false, data, size, offset);
+		};
+	}
+
+	return context;
+}
+
+void HelloTriangleApp::loadMeshes() {
+	const std::string meshPath = utils::io::path + "meshes/" + SCENE_MESH;
+
+	mesh::LoadStats stats;
+	std::vector<mesh::MeshData> meshes;
+	meshes.push_back(mesh::loadMesh(meshPath, stats));
+	mesh::generateLods(meshes);
+
+	sceneMesh = mesh::uploadMesh(getGpuContext(), meshes[0], &stats);
+
+	mesh::logLoadStats(SCENE_MESH, stats);
+	mesh::logLods(SCENE_MESH, meshes[0]);
+}
+
+void HelloTriangleApp::createCommandBuffers() {
+	commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+
 	VkCommandBufferAllocateInfo allocateInfo{};
 	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocateInfo.commandPool = commandPool;
 	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocateInfo.commandBufferCount = 1;
+	allocateInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
 
-	const VkResult allocateResult = vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer);
+	const VkResult allocateResult = vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers.data());
 	if (allocateResult != VK_SUCCESS) {
 		UTIL_THROW("Failed to allocate command buffers!");
 	}
+
+	if (!useAsyncCompute()) return;
+
+	computeCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	allocateInfo.commandPool = computeCommandPool;
+
+	if (vkAllocateCommandBuffers(device, &allocateInfo, computeCommandBuffers.data()) != VK_SUCCESS) {
+		UTIL_THROW("Failed to allocate compute command buffers!");
+	}
 }
 
-void HelloTriangleApp::recordCommandBuffer(const VkCommandBuffer commandBuffer, const uint32_t imageIndex) {
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+void HelloTriangleApp::createStaticCommandBuffers() {
+	destroyStaticCommandBuffers();
+	if (!ENABLE_STATIC_COMMAND_BUFFERS) return;
 
-	VkResult commandBufferBeginResult = vkBeginCommandBuffer(commandBuffer, &beginInfo);
-	if (commandBufferBeginResult != VK_SUCCESS) {
-		UTIL_THROW("Failed to begin recording command buffer!");
+	// Submitting them again needs no simultaneous use flag, the fence of their frame in flight was waited on by then.
+	std::vector<VkCommandBuffer> allocated(MAX_FRAMES_IN_FLIGHT * swapChainImages.size());
+
+	VkCommandBufferAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = commandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = static_cast<uint32_t>(allocated.size());
+
+	if (vkAllocateCommandBuffers(device, &allocateInfo, allocated.data()) != VK_SUCCESS) {
+		UTIL_THROW("Failed to allocate static command buffers!");
 	}
 
-	VkRenderPassBeginInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = renderPass;
-	renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
-	renderPassInfo.renderArea.offset = {0, 0};
-	renderPassInfo.renderArea.extent = swapChainExtent;
+	staticCommandBuffers.resize(allocated.size());
+	for (size_t i = 0; i < allocated.size(); i++) {
+		staticCommandBuffers[i].commandBuffer = allocated[i];
+	}
+
+	if (!useAsyncCompute()) return;
+
+	allocateInfo.commandPool = computeCommandPool;
+	if (vkAllocateCommandBuffers(device, &allocateInfo, allocated.data()) != VK_SUCCESS) {
+		UTIL_THROW("Failed to allocate static compute command buffers!");
+	}
+
+	for (size_t i = 0; i < allocated.size(); i++) {
+		staticCommandBuffers[i].computeCommandBuffer = allocated[i];
+	}
+}
+
+void HelloTriangleApp::destroyStaticCommandBuffers() {
+	for (const StaticCommandBuffers& recorded : staticCommandBuffers) {
+		vkFreeCommandBuffers(device, commandPool, 1, &recorded.commandBuffer);
+		if (recorded.computeCommandBuffer != VK_NULL_HANDLE) {
+			vkFreeCommandBuffers(device, computeCommandPool, 1, &recorded.computeCommandBuffer);
+		}
+	}
+	staticCommandBuffers.clear();
+}
+
+void HelloTriangleApp::invalidateStaticCommandBuffers() {
+	commandsVersion++;
+}
+
+void HelloTriangleApp::createProfiler() {
+	const QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+	gpuProfiler = std::make_unique<gpu::GpuProfiler>(physicalDevice, device, queueFamilyIndices.graphicsFamily.value(),
+	                                                 MAX_FRAMES_IN_FLIGHT, allocator);
+
+	if (useAsyncCompute()) {
+		computeProfiler = std::make_unique<gpu::GpuProfiler>(physicalDevice, device, asyncComputeFamily.value(),
+		                                                     MAX_FRAMES_IN_FLIGHT, allocator);
+
+		// Timestamps of the two queues can only be lined up on the device clock.
+		if (getCalibratedTimestamps != nullptr) {
+			deviceClock = std::make_unique<gpu::DeviceClock>(device, getCalibratedTimestamps);
+			gpuProfiler->SetDeviceClock(deviceClock.get());
+			computeProfiler->SetDeviceClock(deviceClock.get());
+		} else {
+			UTIL_WARN("Async compute: no calibrated device clock, its overlap with graphics work is not reported");
+		}
+		queueOverlap = std::make_unique<gpu::QueueOverlap>("AsyncCompute", "Frame", deviceClock != nullptr);
+	}
+
+	lastProfilerLog = std::chrono::steady_clock::now();
+}
+
+void HelloTriangleApp::createResolutionController() {
+	if (!useDynamicResolution()) return;
+
+	ResolutionController::Settings settings{};
+	settings.targetMilliseconds = GPU_FRAME_BUDGET;
+	settings.minScale = MIN_RESOLUTION_SCALE;
+	// Timings arrive once their frame in flight comes around again, one more frame to be safe.
+	settings.latencyFrames = MAX_FRAMES_IN_FLIGHT + 1;
+	resolutionController = std::make_unique<ResolutionController>(settings);
+
+	UTIL_LOG("Dynamic resolution: " + std::to_string(GPU_FRAME_BUDGET) + " ms GPU budget, down to " +
+		std::to_string(MIN_RESOLUTION_SCALE) + " of the swap chain extent");
+}
+
+void HelloTriangleApp::createFrameCapture() {
+	if (!ENABLE_FRAME_CAPTURE || !useDynamicRendering()) return;
+
+	// A slot per frame in flight and per encoder, so capturing every frame only drops frames when encoding falls behind.
+	const std::string directory = std::string(BINARY_DIR) + "/" + CAPTURE_DIRECTORY;
+	frameCapture = std::make_unique<FrameCapture>(getGpuContext(), directory, MAX_FRAMES_IN_FLIGHT + CAPTURE_ENCODER_THREADS,
+	                                              CAPTURE_ENCODER_THREADS);
+
+	if (!useFrameCapture()) {
+		UTIL_WARN("Frame capture: swap chain images can not be copied from, F11 and F12 do nothing");
+	}
+}
 
-	constexpr VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-	renderPassInfo.clearValueCount = 1;
-	renderPassInfo.pClearValues = &clearColor;
+void HelloTriangleApp::createTextureStreamer() {
+	if (!ENABLE_TEXTURE_STREAMING) return;
+
+	const std::filesystem::path directory = utils::io::path + TEXTURE_DIRECTORY;
+	if (!std::filesystem::is_directory(directory)) {
+		UTIL_WARN("Texture streaming: " + directory.string() + " does not exist, no textures are loaded");
+		return;
+	}
+
+	std::vector<std::string> files;
+	for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+		if (entry.is_regular_file() && entry.path().extension() == ".ktx2") {
+			files.push_back(entry.path().string());
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	TextureStreamer::Settings settings;
+	settings.uploadBudget = TEXTURE_UPLOAD_BUDGET;
+	settings.residencyBudget = getTextureResidencyBudget();
+	settings.framesInFlight = MAX_FRAMES_IN_FLIGHT;
+	textureStreamer = std::make_unique<TextureStreamer>(getGpuContext(), settings);
+
+	for (const std::string& file : files) {
+		const TextureStreamer::TextureId texture = textureStreamer->Load(file);
+		if (!sceneTexture) sceneTexture = texture;
+	}
+
+	UTIL_LOG("Texture streaming: " + std::to_string(files.size()) + " textures, " +
+		std::to_string(TEXTURE_UPLOAD_BUDGET / 1024) + " KiB per frame, " +
+		std::to_string(settings.residencyBudget / (1024 * 1024)) + " MiB resident" +
+		(optionalFeatures.memoryBudget != FeatureSupport::Unsupported ? " (from the memory budget)" : ""));
+}
+
+VkDeviceSize HelloTriangleApp::getTextureResidencyBudget() const {
+	if (optionalFeatures.memoryBudget == FeatureSupport::Unsupported) return TEXTURE_RESIDENCY_BUDGET;
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+	budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+	memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memoryProperties.pNext = &budgetProperties;
+	vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties);
+
+	// Texture images live in the largest device local heap. The budget includes what the process already allocated, the
+	// swap chain and meshes among it, and other processes lower it.
+	VkDeviceSize heapLeft = 0;
+	for (uint32_t heap = 0; heap < memoryProperties.memoryProperties.memoryHeapCount; heap++) {
+		if ((memoryProperties.memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0) continue;
+
+		const VkDeviceSize budget = budgetProperties.heapBudget[heap];
+		const VkDeviceSize usage = budgetProperties.heapUsage[heap];
+		heapLeft = std::max(heapLeft, budget > usage ? budget - usage : 0);
+	}
+
+	if (heapLeft == 0) return TEXTURE_RESIDENCY_BUDGET;
+	return static_cast<VkDeviceSize>(static_cast<double>(heapLeft) * TEXTURE_RESIDENCY_SHARE);
+}
+
+void HelloTriangleApp::createTextureDescriptorSets() {
+	texturePlaceholder = texture::createPlaceholder(getGpuContext());
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, allocator, &textureDescriptorPool) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create texture descriptor pool!");
+	}
+
+	const std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, textureSetLayout);
+	textureSets.resize(MAX_FRAMES_IN_FLIGHT);
+	textureSetViews.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = textureDescriptorPool;
+	allocateInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+	allocateInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocateInfo, textureSets.data()) != VK_SUCCESS) {
+		UTIL_THROW("Failed to allocate texture descriptor sets!");
+	}
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+		updateTextureDescriptor(frame);
+	}
+}
+
+void HelloTriangleApp::updateTextureDescriptor(const uint32_t frame) {
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageView = sceneTexture ? textureStreamer->GetImageView(*sceneTexture) : VK_NULL_HANDLE;
+	imageInfo.sampler = sceneTexture ? textureStreamer->GetSampler() : VK_NULL_HANDLE;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	// Nothing uploaded yet, possibly never within the budgets.
+	if (imageInfo.imageView == VK_NULL_HANDLE) {
+		imageInfo.imageView = texturePlaceholder.view;
+		imageInfo.sampler = texturePlaceholder.sampler;
+	}
+	if (textureSetViews[frame] == imageInfo.imageView) return;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = textureSets[frame];
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	textureSetViews[frame] = imageInfo.imageView;
+
+	// Updating a bound set invalidates the command buffers recorded with it.
+	invalidateStaticCommandBuffers();
+}
+
+void HelloTriangleApp::createSyncObjects() {
+	imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+	renderFinishedSemaphores.resize(swapChainImages.size());
+	inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	// Signaled so the first wait on each frame returns immediately.
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		if (vkCreateSemaphore(device, &semaphoreInfo, allocator, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+			vkCreateFence(device, &fenceInfo, allocator, &inFlightFences[i]) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create synchronization objects for frame " + std::to_string(i) + "!");
+		}
+	}
+
+	for (size_t i = 0; i < renderFinishedSemaphores.size(); i++) {
+		if (vkCreateSemaphore(device, &semaphoreInfo, allocator, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create render finished semaphore for swapChainImage " + std::to_string(i) + "!");
+		}
+	}
+}
+
+void HelloTriangleApp::destroySyncObjects() {
+	for (const auto& semaphore : imageAvailableSemaphores) {
+		vkDestroySemaphore(device, semaphore, allocator);
+	}
+	imageAvailableSemaphores.clear();
+
+	for (const auto& semaphore : renderFinishedSemaphores) {
+		vkDestroySemaphore(device, semaphore, allocator);
+	}
+	renderFinishedSemaphores.clear();
+
+	for (const auto& fence : inFlightFences) {
+		vkDestroyFence(device, fence, allocator);
+	}
+	inFlightFences.clear();
+}
+
+void HelloTriangleApp::createTimelineSemaphores() {
+	if (!useAsyncCompute()) return;
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(device, &semaphoreInfo, allocator, &graphicsTimeline) != VK_SUCCESS ||
+		vkCreateSemaphore(device, &semaphoreInfo, allocator, &computeTimeline) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create timeline semaphores!");
+	}
+
+	computeFrameNumbers.assign(MAX_FRAMES_IN_FLIGHT, 0);
+}
+
+void HelloTriangleApp::destroyTimelineSemaphores() {
+	vkDestroySemaphore(device, computeTimeline, allocator);
+	vkDestroySemaphore(device, graphicsTimeline, allocator);
+	computeTimeline = VK_NULL_HANDLE;
+	graphicsTimeline = VK_NULL_HANDLE;
+}
+
+void HelloTriangleApp::updateRenderExtent() {
+	renderExtent = swapChainExtent;
+	if (!resolutionController || !useDynamicResolution()) return;
+
+	// Needs the latest timings, so only after the profiler's ReadResults().
+	for (const gpu::GpuProfiler::ScopeTiming& timing : gpuProfiler->GetLatestTimings()) {
+		if (timing.name == "Frame" && timing.beginMilliseconds != lastResolutionSample) {
+			lastResolutionSample = timing.beginMilliseconds;
+			resolutionController->Update(timing.milliseconds);
+		}
+	}
+
+	renderExtent = resolutionController->GetRenderExtent(swapChainExtent);
+}
+
+void HelloTriangleApp::updateScene() {
+	const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - sceneStart).count();
+	const float angle = seconds * SCENE_ROTATION_SPEED;
+	scene.SetRotation(sceneRoot, glm::quat(std::cos(angle * 0.5f), 0.0f, 0.0f, std::sin(angle * 0.5f)));
+
+	// The fence of this frame was waited on, so the GPU is done reading its slice.
+	auto* instances = reinterpret_cast<Scene::Instance*>(static_cast<char*>(instanceBuffer.mapped) + getInstanceOffset());
+	scene.UpdateTransforms(instances);
+
+	if (commandCapture) {
+		commandCapture->WriteBufferData(instanceBuffer.buffer, instanceBuffer.size, true, instances,
+		                                scene.GetNodeCount() * sizeof(Scene::Instance), getInstanceOffset());
+	}
+}
+
+VkDeviceSize HelloTriangleApp::getInstanceOffset() const {
+	return static_cast<VkDeviceSize>(currentFrame) * MAX_SCENE_NODES * sizeof(Scene::Instance);
+}
+
+void HelloTriangleApp::selectDraws() {
+	const std::vector<uint32_t>& meshes = scene.GetMeshes();
+	const std::vector<glm::mat4>& worldMatrices = scene.GetWorldMatrices();
+
+	// Meshlet bounds and LOD errors are in mesh space, so is the view each object is looked at with.
+	const auto selectObjectLod = [&](const uint32_t instance, mesh::LodView& objectView) -> const mesh::Lod& {
+		objectView = mesh::makeLodView(viewProjection * worldMatrices[instance], static_cast<float>(renderExtent.height),
+		                               FRONT_FACE == VK_FRONT_FACE_CLOCKWISE);
+		return sceneMesh.lods[mesh::selectLod(sceneMesh.lods, sceneMesh.boundingSphere, objectView, MAX_LOD_PIXEL_ERROR)];
+	};
+
+	mesh::LodView objectView;
+	if (gpuCuller) {
+		// A command stream capture has no compute work, it draws every object the GPU would cull instead.
+		const bool capturing = commandCapture && commandCapture->IsCapturing();
+		visibleDraws.clear();
+
+		for (uint32_t instance = 0; instance < meshes.size(); instance++) {
+			if (meshes[instance] == Scene::NO_MESH) continue;
+			const mesh::Lod& lod = selectObjectLod(instance, objectView);
+			const VkDrawIndexedIndirectCommand draw = {lod.indexCount, 1, lod.firstIndex, 0, instance};
+			gpuCuller->SetObjectDraw(instance, draw);
+			if (capturing) visibleDraws.push_back(draw);
+		}
+		return;
+	}
+
+	const std::vector<glm::vec4>& worldBounds = scene.GetWorldBounds();
+	cullObjects.clear();
+	for (uint32_t instance = 0; instance < meshes.size(); instance++) {
+		if (meshes[instance] != Scene::NO_MESH) cullObjects.push_back({worldBounds[instance], instance});
+	}
+	cpuCuller.SetDynamicObjects(cullObjects);
+
+	visibleObjects.clear();
+	cpuCuller.Cull(culling::extractFrustum(viewProjection), visibleObjects);
+
+	visibleDraws.clear();
+	for (const uint32_t instance : visibleObjects) {
+		visibleRanges.clear();
+		mesh::cullMeshlets(selectObjectLod(instance, objectView), sceneMesh.meshlets, objectView, visibleRanges);
+
+		for (const mesh::IndexRange& range : visibleRanges) {
+			visibleDraws.push_back({range.indexCount, 1, range.firstIndex, 0, instance});
+		}
+	}
+}
+
+void HelloTriangleApp::recordDrawCommands(const VkCommandBuffer commandBuffer) const {
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	if (commandCapture) commandCapture->BindPipeline(graphicsPipeline);
+
+	// The replay binds its placeholder along with the pipeline, textures are not captured.
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &textureSets[currentFrame],
+	                        0, nullptr);
 
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(swapChainExtent.width);
-	viewport.height = static_cast<float>(swapChainExtent.height);
+	viewport.width = static_cast<float>(renderExtent.width);
+	viewport.height = static_cast<float>(renderExtent.height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	if (commandCapture) commandCapture->SetViewport(viewport);
 
 	VkRect2D scissor{};
 	scissor.offset = {0, 0};
-	scissor.extent = swapChainExtent;
+	scissor.extent = renderExtent;
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	if (commandCapture) commandCapture->SetScissor(scissor);
+
+	// The vertex fetch bound part of the frame, what the quantized vertex format is there to shrink.
+	gpuProfiler->BeginScope(commandBuffer, "Draw");
+
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &viewProjection);
+	if (commandCapture) commandCapture->PushConstants(VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &viewProjection);
+
+	const VkBuffer vertexBuffers[] = {sceneMesh.vertexBuffer.buffer, instanceBuffer.buffer};
+	const VkDeviceSize vertexBufferOffsets[] = {0, getInstanceOffset()};
+	vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, vertexBufferOffsets);
+	vkCmdBindIndexBuffer(commandBuffer, sceneMesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+	if (commandCapture) {
+		commandCapture->BindVertexBuffers(0, 2, vertexBuffers, vertexBufferOffsets);
+		commandCapture->BindIndexBuffer(sceneMesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+		for (const VkDrawIndexedIndirectCommand& draw : visibleDraws) {
+			commandCapture->DrawIndexed(draw);
+		}
+	}
+
+	if (gpuCuller) {
+		gpuCuller->RecordDraw(commandBuffer, cmdDrawIndexedIndirectCount, currentFrame);
+	} else {
+		for (const VkDrawIndexedIndirectCommand& draw : visibleDraws) {
+			vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset,
+			                 draw.firstInstance);
+		}
+	}
+
+	gpuProfiler->EndScope(commandBuffer);
+}
+
+bool HelloTriangleApp::prepareCommandBuffers(const uint32_t imageIndex, VkCommandBuffer& commandBuffer,
+                                             VkCommandBuffer& computeCommandBuffer) {
+	// Timings of this frame in flight's previous submission, the render extent is picked from them.
+	if (deviceClock) {
+		deviceClock->Sample();
+	}
+	gpuProfiler->ReadResults(currentFrame);
+	if (computeProfiler) {
+		computeProfiler->ReadResults(currentFrame);
+		queueOverlap->Add(computeProfiler->GetLatestTimings(), gpuProfiler->GetLatestTimings());
+	}
+
+	updateRenderExtent();
+
+	if (commandCapture) {
+		commandCapture->BeginFrame(currentFrame, renderExtent, {{0.0f, 0.0f, 0.0f, 1.0f}});
+	}
+
+	updateScene();
+	selectDraws();
+
+	// Every object samples the scene texture, so it is used whenever anything is drawn. What the GPU culls is not known
+	// here, with it every frame counts.
+	if (sceneTexture && (gpuCuller || !visibleDraws.empty())) {
+		textureStreamer->MarkUsed(*sceneTexture, frameNumber);
+	}
+
+	if (!reuseCommandBuffers || staticCommandBuffers.empty()) {
+		commandBuffer = commandBuffers[currentFrame];
+		computeCommandBuffer = useAsyncCompute() ? computeCommandBuffers[currentFrame] : VK_NULL_HANDLE;
+	} else {
+		// Only the next recording writes the changed draws, the older ones would write back what they replaced.
+		if (gpuCuller && gpuCuller->HasUpdates()) {
+			invalidateStaticCommandBuffers();
+		}
+
+		StaticCommandBuffers& recorded = staticCommandBuffers[currentFrame * swapChainImages.size() + imageIndex];
+		commandBuffer = recorded.commandBuffer;
+		computeCommandBuffer = recorded.computeCommandBuffer;
+
+		// Captures record copies and commands the stream has to see, those recordings are not repeated.
+		const bool capturing = captureNextFrame || captureContinuously || (commandCapture && commandCapture->IsCapturing());
+		if (!capturing && canReuse(recorded)) {
+			gpuProfiler->ReuseFrame(currentFrame);
+			if (computeProfiler) {
+				computeProfiler->ReuseFrame(currentFrame);
+			}
+			return true;
+		}
+
+		recorded.version = capturing ? 0 : commandsVersion;
+		recorded.renderExtent = renderExtent;
+		recorded.viewProjection = viewProjection;
+		recorded.draws = visibleDraws;
+	}
+
+	vkResetCommandBuffer(commandBuffer, 0);
+	if (computeCommandBuffer != VK_NULL_HANDLE) {
+		vkResetCommandBuffer(computeCommandBuffer, 0);
+	}
+
+	recordCommandBuffer(commandBuffer, computeCommandBuffer, imageIndex);
+	return false;
+}
+
+bool HelloTriangleApp::canReuse(const StaticCommandBuffers& recorded) const {
+	const auto sameDraw = [](const VkDrawIndexedIndirectCommand& a, const VkDrawIndexedIndirectCommand& b) {
+		return a.indexCount == b.indexCount && a.instanceCount == b.instanceCount && a.firstIndex == b.firstIndex &&
+			a.vertexOffset == b.vertexOffset && a.firstInstance == b.firstInstance;
+	};
+
+	return recorded.version == commandsVersion && recorded.renderExtent.width == renderExtent.width &&
+		recorded.renderExtent.height == renderExtent.height && recorded.viewProjection == viewProjection &&
+		std::equal(recorded.draws.begin(), recorded.draws.end(), visibleDraws.begin(), visibleDraws.end(), sameDraw);
+}
+
+void HelloTriangleApp::recordCommandBuffer(const VkCommandBuffer commandBuffer, const VkCommandBuffer computeCommandBuffer,
+                                           const uint32_t imageIndex) {
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+	VkResult commandBufferBeginResult = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	if (commandBufferBeginResult != VK_SUCCESS) {
+		UTIL_THROW("Failed to begin recording command buffer!");
+	}
+
+	if (computeCommandBuffer != VK_NULL_HANDLE) {
+		if (vkBeginCommandBuffer(computeCommandBuffer, &beginInfo) != VK_SUCCESS) {
+			UTIL_THROW("Failed to begin recording compute command buffer!");
+		}
+
+		computeProfiler->BeginFrame(computeCommandBuffer, currentFrame);
+		computeProfiler->BeginScope(computeCommandBuffer, "AsyncCompute");
+	}
+
+	gpuProfiler->BeginFrame(commandBuffer, currentFrame);
+	gpuProfiler->BeginScope(commandBuffer, "Frame");
+
+	if (useDynamicRendering()) {
+		// Layout transitions and barriers come from the accesses the passes declared.
+		renderGraph->SetImage(backBufferResource, swapChainImages[imageIndex], swapChainImageViews[imageIndex]);
 
-	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+		if (gpuCuller) {
+			renderGraph->SetBuffer(visibleDrawsResource, gpuCuller->GetVisibleDrawBuffer(currentFrame));
+			renderGraph->SetBuffer(drawCountResource, gpuCuller->GetDrawCountBuffer(currentFrame));
+		}
+
+		renderGraph->Execute(commandBuffer, computeCommandBuffer);
+	} else {
+		constexpr VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+		renderPassInfo.renderArea.offset = {0, 0};
+		renderPassInfo.renderArea.extent = swapChainExtent;
+		renderPassInfo.clearValueCount = 1;
+		renderPassInfo.pClearValues = &clearColor;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		recordDrawCommands(commandBuffer);
+		vkCmdEndRenderPass(commandBuffer);
+	}
 
-	vkCmdEndRenderPass(commandBuffer);
+	gpuProfiler->EndScope(commandBuffer);
+
+	if (commandCapture && commandCapture->IsCapturing()) {
+		commandCapture->EndFrame();
+		if (!commandCapture->IsCapturing()) {
+			UTIL_LOG("Command stream capture: " + std::to_string(COMMAND_CAPTURE_FRAMES) + " frames, " +
+				std::to_string(commandCapture->GetWrittenBytes() / 1024) + " KiB written to " + COMMAND_CAPTURE_FILE);
+		}
+	}
 
 	const VkResult endCommandBufferResult = vkEndCommandBuffer(commandBuffer);
 	if (endCommandBufferResult != VK_SUCCESS) {
 		UTIL_THROW("Failed to end recording command buffer!");
 	}
+
+	if (computeCommandBuffer != VK_NULL_HANDLE) {
+		computeProfiler->EndScope(computeCommandBuffer);
+
+		if (vkEndCommandBuffer(computeCommandBuffer) != VK_SUCCESS) {
+			UTIL_THROW("Failed to end recording compute command buffer!");
+		}
+	}
+}
+
+std::string HelloTriangleApp::reportCommandBufferStats() {
+	const CommandBufferStats& stats = commandBufferStats;
+	if (stats.recordedFrames == 0 && stats.reusedFrames == 0) return "";
+
+	// Both include updating the scene and selecting the draws, the difference is what recording costs.
+	std::string line = "CPU time per frame preparing commands:";
+	if (stats.recordedFrames > 0) {
+		line += " recorded " + std::to_string(stats.recordedMilliseconds / stats.recordedFrames) + " ms (" +
+			std::to_string(stats.recordedFrames) + " frames),";
+	}
+	if (stats.reusedFrames > 0) {
+		line += " reused " + std::to_string(stats.reusedMilliseconds / stats.reusedFrames) + " ms (" +
+			std::to_string(stats.reusedFrames) + " frames),";
+	}
+	line.pop_back();
+
+	commandBufferStats = {};
+	return line;
+}
+
+void HelloTriangleApp::submitAsyncCompute(const VkCommandBuffer computeCommandBuffer) {
+	// Only work the graph found to depend on the previous frame's graphics work waits, the rest overlaps it.
+	const RenderGraph::QueueSync& sync = renderGraph->GetQueueSync(RenderGraph::Queue::AsyncCompute);
+	const uint32_t waitCount = sync.previousFrameStages != 0 ? 1 : 0;
+	const VkPipelineStageFlags waitStages = static_cast<VkPipelineStageFlags>(sync.previousFrameStages);
+	const uint64_t waitValue = frameNumber - 1;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = waitCount;
+	timelineInfo.pWaitSemaphoreValues = &waitValue;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &frameNumber;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = &graphicsTimeline;
+	submitInfo.pWaitDstStageMask = &waitStages;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &computeCommandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &computeTimeline;
+
+	if (vkQueueSubmit(computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		UTIL_THROW("Failed to submit async compute command buffer!");
+	}
+
+	computeFrameNumbers[currentFrame] = frameNumber;
+}
+
+void HelloTriangleApp::drawFrame() {
+	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+	// The fence only covers the graphics queue, this frame's compute work may finish after it.
+	if (useAsyncCompute()) {
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &computeTimeline;
+		waitInfo.pValues = &computeFrameNumbers[currentFrame];
+		waitTimelineSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max());
+	}
+
+	// The last frame submitted with this frame in flight is done now, so are all before it. Their copies are read back
+	// without waiting on anything else.
+	if (frameCapture && frameNumber >= MAX_FRAMES_IN_FLIGHT) {
+		frameCapture->Collect(frameNumber + 1 - MAX_FRAMES_IN_FLIGHT);
+	}
+
+	// Submitted ahead of this frame, which already samples whatever it uploads.
+	if (textureStreamer) {
+		textureStreamer->Update(frameNumber);
+	}
+	updateTextureDescriptor(currentFrame);
+
+	uint32_t imageIndex;
+	const VkResult acquireResult = vkAcquireNextImageKHR(device, swapChain, std::numeric_limits<uint64_t>::max(),
+	                                                     imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+	if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+		recreateSwapChain();
+		return;
+	}
+	if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
+		UTIL_THROW("Failed to acquire swap chain image!");
+	}
+
+	// Only reset once we know work will be submitted, otherwise the next wait would dead lock.
+	vkResetFences(device, 1, &inFlightFences[currentFrame]);
+	frameNumber++;
+
+	const auto prepareStart = std::chrono::steady_clock::now();
+	VkCommandBuffer commandBuffer;
+	VkCommandBuffer computeCommandBuffer;
+	const bool reused = prepareCommandBuffers(imageIndex, commandBuffer, computeCommandBuffer);
+	const double prepareMilliseconds =
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - prepareStart).count();
+
+	if (reused) {
+		commandBufferStats.reusedFrames++;
+		commandBufferStats.reusedMilliseconds += prepareMilliseconds;
+	} else {
+		commandBufferStats.recordedFrames++;
+		commandBufferStats.recordedMilliseconds += prepareMilliseconds;
+	}
+
+	if (useAsyncCompute()) {
+		submitAsyncCompute(computeCommandBuffer);
+	}
+
+	// With async compute the draw waits on the compute work of its frame and tells the next frame's compute work when
+	// it is done. Binary semaphores ignore their timeline values.
+	const RenderGraph::QueueSync graphicsSync = useAsyncCompute() ? renderGraph->GetQueueSync(RenderGraph::Queue::Graphics)
+	                                                               : RenderGraph::QueueSync{};
+
+	const VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame], computeTimeline};
+	const VkPipelineStageFlags waitStages[] = {
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, static_cast<VkPipelineStageFlags>(graphicsSync.sameFrameStages)
+	};
+	const uint64_t waitValues[] = {0, frameNumber};
+	const uint32_t waitCount = graphicsSync.sameFrameStages != 0 ? 2 : 1;
+
+	const VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[imageIndex], graphicsTimeline};
+	const uint64_t signalValues[] = {0, frameNumber};
+	const uint32_t signalCount = useAsyncCompute() ? 2 : 1;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = waitCount;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	timelineInfo.signalSemaphoreValueCount = signalCount;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = useAsyncCompute() ? &timelineInfo : nullptr;
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = signalCount;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+
+	const VkResult submitResult = vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]);
+	if (submitResult != VK_SUCCESS) {
+		UTIL_THROW("Failed to submit draw command buffer!");
+	}
+
+	VkPresentInfoKHR presentInfo{};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &swapChain;
+	presentInfo.pImageIndices = &imageIndex;
+
+	const VkResult presentResult = vkQueuePresentKHR(presentQueue, &presentInfo);
+	if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR) {
+		recreateSwapChain();
+	} else if (presentResult != VK_SUCCESS) {
+		UTIL_THROW("Failed to present swap chain image!");
+	}
+
+	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
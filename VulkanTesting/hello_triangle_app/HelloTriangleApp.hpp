@@ -1,11 +1,30 @@
 ﻿#pragma once
 
+#include <chrono>
+#include <memory>
 #include <optional>
 #include <vector>
 #include <string>
 
 #define GLFW_INCLUDE_VULKAN
 #include <glfw/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "capture/FrameCapture.hpp"
+#include "culling/CpuCuller.hpp"
+#include "culling/GpuCuller.hpp"
+#include "gpu/Buffer.hpp"
+#include "gpu/GpuProfiler.hpp"
+#include "gpu/HostAllocator.hpp"
+#include "gpu/QueueOverlap.hpp"
+#include "mesh/GpuMesh.hpp"
+#include "mesh/LodSelection.hpp"
+#include "render_graph/RenderGraph.hpp"
+#include "replay/CommandStream.hpp"
+#include "resolution/ResolutionController.hpp"
+#include "scene/Scene.hpp"
+#include "texture/Placeholder.hpp"
+#include "texture/TextureStreamer.hpp"
 
 class HelloTriangleApp {
 public: // Properties
@@ -14,6 +33,8 @@ private: // Member Variables
 	struct QueueFamilyIndices {
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		// Compute without graphics, so its queue runs next to the graphics one. Optional, only used for async compute.
+		std::optional<uint32_t> computeFamily;
 
 		bool isComplete() const {
 			return graphicsFamily.has_value() && presentFamily.has_value();
@@ -56,12 +77,88 @@ private: // Member Variables
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 	};
 
+	// How an optional device feature is reached on the picked device, decided once at device creation.
+	enum class FeatureSupport {
+		Unsupported,
+		Core,
+		Extension,
+	};
+
+	struct OptionalFeatures {
+		// Without it rendering falls back to VkRenderPass + VkFramebuffer objects.
+		FeatureSupport dynamicRendering = FeatureSupport::Unsupported;
+		// Without it the render graph records its barriers with vkCmdPipelineBarrier.
+		FeatureSupport synchronization2 = FeatureSupport::Unsupported;
+		// Without it objects are not culled on the GPU.
+		FeatureSupport drawIndirectCount = FeatureSupport::Unsupported;
+		// Without it compute work stays on the graphics queue.
+		FeatureSupport timelineSemaphore = FeatureSupport::Unsupported;
+		// Without it, or without the device time domain, how much async compute overlaps graphics work is not reported.
+		FeatureSupport calibratedTimestamps = FeatureSupport::Unsupported;
+		// Without it textures keep to TEXTURE_RESIDENCY_BUDGET instead of a share of the device local heap's budget.
+		FeatureSupport memoryBudget = FeatureSupport::Unsupported;
+	};
+
+	// Upper bound for the culling buffers, the draw recorded for them costs the same at any count.
+	const uint32_t MAX_CULLED_OBJECTS = 1 << 20;
+	// Instances per frame in flight, every scene node takes one and is culled as one object.
+	const uint32_t MAX_SCENE_NODES = 1 << 16;
+
+	const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+
+	// LOD selection and meshlet cone culling need to know which winding is the front.
+	const VkFrontFace FRONT_FACE = VK_FRONT_FACE_CLOCKWISE;
+	// Coarser LODs are picked as long as their error stays below this on screen.
+	const float MAX_LOD_PIXEL_ERROR = 1.0f;
+
+	// Renders into an offscreen target at a fraction of the swap chain extent and blits it up, the fraction picked to keep
+	// the GPU time of a frame within GPU_FRAME_BUDGET. Needs the render graph and blittable swap chain images.
+	const bool ENABLE_DYNAMIC_RESOLUTION = true;
+	const double GPU_FRAME_BUDGET = 12.0; // Milliseconds, below 60 Hz with room for presentation.
+	const float MIN_RESOLUTION_SCALE = 0.5f;
+
+	// F12 saves the next frame as an image, F11 starts and stops appending every frame to a raw stream. Copies the swap
+	// chain images out, which needs the render graph and a transfer source usage on them.
+	const bool ENABLE_FRAME_CAPTURE = true;
+	const std::string CAPTURE_DIRECTORY = "captures";
+	const uint32_t CAPTURE_ENCODER_THREADS = 2;
+
+	// Records the uploads and the first this many frames to COMMAND_CAPTURE_FILE in the capture directory, for the
+	// Replay executable to play back without a window. 0 turns it off. Only the draws are captured: culling on the GPU
+	// is replaced by drawing every object, and the render graph's transfers are left out.
+	const uint32_t COMMAND_CAPTURE_FRAMES = 0;
+	const std::string COMMAND_CAPTURE_FILE = "commands.vkcs";
+
+	// Keeps the command buffers of every frame in flight and swap chain image pair and submits them again as long as
+	// nothing they recorded changed, the transforms and culling results reach them through buffers. F8 switches between
+	// this and recording every frame, to compare the CPU time of both.
+	const bool ENABLE_STATIC_COMMAND_BUFFERS = true;
+
+	// Hands the driver's host allocations to gpu::HostAllocator instead of its own malloc, which counts them per scope.
+	// Its statistics are logged once everything is created and again after everything is destroyed. Off by default, it
+	// is only as fast as malloc per allocation (HostAllocatorBenchmark), so it is worth it for the statistics alone.
+	const bool ENABLE_HOST_ALLOCATOR = false;
+
+	// Streams every KTX2 file in TEXTURE_DIRECTORY of the resources, coarsest level first, with at most
+	// TEXTURE_UPLOAD_BUDGET bytes uploaded per frame. The scene samples the first of them. Textures not used for a while
+	// lose their finest levels when the images would outgrow TEXTURE_RESIDENCY_SHARE of what VK_EXT_memory_budget says
+	// the device local heap has left at startup, or TEXTURE_RESIDENCY_BUDGET without the extension.
+	const bool ENABLE_TEXTURE_STREAMING = true;
+	const std::string TEXTURE_DIRECTORY = "textures";
+	const VkDeviceSize TEXTURE_UPLOAD_BUDGET = 4 * 1024 * 1024;
+	const double TEXTURE_RESIDENCY_SHARE = 0.25;
+	const VkDeviceSize TEXTURE_RESIDENCY_BUDGET = 64 * 1024 * 1024;
+
 #ifdef NDEBUG
 	const bool ENABLE_VALIDATION_LAYERS = false;
 #else
 	const bool ENABLE_VALIDATION_LAYERS = true;
 #endif
 
+	// Declared first, every Vulkan object is destroyed with the same callbacks it was created with.
+	gpu::HostAllocator hostAllocator;
+	const VkAllocationCallbacks* allocator = ENABLE_HOST_ALLOCATOR ? hostAllocator.GetCallbacks() : nullptr;
+
 	GLFWwindow* windowHandle;
 
 	VkInstance instance;
@@ -71,23 +168,131 @@ private: // Member Variables
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device;
 
+	OptionalFeatures optionalFeatures;
+	PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+	PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+	PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2 = nullptr;
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+	PFN_vkWaitSemaphoresKHR waitTimelineSemaphores = nullptr;
+	PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps = nullptr;
+
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	// Culling runs here when set, overlapping the graphics work of the previous frame.
+	std::optional<uint32_t> asyncComputeFamily;
+	VkQueue computeQueue = VK_NULL_HANDLE;
 
 	VkSwapchainKHR swapChain;
 	std::vector<VkImage> swapChainImages;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
 	std::vector<VkImageView> swapChainImageViews;
+	bool swapChainBlittable = false;
+	bool swapChainReadable = false;
 
-	VkRenderPass renderPass;
+	// What the scene is rendered at this frame, swapChainExtent without dynamic resolution.
+	VkExtent2D renderExtent;
+	std::unique_ptr<ResolutionController> resolutionController;
+	double lastResolutionSample = -1.0; // Begin of the last GPU frame fed to the controller, each is only fed once.
+
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkDescriptorSetLayout textureSetLayout;
 	VkPipelineLayout pipelineLayout;
 	VkPipeline graphicsPipeline;
 
 	std::vector<VkFramebuffer> swapChainFramebuffers;
 
+	// Only used with dynamic rendering, the render pass path keeps its implicit subpass transitions.
+	std::unique_ptr<RenderGraph> renderGraph;
+	RenderGraph::ResourceId backBufferResource;
+	// The offscreen target with dynamic resolution, the back buffer otherwise.
+	RenderGraph::ResourceId sceneColorResource;
+	RenderGraph::ResourceId visibleDrawsResource;
+	RenderGraph::ResourceId drawCountResource;
+	RenderGraph::ResourceId objectDrawsResource;
+
+	// Loaded from resources/meshes, the triangle keeps its clip space positions so it needs no camera.
+	const std::string SCENE_MESH = "triangle.obj";
+	mesh::GpuMesh sceneMesh;
+
+	// The triangle at the root with smaller copies circling it as children, turning over time. Every node with a mesh
+	// draws sceneMesh, as it is the only one. Transforms go straight into the mapped instance buffer, one slice per
+	// frame in flight, host writes before the submit need no barrier.
+	const float SCENE_ROTATION_SPEED = 0.5f; // Radians per second.
+	Scene scene;
+	Scene::Handle sceneRoot;
+	gpu::Buffer instanceBuffer;
+	std::chrono::steady_clock::time_point sceneStart;
+
+	// Only created when the render graph and indirect count draws are available.
+	std::unique_ptr<GpuCuller> gpuCuller;
+	// Culls when the GPU does not, the surviving meshlets of the LOD picked per visible object are drawn as index ranges.
+	CpuCuller cpuCuller;
+	std::vector<CpuCuller::Object> cullObjects;
+	std::vector<uint32_t> visibleObjects;
+	std::vector<mesh::IndexRange> visibleRanges;
+	std::vector<VkDrawIndexedIndirectCommand> visibleDraws;
+	// The triangle is specified in clip space, so there is no camera yet.
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+
 	VkCommandPool commandPool;
-	VkCommandBuffer commandBuffer;
+	std::vector<VkCommandBuffer> commandBuffers;
+	VkCommandPool computeCommandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> computeCommandBuffers;
+
+	// What a recording depended on besides commandsVersion, compared every frame before it is submitted again.
+	struct StaticCommandBuffers {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE;
+		uint64_t version = 0; // 0 until recorded, and for recordings that must not be repeated.
+		VkExtent2D renderExtent{};
+		glm::mat4 viewProjection{};
+		std::vector<VkDrawIndexedIndirectCommand> draws;
+	};
+
+	struct CommandBufferStats {
+		uint32_t recordedFrames = 0;
+		uint32_t reusedFrames = 0;
+		double recordedMilliseconds = 0.0;
+		double reusedMilliseconds = 0.0;
+	};
+
+	// Indexed by currentFrame * swap chain image count + image index.
+	std::vector<StaticCommandBuffers> staticCommandBuffers;
+	// Bumped by everything a recording depends on that is not compared per entry: the swap chain, pipelines, the scene.
+	uint64_t commandsVersion = 1;
+	bool reuseCommandBuffers = ENABLE_STATIC_COMMAND_BUFFERS;
+	CommandBufferStats commandBufferStats;
+
+	std::vector<VkSemaphore> imageAvailableSemaphores;
+	std::vector<VkSemaphore> renderFinishedSemaphores; // One per swap chain image, as presentation may still hold it.
+	std::vector<VkFence> inFlightFences;
+	uint32_t currentFrame = 0;
+
+	// Both queues signal the number of the frame they finished, the other queue waits on it where the render graph says so.
+	// They outlive swap chain recreation, unlike the objects above.
+	VkSemaphore graphicsTimeline = VK_NULL_HANDLE;
+	VkSemaphore computeTimeline = VK_NULL_HANDLE;
+	uint64_t frameNumber = 0;
+	std::vector<uint64_t> computeFrameNumbers; // Last signaled by each frame in flight, its compute buffer is free after.
+
+	const std::chrono::seconds PROFILER_LOG_INTERVAL = std::chrono::seconds(5);
+	std::unique_ptr<gpu::DeviceClock> deviceClock; // Shared by both profilers, only with async compute.
+	std::unique_ptr<gpu::GpuProfiler> gpuProfiler;
+	std::unique_ptr<gpu::GpuProfiler> computeProfiler;
+	std::unique_ptr<gpu::QueueOverlap> queueOverlap;
+	std::chrono::steady_clock::time_point lastProfilerLog;
+
+	std::unique_ptr<FrameCapture> frameCapture;
+	std::unique_ptr<TextureStreamer> textureStreamer;
+	std::optional<TextureStreamer::TextureId> sceneTexture; // Without one the placeholder is sampled.
+	texture::Placeholder texturePlaceholder;
+	VkDescriptorPool textureDescriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> textureSets; // One per frame in flight.
+	std::vector<VkImageView> textureSetViews; // What each of textureSets points at.
+	std::unique_ptr<replay::CommandStreamWriter> commandCapture;
+	bool captureNextFrame = false;
+	bool captureContinuously = false;
 
 public: // Public Functions
 	HelloTriangleApp();
@@ -101,6 +306,7 @@ public: // Public Functions
 
 private: // Private Methods
 	void createWindow();
+	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 	std::vector<const char*> getRequiredExtensions() const;
 	void validateExtensions(const std::vector<const char*>& extensions) const;
@@ -121,22 +327,69 @@ private: // Private Methods
 
 	int32_t rateDeviceSuitability(VkPhysicalDevice device);
 
+	// Optional features
+	bool hasDeviceExtension(VkPhysicalDevice device, const char* extensionName) const;
+	OptionalFeatures queryOptionalFeatures(VkPhysicalDevice device) const;
+	bool useDynamicRendering() const;
+	bool useAsyncCompute() const;
+	bool useDynamicResolution() const;
+	bool useFrameCapture() const;
+	// Queue families resources used by both queues are shared between, empty without async compute.
+	std::vector<uint32_t> getSharedQueueFamilies();
+
 	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
 	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
 	void pickPhysicalDevice();
 	void createLogicalDevice();
+	void createCommandCapture();
 	void createSwapChain();
 	void createImageViews();
+	void cleanupSwapChain();
+	void recreateSwapChain();
 	void createRenderPass();
 
 	
 	VkShaderModule createShaderModule(const std::vector<char>& code, const std::string& shaderName);
 	void createGraphicsPipeline();
+	void createInstanceBuffer();
+	void createComputePipeline();
+	void createSceneObjects();
 
 	void createFramebuffers();
+	void createRenderGraph();
 	void createCommandPool();
-	void createCommandBuffer();
-	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	gpu::Context getGpuContext() const;
+	void loadMeshes();
+	void createCommandBuffers();
+	void createStaticCommandBuffers();
+	void destroyStaticCommandBuffers();
+	void invalidateStaticCommandBuffers();
+	void createProfiler();
+	void createResolutionController();
+	void createFrameCapture();
+	VkDeviceSize getTextureResidencyBudget() const;
+	void createTextureStreamer();
+	void createTextureDescriptorSets();
+	// Points the frame in flight's set at the scene texture's current view, after TextureStreamer::Update().
+	void updateTextureDescriptor(uint32_t frame);
+	void createSyncObjects();
+	void destroySyncObjects();
+	void createTimelineSemaphores();
+	void destroyTimelineSemaphores();
+
+	void updateRenderExtent();
+	void updateScene();
+	VkDeviceSize getInstanceOffset() const;
+	void selectDraws();
+	void recordDrawCommands(VkCommandBuffer commandBuffer) const;
+	// Updates the frame's data and records its command buffers, or picks the ones recorded for it before. Returns
+	// whether they were reused. computeCommandBuffer is VK_NULL_HANDLE without async compute.
+	bool prepareCommandBuffers(uint32_t imageIndex, VkCommandBuffer& commandBuffer, VkCommandBuffer& computeCommandBuffer);
+	bool canReuse(const StaticCommandBuffers& recorded) const;
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBuffer computeCommandBuffer, uint32_t imageIndex);
+	std::string reportCommandBufferStats();
+	void submitAsyncCompute(VkCommandBuffer computeCommandBuffer);
+	void drawFrame();
 };
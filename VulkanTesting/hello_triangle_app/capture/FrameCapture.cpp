@@ -0,0 +1,214 @@
+﻿#include "FrameCapture.hpp"
+
+#include <chrono>
+#include <filesystem>
+
+#include "../../utils/log.hpp"
+
+namespace
+{
+	constexpr uint32_t BYTES_PER_PIXEL = 4;
+}
+
+FrameCapture::FrameCapture(const gpu::Context& context, const std::string& directory, const uint32_t slotCount,
+                           const uint32_t encoderThreads)
+	: context(context), directory(directory), encoders(encoderThreads + 1) {
+	std::filesystem::create_directories(directory);
+
+	VkPhysicalDeviceMemoryProperties deviceMemoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(context.physicalDevice, &deviceMemoryProperties);
+
+	memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	for (uint32_t i = 0; i < deviceMemoryProperties.memoryTypeCount; i++) {
+		constexpr VkMemoryPropertyFlags CACHED = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		if ((deviceMemoryProperties.memoryTypes[i].propertyFlags & CACHED) == CACHED) {
+			memoryProperties = CACHED;
+			break;
+		}
+	}
+
+	slots.reserve(slotCount);
+	for (uint32_t i = 0; i < slotCount; i++) {
+		slots.push_back(std::make_unique<Slot>());
+	}
+}
+
+FrameCapture::~FrameCapture() {
+	encoders.Wait(pendingEncodes);
+
+	for (const std::unique_ptr<Slot>& slot : slots) {
+		if (slot->buffer.buffer != VK_NULL_HANDLE) {
+			gpu::destroyBuffer(context, slot->buffer);
+		}
+	}
+}
+
+bool FrameCapture::IsFormatSupported(const VkFormat format) {
+	switch (format) {
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool FrameCapture::RecordCopy(const VkCommandBuffer commandBuffer, const VkImage image, const VkFormat format,
+                              const VkExtent2D extent, const uint64_t frameNumber, const Output output) {
+	if (!IsFormatSupported(format)) {
+		UTIL_THROW("Frame capture does not support format " + std::to_string(format) + "!");
+	}
+
+	const VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * BYTES_PER_PIXEL;
+	Slot* slot = acquireSlot(size);
+	if (slot == nullptr) {
+		std::lock_guard lock(statsMutex);
+		stats.droppedCount++;
+		return false;
+	}
+
+	slot->frameNumber = frameNumber;
+	slot->extent = extent;
+	slot->order = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB ? capture::PixelOrder::Bgra
+	                                                                                      : capture::PixelOrder::Rgba;
+	slot->output = output;
+	slot->state.store(SlotState::Copying, std::memory_order_relaxed);
+
+	// Tightly packed rows, the encoders take the pitch as width * 4.
+	VkBufferImageCopy region{};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = {extent.width, extent.height, 1};
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer.buffer, 1, &region);
+
+	// Makes the copy visible to host reads once the frame's fence signaled.
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = slot->buffer.buffer;
+	barrier.size = size;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+	                     0, nullptr, 1, &barrier, 0, nullptr);
+
+	std::lock_guard lock(statsMutex);
+	stats.capturedCount++;
+	return true;
+}
+
+void FrameCapture::Collect(const uint64_t completedFrameNumber) {
+	for (const std::unique_ptr<Slot>& slot : slots) {
+		if (slot->state.load(std::memory_order_relaxed) != SlotState::Copying) continue;
+		if (slot->frameNumber > completedFrameNumber) continue;
+
+		slot->state.store(SlotState::Encoding, std::memory_order_relaxed);
+		Slot* encodedSlot = slot.get();
+		encoders.Run([this, encodedSlot] { encode(*encodedSlot); }, &pendingEncodes);
+	}
+}
+
+FrameCapture::Stats FrameCapture::GetStats() {
+	std::lock_guard lock(statsMutex);
+	return stats;
+}
+
+std::string FrameCapture::ReportStats() {
+	const Stats current = GetStats();
+	if (current.capturedCount == 0 && current.droppedCount == 0) return "";
+
+	const double encodeAverage = current.writtenCount > 0 ? current.encodeMilliseconds / current.writtenCount : 0.0;
+	std::string report = "Capture: " + std::to_string(current.capturedCount) + " frames copied, " +
+		std::to_string(current.droppedCount) + " dropped, " + std::to_string(current.writtenCount) + " written (" +
+		std::to_string(current.writtenBytes / (1024 * 1024)) + " MiB), " + std::to_string(encodeAverage) +
+		" ms encode per frame";
+	if (current.failedCount > 0) {
+		report += "\nCapture: " + std::to_string(current.failedCount) + " frames failed to write to " + directory;
+	}
+
+	std::lock_guard lock(statsMutex);
+	stats = {};
+	return report;
+}
+
+FrameCapture::Slot* FrameCapture::acquireSlot(const VkDeviceSize size) {
+	for (const std::unique_ptr<Slot>& slot : slots) {
+		// Pairs with the release of the encoder, its reads of the buffer are done before the next copy is recorded.
+		if (slot->state.load(std::memory_order_acquire) != SlotState::Free) continue;
+
+		// Grows with the captured extent, freeing is safe as nothing uses a free slot's buffer.
+		if (slot->buffer.size < size) {
+			if (slot->buffer.buffer != VK_NULL_HANDLE) {
+				gpu::destroyBuffer(context, slot->buffer);
+			}
+			slot->buffer = gpu::createBuffer(context, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryProperties);
+		}
+
+		return slot.get();
+	}
+
+	return nullptr;
+}
+
+void FrameCapture::encode(Slot& slot) {
+	const auto start = std::chrono::steady_clock::now();
+
+	if (!(memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+		VkMappedMemoryRange range{};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = slot.buffer.memory;
+		range.size = VK_WHOLE_SIZE;
+		vkInvalidateMappedMemoryRanges(context.device, 1, &range);
+	}
+
+	const uint8_t* pixels = static_cast<const uint8_t*>(slot.buffer.mapped);
+	uint64_t writtenBytes = 0;
+	const bool written = slot.output == Output::Qoi ? writeQoi(slot, pixels, writtenBytes)
+	                                                : appendToStream(slot, pixels, writtenBytes);
+
+	const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	slot.state.store(SlotState::Free, std::memory_order_release);
+
+	// Logging from here would serialize the encoders on the console, failures are reported by ReportStats().
+	std::lock_guard lock(statsMutex);
+	if (written) {
+		stats.writtenCount++;
+		stats.writtenBytes += writtenBytes;
+		stats.encodeMilliseconds += milliseconds;
+	} else {
+		stats.failedCount++;
+	}
+}
+
+bool FrameCapture::writeQoi(const Slot& slot, const uint8_t* pixels, uint64_t& writtenBytes) {
+	const std::vector<uint8_t> data = capture::encodeQoi(pixels, slot.extent.width, slot.extent.height,
+	                                                     slot.extent.width * BYTES_PER_PIXEL, slot.order);
+
+	std::ofstream file(directory + "/frame_" + std::to_string(slot.frameNumber) + ".qoi", std::ios::binary);
+	file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	writtenBytes = data.size();
+	return file.good();
+}
+
+bool FrameCapture::appendToStream(const Slot& slot, const uint8_t* pixels, uint64_t& writtenBytes) {
+	RawFrameHeader header{};
+	header.width = slot.extent.width;
+	header.height = slot.extent.height;
+	header.pixelOrder = static_cast<uint32_t>(slot.order);
+	header.frameNumber = slot.frameNumber;
+	const size_t size = static_cast<size_t>(slot.extent.width) * slot.extent.height * BYTES_PER_PIXEL;
+
+	// Written straight from the mapped buffer, the lock keeps each frame's header and pixels together.
+	std::lock_guard lock(streamMutex);
+	if (!stream.is_open()) {
+		stream.open(directory + "/frames.raw", std::ios::binary | std::ios::trunc);
+	}
+
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	stream.write(reinterpret_cast<const char*>(pixels), static_cast<std::streamsize>(size));
+	writtenBytes = sizeof(header) + size;
+	return stream.good();
+}
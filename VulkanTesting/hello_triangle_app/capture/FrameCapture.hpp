@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Qoi.hpp"
+#include "../gpu/Buffer.hpp"
+#include "../gpu/Context.hpp"
+#include "../../utils/JobSystem.hpp"
+
+// Reads rendered images back without the frame ever waiting on it. Copies go into a ring of host visible buffers,
+// which are only looked at once the frame that copied into them is known to be finished, and are then encoded and
+// written by threads of its own. When every buffer is still busy the frame is dropped rather than stalling rendering.
+class FrameCapture {
+public: // Properties
+	enum class Output {
+		Qoi, // One image file per frame.
+		RawStream, // Appended unencoded to a single file, the cheapest for capturing every frame.
+	};
+
+	// Every frame of the raw stream starts with this, the pixels follow tightly packed in pixelOrder. Frames are
+	// written in the order their encoders finish, which is not always the order they were rendered in.
+	struct RawFrameHeader {
+		char magic[4] = {'R', 'A', 'W', 'F'};
+		uint32_t width;
+		uint32_t height;
+		uint32_t pixelOrder; // capture::PixelOrder
+		uint64_t frameNumber;
+	};
+
+	struct Stats {
+		uint32_t capturedCount = 0;
+		uint32_t droppedCount = 0; // Every slot was still busy.
+		uint32_t writtenCount = 0;
+		uint32_t failedCount = 0;
+		uint64_t writtenBytes = 0;
+		double encodeMilliseconds = 0.0; // Summed over all encoder threads.
+	};
+
+private: // Member Variables
+	enum class SlotState : uint8_t {
+		Free,
+		Copying, // Recorded, the frame may still be running on the GPU.
+		Encoding, // Handed to an encoder, which frees it once written.
+	};
+
+	struct Slot {
+		gpu::Buffer buffer;
+		std::atomic<SlotState> state = SlotState::Free;
+		uint64_t frameNumber = 0;
+		VkExtent2D extent = {};
+		capture::PixelOrder order = capture::PixelOrder::Rgba;
+		Output output = Output::Qoi;
+	};
+
+	gpu::Context context;
+	std::string directory;
+	// Cached memory makes reading the copies on the CPU much faster, but is not always coherent.
+	VkMemoryPropertyFlags memoryProperties;
+
+	std::vector<std::unique_ptr<Slot>> slots;
+
+	// Separate from the shared job system, so slow disk writes never hold up jobs a frame waits on.
+	utils::JobSystem encoders;
+	utils::JobCounter pendingEncodes;
+
+	std::mutex streamMutex;
+	std::ofstream stream;
+
+	std::mutex statsMutex;
+	Stats stats;
+
+public: // Public Functions
+	// slotCount has to cover the frames in flight plus the ones still encoding, or frames get dropped.
+	FrameCapture(const gpu::Context& context, const std::string& directory, uint32_t slotCount, uint32_t encoderThreads);
+	// Waits for the encoders. Copies that were never collected are discarded.
+	~FrameCapture();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture(FrameCapture&&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// 8 bit RGBA and BGRA, what swap chains offer in practice.
+	static bool IsFormatSupported(VkFormat format);
+
+	// Records a copy of image, which has to be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL. Returns false when the frame
+	// is dropped because every slot is still busy.
+	bool RecordCopy(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkExtent2D extent, uint64_t frameNumber,
+	                Output output);
+	// Hands the copies of frames up to completedFrameNumber to the encoders. Only call once the GPU finished those frames,
+	// after waiting on their fences.
+	void Collect(uint64_t completedFrameNumber);
+
+	Stats GetStats();
+	// The stats since the last call, a line and one more for failures, empty without any, and starts over.
+	std::string ReportStats();
+
+private: // Private Methods
+	Slot* acquireSlot(VkDeviceSize size);
+	void encode(Slot& slot);
+	bool writeQoi(const Slot& slot, const uint8_t* pixels, uint64_t& writtenBytes);
+	bool appendToStream(const Slot& slot, const uint8_t* pixels, uint64_t& writtenBytes);
+};
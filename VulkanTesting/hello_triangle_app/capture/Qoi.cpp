@@ -0,0 +1,197 @@
+﻿#include "Qoi.hpp"
+
+#include <cstring>
+#include <string>
+
+#include "../../utils/log.hpp"
+
+namespace capture
+{
+	namespace
+	{
+		constexpr uint8_t OP_INDEX = 0x00; // 2 bit tag, 6 bit index into the color hash.
+		constexpr uint8_t OP_DIFF = 0x40; // 2 bit tag, 2 bits each for r, g and b differences in [-2, 1].
+		constexpr uint8_t OP_LUMA = 0x80; // 2 bit tag, 6 bit green difference, then 4 bits each for r - g and b - g.
+		constexpr uint8_t OP_RUN = 0xC0; // 2 bit tag, 6 bit run length minus one.
+		constexpr uint8_t OP_RGB = 0xFE;
+		constexpr uint8_t OP_RGBA = 0xFF;
+		constexpr uint8_t TAG_MASK = 0xC0;
+
+		constexpr uint32_t HEADER_SIZE = 14;
+		constexpr uint8_t END_MARKER[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+		// Run lengths 63 and 64 would collide with the OP_RGB and OP_RGBA tags.
+		constexpr uint32_t MAX_RUN = 62;
+
+		struct Color {
+			uint8_t r, g, b, a;
+
+			bool operator==(const Color& other) const = default;
+		};
+
+		uint32_t hashColor(const Color& color) {
+			return (color.r * 3 + color.g * 5 + color.b * 7 + color.a * 11) % 64;
+		}
+
+		void writeBigEndian(uint8_t* out, const uint32_t value) {
+			out[0] = static_cast<uint8_t>(value >> 24);
+			out[1] = static_cast<uint8_t>(value >> 16);
+			out[2] = static_cast<uint8_t>(value >> 8);
+			out[3] = static_cast<uint8_t>(value);
+		}
+
+		uint32_t readBigEndian(const uint8_t* in) {
+			return static_cast<uint32_t>(in[0]) << 24 | static_cast<uint32_t>(in[1]) << 16 |
+				static_cast<uint32_t>(in[2]) << 8 | static_cast<uint32_t>(in[3]);
+		}
+	}
+
+	std::vector<uint8_t> encodeQoi(const uint8_t* pixels, const uint32_t width, const uint32_t height, const uint32_t rowPitch,
+	                               const PixelOrder order) {
+		// Worst case is a full OP_RGBA per pixel, sized once so the loop writes through a plain pointer.
+		std::vector<uint8_t> data(HEADER_SIZE + static_cast<size_t>(width) * height * 5 + sizeof(END_MARKER));
+		uint8_t* out = data.data();
+
+		memcpy(out, "qoif", 4);
+		writeBigEndian(out + 4, width);
+		writeBigEndian(out + 8, height);
+		out[12] = 4; // Channels
+		out[13] = 0; // sRGB with linear alpha
+		out += HEADER_SIZE;
+
+		const uint32_t red = order == PixelOrder::Rgba ? 0 : 2;
+		const uint32_t blue = 2 - red;
+
+		Color seen[64] = {};
+		Color previous = {0, 0, 0, 255};
+		uint32_t run = 0;
+
+		for (uint32_t y = 0; y < height; y++) {
+			const uint8_t* row = pixels + static_cast<size_t>(y) * rowPitch;
+
+			for (uint32_t x = 0; x < width; x++) {
+				const uint8_t* pixel = row + x * 4;
+				const Color color = {pixel[red], pixel[1], pixel[blue], pixel[3]};
+
+				if (color == previous) {
+					run++;
+					if (run == MAX_RUN) {
+						*out++ = OP_RUN | (run - 1);
+						run = 0;
+					}
+					continue;
+				}
+
+				if (run > 0) {
+					*out++ = OP_RUN | (run - 1);
+					run = 0;
+				}
+
+				const uint32_t index = hashColor(color);
+				if (seen[index] == color) {
+					*out++ = OP_INDEX | index;
+				} else {
+					seen[index] = color;
+
+					if (color.a == previous.a) {
+						// Differences wrap around, as the decoder adds them modulo 256.
+						const int8_t dr = static_cast<int8_t>(color.r - previous.r);
+						const int8_t dg = static_cast<int8_t>(color.g - previous.g);
+						const int8_t db = static_cast<int8_t>(color.b - previous.b);
+						const int8_t drg = static_cast<int8_t>(dr - dg);
+						const int8_t dbg = static_cast<int8_t>(db - dg);
+
+						if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+							*out++ = OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+						} else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+							*out++ = OP_LUMA | (dg + 32);
+							*out++ = static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8));
+						} else {
+							*out++ = OP_RGB;
+							*out++ = color.r;
+							*out++ = color.g;
+							*out++ = color.b;
+						}
+					} else {
+						*out++ = OP_RGBA;
+						*out++ = color.r;
+						*out++ = color.g;
+						*out++ = color.b;
+						*out++ = color.a;
+					}
+				}
+
+				previous = color;
+			}
+		}
+
+		if (run > 0) {
+			*out++ = OP_RUN | (run - 1);
+		}
+
+		memcpy(out, END_MARKER, sizeof(END_MARKER));
+		out += sizeof(END_MARKER);
+
+		data.resize(out - data.data());
+		return data;
+	}
+
+	std::vector<uint8_t> decodeQoi(const std::vector<uint8_t>& data, uint32_t& width, uint32_t& height) {
+		if (data.size() < HEADER_SIZE + sizeof(END_MARKER) || memcmp(data.data(), "qoif", 4) != 0) {
+			UTIL_THROW("Not a QOI image!");
+		}
+
+		width = readBigEndian(data.data() + 4);
+		height = readBigEndian(data.data() + 8);
+
+		const size_t pixelCount = static_cast<size_t>(width) * height;
+		std::vector<uint8_t> pixels(pixelCount * 4);
+
+		const uint8_t* in = data.data() + HEADER_SIZE;
+		const uint8_t* end = data.data() + data.size() - sizeof(END_MARKER);
+
+		Color seen[64] = {};
+		Color color = {0, 0, 0, 255};
+		uint32_t run = 0;
+
+		for (size_t i = 0; i < pixelCount; i++) {
+			if (run > 0) {
+				run--;
+			} else {
+				if (in >= end) {
+					UTIL_THROW("QOI image ends after " + std::to_string(i) + " of " + std::to_string(pixelCount) + " pixels!");
+				}
+
+				const uint8_t op = *in++;
+				if (op == OP_RGB) {
+					color.r = in[0];
+					color.g = in[1];
+					color.b = in[2];
+					in += 3;
+				} else if (op == OP_RGBA) {
+					color = {in[0], in[1], in[2], in[3]};
+					in += 4;
+				} else if ((op & TAG_MASK) == OP_INDEX) {
+					color = seen[op];
+				} else if ((op & TAG_MASK) == OP_DIFF) {
+					color.r += ((op >> 4) & 3) - 2;
+					color.g += ((op >> 2) & 3) - 2;
+					color.b += (op & 3) - 2;
+				} else if ((op & TAG_MASK) == OP_LUMA) {
+					const int32_t dg = (op & 0x3F) - 32;
+					const uint8_t next = *in++;
+					color.r += dg + ((next >> 4) & 0x0F) - 8;
+					color.g += dg;
+					color.b += dg + (next & 0x0F) - 8;
+				} else {
+					run = op & 0x3F;
+				}
+
+				seen[hashColor(color)] = color;
+			}
+
+			memcpy(pixels.data() + i * 4, &color, 4);
+		}
+
+		return pixels;
+	}
+}
@@ -0,0 +1,22 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace capture
+{
+	// Byte order of the 4 byte pixels handed to the encoder, swap chains are usually BGRA.
+	enum class PixelOrder {
+		Rgba,
+		Bgra,
+	};
+
+	// Lossless "Quite OK Image" format: one pass over the pixels with a 64 entry hash of recent colors, runs and small
+	// deltas to the previous pixel. Several times faster than PNG's deflate at a similar size for rendered frames.
+	// rowPitch is in bytes, readbacks pad their rows. Always writes 4 channels, marked as sRGB.
+	std::vector<uint8_t> encodeQoi(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t rowPitch,
+	                               PixelOrder order = PixelOrder::Rgba);
+
+	// Tightly packed RGBA, throws on data that is not a complete QOI image.
+	std::vector<uint8_t> decodeQoi(const std::vector<uint8_t>& data, uint32_t& width, uint32_t& height);
+}
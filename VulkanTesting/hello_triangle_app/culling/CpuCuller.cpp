@@ -0,0 +1,336 @@
+﻿#include "CpuCuller.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CPU_CULLER_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CPU_CULLER_SSE
+#endif
+
+#include "../../utils/log.hpp"
+
+namespace
+{
+	constexpr uint32_t PLANE_COUNT = 6;
+	constexpr uint32_t ALL_PLANES = (1u << PLANE_COUNT) - 1;
+	constexpr uint32_t PADDING_ID = std::numeric_limits<uint32_t>::max();
+	// center + radius stays negative for any plane, so padding lanes are always culled.
+	constexpr float PADDING_RADIUS = -std::numeric_limits<float>::max();
+
+	// All kernels return a bit per lane of the block, set when the sphere is inside every active plane.
+
+	uint32_t visibleMaskScalar(const float* x, const float* y, const float* z, const float* r,
+	                           const culling::Frustum& frustum, const uint32_t planeMask) {
+		uint32_t visible = (1u << CpuCuller::BLOCK_SIZE) - 1;
+
+		for (uint32_t lane = 0; lane < CpuCuller::BLOCK_SIZE; lane++) {
+			for (uint32_t plane = 0; plane < PLANE_COUNT; plane++) {
+				if (!(planeMask & (1u << plane))) continue;
+
+				const glm::vec4& p = frustum[plane];
+				if (p.x * x[lane] + p.y * y[lane] + p.z * z[lane] + p.w + r[lane] < 0.0f) {
+					visible &= ~(1u << lane);
+					break;
+				}
+			}
+		}
+
+		return visible;
+	}
+
+#ifdef CPU_CULLER_SSE
+	uint32_t visibleMaskSse(const float* x, const float* y, const float* z, const float* r,
+	                        const culling::Frustum& frustum, const uint32_t planeMask) {
+		uint32_t outside = 0;
+
+		for (uint32_t half = 0; half < CpuCuller::BLOCK_SIZE; half += 4) {
+			const __m128 centerX = _mm_load_ps(x + half);
+			const __m128 centerY = _mm_load_ps(y + half);
+			const __m128 centerZ = _mm_load_ps(z + half);
+			const __m128 radius = _mm_load_ps(r + half);
+			__m128 outsideLanes = _mm_setzero_ps();
+
+			for (uint32_t plane = 0; plane < PLANE_COUNT; plane++) {
+				if (!(planeMask & (1u << plane))) continue;
+
+				const glm::vec4& p = frustum[plane];
+				__m128 distance = _mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(p.x)), _mm_set1_ps(p.w));
+				distance = _mm_add_ps(distance, _mm_mul_ps(centerY, _mm_set1_ps(p.y)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(centerZ, _mm_set1_ps(p.z)));
+				outsideLanes = _mm_or_ps(outsideLanes, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+			}
+
+			outside |= static_cast<uint32_t>(_mm_movemask_ps(outsideLanes)) << half;
+		}
+
+		return ~outside & ((1u << CpuCuller::BLOCK_SIZE) - 1);
+	}
+#endif
+
+#ifdef CPU_CULLER_AVX2
+	uint32_t visibleMaskAvx2(const float* x, const float* y, const float* z, const float* r,
+	                         const culling::Frustum& frustum, const uint32_t planeMask) {
+		const __m256 centerX = _mm256_load_ps(x);
+		const __m256 centerY = _mm256_load_ps(y);
+		const __m256 centerZ = _mm256_load_ps(z);
+		const __m256 radius = _mm256_load_ps(r);
+		__m256 outsideLanes = _mm256_setzero_ps();
+
+		for (uint32_t plane = 0; plane < PLANE_COUNT; plane++) {
+			if (!(planeMask & (1u << plane))) continue;
+
+			const glm::vec4& p = frustum[plane];
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(p.x)), _mm256_set1_ps(p.w));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(centerY, _mm256_set1_ps(p.y)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(centerZ, _mm256_set1_ps(p.z)));
+			outsideLanes = _mm256_or_ps(outsideLanes, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+		}
+
+		return ~static_cast<uint32_t>(_mm256_movemask_ps(outsideLanes)) & ((1u << CpuCuller::BLOCK_SIZE) - 1);
+	}
+#endif
+}
+
+CpuCuller::CpuCuller() : simd(GetBestSimd()) {}
+
+void CpuCuller::SetStaticObjects(const std::vector<Object>& objects) {
+	staticBlocks.clear();
+	bvhNodes.clear();
+
+	if (objects.empty()) return;
+
+	std::vector<Object> sorted = objects;
+	staticBlocks.reserve((objects.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	buildBvh(sorted);
+}
+
+void CpuCuller::SetDynamicObjects(const std::vector<Object>& objects) {
+	dynamicBlocks.clear();
+	fillBlocks(objects.data(), objects.size(), dynamicBlocks);
+}
+
+void CpuCuller::Cull(const culling::Frustum& frustum, std::vector<uint32_t>& visible) const {
+	if (!bvhNodes.empty()) {
+		struct StackEntry {
+			uint32_t node;
+			uint32_t planeMask; // Planes the node is not yet known to be fully inside of.
+		};
+
+		// A median split BVH over a million objects is about 15 levels deep.
+		std::array<StackEntry, 64> stack;
+		uint32_t stackSize = 0;
+		stack[stackSize++] = {0, ALL_PLANES};
+
+		while (stackSize > 0) {
+			const StackEntry entry = stack[--stackSize];
+			const BvhNode& node = bvhNodes[entry.node];
+			uint32_t planeMask = entry.planeMask;
+			bool outside = false;
+
+			for (uint32_t plane = 0; plane < PLANE_COUNT && !outside; plane++) {
+				if (!(planeMask & (1u << plane))) continue;
+
+				const glm::vec3 normal = glm::vec3(frustum[plane]);
+				const glm::vec3 positive = glm::vec3(normal.x >= 0.0f ? node.max.x : node.min.x,
+				                                     normal.y >= 0.0f ? node.max.y : node.min.y,
+				                                     normal.z >= 0.0f ? node.max.z : node.min.z);
+				const glm::vec3 negative = node.min + node.max - positive;
+
+				if (glm::dot(normal, positive) + frustum[plane].w < 0.0f) {
+					outside = true;
+				} else if (glm::dot(normal, negative) + frustum[plane].w >= 0.0f) {
+					planeMask &= ~(1u << plane);
+				}
+			}
+
+			if (outside) continue;
+
+			if (planeMask == 0) {
+				acceptBlocks(staticBlocks.data() + node.firstBlock, node.blockCount, visible);
+			} else if (node.leftChild == 0) {
+				cullBlocks(staticBlocks.data() + node.firstBlock, node.blockCount, frustum, planeMask, visible);
+			} else {
+				stack[stackSize++] = {node.leftChild + 1, planeMask};
+				stack[stackSize++] = {node.leftChild, planeMask};
+			}
+		}
+	}
+
+	cullBlocks(dynamicBlocks.data(), dynamicBlocks.size(), frustum, ALL_PLANES, visible);
+}
+
+size_t CpuCuller::GetObjectCount() const {
+	size_t count = 0;
+
+	for (const std::vector<SphereBlock>* blocks : {&staticBlocks, &dynamicBlocks}) {
+		for (const SphereBlock& block : *blocks) {
+			count += std::count_if(std::begin(block.id), std::end(block.id), [](const uint32_t id) {
+				return id != PADDING_ID;
+			});
+		}
+	}
+
+	return count;
+}
+
+CpuCuller::Simd CpuCuller::GetBestSimd() {
+#if defined(CPU_CULLER_AVX2)
+	return Simd::Avx2;
+#elif defined(CPU_CULLER_SSE)
+	return Simd::Sse;
+#else
+	return Simd::Scalar;
+#endif
+}
+
+CpuCuller::Simd CpuCuller::GetSimd() const {
+	return simd;
+}
+
+void CpuCuller::SetSimd(const Simd simd) {
+	if (simd > GetBestSimd()) {
+		UTIL_THROW("Requested culling SIMD path is not compiled in, see VULKAN_TESTING_AVX2");
+	}
+
+	this->simd = simd;
+}
+
+void CpuCuller::fillBlocks(const Object* objects, const size_t count, std::vector<SphereBlock>& blocks) {
+	for (size_t first = 0; first < count; first += BLOCK_SIZE) {
+		SphereBlock& block = blocks.emplace_back();
+
+		for (uint32_t lane = 0; lane < BLOCK_SIZE; lane++) {
+			const bool isPadding = first + lane >= count;
+			const glm::vec4 sphere = isPadding ? glm::vec4(0.0f, 0.0f, 0.0f, PADDING_RADIUS) : objects[first + lane].boundingSphere;
+
+			block.centerX[lane] = sphere.x;
+			block.centerY[lane] = sphere.y;
+			block.centerZ[lane] = sphere.z;
+			block.radius[lane] = sphere.w;
+			block.id[lane] = isPadding ? PADDING_ID : objects[first + lane].id;
+		}
+	}
+}
+
+void CpuCuller::buildBvh(std::vector<Object>& objects) {
+	struct BuildEntry {
+		uint32_t node;
+		size_t begin;
+		size_t end;
+	};
+
+	// Explicit stack, processed depth first left to right so leaves append their blocks in subtree order.
+	std::vector<BuildEntry> stack = {{0, 0, objects.size()}};
+	bvhNodes.push_back({});
+
+	while (!stack.empty()) {
+		const BuildEntry entry = stack.back();
+		stack.pop_back();
+
+		glm::vec3 boundsMin(std::numeric_limits<float>::max());
+		glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+		glm::vec3 centroidMin = boundsMin;
+		glm::vec3 centroidMax = boundsMax;
+
+		for (size_t i = entry.begin; i < entry.end; i++) {
+			const glm::vec3 center = glm::vec3(objects[i].boundingSphere);
+			const float radius = objects[i].boundingSphere.w;
+			boundsMin = glm::min(boundsMin, center - radius);
+			boundsMax = glm::max(boundsMax, center + radius);
+			centroidMin = glm::min(centroidMin, center);
+			centroidMax = glm::max(centroidMax, center);
+		}
+
+		bvhNodes[entry.node].min = boundsMin;
+		bvhNodes[entry.node].max = boundsMax;
+
+		const size_t count = entry.end - entry.begin;
+		if (count <= MAX_LEAF_BLOCKS * BLOCK_SIZE) {
+			bvhNodes[entry.node].firstBlock = static_cast<uint32_t>(staticBlocks.size());
+			bvhNodes[entry.node].leftChild = 0;
+			fillBlocks(objects.data() + entry.begin, count, staticBlocks);
+			bvhNodes[entry.node].blockCount = static_cast<uint32_t>(staticBlocks.size()) - bvhNodes[entry.node].firstBlock;
+			continue;
+		}
+
+		// Median along the widest centroid axis, rounded so the left half fills its blocks completely.
+		const glm::vec3 extent = centroidMax - centroidMin;
+		const int axis = extent.x > extent.y && extent.x > extent.z ? 0 : (extent.y > extent.z ? 1 : 2);
+		const size_t half = (count / 2 + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+		const size_t middle = entry.begin + half;
+
+		std::nth_element(objects.begin() + static_cast<ptrdiff_t>(entry.begin),
+		                 objects.begin() + static_cast<ptrdiff_t>(middle),
+		                 objects.begin() + static_cast<ptrdiff_t>(entry.end),
+		                 [axis](const Object& a, const Object& b) {
+			                 return a.boundingSphere[axis] < b.boundingSphere[axis];
+		                 });
+
+		const uint32_t leftChild = static_cast<uint32_t>(bvhNodes.size());
+		bvhNodes[entry.node].leftChild = leftChild;
+		bvhNodes.push_back({});
+		bvhNodes.push_back({});
+
+		stack.push_back({leftChild + 1, middle, entry.end});
+		stack.push_back({leftChild, entry.begin, middle});
+	}
+
+	// Children always come after their parent, so walking backwards sees them finished first.
+	for (size_t i = bvhNodes.size(); i-- > 0;) {
+		BvhNode& node = bvhNodes[i];
+		if (node.leftChild == 0) continue;
+
+		const BvhNode& left = bvhNodes[node.leftChild];
+		const BvhNode& right = bvhNodes[node.leftChild + 1];
+		node.firstBlock = left.firstBlock;
+		node.blockCount = right.firstBlock + right.blockCount - left.firstBlock;
+	}
+}
+
+void CpuCuller::cullBlocks(const SphereBlock* blocks, const size_t blockCount, const culling::Frustum& frustum,
+                           const uint32_t planeMask, std::vector<uint32_t>& visible) const {
+	for (size_t i = 0; i < blockCount; i++) {
+		const SphereBlock& block = blocks[i];
+		uint32_t mask;
+
+		switch (simd) {
+#ifdef CPU_CULLER_AVX2
+			case Simd::Avx2:
+				mask = visibleMaskAvx2(block.centerX, block.centerY, block.centerZ, block.radius, frustum, planeMask);
+				break;
+#endif
+#ifdef CPU_CULLER_SSE
+			case Simd::Sse:
+				mask = visibleMaskSse(block.centerX, block.centerY, block.centerZ, block.radius, frustum, planeMask);
+				break;
+#endif
+			default:
+				mask = visibleMaskScalar(block.centerX, block.centerY, block.centerZ, block.radius, frustum, planeMask);
+				break;
+		}
+
+		while (mask != 0) {
+			visible.emplace_back(block.id[std::countr_zero(mask)]);
+			mask &= mask - 1;
+		}
+	}
+}
+
+void CpuCuller::acceptBlocks(const SphereBlock* blocks, const size_t blockCount, std::vector<uint32_t>& visible) {
+	for (size_t i = 0; i < blockCount; i++) {
+		for (const uint32_t id : blocks[i].id) {
+			if (id != PADDING_ID) {
+				visible.emplace_back(id);
+			}
+		}
+	}
+}
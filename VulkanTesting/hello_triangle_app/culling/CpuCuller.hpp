@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.hpp"
+
+// Frustum culling on the CPU for when the GPU path is not available.
+// Bounds are stored as structure of arrays in blocks of eight, so one block is one AVX2 or two SSE iterations.
+// Static objects are additionally ordered by a BVH, letting whole subtrees be rejected or accepted at once.
+class CpuCuller {
+public: // Properties
+	struct Object {
+		glm::vec4 boundingSphere; // xyz center, w radius
+		uint32_t id; // Reported back in the visible list.
+	};
+
+	enum class Simd {
+		Scalar,
+		Sse,
+		Avx2,
+	};
+
+	static constexpr uint32_t BLOCK_SIZE = 8;
+	static constexpr uint32_t MAX_LEAF_BLOCKS = 4;
+
+private: // Member Variables
+	struct alignas(32) SphereBlock {
+		float centerX[BLOCK_SIZE];
+		float centerY[BLOCK_SIZE];
+		float centerZ[BLOCK_SIZE];
+		float radius[BLOCK_SIZE]; // Padding lanes have a radius no plane can accept.
+		uint32_t id[BLOCK_SIZE];
+	};
+
+	struct BvhNode {
+		glm::vec3 min;
+		glm::vec3 max;
+		// Blocks of the whole subtree are contiguous, so a fully visible node is a single range copy.
+		uint32_t firstBlock;
+		uint32_t blockCount;
+		uint32_t leftChild; // Right child is leftChild + 1, 0 for leaves as the root is never a child.
+	};
+
+	std::vector<SphereBlock> staticBlocks;
+	std::vector<BvhNode> bvhNodes;
+	std::vector<SphereBlock> dynamicBlocks;
+
+	Simd simd;
+
+public: // Public Functions
+	CpuCuller();
+
+	// Rebuilds the BVH, meant for objects that do not move.
+	void SetStaticObjects(const std::vector<Object>& objects);
+	// Tested linearly every frame, cheap to replace.
+	void SetDynamicObjects(const std::vector<Object>& objects);
+
+	// Visible ids are appended, static objects in BVH order first.
+	void Cull(const culling::Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+	size_t GetObjectCount() const;
+	static Simd GetBestSimd();
+	Simd GetSimd() const;
+	// Lets benchmarks compare against the narrower paths, throws for paths not compiled in.
+	void SetSimd(Simd simd);
+
+private: // Private Methods
+	static void fillBlocks(const Object* objects, size_t count, std::vector<SphereBlock>& blocks);
+	void buildBvh(std::vector<Object>& objects);
+
+	void cullBlocks(const SphereBlock* blocks, size_t blockCount, const culling::Frustum& frustum,
+	                uint32_t planeMask, std::vector<uint32_t>& visible) const;
+	static void acceptBlocks(const SphereBlock* blocks, size_t blockCount, std::vector<uint32_t>& visible);
+};
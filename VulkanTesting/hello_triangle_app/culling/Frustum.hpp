@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include <array>
+
+#include <glm/glm.hpp>
+
+namespace culling
+{
+	// Plane as (normal, distance), a point p is inside when dot(normal, p) + distance >= 0.
+	using Frustum = std::array<glm::vec4, 6>;
+
+	// Gribb/Hartmann extraction for Vulkan clip space, where depth runs from 0 to w.
+	inline Frustum extractFrustum(const glm::mat4& viewProjection) {
+		const glm::mat4 rows = glm::transpose(viewProjection);
+
+		Frustum frustum = {
+			rows[3] + rows[0], // Left
+			rows[3] - rows[0], // Right
+			rows[3] + rows[1], // Bottom
+			rows[3] - rows[1], // Top
+			rows[2],           // Near
+			rows[3] - rows[2], // Far
+		};
+
+		for (glm::vec4& plane : frustum) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+
+		return frustum;
+	}
+}
@@ -0,0 +1,256 @@
+﻿#include "GpuCuller.hpp"
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+#include "../../utils/log.hpp"
+
+GpuCuller::GpuCuller(const gpu::Context& context, const VkShaderModule cullShader, const uint32_t maxObjects,
+                     const VkBuffer instanceBuffer, const uint32_t framesInFlight, const std::vector<uint32_t>& queueFamilies)
+	: context(context), maxObjects(maxObjects), framesInFlight(framesInFlight), queueFamilies(queueFamilies),
+	  instanceBuffer(instanceBuffer) {
+	createBuffers();
+	createDescriptorSet();
+	createPipeline(cullShader);
+}
+
+GpuCuller::~GpuCuller() {
+	vkDestroyPipeline(context.device, pipeline, context.allocator);
+	vkDestroyPipelineLayout(context.device, pipelineLayout, context.allocator);
+	vkDestroyDescriptorPool(context.device, descriptorPool, context.allocator);
+	vkDestroyDescriptorSetLayout(context.device, descriptorSetLayout, context.allocator);
+
+	for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+		gpu::destroyBuffer(context, drawCountBuffers[frame]);
+		gpu::destroyBuffer(context, visibleDrawBuffers[frame]);
+	}
+	gpu::destroyBuffer(context, objectDrawBuffer);
+}
+
+void GpuCuller::SetObjects(const std::vector<VkDrawIndexedIndirectCommand>& draws) {
+	if (draws.size() > maxObjects) {
+		UTIL_THROW("GpuCuller was created for " + std::to_string(maxObjects) + " objects, got " + std::to_string(draws.size()));
+	}
+
+	objectCount = static_cast<uint32_t>(draws.size());
+	objectDraws = draws;
+	dirtyObjects.clear();
+	isDirty.assign(draws.size(), false);
+	if (objectCount == 0) return;
+
+	gpu::uploadBuffer(context, objectDrawBuffer, objectDraws.data(), objectDraws.size() * sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void GpuCuller::SetObjectDraw(const uint32_t object, const VkDrawIndexedIndirectCommand& draw) {
+	if (object >= objectCount) {
+		UTIL_THROW("Object " + std::to_string(object) + " does not exist, there are " + std::to_string(objectCount));
+	}
+
+	VkDrawIndexedIndirectCommand& current = objectDraws[object];
+	if (current.indexCount == draw.indexCount && current.instanceCount == draw.instanceCount &&
+	    current.firstIndex == draw.firstIndex && current.vertexOffset == draw.vertexOffset &&
+	    current.firstInstance == draw.firstInstance) {
+		return;
+	}
+
+	current = draw;
+	if (!isDirty[object]) {
+		isDirty[object] = true;
+		dirtyObjects.push_back(object);
+	}
+}
+
+void GpuCuller::RecordClear(const VkCommandBuffer commandBuffer, const uint32_t frameIndex) const {
+	vkCmdFillBuffer(commandBuffer, drawCountBuffers[frameIndex].buffer, 0, sizeof(uint32_t), 0);
+}
+
+void GpuCuller::RecordUpdates(const VkCommandBuffer commandBuffer) {
+	// vkCmdUpdateBuffer takes at most 64 KiB per call.
+	constexpr uint32_t MAX_DRAWS_PER_UPDATE = 65536 / sizeof(VkDrawIndexedIndirectCommand);
+
+	std::sort(dirtyObjects.begin(), dirtyObjects.end());
+
+	for (size_t first = 0; first < dirtyObjects.size();) {
+		size_t last = first + 1;
+		while (last < dirtyObjects.size() && dirtyObjects[last] == dirtyObjects[last - 1] + 1 &&
+		       last - first < MAX_DRAWS_PER_UPDATE) {
+			last++;
+		}
+
+		const uint32_t object = dirtyObjects[first];
+		vkCmdUpdateBuffer(commandBuffer, objectDrawBuffer.buffer, object * sizeof(VkDrawIndexedIndirectCommand),
+		                  (last - first) * sizeof(VkDrawIndexedIndirectCommand), &objectDraws[object]);
+		first = last;
+	}
+
+	for (const uint32_t object : dirtyObjects) {
+		isDirty[object] = false;
+	}
+	dirtyObjects.clear();
+}
+
+bool GpuCuller::HasUpdates() const {
+	return !dirtyObjects.empty();
+}
+
+void GpuCuller::RecordCull(const VkCommandBuffer commandBuffer, const glm::mat4& viewProjection,
+                           const uint32_t firstInstance, const uint32_t frameIndex) const {
+	if (objectCount == 0) return;
+
+	PushConstants pushConstants{};
+	pushConstants.frustum = culling::extractFrustum(viewProjection);
+	pushConstants.objectCount = objectCount;
+	pushConstants.firstInstance = firstInstance;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[frameIndex], 0,
+	                        nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pushConstants);
+	vkCmdDispatch(commandBuffer, (objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+}
+
+void GpuCuller::RecordDraw(const VkCommandBuffer commandBuffer, const PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount,
+                           const uint32_t frameIndex) const {
+	cmdDrawIndexedIndirectCount(commandBuffer, visibleDrawBuffers[frameIndex].buffer, 0, drawCountBuffers[frameIndex].buffer, 0,
+	                            objectCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+VkBuffer GpuCuller::GetObjectDrawBuffer() const {
+	return objectDrawBuffer.buffer;
+}
+
+VkBuffer GpuCuller::GetVisibleDrawBuffer(const uint32_t frameIndex) const {
+	return visibleDrawBuffers[frameIndex].buffer;
+}
+
+VkBuffer GpuCuller::GetDrawCountBuffer(const uint32_t frameIndex) const {
+	return drawCountBuffers[frameIndex].buffer;
+}
+
+uint32_t GpuCuller::GetObjectCount() const {
+	return objectCount;
+}
+
+void GpuCuller::createBuffers() {
+	const VkDeviceSize drawStreamSize = static_cast<VkDeviceSize>(maxObjects) * sizeof(VkDrawIndexedIndirectCommand);
+
+	objectDrawBuffer = gpu::createBuffer(context, drawStreamSize,
+	                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, queueFamilies);
+
+	for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+		visibleDrawBuffers.push_back(gpu::createBuffer(context, drawStreamSize,
+		                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+		drawCountBuffers.push_back(gpu::createBuffer(context, sizeof(uint32_t),
+		                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+	}
+}
+
+void GpuCuller::createDescriptorSet() {
+	// Instances, per object draws, compacted draws, draw count. Same order as the bindings in cull.comp.
+	constexpr uint32_t BINDING_COUNT = 4;
+
+	std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(context.device, &layoutInfo, context.allocator, &descriptorSetLayout) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create culling descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = BINDING_COUNT * framesInFlight;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = framesInFlight;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(context.device, &poolInfo, context.allocator, &descriptorPool) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create culling descriptor pool!");
+	}
+
+	const std::vector<VkDescriptorSetLayout> layouts(framesInFlight, descriptorSetLayout);
+	descriptorSets.resize(framesInFlight);
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = descriptorPool;
+	allocateInfo.descriptorSetCount = framesInFlight;
+	allocateInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(context.device, &allocateInfo, descriptorSets.data()) != VK_SUCCESS) {
+		UTIL_THROW("Failed to allocate culling descriptor sets!");
+	}
+
+	for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+		const std::array<VkBuffer, BINDING_COUNT> buffers = {
+			instanceBuffer, objectDrawBuffer.buffer, visibleDrawBuffers[frame].buffer, drawCountBuffers[frame].buffer
+		};
+
+		std::array<VkDescriptorBufferInfo, BINDING_COUNT> bufferInfos{};
+		std::array<VkWriteDescriptorSet, BINDING_COUNT> writes{};
+
+		for (uint32_t i = 0; i < writes.size(); i++) {
+			bufferInfos[i].buffer = buffers[i];
+			bufferInfos[i].offset = 0;
+			bufferInfos[i].range = VK_WHOLE_SIZE;
+
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = descriptorSets[frame];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(context.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
+
+void GpuCuller::createPipeline(const VkShaderModule cullShader) {
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(context.device, &pipelineLayoutInfo, context.allocator, &pipelineLayout) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create culling pipeline layout!");
+	}
+
+	VkPipelineShaderStageCreateInfo stageInfo{};
+	stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	stageInfo.module = cullShader;
+	stageInfo.pName = "main";
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = stageInfo;
+	pipelineInfo.layout = pipelineLayout;
+
+	if (vkCreateComputePipelines(context.device, VK_NULL_HANDLE, 1, &pipelineInfo, context.allocator, &pipeline) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create culling pipeline!");
+	}
+}
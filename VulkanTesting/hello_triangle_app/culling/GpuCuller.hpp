@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include "Frustum.hpp"
+#include "../gpu/Buffer.hpp"
+
+// Frustum culls objects in a compute shader and compacts the survivors into an indirect draw stream,
+// so the CPU records the same three commands whether there are a thousand objects or a million.
+// Object i is culled by the bounding sphere of Scene::Instance i, read from the instance buffer every frame.
+// The compacted draws and their count exist once per frame in flight, so culling the next frame (possibly on another
+// queue) does not have to wait for the previous one to finish drawing.
+class GpuCuller {
+public: // Properties
+	static constexpr uint32_t WORKGROUP_SIZE = 64; // Has to match local_size_x in cull.comp.
+
+private: // Member Variables
+	struct PushConstants {
+		culling::Frustum frustum;
+		uint32_t objectCount;
+		uint32_t firstInstance;
+	};
+
+	gpu::Context context;
+	uint32_t maxObjects;
+	uint32_t framesInFlight;
+	std::vector<uint32_t> queueFamilies;
+	uint32_t objectCount = 0;
+
+	// Mirror of objectDrawBuffer, so unchanged draws are never uploaded again.
+	std::vector<VkDrawIndexedIndirectCommand> objectDraws;
+	std::vector<uint32_t> dirtyObjects;
+	std::vector<bool> isDirty;
+
+	VkBuffer instanceBuffer;
+	gpu::Buffer objectDrawBuffer;
+	std::vector<gpu::Buffer> visibleDrawBuffers;
+	std::vector<gpu::Buffer> drawCountBuffers;
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorPool descriptorPool;
+	std::vector<VkDescriptorSet> descriptorSets; // One per frame in flight.
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+
+public: // Public Functions
+	// The shader module is only needed during construction, it and the buffer of Scene::Instance stay owned by the caller.
+	// With more than one queue family in queueFamilies the per object draws are shared between them, as they are uploaded
+	// on the queue of context but read wherever culling runs. The per frame outputs stay exclusive.
+	GpuCuller(const gpu::Context& context, VkShaderModule cullShader, uint32_t maxObjects, VkBuffer instanceBuffer,
+	          uint32_t framesInFlight, const std::vector<uint32_t>& queueFamilies = {});
+	~GpuCuller();
+
+	GpuCuller(const GpuCuller&) = delete;
+	GpuCuller(GpuCuller&&) = delete;
+	GpuCuller& operator=(const GpuCuller&) = delete;
+
+	// Uploads through staging into a device local buffer, not meant to be called every frame.
+	void SetObjects(const std::vector<VkDrawIndexedIndirectCommand>& draws);
+
+	// Changes what one object draws, for example when it switches LOD. Takes effect with the next RecordUpdates().
+	void SetObjectDraw(uint32_t object, const VkDrawIndexedIndirectCommand& draw);
+
+	// Have to run before RecordCull() every frame, with a transfer to compute barrier in between.
+	void RecordClear(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+	// Writes the draws changed since the last call inline with vkCmdUpdateBuffer, runs of neighbours as one command.
+	void RecordUpdates(VkCommandBuffer commandBuffer);
+	// Whether RecordUpdates() has anything to write, command buffers recorded before then draw the old objects.
+	bool HasUpdates() const;
+	// The instances of this frame start at firstInstance in the instance buffer.
+	void RecordCull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, uint32_t firstInstance,
+	                uint32_t frameIndex) const;
+	// Expects pipeline, index buffer and dynamic state to be bound already.
+	void RecordDraw(VkCommandBuffer commandBuffer, PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount,
+	                uint32_t frameIndex) const;
+
+	VkBuffer GetObjectDrawBuffer() const;
+	VkBuffer GetVisibleDrawBuffer(uint32_t frameIndex) const;
+	VkBuffer GetDrawCountBuffer(uint32_t frameIndex) const;
+	uint32_t GetObjectCount() const;
+
+private: // Private Methods
+	void createBuffers();
+	void createDescriptorSet();
+	void createPipeline(VkShaderModule cullShader);
+};
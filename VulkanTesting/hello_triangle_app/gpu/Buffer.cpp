@@ -0,0 +1,76 @@
+﻿#include "Buffer.hpp"
+
+#include <cstring>
+#include <string>
+
+#include "Memory.hpp"
+#include "../../utils/log.hpp"
+
+namespace gpu
+{
+	Buffer createBuffer(const Context& context, const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties,
+	                    const std::vector<uint32_t>& queueFamilies) {
+		Buffer buffer;
+		buffer.size = size;
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (queueFamilies.size() > 1) {
+			bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+			bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+		}
+
+		if (vkCreateBuffer(context.device, &bufferInfo, context.allocator, &buffer.buffer) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create buffer of " + std::to_string(size) + " bytes!");
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetBufferMemoryRequirements(context.device, buffer.buffer, &memoryRequirements);
+
+		VkMemoryAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = memoryRequirements.size;
+		allocateInfo.memoryTypeIndex = findMemoryType(context.physicalDevice, memoryRequirements.memoryTypeBits, properties);
+
+		if (vkAllocateMemory(context.device, &allocateInfo, context.allocator, &buffer.memory) != VK_SUCCESS) {
+			UTIL_THROW("Failed to allocate buffer memory!");
+		}
+
+		vkBindBufferMemory(context.device, buffer.buffer, buffer.memory, 0);
+
+		if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			vkMapMemory(context.device, buffer.memory, 0, size, 0, &buffer.mapped);
+		}
+
+		return buffer;
+	}
+
+	void destroyBuffer(const Context& context, Buffer& buffer) {
+		vkDestroyBuffer(context.device, buffer.buffer, context.allocator);
+		vkFreeMemory(context.device, buffer.memory, context.allocator);
+		buffer = {};
+	}
+
+	void uploadBuffer(const Context& context, const Buffer& destination, const void* data, const VkDeviceSize size, const VkDeviceSize offset) {
+		Buffer staging = createBuffer(context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		memcpy(staging.mapped, data, size);
+		if (context.uploadObserver) context.uploadObserver(destination.buffer, destination.size, data, size, offset);
+
+		const VkCommandBuffer commandBuffer = beginOneTimeCommands(context);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = 0;
+		copyRegion.dstOffset = offset;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(commandBuffer, staging.buffer, destination.buffer, 1, &copyRegion);
+
+		endOneTimeCommands(context, commandBuffer);
+		destroyBuffer(context, staging);
+	}
+}
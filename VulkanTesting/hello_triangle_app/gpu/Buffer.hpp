@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Context.hpp"
+
+namespace gpu
+{
+	struct Buffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr; // Host visible buffers stay mapped for their whole lifetime.
+	};
+
+	// Shared concurrently between queueFamilies when there are several, for data every queue reads without ownership
+	// transfers. Exclusive to whichever family uses it first otherwise.
+	Buffer createBuffer(const Context& context, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+	                    const std::vector<uint32_t>& queueFamilies = {});
+	void destroyBuffer(const Context& context, Buffer& buffer);
+
+	// Goes through a temporary staging buffer, the destination needs VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+	void uploadBuffer(const Context& context, const Buffer& destination, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+}
@@ -0,0 +1,49 @@
+﻿#include "Context.hpp"
+
+#include <string>
+
+#include "../../utils/log.hpp"
+
+namespace gpu
+{
+	VkCommandBuffer beginOneTimeCommands(const Context& context) {
+		VkCommandBufferAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = context.commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(context.device, &allocateInfo, &commandBuffer) != VK_SUCCESS) {
+			UTIL_THROW("Failed to allocate one time command buffer!");
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			UTIL_THROW("Failed to begin recording one time command buffer!");
+		}
+
+		return commandBuffer;
+	}
+
+	void endOneTimeCommands(const Context& context, const VkCommandBuffer commandBuffer) {
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			UTIL_THROW("Failed to end recording one time command buffer!");
+		}
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+
+		if (vkQueueSubmit(context.queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			UTIL_THROW("Failed to submit one time command buffer!");
+		}
+
+		vkQueueWaitIdle(context.queue);
+		vkFreeCommandBuffers(context.device, context.commandPool, 1, &commandBuffer);
+	}
+}
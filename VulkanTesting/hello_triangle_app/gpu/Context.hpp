@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include <functional>
+
+#include <vulkan/vulkan.h>
+
+namespace gpu
+{
+	// Handles subsystems need to create their own resources and upload to them.
+	struct Context {
+		VkPhysicalDevice physicalDevice;
+		VkDevice device;
+		VkCommandPool commandPool;
+		VkQueue queue; // Used for one-off uploads, must belong to the family of commandPool.
+		const VkAllocationCallbacks* allocator = nullptr; // Host memory for every object created through the context.
+
+		// Sees the contents of every upload while set, the command stream capture records them through it.
+		std::function<void(VkBuffer destination, VkDeviceSize destinationSize, const void* data, VkDeviceSize size,
+		                   VkDeviceSize offset)> uploadObserver;
+	};
+
+	// For work done once at load time, endOneTimeCommands() waits for the queue to finish it.
+	VkCommandBuffer beginOneTimeCommands(const Context& context);
+	void endOneTimeCommands(const Context& context, VkCommandBuffer commandBuffer);
+}
@@ -0,0 +1,27 @@
+﻿#include "DeviceClock.hpp"
+
+#include "../../utils/log.hpp"
+
+namespace gpu
+{
+	DeviceClock::DeviceClock(const VkDevice device, const PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps)
+		: device(device), getCalibratedTimestamps(getCalibratedTimestamps) {
+		Sample();
+	}
+
+	void DeviceClock::Sample() {
+		VkCalibratedTimestampInfoEXT info{};
+		info.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		info.timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+
+		uint64_t maxDeviation;
+		if (getCalibratedTimestamps(device, 1, &info, &now, &maxDeviation) != VK_SUCCESS) {
+			UTIL_THROW("Failed to read the device clock!");
+		}
+	}
+
+	uint64_t DeviceClock::Extend(const uint64_t timestamp, const uint32_t validBits) const {
+		const uint64_t mask = validBits >= 64 ? ~uint64_t{0} : (uint64_t{1} << validBits) - 1;
+		return now - ((now - timestamp) & mask);
+	}
+}
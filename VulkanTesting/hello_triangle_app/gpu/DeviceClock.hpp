@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+namespace gpu
+{
+	// The device time domain of VK_EXT_calibrated_timestamps, which timestamps written on any queue are comparable with.
+	// Query results only keep the timestampValidBits of their queue family, so queues of different widths wrap at
+	// different points. Extend() puts them back on the full device clock, sampled once per frame.
+	class DeviceClock {
+	private: // Member Variables
+		VkDevice device;
+		PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps;
+		uint64_t now = 0;
+
+	public: // Public Functions
+		DeviceClock(VkDevice device, PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps);
+
+		DeviceClock(const DeviceClock&) = delete;
+		DeviceClock(DeviceClock&&) = delete;
+		DeviceClock& operator=(const DeviceClock&) = delete;
+
+		// Call before reading results, after waiting on the frame's fence.
+		void Sample();
+		// A timestamp written before the last Sample(), less than a wrap of its valid bits ago.
+		uint64_t Extend(uint64_t timestamp, uint32_t validBits) const;
+	};
+}
@@ -0,0 +1,163 @@
+﻿#include "GpuProfiler.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "../../utils/log.hpp"
+
+namespace gpu
+{
+	GpuProfiler::GpuProfiler(const VkPhysicalDevice physicalDevice, const VkDevice device, const uint32_t queueFamilyIndex,
+	                         const uint32_t framesInFlight, const VkAllocationCallbacks* allocator, const uint32_t maxScopes)
+		: device(device), allocator(allocator), maxScopes(maxScopes), frames(framesInFlight) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		nanosecondsPerTick = properties.limits.timestampPeriod;
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		supported = queueFamilyIndex < queueFamilyCount && queueFamilies[queueFamilyIndex].timestampValidBits > 0;
+		timestampValidBits = supported ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+		if (!supported) {
+			UTIL_WARN("Queue family " + std::to_string(queueFamilyIndex) + " has no timestamps, GPU timings are unavailable");
+			return;
+		}
+
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = maxScopes * 2;
+
+		for (Frame& frame : frames) {
+			if (vkCreateQueryPool(device, &queryPoolInfo, allocator, &frame.queryPool) != VK_SUCCESS) {
+				UTIL_THROW("Failed to create timestamp query pool!");
+			}
+		}
+	}
+
+	GpuProfiler::~GpuProfiler() {
+		for (const Frame& frame : frames) {
+			vkDestroyQueryPool(device, frame.queryPool, allocator);
+		}
+	}
+
+	void GpuProfiler::BeginFrame(const VkCommandBuffer commandBuffer, const uint32_t frameIndex) {
+		if (!supported) return;
+
+		ReadResults(frameIndex);
+		currentFrame = frameIndex;
+		Frame& frame = frames[currentFrame];
+		frame.scopeNames.clear();
+		frame.resultsRead = false;
+		openScopes.clear();
+
+		vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, maxScopes * 2);
+	}
+
+	void GpuProfiler::BeginScope(const VkCommandBuffer commandBuffer, const std::string& name) {
+		if (!supported) return;
+
+		Frame& frame = frames[currentFrame];
+		if (frame.scopeNames.size() >= maxScopes) {
+			UTIL_THROW("GpuProfiler was created for " + std::to_string(maxScopes) + " scopes per frame");
+		}
+
+		const uint32_t scope = static_cast<uint32_t>(frame.scopeNames.size());
+		frame.scopeNames.push_back(name);
+		openScopes.push_back(scope);
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, scope * 2);
+	}
+
+	void GpuProfiler::EndScope(const VkCommandBuffer commandBuffer) {
+		if (!supported) return;
+
+		if (openScopes.empty()) {
+			UTIL_THROW("GpuProfiler::EndScope() without an open scope");
+		}
+
+		const uint32_t scope = openScopes.back();
+		openScopes.pop_back();
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames[currentFrame].queryPool, scope * 2 + 1);
+	}
+
+	void GpuProfiler::ReadResults(const uint32_t frameIndex) {
+		if (!supported) return;
+
+		Frame& frame = frames[frameIndex];
+		if (frame.resultsRead) return;
+
+		collectResults(frame);
+		frame.resultsRead = true;
+	}
+
+	void GpuProfiler::ReuseFrame(const uint32_t frameIndex) {
+		if (!supported) return;
+
+		ReadResults(frameIndex);
+		currentFrame = frameIndex;
+		frames[frameIndex].resultsRead = false;
+	}
+
+	const std::vector<GpuProfiler::ScopeTiming>& GpuProfiler::GetLatestTimings() const {
+		return latestTimings;
+	}
+
+	std::string GpuProfiler::ReportAverages() {
+		if (averages.empty()) return "";
+
+		std::string line = "GPU time per frame:";
+		for (const Average& average : averages) {
+			line += " " + average.name + " " + std::to_string(average.totalMilliseconds / average.sampleCount) + " ms,";
+		}
+		line.pop_back();
+
+		averages.clear();
+		return line;
+	}
+
+	bool GpuProfiler::IsSupported() const {
+		return supported;
+	}
+
+	void GpuProfiler::SetDeviceClock(const DeviceClock* clock) {
+		this->clock = clock;
+	}
+
+	void GpuProfiler::collectResults(Frame& frame) {
+		if (frame.scopeNames.empty()) return;
+
+		// The fence of this frame was waited on, so without a wait flag the only way to miss is a frame that never got submitted.
+		const uint32_t queryCount = static_cast<uint32_t>(frame.scopeNames.size()) * 2;
+		std::vector<uint64_t> timestamps(queryCount);
+		const VkResult result = vkGetQueryPoolResults(device, frame.queryPool, 0, queryCount, timestamps.size() * sizeof(uint64_t),
+		                                              timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS) return;
+
+		// Only the valid bits count, a scope may span the point where they wrap.
+		const uint64_t mask = timestampValidBits >= 64 ? ~uint64_t{0} : (uint64_t{1} << timestampValidBits) - 1;
+
+		latestTimings.clear();
+		for (size_t scope = 0; scope < frame.scopeNames.size(); scope++) {
+			const uint64_t ticks = (timestamps[scope * 2 + 1] - timestamps[scope * 2]) & mask;
+			const uint64_t begin = clock != nullptr ? clock->Extend(timestamps[scope * 2], timestampValidBits) : timestamps[scope * 2];
+			const double milliseconds = static_cast<double>(ticks) * nanosecondsPerTick / 1'000'000.0;
+			const double beginMilliseconds = static_cast<double>(begin) * nanosecondsPerTick / 1'000'000.0;
+			latestTimings.push_back({frame.scopeNames[scope], milliseconds, beginMilliseconds, beginMilliseconds + milliseconds});
+
+			auto average = std::find_if(averages.begin(), averages.end(), [&](const Average& candidate) {
+				return candidate.name == frame.scopeNames[scope];
+			});
+			if (average == averages.end()) {
+				average = averages.insert(averages.end(), Average{frame.scopeNames[scope]});
+			}
+
+			average->totalMilliseconds += milliseconds;
+			average->sampleCount++;
+		}
+	}
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceClock.hpp"
+
+namespace gpu
+{
+	// Timestamp queries around named scopes of a frame's commands. Results are read back without stalling when the same
+	// frame in flight comes around again, so they lag MAX_FRAMES_IN_FLIGHT frames behind.
+	class GpuProfiler {
+	public: // Properties
+		struct ScopeTiming {
+			std::string name;
+			double milliseconds;
+			// Comparable across queues with a DeviceClock set, on the full device clock. Without one only timings of the
+			// same queue are, the spec does not promise that queues share a clock.
+			double beginMilliseconds;
+			double endMilliseconds;
+		};
+
+	private: // Member Variables
+		struct Frame {
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			std::vector<std::string> scopeNames; // Scope i owns queries 2i and 2i + 1.
+			bool resultsRead = false;
+		};
+
+		struct Average {
+			std::string name;
+			double totalMilliseconds = 0.0;
+			uint32_t sampleCount = 0;
+		};
+
+		VkDevice device;
+		const VkAllocationCallbacks* allocator;
+		bool supported;
+		double nanosecondsPerTick;
+		uint32_t timestampValidBits = 0;
+		const DeviceClock* clock = nullptr;
+		uint32_t maxScopes;
+
+		std::vector<Frame> frames;
+		uint32_t currentFrame = 0;
+		std::vector<uint32_t> openScopes;
+
+		std::vector<ScopeTiming> latestTimings;
+		std::vector<Average> averages;
+
+	public: // Public Functions
+		// Timestamps are disabled when the queue family does not support them, every call then does nothing.
+		GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t framesInFlight,
+		            const VkAllocationCallbacks* allocator = nullptr, uint32_t maxScopes = 32);
+		~GpuProfiler();
+
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler(GpuProfiler&&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		// Call right after beginning the frame's command buffer, once its fence has been waited on.
+		void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+		// Scopes nest and have to be closed in the same frame, outside or inside the same render pass instance.
+		void BeginScope(VkCommandBuffer commandBuffer, const std::string& name);
+		void EndScope(VkCommandBuffer commandBuffer);
+		// Reads the timings of the frame's previous submission, once its fence has been waited on. BeginFrame() and
+		// ReuseFrame() do this as well, call it earlier for timings that decide what to record.
+		void ReadResults(uint32_t frameIndex);
+		// Instead of BeginFrame() when the frame's command buffer is submitted again unchanged. It already resets the
+		// queries and writes the same scopes, so only the results are read.
+		void ReuseFrame(uint32_t frameIndex);
+
+		// Of the newest frame that completed.
+		const std::vector<ScopeTiming>& GetLatestTimings() const;
+		// The average time of every scope since the last call as one line, empty without any, and starts over.
+		std::string ReportAverages();
+		bool IsSupported() const;
+		// Puts the begin and end of the timings on the device clock from then on.
+		void SetDeviceClock(const DeviceClock* clock);
+
+	private: // Private Methods
+		void collectResults(Frame& frame);
+	};
+}
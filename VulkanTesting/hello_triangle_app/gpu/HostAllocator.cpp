@@ -0,0 +1,370 @@
+﻿#include "HostAllocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+
+#include "../../utils/log.hpp"
+
+namespace gpu
+{
+	namespace
+	{
+		const char* const SCOPE_NAMES[HostAllocator::SCOPE_COUNT] = {"Command", "Object", "Cache", "Device", "Instance"};
+
+		uintptr_t alignUp(const uintptr_t value, const size_t alignment) {
+			return (value + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		}
+
+		std::string toKib(const size_t bytes) {
+			return std::to_string((bytes + 1023) / 1024) + " KiB";
+		}
+
+		std::atomic<uint64_t> nextAllocatorId = 1;
+
+		// For counters only their own thread writes, a plain load and store without a locked instruction.
+		template<typename T>
+		T addOwned(std::atomic<T>& counter, const T value) {
+			const T result = counter.load(std::memory_order_relaxed) + value;
+			counter.store(result, std::memory_order_relaxed);
+			return result;
+		}
+
+		void raiseOwned(std::atomic<int64_t>& peak, const int64_t value) {
+			if (value > peak.load(std::memory_order_relaxed)) peak.store(value, std::memory_order_relaxed);
+		}
+
+		size_t clampToSize(const int64_t value) {
+			return static_cast<size_t>(std::max<int64_t>(value, 0));
+		}
+	}
+
+	thread_local HostAllocator::CacheLookup HostAllocator::lastCache;
+
+	HostAllocator::HostAllocator() : id(nextAllocatorId.fetch_add(1)) {
+		callbacks.pUserData = this;
+		callbacks.pfnAllocation = allocationCallback;
+		callbacks.pfnReallocation = reallocationCallback;
+		callbacks.pfnFree = freeCallback;
+		callbacks.pfnInternalAllocation = internalAllocationCallback;
+		callbacks.pfnInternalFree = internalFreeCallback;
+	}
+
+	const VkAllocationCallbacks* HostAllocator::GetCallbacks() const {
+		return &callbacks;
+	}
+
+	HostAllocator::Stats HostAllocator::GetStats() {
+		std::lock_guard lock(mutex);
+
+		Stats stats;
+		std::array<int64_t, SCOPE_COUNT> liveBytes{};
+		std::array<int64_t, SCOPE_COUNT> liveInternalBytes{};
+		for (const std::unique_ptr<ThreadCache>& cache : caches) {
+			for (uint32_t scope = 0; scope < SCOPE_COUNT; scope++) {
+				const ScopeCounters& counters = cache->scopes[scope];
+				ScopeStats& scopeStats = stats.scopes[scope];
+				scopeStats.allocationCount += counters.allocationCount.load(std::memory_order_relaxed);
+				scopeStats.reallocationCount += counters.reallocationCount.load(std::memory_order_relaxed);
+				scopeStats.freeCount += counters.freeCount.load(std::memory_order_relaxed);
+				scopeStats.peakBytes += clampToSize(counters.peakBytes.load(std::memory_order_relaxed));
+				scopeStats.peakInternalBytes += clampToSize(counters.peakInternalBytes.load(std::memory_order_relaxed));
+				liveBytes[scope] += counters.liveBytes.load(std::memory_order_relaxed);
+				liveInternalBytes[scope] += counters.liveInternalBytes.load(std::memory_order_relaxed);
+			}
+			stats.arenaPeakBytes = std::max(stats.arenaPeakBytes, cache->arenaPeakBytes.load(std::memory_order_relaxed));
+			stats.arenaOverflowCount += cache->arenaOverflowCount.load(std::memory_order_relaxed);
+		}
+
+		for (uint32_t scope = 0; scope < SCOPE_COUNT; scope++) {
+			stats.scopes[scope].liveBytes = clampToSize(liveBytes[scope]);
+			stats.scopes[scope].liveInternalBytes = clampToSize(liveInternalBytes[scope]);
+		}
+		stats.poolBytes = chunks.size() * CHUNK_SIZE;
+		return stats;
+	}
+
+	void HostAllocator::LogStats(const std::string& when) {
+		const Stats current = GetStats();
+
+		std::string line = "Vulkan host memory " + when + ":";
+		for (uint32_t scope = 0; scope < SCOPE_COUNT; scope++) {
+			const ScopeStats& scopeStats = current.scopes[scope];
+			if (scopeStats.allocationCount == 0 && scopeStats.peakInternalBytes == 0) continue;
+
+			line += std::string(" ") + SCOPE_NAMES[scope] + " " + std::to_string(scopeStats.allocationCount) +
+				" allocations, " + toKib(scopeStats.liveBytes) + " live, peak " + toKib(scopeStats.peakBytes);
+			if (scopeStats.peakInternalBytes > 0) {
+				line += ", internal peak " + toKib(scopeStats.peakInternalBytes);
+			}
+			line += ";";
+		}
+		line += " command arena peak " + toKib(current.arenaPeakBytes) + " with " +
+			std::to_string(current.arenaOverflowCount) + " overflows, size classes hold " + toKib(current.poolBytes);
+
+		UTIL_LOG(line);
+	}
+
+	void* VKAPI_CALL HostAllocator::allocationCallback(void* userData, const size_t size, const size_t alignment,
+	                                                   const VkSystemAllocationScope scope) {
+		auto* allocator = static_cast<HostAllocator*>(userData);
+		return allocator->allocate(allocator->getThreadCache(), size, alignment, scope);
+	}
+
+	void* VKAPI_CALL HostAllocator::reallocationCallback(void* userData, void* original, const size_t size,
+	                                                     const size_t alignment, const VkSystemAllocationScope scope) {
+		auto* allocator = static_cast<HostAllocator*>(userData);
+		ThreadCache& cache = allocator->getThreadCache();
+
+		if (original == nullptr) return allocator->allocate(cache, size, alignment, scope);
+		if (size == 0) {
+			allocator->release(cache, original);
+			return nullptr;
+		}
+
+		Header& header = headerOf(original);
+		ScopeCounters& counters = cache.scopes[header.scope];
+		addOwned(counters.reallocationCount, uint64_t{1});
+
+		// Drivers grow their arrays in small steps, most of which still fit the block.
+		if (header.source == Source::Pool && header.offset + size <= MIN_BLOCK_SIZE << header.sizeClass) {
+			const int64_t growth = static_cast<int64_t>(size) - static_cast<int64_t>(header.size);
+			raiseOwned(counters.peakBytes, addOwned(counters.liveBytes, growth));
+			header.size = size;
+			return original;
+		}
+
+		// On failure the original has to stay valid.
+		void* memory = allocator->allocate(cache, size, alignment, scope);
+		if (memory == nullptr) return nullptr;
+
+		std::memcpy(memory, original, std::min(header.size, size));
+		allocator->release(cache, original);
+		return memory;
+	}
+
+	void VKAPI_CALL HostAllocator::freeCallback(void* userData, void* memory) {
+		if (memory == nullptr) return;
+
+		auto* allocator = static_cast<HostAllocator*>(userData);
+		allocator->release(allocator->getThreadCache(), memory);
+	}
+
+	void VKAPI_CALL HostAllocator::internalAllocationCallback(void* userData, const size_t size, VkInternalAllocationType,
+	                                                          const VkSystemAllocationScope scope) {
+		auto* allocator = static_cast<HostAllocator*>(userData);
+		ScopeCounters& counters = allocator->getThreadCache().scopes[scope];
+		raiseOwned(counters.peakInternalBytes, addOwned(counters.liveInternalBytes, static_cast<int64_t>(size)));
+	}
+
+	void VKAPI_CALL HostAllocator::internalFreeCallback(void* userData, const size_t size, VkInternalAllocationType,
+	                                                    const VkSystemAllocationScope scope) {
+		auto* allocator = static_cast<HostAllocator*>(userData);
+		addOwned(allocator->getThreadCache().scopes[scope].liveInternalBytes, -static_cast<int64_t>(size));
+	}
+
+	HostAllocator::ThreadCache& HostAllocator::getThreadCache() {
+		if (lastCache.allocatorId != id) {
+			lastCache = {id, &findThreadCache()};
+		}
+		return *lastCache.cache;
+	}
+
+	HostAllocator::ThreadCache& HostAllocator::findThreadCache() {
+		std::lock_guard lock(mutex);
+
+		// A thread that ended leaves its cache to the next thread getting the same id.
+		const std::thread::id thread = std::this_thread::get_id();
+		for (const std::unique_ptr<ThreadCache>& cache : caches) {
+			if (cache->thread == thread) return *cache;
+		}
+
+		auto& cache = caches.emplace_back(std::make_unique<ThreadCache>());
+		cache->thread = thread;
+		cache->index = static_cast<uint32_t>(caches.size() - 1);
+		return *cache;
+	}
+
+	void* HostAllocator::allocate(ThreadCache& cache, const size_t size, size_t alignment,
+	                              const VkSystemAllocationScope scope) {
+		// Keeps the header in front of the memory aligned as well.
+		alignment = std::max(alignment, sizeof(Header));
+
+		std::byte* memory = nullptr;
+		Source source = Source::System;
+		uint32_t offset = static_cast<uint32_t>(alignment);
+		uint8_t sizeClass = 0;
+		if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+			memory = allocateFromArena(cache, size, alignment);
+			if (memory != nullptr) {
+				source = Source::Arena;
+				offset = cache.index;
+			} else {
+				addOwned(cache.arenaOverflowCount, uint64_t{1});
+			}
+		} else if (scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT && alignment == sizeof(Header)) {
+			// Blocks are only aligned to their chunk's default new alignment, larger alignments skip the pool.
+			std::byte* block = allocateFromPool(cache, sizeof(Header) + size, sizeClass);
+			if (block != nullptr) {
+				source = Source::Pool;
+				memory = block + sizeof(Header);
+			}
+		}
+
+		if (memory == nullptr) {
+			auto* block = static_cast<std::byte*>(::operator new(alignment + size, std::align_val_t(alignment), std::nothrow));
+			if (block == nullptr) return nullptr;
+
+			memory = block + alignment;
+		}
+
+		// Written field by field, a copy from the stack would be a wide load of narrow stores that just happened.
+		Header& header = *new(memory - sizeof(Header)) Header;
+		header.size = size;
+		header.offset = offset;
+		header.alignmentLog2 = static_cast<uint8_t>(std::countr_zero(alignment));
+		header.scope = static_cast<uint8_t>(scope);
+		header.source = source;
+		header.sizeClass = sizeClass;
+		ScopeCounters& counters = cache.scopes[scope];
+		addOwned(counters.allocationCount, uint64_t{1});
+		raiseOwned(counters.peakBytes, addOwned(counters.liveBytes, static_cast<int64_t>(size)));
+		return memory;
+	}
+
+	void HostAllocator::release(ThreadCache& cache, void* memory) {
+		// Read field by field as well, the free list link written over a pool block's start ends its header.
+		const Header& header = headerOf(memory);
+		const uint32_t offset = header.offset;
+		const uint8_t sizeClass = header.sizeClass;
+
+		ScopeCounters& counters = cache.scopes[header.scope];
+		addOwned(counters.freeCount, uint64_t{1});
+		addOwned(counters.liveBytes, -static_cast<int64_t>(header.size));
+
+		std::byte* block = static_cast<std::byte*>(memory) - offset;
+		switch (header.source) {
+			case Source::Arena:
+				releaseToArena(cache, offset);
+				break;
+			case Source::Pool:
+				releaseToPool(cache, block, sizeClass);
+				break;
+			case Source::System:
+				::operator delete(block, std::align_val_t(size_t{1} << header.alignmentLog2));
+				break;
+		}
+	}
+
+	std::byte* HostAllocator::allocateFromArena(ThreadCache& cache, const size_t size, const size_t alignment) {
+		if (!cache.arena) {
+			cache.arena.reset(new(std::nothrow) std::byte[ARENA_SIZE]);
+			if (!cache.arena) return nullptr;
+		}
+		resetArenaIfEmpty(cache);
+
+		const uintptr_t base = reinterpret_cast<uintptr_t>(cache.arena.get());
+		const uintptr_t memory = alignUp(base + cache.arenaUsed + sizeof(Header), alignment);
+		if (memory + size > base + ARENA_SIZE) return nullptr;
+
+		cache.arenaUsed = memory + size - base;
+		cache.arenaLiveCount++;
+		if (cache.arenaUsed > cache.arenaPeakBytes.load(std::memory_order_relaxed)) {
+			cache.arenaPeakBytes.store(cache.arenaUsed, std::memory_order_relaxed);
+		}
+		return cache.arena.get() + (memory - base);
+	}
+
+	void HostAllocator::releaseToArena(ThreadCache& cache, const uint32_t owner) {
+		if (owner == cache.index) {
+			cache.arenaLiveCount--;
+			resetArenaIfEmpty(cache);
+			return;
+		}
+
+		// Rare, command scope allocations are freed within the call that made them. The owner resets its arena once
+		// it sees these frees.
+		std::lock_guard lock(mutex);
+		caches[owner]->arenaRemoteFreeCount.fetch_add(1, std::memory_order_release);
+	}
+
+	void HostAllocator::resetArenaIfEmpty(ThreadCache& cache) {
+		// Nothing is reused until every command scope allocation is gone, which is after each call in practice.
+		const uint32_t remoteFreeCount = cache.arenaRemoteFreeCount.load(std::memory_order_acquire);
+		if (cache.arenaLiveCount != remoteFreeCount) return;
+
+		if (remoteFreeCount > 0) {
+			cache.arenaRemoteFreeCount.fetch_sub(remoteFreeCount, std::memory_order_relaxed);
+		}
+		cache.arenaLiveCount = 0;
+		cache.arenaUsed = 0;
+	}
+
+	std::byte* HostAllocator::allocateFromPool(ThreadCache& cache, const size_t blockSize, uint8_t& sizeClass) {
+		const auto candidate = static_cast<uint8_t>(std::bit_width((blockSize - 1) / MIN_BLOCK_SIZE));
+		if (candidate >= SIZE_CLASS_COUNT) return nullptr;
+
+		FreeList& list = cache.freeLists[candidate];
+		if (list.head == nullptr && !refillFreeList(list, candidate)) return nullptr;
+
+		auto* block = static_cast<std::byte*>(list.head);
+		list.head = *reinterpret_cast<void**>(block);
+		list.count--;
+		sizeClass = candidate;
+		return block;
+	}
+
+	void HostAllocator::releaseToPool(ThreadCache& cache, std::byte* block, const uint8_t sizeClass) {
+		FreeList& list = cache.freeLists[sizeClass];
+		*reinterpret_cast<void**>(block) = list.head;
+		list.head = block;
+		list.count++;
+		if (list.count <= CACHED_BLOCK_LIMIT) return;
+
+		// Blocks freed on another thread than they were allocated on would otherwise pile up here.
+		std::lock_guard lock(mutex);
+		FreeList& shared = sharedLists[sizeClass];
+		for (uint32_t i = 0; i < CACHED_BLOCK_LIMIT / 2; i++) {
+			void* moved = list.head;
+			list.head = *static_cast<void**>(moved);
+			*static_cast<void**>(moved) = shared.head;
+			shared.head = moved;
+		}
+		list.count -= CACHED_BLOCK_LIMIT / 2;
+		shared.count += CACHED_BLOCK_LIMIT / 2;
+	}
+
+	bool HostAllocator::refillFreeList(FreeList& list, const uint8_t sizeClass) {
+		std::lock_guard lock(mutex);
+		FreeList& shared = sharedLists[sizeClass];
+
+		if (shared.head == nullptr) {
+			std::unique_ptr<std::byte[]> chunk(new(std::nothrow) std::byte[CHUNK_SIZE]);
+			if (!chunk) return false;
+
+			// The whole chunk goes to this size class.
+			const size_t classSize = MIN_BLOCK_SIZE << sizeClass;
+			for (size_t offset = 0; offset + classSize <= CHUNK_SIZE; offset += classSize) {
+				*reinterpret_cast<void**>(chunk.get() + offset) = shared.head;
+				shared.head = chunk.get() + offset;
+				shared.count++;
+			}
+			chunks.push_back(std::move(chunk));
+		}
+
+		while (shared.head != nullptr && list.count < CACHED_BLOCK_LIMIT / 2) {
+			void* moved = shared.head;
+			shared.head = *static_cast<void**>(moved);
+			*static_cast<void**>(moved) = list.head;
+			list.head = moved;
+			shared.count--;
+			list.count++;
+		}
+		return true;
+	}
+
+	HostAllocator::Header& HostAllocator::headerOf(void* memory) {
+		return *reinterpret_cast<Header*>(static_cast<std::byte*>(memory) - sizeof(Header));
+	}
+}
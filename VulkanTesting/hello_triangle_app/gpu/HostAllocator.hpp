@@ -0,0 +1,154 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace gpu
+{
+	// Host memory for the driver, handed to every vkCreate*, vkAllocate* and their destroy and free calls. Routed by the
+	// scope the driver asks for: command scope allocations only live for the duration of one call and come from a bump
+	// arena that starts over once all of them are freed, object scope ones come from free lists per size class. Other
+	// scopes and whatever does not fit go to the system allocator. Counts calls and bytes per scope, with high-water marks.
+	// Every thread calling into the driver gets its own arena, free lists and counters, so allocating and freeing takes no
+	// lock. The mutex is only taken on a thread's first call, when its free lists run empty or overflow, and for stats.
+	class HostAllocator {
+	public: // Properties
+		static constexpr uint32_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+		static constexpr size_t ARENA_SIZE = 256 * 1024; // Per thread.
+		// Blocks of 32 to 4096 bytes, the 16 byte header included. Larger object allocations go to the system.
+		static constexpr uint32_t SIZE_CLASS_COUNT = 8;
+		static constexpr size_t MIN_BLOCK_SIZE = 32;
+		static constexpr size_t CHUNK_SIZE = 64 * 1024;
+		// A thread keeps up to this many free blocks per size class, and moves half of them at once to or from the shared lists.
+		static constexpr uint32_t CACHED_BLOCK_LIMIT = 128;
+
+		struct ScopeStats {
+			uint64_t allocationCount = 0;
+			uint64_t reallocationCount = 0;
+			uint64_t freeCount = 0; // A reallocation that moves counts as an allocation and a free as well.
+			size_t liveBytes = 0;
+			size_t peakBytes = 0; // Summed over the threads, an upper bound when several allocate at once.
+			// Allocated by the driver itself and only reported, for executable memory and the like.
+			size_t liveInternalBytes = 0;
+			size_t peakInternalBytes = 0;
+		};
+
+		struct Stats {
+			std::array<ScopeStats, SCOPE_COUNT> scopes;
+			size_t arenaPeakBytes = 0; // Of the fullest thread arena.
+			uint64_t arenaOverflowCount = 0; // Command scope allocations that did not fit and went to the system.
+			size_t poolBytes = 0; // Reserved in chunks for the size classes, never given back before destruction.
+		};
+
+	private: // Member Variables
+		enum class Source : uint8_t {
+			System,
+			Arena,
+			Pool
+		};
+
+		// Right in front of every pointer handed out, which is why everything is aligned to at least its size.
+		struct Header {
+			size_t size;
+			uint32_t offset; // From the start of the block to the pointer handed out, the owning thread for the arena.
+			uint8_t alignmentLog2;
+			uint8_t scope;
+			Source source;
+			uint8_t sizeClass;
+		};
+		static_assert(sizeof(Header) == 16);
+
+		// Only written by the thread they belong to, GetStats() reads them from any thread. Frees on another thread than
+		// the allocation count where they happen, so the live bytes of one thread can go negative.
+		struct ScopeCounters {
+			std::atomic<uint64_t> allocationCount = 0;
+			std::atomic<uint64_t> reallocationCount = 0;
+			std::atomic<uint64_t> freeCount = 0;
+			std::atomic<int64_t> liveBytes = 0;
+			std::atomic<int64_t> peakBytes = 0;
+			std::atomic<int64_t> liveInternalBytes = 0;
+			std::atomic<int64_t> peakInternalBytes = 0;
+		};
+
+		struct FreeList {
+			void* head = nullptr; // Singly linked through the first bytes of each block.
+			uint32_t count = 0;
+		};
+
+		struct ThreadCache {
+			std::thread::id thread;
+			uint32_t index;
+
+			std::unique_ptr<std::byte[]> arena; // Created on the thread's first command scope allocation.
+			size_t arenaUsed = 0;
+			uint32_t arenaLiveCount = 0; // Allocated minus what this thread freed again.
+			std::atomic<uint32_t> arenaRemoteFreeCount = 0; // Freed by other threads, the only part they touch.
+
+			std::array<FreeList, SIZE_CLASS_COUNT> freeLists;
+			std::array<ScopeCounters, SCOPE_COUNT> scopes;
+			std::atomic<size_t> arenaPeakBytes = 0;
+			std::atomic<uint64_t> arenaOverflowCount = 0;
+		};
+
+		// The cache of the allocator this thread used last. Allocators are told apart by id, not by address, which a
+		// later allocator could have again.
+		struct CacheLookup {
+			uint64_t allocatorId = 0;
+			ThreadCache* cache = nullptr;
+		};
+		static thread_local CacheLookup lastCache;
+
+		uint64_t id;
+		VkAllocationCallbacks callbacks{};
+
+		// Guards everything below.
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadCache>> caches;
+		std::array<FreeList, SIZE_CLASS_COUNT> sharedLists;
+		std::vector<std::unique_ptr<std::byte[]>> chunks;
+
+	public: // Public Functions
+		HostAllocator();
+
+		HostAllocator(const HostAllocator&) = delete;
+		HostAllocator(HostAllocator&&) = delete;
+		HostAllocator& operator=(const HostAllocator&) = delete;
+
+		// Valid as long as the allocator, which has to outlive every object created with it.
+		const VkAllocationCallbacks* GetCallbacks() const;
+		Stats GetStats();
+		void LogStats(const std::string& when);
+
+	private: // Private Methods
+		static void* VKAPI_CALL allocationCallback(void* userData, size_t size, size_t alignment,
+		                                           VkSystemAllocationScope scope);
+		static void* VKAPI_CALL reallocationCallback(void* userData, void* original, size_t size, size_t alignment,
+		                                             VkSystemAllocationScope scope);
+		static void VKAPI_CALL freeCallback(void* userData, void* memory);
+		static void VKAPI_CALL internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType type,
+		                                                  VkSystemAllocationScope scope);
+		static void VKAPI_CALL internalFreeCallback(void* userData, size_t size, VkInternalAllocationType type,
+		                                            VkSystemAllocationScope scope);
+
+		ThreadCache& getThreadCache();
+		ThreadCache& findThreadCache();
+		void* allocate(ThreadCache& cache, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void release(ThreadCache& cache, void* memory);
+		static std::byte* allocateFromArena(ThreadCache& cache, size_t size, size_t alignment);
+		void releaseToArena(ThreadCache& cache, uint32_t owner);
+		static void resetArenaIfEmpty(ThreadCache& cache);
+		std::byte* allocateFromPool(ThreadCache& cache, size_t blockSize, uint8_t& sizeClass);
+		void releaseToPool(ThreadCache& cache, std::byte* block, uint8_t sizeClass);
+		bool refillFreeList(FreeList& list, uint8_t sizeClass);
+		static Header& headerOf(void* memory);
+	};
+}
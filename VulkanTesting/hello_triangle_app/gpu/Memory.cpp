@@ -0,0 +1,21 @@
+﻿#include "Memory.hpp"
+
+#include <string>
+
+#include "../../utils/log.hpp"
+
+namespace gpu
+{
+	uint32_t findMemoryType(const VkPhysicalDevice physicalDevice, const uint32_t typeFilter, const VkMemoryPropertyFlags properties) {
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+			if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+
+		UTIL_THROW("Failed to find suitable memory type!");
+	}
+}
@@ -0,0 +1,9 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace gpu
+{
+	// Index of the first memory type allowed by typeFilter that has all of the requested properties.
+	uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+}
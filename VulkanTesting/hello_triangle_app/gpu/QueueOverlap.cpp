@@ -0,0 +1,59 @@
+﻿#include "QueueOverlap.hpp"
+
+#include <algorithm>
+
+namespace gpu
+{
+	QueueOverlap::QueueOverlap(const std::string& asyncScope, const std::string& mainScope, const bool sharedClock)
+		: asyncScope(asyncScope), mainScope(mainScope), sharedClock(sharedClock) {}
+
+	void QueueOverlap::Add(const std::vector<GpuProfiler::ScopeTiming>& asyncTimings,
+	                       const std::vector<GpuProfiler::ScopeTiming>& mainTimings) {
+		const GpuProfiler::ScopeTiming* main = sharedClock ? findScope(mainTimings, mainScope) : nullptr;
+		if (main != nullptr && (mainIntervals.empty() || mainIntervals.back().begin != main->beginMilliseconds)) {
+			mainIntervals.push_back({main->beginMilliseconds, main->endMilliseconds});
+			if (mainIntervals.size() > KEPT_MAIN_INTERVALS) {
+				mainIntervals.erase(mainIntervals.begin());
+			}
+		}
+
+		const GpuProfiler::ScopeTiming* async = findScope(asyncTimings, asyncScope);
+		if (async == nullptr || lastAsyncBegin == async->beginMilliseconds) return;
+		lastAsyncBegin = async->beginMilliseconds;
+
+		// Work on the same queue never overlaps itself, so the overlaps with each interval simply add up.
+		double overlapped = 0.0;
+		for (const Interval& interval : mainIntervals) {
+			overlapped += std::max(0.0, std::min(async->endMilliseconds, interval.end) - std::max(async->beginMilliseconds, interval.begin));
+		}
+
+		asyncMilliseconds += async->milliseconds;
+		overlappedMilliseconds += std::min(overlapped, async->milliseconds);
+		sampleCount++;
+	}
+
+	std::string QueueOverlap::ReportAverages() {
+		if (sampleCount == 0) return "";
+
+		std::string line = "Async compute: " + std::to_string(asyncMilliseconds / sampleCount) + " ms per frame";
+		if (sharedClock) {
+			const double overlapPercent = asyncMilliseconds > 0.0 ? overlappedMilliseconds / asyncMilliseconds * 100.0 : 0.0;
+			line += ", " + std::to_string(overlapPercent) + "% overlapped with " + mainScope;
+		} else {
+			line += ", overlap unknown without calibrated timestamps";
+		}
+
+		asyncMilliseconds = 0.0;
+		overlappedMilliseconds = 0.0;
+		sampleCount = 0;
+		return line;
+	}
+
+	const GpuProfiler::ScopeTiming* QueueOverlap::findScope(const std::vector<GpuProfiler::ScopeTiming>& timings,
+	                                                        const std::string& name) {
+		const auto timing = std::find_if(timings.begin(), timings.end(), [&](const GpuProfiler::ScopeTiming& candidate) {
+			return candidate.name == name;
+		});
+		return timing != timings.end() ? &*timing : nullptr;
+	}
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "GpuProfiler.hpp"
+
+namespace gpu
+{
+	// How much of the async compute work ran while the graphics queue was busy, from the timings of one scope per queue.
+	// Work that overlaps nothing only moved to another queue, overlapped work is what async compute actually saves.
+	// Needs both profilers on a DeviceClock, without one only the async compute time is reported.
+	class QueueOverlap {
+	private: // Member Variables
+		struct Interval {
+			double begin;
+			double end;
+		};
+
+		// Compute work of a frame mostly runs during the graphics work of the frame before.
+		static constexpr size_t KEPT_MAIN_INTERVALS = 3;
+
+		std::string asyncScope;
+		std::string mainScope;
+		bool sharedClock;
+
+		std::vector<Interval> mainIntervals; // Newest last.
+		std::optional<double> lastAsyncBegin;
+
+		double asyncMilliseconds = 0.0;
+		double overlappedMilliseconds = 0.0;
+		uint32_t sampleCount = 0;
+
+	public: // Public Functions
+		QueueOverlap(const std::string& asyncScope, const std::string& mainScope, bool sharedClock);
+
+		// Takes GpuProfiler::GetLatestTimings() of both queues, frames already seen are skipped.
+		void Add(const std::vector<GpuProfiler::ScopeTiming>& asyncTimings, const std::vector<GpuProfiler::ScopeTiming>& mainTimings);
+		// The averages since the last call as one line, empty without any, and starts over.
+		std::string ReportAverages();
+
+	private: // Private Methods
+		static const GpuProfiler::ScopeTiming* findScope(const std::vector<GpuProfiler::ScopeTiming>& timings, const std::string& name);
+	};
+}
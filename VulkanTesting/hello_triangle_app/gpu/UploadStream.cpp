@@ -0,0 +1,126 @@
+﻿#include "UploadStream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "../../utils/log.hpp"
+
+namespace gpu
+{
+	UploadStream::UploadStream(const Context& context, const VkDeviceSize slotSize) : context(context), slotSize(slotSize) {
+		VkCommandBufferAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = context.commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		for (Slot& slot : slots) {
+			slot.staging = createBuffer(context, slotSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+			if (vkAllocateCommandBuffers(context.device, &allocateInfo, &slot.commandBuffer) != VK_SUCCESS) {
+				UTIL_THROW("Failed to allocate upload stream command buffer!");
+			}
+
+			if (vkCreateFence(context.device, &fenceInfo, context.allocator, &slot.fence) != VK_SUCCESS) {
+				UTIL_THROW("Failed to create upload stream fence!");
+			}
+		}
+	}
+
+	UploadStream::~UploadStream() {
+		Finish();
+
+		for (Slot& slot : slots) {
+			vkDestroyFence(context.device, slot.fence, context.allocator);
+			vkFreeCommandBuffers(context.device, context.commandPool, 1, &slot.commandBuffer);
+			destroyBuffer(context, slot.staging);
+		}
+	}
+
+	void UploadStream::Write(const Buffer& destination, const void* data, VkDeviceSize size, VkDeviceSize offset) {
+		const char* source = static_cast<const char*>(data);
+		if (context.uploadObserver) context.uploadObserver(destination.buffer, destination.size, data, size, offset);
+
+		while (size > 0) {
+			if (!recording) beginSlot();
+
+			Slot& slot = slots[currentSlot];
+			const VkDeviceSize chunkSize = std::min(size, slotSize - slot.used);
+			memcpy(static_cast<char*>(slot.staging.mapped) + slot.used, source, chunkSize);
+
+			VkBufferCopy copyRegion{};
+			copyRegion.srcOffset = slot.used;
+			copyRegion.dstOffset = offset;
+			copyRegion.size = chunkSize;
+			vkCmdCopyBuffer(slot.commandBuffer, slot.staging.buffer, destination.buffer, 1, &copyRegion);
+
+			slot.used += chunkSize;
+			source += chunkSize;
+			offset += chunkSize;
+			size -= chunkSize;
+
+			if (slot.used == slotSize) submitSlot();
+		}
+	}
+
+	void UploadStream::Finish() {
+		if (recording) submitSlot();
+
+		for (Slot& slot : slots) {
+			if (!slot.submitted) continue;
+
+			vkWaitForFences(context.device, 1, &slot.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			slot.submitted = false;
+		}
+	}
+
+	void UploadStream::beginSlot() {
+		Slot& slot = slots[currentSlot];
+
+		// The slot was last used SLOT_COUNT submits ago, usually long done by now.
+		if (slot.submitted) {
+			vkWaitForFences(context.device, 1, &slot.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			slot.submitted = false;
+		}
+
+		vkResetFences(context.device, 1, &slot.fence);
+		vkResetCommandBuffer(slot.commandBuffer, 0);
+		slot.used = 0;
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS) {
+			UTIL_THROW("Failed to begin recording upload stream command buffer!");
+		}
+
+		recording = true;
+	}
+
+	void UploadStream::submitSlot() {
+		Slot& slot = slots[currentSlot];
+
+		if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS) {
+			UTIL_THROW("Failed to end recording upload stream command buffer!");
+		}
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &slot.commandBuffer;
+
+		if (vkQueueSubmit(context.queue, 1, &submitInfo, slot.fence) != VK_SUCCESS) {
+			UTIL_THROW("Failed to submit upload stream command buffer!");
+		}
+
+		slot.submitted = true;
+		recording = false;
+		currentSlot = (currentSlot + 1) % SLOT_COUNT;
+	}
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <array>
+
+#include <vulkan/vulkan.h>
+
+#include "Buffer.hpp"
+#include "Context.hpp"
+
+namespace gpu
+{
+	// Copies into device local buffers through a small ring of staging slots. Filling one slot overlaps with the
+	// transfer of the previous ones, and uploads of any size need no more staging memory than the ring.
+	class UploadStream {
+	public: // Properties
+		static constexpr uint32_t SLOT_COUNT = 3;
+		static constexpr VkDeviceSize DEFAULT_SLOT_SIZE = 4 * 1024 * 1024;
+
+	private: // Member Variables
+		struct Slot {
+			Buffer staging;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			VkDeviceSize used = 0;
+			bool submitted = false;
+		};
+
+		Context context;
+		VkDeviceSize slotSize;
+		std::array<Slot, SLOT_COUNT> slots;
+		uint32_t currentSlot = 0;
+		bool recording = false;
+
+	public: // Public Functions
+		explicit UploadStream(const Context& context, VkDeviceSize slotSize = DEFAULT_SLOT_SIZE);
+		// Waits for everything still in flight.
+		~UploadStream();
+
+		UploadStream(const UploadStream&) = delete;
+		UploadStream(UploadStream&&) = delete;
+		UploadStream& operator=(const UploadStream&) = delete;
+
+		// The data is copied out before returning, the destination needs VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+		void Write(const Buffer& destination, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+		// Submits what is still recorded and waits until every copy has landed.
+		void Finish();
+
+	private: // Private Methods
+		void beginSlot();
+		void submitSlot();
+	};
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace mesh
+{
+	// Hands out one index per distinct key. Open addressing with linear probing over a power of two table that is
+	// never rehashed, the slots only hold indices into the key array so probing stays within a few cache lines.
+	template<typename Key, typename Hasher>
+	class Deduplicator {
+	public: // Properties
+		static constexpr uint32_t EMPTY = UINT32_MAX;
+
+	private: // Member Variables
+		std::vector<uint32_t> slots;
+		std::vector<Key> keys;
+		size_t mask;
+
+	public: // Public Functions
+		// Inserting more than maxKeys distinct keys is not supported, the table is sized for at most half occupancy.
+		explicit Deduplicator(const size_t maxKeys)
+			: slots(std::bit_ceil(maxKeys * 2 + 1), EMPTY), mask(slots.size() - 1) {
+			keys.reserve(maxKeys);
+		}
+
+		// Returns the index of the key, keys seen for the first time get the next free one.
+		uint32_t Insert(const Key& key) {
+			size_t slot = Hasher{}(key) & mask;
+
+			while (slots[slot] != EMPTY) {
+				if (keys[slots[slot]] == key) return slots[slot];
+				slot = (slot + 1) & mask;
+			}
+
+			slots[slot] = static_cast<uint32_t>(keys.size());
+			keys.push_back(key);
+			return slots[slot];
+		}
+
+		const std::vector<Key>& GetKeys() const {
+			return keys;
+		}
+	};
+
+	// Finalizer of MurmurHash3, spreads the entropy of every input bit over the low bits the table uses.
+	inline uint64_t mixHash(uint64_t hash) {
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+}
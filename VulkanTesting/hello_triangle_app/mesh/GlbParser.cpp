@@ -0,0 +1,349 @@
+﻿#include "MeshLoader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "Deduplicator.hpp"
+#include "Json.hpp"
+#include "../../utils/log.hpp"
+
+namespace mesh
+{
+	namespace
+	{
+		constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+		constexpr uint32_t CHUNK_JSON = 0x4E4F534A;
+		constexpr uint32_t CHUNK_BIN = 0x004E4942;
+
+		constexpr int COMPONENT_BYTE = 5120;
+		constexpr int COMPONENT_UNSIGNED_BYTE = 5121;
+		constexpr int COMPONENT_SHORT = 5122;
+		constexpr int COMPONENT_UNSIGNED_SHORT = 5123;
+		constexpr int COMPONENT_UNSIGNED_INT = 5125;
+		constexpr int COMPONENT_FLOAT = 5126;
+
+		constexpr int MODE_TRIANGLES = 4;
+
+		// Strided read access to one accessor inside the binary chunk.
+		struct AccessorView {
+			const char* data = nullptr;
+			size_t stride = 0;
+			size_t count = 0;
+			int componentType = 0;
+			uint32_t componentCount = 0;
+			bool normalized = false;
+
+			float ReadComponent(const size_t element, const uint32_t component) const {
+				const char* source = data + element * stride;
+
+				switch (componentType) {
+					case COMPONENT_FLOAT: {
+						float value;
+						memcpy(&value, source + component * sizeof(float), sizeof(float));
+						return value;
+					}
+					case COMPONENT_UNSIGNED_BYTE: {
+						const float value = static_cast<uint8_t>(source[component]);
+						return normalized ? value / 255.0f : value;
+					}
+					case COMPONENT_BYTE: {
+						const float value = static_cast<int8_t>(source[component]);
+						return normalized ? std::max(value / 127.0f, -1.0f) : value;
+					}
+					case COMPONENT_UNSIGNED_SHORT: {
+						uint16_t value;
+						memcpy(&value, source + component * sizeof(uint16_t), sizeof(uint16_t));
+						return normalized ? value / 65535.0f : value;
+					}
+					case COMPONENT_SHORT: {
+						int16_t value;
+						memcpy(&value, source + component * sizeof(int16_t), sizeof(int16_t));
+						return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+					}
+					default:
+						return 0.0f;
+				}
+			}
+
+			uint32_t ReadIndex(const size_t element) const {
+				const char* source = data + element * stride;
+
+				switch (componentType) {
+					case COMPONENT_UNSIGNED_BYTE:
+						return static_cast<uint8_t>(*source);
+					case COMPONENT_UNSIGNED_SHORT: {
+						uint16_t value;
+						memcpy(&value, source, sizeof(uint16_t));
+						return value;
+					}
+					default: {
+						uint32_t value;
+						memcpy(&value, source, sizeof(uint32_t));
+						return value;
+					}
+				}
+			}
+		};
+
+		struct Document {
+			json::Value root;
+			std::string_view binary;
+		};
+
+		struct Primitive {
+			const json::Value* description;
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			bool hasNormals = false;
+		};
+
+		struct VertexHasher {
+			size_t operator()(const Vertex& vertex) const {
+				uint32_t bits[8];
+				memcpy(bits, &vertex, sizeof(bits));
+
+				uint64_t hash = 0;
+				for (const uint32_t word : bits) {
+					hash = (hash ^ word) * 0x100000001B3ull;
+				}
+				return mixHash(hash);
+			}
+		};
+
+		struct VertexKey {
+			Vertex vertex;
+
+			// Bitwise, so deduplication never merges vertices a shader could tell apart.
+			bool operator==(const VertexKey& other) const {
+				return memcmp(&vertex, &other.vertex, sizeof(Vertex)) == 0;
+			}
+		};
+
+		struct VertexKeyHasher {
+			size_t operator()(const VertexKey& key) const {
+				return VertexHasher{}(key.vertex);
+			}
+		};
+
+		static_assert(sizeof(Vertex) == 8 * sizeof(float), "VertexHasher hashes the vertex as eight words");
+
+		uint32_t readUint32(const std::string_view bytes, const size_t offset) {
+			uint32_t value;
+			memcpy(&value, bytes.data() + offset, sizeof(uint32_t));
+			return value;
+		}
+
+		Document readContainer(const std::string_view bytes) {
+			if (bytes.size() < 20 || readUint32(bytes, 0) != GLB_MAGIC) UTIL_THROW("Not a binary glTF file");
+			if (readUint32(bytes, 4) != 2) UTIL_THROW("Unsupported glTF container version " + std::to_string(readUint32(bytes, 4)));
+
+			const size_t length = std::min<size_t>(readUint32(bytes, 8), bytes.size());
+			Document document;
+			bool hasJson = false;
+
+			// Chunks are 4 byte aligned, JSON first and the binary buffer after it.
+			for (size_t offset = 12; offset + 8 <= length;) {
+				const size_t chunkLength = readUint32(bytes, offset);
+				const uint32_t chunkType = readUint32(bytes, offset + 4);
+				if (offset + 8 + chunkLength > length) UTIL_THROW("Truncated glTF chunk");
+
+				const std::string_view chunk = bytes.substr(offset + 8, chunkLength);
+				if (chunkType == CHUNK_JSON && !hasJson) {
+					document.root = json::parse(chunk);
+					hasJson = true;
+				} else if (chunkType == CHUNK_BIN && document.binary.empty()) {
+					document.binary = chunk;
+				}
+
+				offset += 8 + ((chunkLength + 3) & ~static_cast<size_t>(3));
+			}
+
+			if (!hasJson) UTIL_THROW("Binary glTF file without a JSON chunk");
+			return document;
+		}
+
+		const json::Value& element(const json::Value* array, const double index, const char* what) {
+			if (array == nullptr || index < 0.0 || index >= static_cast<double>(array->elements.size())) {
+				UTIL_THROW(std::string("glTF references missing ") + what + " " + std::to_string(index));
+			}
+			return array->elements[static_cast<size_t>(index)];
+		}
+
+		uint32_t componentCountOf(const std::string& type) {
+			if (type == "SCALAR") return 1;
+			if (type == "VEC2") return 2;
+			if (type == "VEC3") return 3;
+			if (type == "VEC4") return 4;
+			UTIL_THROW("Unsupported glTF accessor type " + type);
+		}
+
+		size_t componentSizeOf(const int componentType) {
+			switch (componentType) {
+				case COMPONENT_BYTE:
+				case COMPONENT_UNSIGNED_BYTE:
+					return 1;
+				case COMPONENT_SHORT:
+				case COMPONENT_UNSIGNED_SHORT:
+					return 2;
+				case COMPONENT_UNSIGNED_INT:
+				case COMPONENT_FLOAT:
+					return 4;
+				default:
+					UTIL_THROW("Unsupported glTF component type " + std::to_string(componentType));
+			}
+		}
+
+		AccessorView readAccessor(const Document& document, const double accessorIndex) {
+			const json::Value& accessor = element(document.root.Find("accessors"), accessorIndex, "accessor");
+
+			AccessorView view;
+			view.count = static_cast<size_t>(accessor.GetNumber("count", 0.0));
+			view.componentType = static_cast<int>(accessor.GetNumber("componentType", 0.0));
+			view.componentCount = componentCountOf(accessor.GetString("type"));
+
+			const json::Value* normalized = accessor.Find("normalized");
+			view.normalized = normalized != nullptr && normalized->boolean;
+
+			const size_t elementSize = componentSizeOf(view.componentType) * view.componentCount;
+			const double bufferViewIndex = accessor.GetNumber("bufferView", -1.0);
+			if (bufferViewIndex < 0.0) UTIL_THROW("Sparse or zero initialized glTF accessors are not supported");
+
+			const json::Value& bufferView = element(document.root.Find("bufferViews"), bufferViewIndex, "buffer view");
+			if (bufferView.GetNumber("buffer", 0.0) != 0.0) UTIL_THROW("Only the embedded glTF buffer is supported");
+
+			const size_t viewOffset = static_cast<size_t>(bufferView.GetNumber("byteOffset", 0.0));
+			const size_t viewLength = static_cast<size_t>(bufferView.GetNumber("byteLength", 0.0));
+			const size_t accessorOffset = static_cast<size_t>(accessor.GetNumber("byteOffset", 0.0));
+			view.stride = static_cast<size_t>(bufferView.GetNumber("byteStride", static_cast<double>(elementSize)));
+
+			const size_t lastByte = view.count == 0 ? 0 : accessorOffset + (view.count - 1) * view.stride + elementSize;
+			if (viewOffset + viewLength > document.binary.size() || lastByte > viewLength) {
+				UTIL_THROW("glTF accessor " + std::to_string(accessorIndex) + " reaches outside of its buffer");
+			}
+
+			view.data = document.binary.data() + viewOffset + accessorOffset;
+			return view;
+		}
+
+		void readPrimitive(const Document& document, Primitive& primitive) {
+			const json::Value* attributes = primitive.description->Find("attributes");
+			if (attributes == nullptr || attributes->Find("POSITION") == nullptr) {
+				UTIL_THROW("glTF primitive without positions");
+			}
+
+			const AccessorView positions = readAccessor(document, attributes->GetNumber("POSITION", -1.0));
+			if (positions.componentType != COMPONENT_FLOAT || positions.componentCount != 3) {
+				UTIL_THROW("glTF positions have to be float VEC3");
+			}
+
+			primitive.vertices.resize(positions.count);
+			for (size_t i = 0; i < positions.count; i++) {
+				Vertex& vertex = primitive.vertices[i];
+				vertex.position = glm::vec3(positions.ReadComponent(i, 0), positions.ReadComponent(i, 1), positions.ReadComponent(i, 2));
+				vertex.normal = glm::vec3(0.0f);
+				vertex.uv = glm::vec2(0.0f);
+			}
+
+			// Missing ones are generated once the primitives are merged, like for OBJ files.
+			if (attributes->Find("NORMAL") != nullptr) {
+				const AccessorView normals = readAccessor(document, attributes->GetNumber("NORMAL", -1.0));
+				if (normals.componentType != COMPONENT_FLOAT || normals.componentCount != 3 || normals.count != positions.count) {
+					UTIL_THROW("glTF normals have to be float VEC3 with one per position");
+				}
+
+				for (size_t i = 0; i < positions.count; i++) {
+					primitive.vertices[i].normal = glm::vec3(normals.ReadComponent(i, 0), normals.ReadComponent(i, 1), normals.ReadComponent(i, 2));
+				}
+				primitive.hasNormals = true;
+			}
+
+			if (attributes->Find("TEXCOORD_0") != nullptr) {
+				const AccessorView uvs = readAccessor(document, attributes->GetNumber("TEXCOORD_0", -1.0));
+				if (uvs.componentType != COMPONENT_FLOAT || uvs.componentCount != 2 || uvs.count != positions.count) {
+					UTIL_THROW("glTF texture coordinates have to be float VEC2 with one per position");
+				}
+
+				for (size_t i = 0; i < positions.count; i++) {
+					primitive.vertices[i].uv = glm::vec2(uvs.ReadComponent(i, 0), uvs.ReadComponent(i, 1));
+				}
+			}
+
+			if (primitive.description->Find("indices") != nullptr) {
+				const AccessorView indices = readAccessor(document, primitive.description->GetNumber("indices", -1.0));
+				primitive.indices.resize(indices.count - indices.count % 3);
+
+				for (size_t i = 0; i < primitive.indices.size(); i++) {
+					primitive.indices[i] = indices.ReadIndex(i);
+					if (primitive.indices[i] >= positions.count) UTIL_THROW("glTF index out of range");
+				}
+			} else {
+				primitive.indices.resize(positions.count - positions.count % 3);
+				for (size_t i = 0; i < primitive.indices.size(); i++) {
+					primitive.indices[i] = static_cast<uint32_t>(i);
+				}
+			}
+		}
+	}
+
+	MeshData parseGlb(const std::string_view bytes, utils::JobSystem& jobSystem, size_t& inputVertexCount) {
+		const Document document = readContainer(bytes);
+
+		std::vector<Primitive> primitives;
+		if (const json::Value* meshes = document.root.Find("meshes")) {
+			for (const json::Value& meshDescription : meshes->elements) {
+				const json::Value* meshPrimitives = meshDescription.Find("primitives");
+				if (meshPrimitives == nullptr) continue;
+
+				for (const json::Value& primitiveDescription : meshPrimitives->elements) {
+					// Points and lines have no place in a triangle mesh, strips and fans are rare enough to skip as well.
+					if (primitiveDescription.GetNumber("mode", MODE_TRIANGLES) != MODE_TRIANGLES) continue;
+					primitives.push_back({&primitiveDescription, {}, {}, false});
+				}
+			}
+		}
+
+		// Primitives are the unit of work, a throwing one fails the load once the others finished.
+		jobSystem.ParallelFor(static_cast<uint32_t>(primitives.size()), 1, [&document, &primitives](const uint32_t begin, const uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				readPrimitive(document, primitives[i]);
+			}
+		});
+
+		size_t cornerCount = 0;
+		for (const Primitive& primitive : primitives) {
+			cornerCount += primitive.indices.size();
+		}
+		inputVertexCount = cornerCount;
+
+		// Exporters duplicate vertices across primitives and along UV seams that turned out not to be seams.
+		MeshData mesh;
+		mesh.indices.reserve(cornerCount);
+		Deduplicator<VertexKey, VertexKeyHasher> deduplicator(cornerCount);
+		std::vector<bool> missingNormal(cornerCount, false);
+		bool anyMissingNormal = false;
+
+		for (const Primitive& primitive : primitives) {
+			for (const uint32_t index : primitive.indices) {
+				const uint32_t vertexIndex = deduplicator.Insert({primitive.vertices[index]});
+				mesh.indices.push_back(vertexIndex);
+				if (!primitive.hasNormals) {
+					missingNormal[vertexIndex] = true;
+					anyMissingNormal = true;
+				}
+			}
+		}
+
+		mesh.vertices.reserve(deduplicator.GetKeys().size());
+		for (const VertexKey& key : deduplicator.GetKeys()) {
+			mesh.vertices.push_back(key.vertex);
+		}
+
+		if (anyMissingNormal) {
+			missingNormal.resize(mesh.vertices.size());
+			generateMissingNormals(mesh, missingNormal);
+		}
+
+		return mesh;
+	}
+}
@@ -0,0 +1,61 @@
+﻿#include "GpuMesh.hpp"
+
+#include <chrono>
+#include <string>
+
+#include "Quantization.hpp"
+#include "../gpu/UploadStream.hpp"
+#include "../../utils/log.hpp"
+
+namespace mesh
+{
+	GpuMesh uploadMesh(const gpu::Context& context, const MeshData& mesh, LoadStats* stats) {
+		if (mesh.vertices.empty() || mesh.indices.empty()) {
+			UTIL_THROW("Can not upload a mesh without triangles");
+		}
+
+		const auto quantizeStart = std::chrono::steady_clock::now();
+		std::vector<QuantizedVertex> vertices;
+		const size_t clampedCount = quantizeVertices(mesh.vertices, vertices);
+		const auto uploadStart = std::chrono::steady_clock::now();
+
+		if (clampedCount > 0) {
+			UTIL_WARN(std::to_string(clampedCount) + " vertices have texture coordinates outside [0, 1], they were clamped");
+		}
+
+		const VkDeviceSize vertexBytes = vertices.size() * sizeof(QuantizedVertex);
+		const VkDeviceSize indexBytes = mesh.indices.size() * sizeof(uint32_t);
+
+		GpuMesh gpuMesh;
+		gpuMesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+		gpuMesh.boundingSphere = mesh.boundingSphere;
+		gpuMesh.lods = mesh.lods;
+		gpuMesh.meshlets = mesh.meshlets;
+		if (gpuMesh.lods.empty()) gpuMesh.lods.push_back({0, gpuMesh.indexCount, 0.0f, 0, 0});
+		gpuMesh.vertexBuffer = gpu::createBuffer(context, vertexBytes,
+		                                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		gpuMesh.indexBuffer = gpu::createBuffer(context, indexBytes,
+		                                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		gpu::UploadStream uploadStream(context);
+		uploadStream.Write(gpuMesh.vertexBuffer, vertices.data(), vertexBytes);
+		uploadStream.Write(gpuMesh.indexBuffer, mesh.indices.data(), indexBytes);
+		uploadStream.Finish();
+
+		if (stats != nullptr) {
+			stats->quantizeSeconds = std::chrono::duration<double>(uploadStart - quantizeStart).count();
+			stats->uploadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - uploadStart).count();
+			stats->bytesPerVertex = sizeof(QuantizedVertex);
+		}
+
+		return gpuMesh;
+	}
+
+	void destroyMesh(const gpu::Context& context, GpuMesh& mesh) {
+		gpu::destroyBuffer(context, mesh.vertexBuffer);
+		gpu::destroyBuffer(context, mesh.indexBuffer);
+		mesh = {};
+	}
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "../gpu/Buffer.hpp"
+
+namespace mesh
+{
+	// Device local copy of a MeshData, drawn as uint32 indexed triangles of QuantizedVertex from binding 0.
+	struct GpuMesh {
+		gpu::Buffer vertexBuffer;
+		gpu::Buffer indexBuffer;
+		uint32_t indexCount = 0; // Of all LODs together.
+		glm::vec4 boundingSphere = glm::vec4(0.0f);
+
+		// Kept on the CPU to pick what to draw, a mesh without generated LODs has a single one covering all indices.
+		std::vector<Lod> lods;
+		std::vector<Meshlet> meshlets;
+	};
+
+	// Quantizes the vertices, then streams both buffers through a gpu::UploadStream and returns once they are complete.
+	// Fills in the quantization and upload part of the stats when given.
+	GpuMesh uploadMesh(const gpu::Context& context, const MeshData& mesh, LoadStats* stats = nullptr);
+	void destroyMesh(const gpu::Context& context, GpuMesh& mesh);
+}
@@ -0,0 +1,251 @@
+﻿#include "Json.hpp"
+
+#include <charconv>
+#include <string>
+
+#include "../../utils/log.hpp"
+
+namespace mesh::json
+{
+	namespace
+	{
+		class Parser {
+		private: // Member Variables
+			std::string_view text;
+			size_t position = 0;
+
+		public: // Public Functions
+			explicit Parser(const std::string_view text) : text(text) {}
+
+			// Iterative, the open containers are kept on a stack instead of the call stack so deep documents can not overflow it.
+			// Containers on the stack are always the last element of their parent, so their addresses stay valid.
+			Value ParseDocument() {
+				Value root;
+				std::vector<Value*> openContainers;
+				Value* target = &root;
+
+				while (true) {
+					skipWhitespace();
+
+					bool opened = false;
+					switch (peek()) {
+						case '{':
+							position++;
+							target->type = Value::Type::Object;
+							skipWhitespace();
+							if (peek() == '}') {
+								position++;
+							} else {
+								openContainers.push_back(target);
+								target = beginMember(*target);
+								opened = true;
+							}
+							break;
+						case '[':
+							position++;
+							target->type = Value::Type::Array;
+							skipWhitespace();
+							if (peek() == ']') {
+								position++;
+							} else {
+								openContainers.push_back(target);
+								target = &target->elements.emplace_back();
+								opened = true;
+							}
+							break;
+						case '"':
+							target->type = Value::Type::String;
+							target->string = parseString();
+							break;
+						case 't':
+							expectLiteral("true");
+							target->type = Value::Type::Bool;
+							target->boolean = true;
+							break;
+						case 'f':
+							expectLiteral("false");
+							target->type = Value::Type::Bool;
+							break;
+						case 'n':
+							expectLiteral("null");
+							break;
+						default:
+							target->type = Value::Type::Number;
+							target->number = parseNumber();
+							break;
+					}
+
+					if (opened) continue;
+
+					// The value is complete, close every container that ends here.
+					while (true) {
+						if (openContainers.empty()) {
+							skipWhitespace();
+							if (position != text.size()) fail("trailing characters");
+							return root;
+						}
+
+						Value& container = *openContainers.back();
+						const bool isArray = container.type == Value::Type::Array;
+
+						skipWhitespace();
+						if (peek() == ',') {
+							position++;
+							target = isArray ? &container.elements.emplace_back() : beginMember(container);
+							break;
+						}
+
+						if (peek() != (isArray ? ']' : '}')) fail(isArray ? "expected ',' or ']'" : "expected ',' or '}'");
+						position++;
+						openContainers.pop_back();
+					}
+				}
+			}
+
+		private: // Private Methods
+			[[noreturn]] void fail(const std::string& reason) const {
+				UTIL_THROW("Invalid JSON at offset " + std::to_string(position) + ": " + reason);
+			}
+
+			char peek() const {
+				if (position >= text.size()) fail("unexpected end");
+				return text[position];
+			}
+
+			void skipWhitespace() {
+				while (position < text.size() && (text[position] == ' ' || text[position] == '\t' ||
+				                                  text[position] == '\n' || text[position] == '\r')) {
+					position++;
+				}
+			}
+
+			void expectLiteral(const std::string_view literal) {
+				if (text.substr(position, literal.size()) != literal) fail("unknown literal");
+				position += literal.size();
+			}
+
+			Value* beginMember(Value& object) {
+				skipWhitespace();
+				if (peek() != '"') fail("expected a member name");
+				object.keys.push_back(parseString());
+
+				skipWhitespace();
+				if (peek() != ':') fail("expected ':'");
+				position++;
+
+				return &object.elements.emplace_back();
+			}
+
+			double parseNumber() {
+				double number = 0.0;
+				const char* begin = text.data() + position;
+				const char* end = text.data() + text.size();
+
+				// from_chars does not take the leading '+' JSON forbids anyway, but does take "inf" and "nan" which JSON does not.
+				if (*begin != '-' && (*begin < '0' || *begin > '9')) fail("unexpected character");
+
+				const auto [pointer, error] = std::from_chars(begin, end, number);
+				if (error != std::errc()) fail("invalid number");
+
+				position += pointer - begin;
+				return number;
+			}
+
+			void appendUtf8(std::string& string, const uint32_t codePoint) const {
+				if (codePoint < 0x80) {
+					string += static_cast<char>(codePoint);
+				} else if (codePoint < 0x800) {
+					string += static_cast<char>(0xC0 | codePoint >> 6);
+					string += static_cast<char>(0x80 | (codePoint & 0x3F));
+				} else if (codePoint < 0x10000) {
+					string += static_cast<char>(0xE0 | codePoint >> 12);
+					string += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+					string += static_cast<char>(0x80 | (codePoint & 0x3F));
+				} else {
+					string += static_cast<char>(0xF0 | codePoint >> 18);
+					string += static_cast<char>(0x80 | (codePoint >> 12 & 0x3F));
+					string += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+					string += static_cast<char>(0x80 | (codePoint & 0x3F));
+				}
+			}
+
+			uint32_t parseHex4() {
+				if (position + 4 > text.size()) fail("unexpected end");
+
+				uint32_t value = 0;
+				const auto [pointer, error] = std::from_chars(text.data() + position, text.data() + position + 4, value, 16);
+				if (error != std::errc() || pointer != text.data() + position + 4) fail("invalid \\u escape");
+
+				position += 4;
+				return value;
+			}
+
+			std::string parseString() {
+				position++; // Opening quote.
+				std::string string;
+
+				while (true) {
+					const char character = peek();
+					position++;
+
+					if (character == '"') return string;
+					if (character != '\\') {
+						string += character;
+						continue;
+					}
+
+					const char escape = peek();
+					position++;
+
+					switch (escape) {
+						case '"': string += '"'; break;
+						case '\\': string += '\\'; break;
+						case '/': string += '/'; break;
+						case 'b': string += '\b'; break;
+						case 'f': string += '\f'; break;
+						case 'n': string += '\n'; break;
+						case 'r': string += '\r'; break;
+						case 't': string += '\t'; break;
+						case 'u': {
+							uint32_t codePoint = parseHex4();
+							// A high surrogate combines with the low surrogate escaped right after it.
+							if (codePoint >= 0xD800 && codePoint < 0xDC00 && text.substr(position, 2) == "\\u") {
+								position += 2;
+								const uint32_t low = parseHex4();
+								codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+							}
+							appendUtf8(string, codePoint);
+							break;
+						}
+						default:
+							fail("invalid escape");
+					}
+				}
+			}
+		};
+	}
+
+	const Value* Value::Find(const std::string_view key) const {
+		for (size_t i = 0; i < keys.size(); i++) {
+			if (keys[i] == key) return &elements[i];
+		}
+
+		return nullptr;
+	}
+
+	double Value::GetNumber(const std::string_view key, const double fallback) const {
+		const Value* member = Find(key);
+		return member != nullptr && member->type == Type::Number ? member->number : fallback;
+	}
+
+	const std::string& Value::GetString(const std::string_view key) const {
+		static const std::string EMPTY;
+
+		const Value* member = Find(key);
+		return member != nullptr && member->type == Type::String ? member->string : EMPTY;
+	}
+
+	Value parse(const std::string_view text) {
+		return Parser(text).ParseDocument();
+	}
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mesh::json
+{
+	// Just enough JSON for the glTF header, a document tree without any comments or extensions.
+	struct Value {
+		enum class Type {
+			Null,
+			Bool,
+			Number,
+			String,
+			Array,
+			Object,
+		};
+
+		Type type = Type::Null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<Value> elements; // Array elements, or the object member values in the order of keys.
+		std::vector<std::string> keys;
+
+		// Missing members and members of non objects are nullptr.
+		const Value* Find(std::string_view key) const;
+
+		double GetNumber(std::string_view key, double fallback) const;
+		const std::string& GetString(std::string_view key) const;
+	};
+
+	Value parse(std::string_view text);
+}
@@ -0,0 +1,61 @@
+﻿#include "LodChain.hpp"
+
+#include "Meshlets.hpp"
+#include "Simplifier.hpp"
+#include "VertexCache.hpp"
+#include "../../utils/log.hpp"
+
+namespace mesh
+{
+	void generateLods(MeshData& mesh) {
+		// Only LOD 0 survives a second call, so regenerating never simplifies a simplified chain.
+		if (!mesh.lods.empty()) mesh.indices.resize(mesh.lods[0].indexCount);
+		mesh.lods.clear();
+		mesh.meshlets.clear();
+
+		mesh.lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f, 0, 0});
+		std::vector<uint32_t> current = mesh.indices;
+		float error = 0.0f;
+
+		while (mesh.lods.size() < MAX_LODS && current.size() / 3 > MIN_LOD_TRIANGLES) {
+			const size_t targetIndexCount = static_cast<size_t>(static_cast<float>(current.size() / 3) * LOD_REDUCTION) * 3;
+
+			float simplifyError = 0.0f;
+			std::vector<uint32_t> simplified = simplify(mesh.vertices, current, targetIndexCount, simplifyError);
+			// Less than a tenth fewer triangles is not worth the memory of another LOD.
+			if (simplified.size() * 10 > current.size() * 9) break;
+
+			optimizeVertexCache(simplified, mesh.vertices.size());
+			// Every step is measured against the LOD it started from, adding them up keeps the bound against LOD 0.
+			error += simplifyError;
+
+			mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(simplified.size()),
+			                     error, 0, 0});
+			mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+			current = std::move(simplified);
+		}
+
+		for (Lod& lod : mesh.lods) {
+			lod.firstMeshlet = static_cast<uint32_t>(mesh.meshlets.size());
+			buildMeshlets(mesh.vertices, mesh.indices, lod.firstIndex, lod.indexCount, mesh.meshlets);
+			lod.meshletCount = static_cast<uint32_t>(mesh.meshlets.size()) - lod.firstMeshlet;
+		}
+	}
+
+	void generateLods(std::vector<MeshData>& meshes, utils::JobSystem& jobSystem) {
+		// Meshes differ wildly in size, single mesh jobs let idle workers steal the rest instead of waiting on fixed slices.
+		jobSystem.ParallelFor(static_cast<uint32_t>(meshes.size()), 1, [&meshes](const uint32_t begin, const uint32_t end) {
+			for (uint32_t mesh = begin; mesh < end; mesh++) {
+				generateLods(meshes[mesh]);
+			}
+		});
+	}
+
+	void logLods(const std::string& name, const MeshData& mesh) {
+		UTIL_LOG("LODs of " + name + ":");
+		for (size_t lod = 0; lod < mesh.lods.size(); lod++) {
+			UTIL_LOG("  LOD " + std::to_string(lod) + ": " + std::to_string(mesh.lods[lod].indexCount / 3) + " triangles in " +
+				std::to_string(mesh.lods[lod].meshletCount) + " meshlets, error " + std::to_string(mesh.lods[lod].error));
+		}
+	}
+}
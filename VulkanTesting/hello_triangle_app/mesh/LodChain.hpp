@@ -0,0 +1,26 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "../../utils/JobSystem.hpp"
+
+namespace mesh
+{
+	constexpr uint32_t MAX_LODS = 8;
+	// Every LOD aims for this share of the triangles of the one before it.
+	constexpr float LOD_REDUCTION = 0.5f;
+	// Below this many triangles a coarser LOD saves less than the draw costs.
+	constexpr uint32_t MIN_LOD_TRIANGLES = 64;
+
+	// Replaces mesh.lods and mesh.meshlets with a chain simplified from indices as LOD 0, appending the coarser index
+	// ranges behind it. Every LOD is cache optimized on its own and split into meshlets. Stops early when simplification
+	// stalls, as locked borders and seams can only shrink so far.
+	void generateLods(MeshData& mesh);
+	// The same for many meshes, one job per mesh.
+	void generateLods(std::vector<MeshData>& meshes, utils::JobSystem& jobSystem = utils::JobSystem::GetShared());
+
+	void logLods(const std::string& name, const MeshData& mesh);
+}
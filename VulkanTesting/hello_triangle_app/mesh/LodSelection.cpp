@@ -0,0 +1,89 @@
+﻿#include "LodSelection.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mesh
+{
+	namespace
+	{
+		glm::vec4 row(const glm::mat4& matrix, const int index) {
+			return glm::vec4(matrix[0][index], matrix[1][index], matrix[2][index], matrix[3][index]);
+		}
+
+		bool isInFrustum(const culling::Frustum& frustum, const glm::vec4& sphere) {
+			for (const glm::vec4& plane : frustum) {
+				if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w) return false;
+			}
+			return true;
+		}
+
+		bool isBackFacing(const Meshlet& meshlet, const LodView& view) {
+			if (meshlet.coneCutoff >= 1.0f) return false;
+
+			// The cone holds counter clockwise normals, flip it when those are the back faces' normals.
+			const glm::vec3 backAxis = meshlet.coneAxis * -view.frontFacing;
+
+			if (view.eye.w == 0.0f) return glm::dot(glm::vec3(view.eye), backAxis) >= meshlet.coneCutoff;
+
+			// Widened by the radius, so the test holds from every point of the sphere and needs no cone apex.
+			const glm::vec3 toCenter = glm::vec3(meshlet.boundingSphere) - glm::vec3(view.eye);
+			return glm::dot(toCenter, backAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.boundingSphere.w;
+		}
+	}
+
+	LodView makeLodView(const glm::mat4& viewProjection, const float viewportHeight, const bool clockwiseFrontFace) {
+		LodView view;
+		view.viewProjection = viewProjection;
+		view.frustum = culling::extractFrustum(viewProjection);
+
+		// The point at infinity in front of the near plane, it is the eye itself for perspective projections.
+		glm::vec4 eye = glm::inverse(viewProjection) * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+		if (std::abs(eye.w) > 1e-6f) {
+			view.eye = glm::vec4(glm::vec3(eye) / eye.w, 1.0f);
+		} else {
+			view.eye = glm::vec4(glm::normalize(glm::vec3(eye)), 0.0f);
+		}
+
+		view.pixelScale = glm::length(glm::vec3(row(viewProjection, 1))) * viewportHeight * 0.5f;
+
+		// Mirroring transforms turn the screen space winding around, as does switching the front face.
+		const float handedness = glm::determinant(viewProjection) < 0.0f ? -1.0f : 1.0f;
+		view.frontFacing = clockwiseFrontFace ? handedness : -handedness;
+		return view;
+	}
+
+	uint32_t selectLod(const std::vector<Lod>& lods, const glm::vec4& boundingSphere, const LodView& view,
+	                   const float maxPixelError) {
+		const glm::vec4 wRow = row(view.viewProjection, 3);
+		const float centerW = glm::dot(wRow, glm::vec4(glm::vec3(boundingSphere), 1.0f));
+		const float nearestW = centerW - boundingSphere.w * glm::length(glm::vec3(wRow));
+		if (nearestW <= 0.0f) return 0;
+
+		uint32_t selected = 0;
+		for (uint32_t lod = 1; lod < lods.size(); lod++) {
+			if (lods[lod].error * view.pixelScale / nearestW > maxPixelError) break;
+			selected = lod;
+		}
+		return selected;
+	}
+
+	void cullMeshlets(const Lod& lod, const std::vector<Meshlet>& meshlets, const LodView& view,
+	                  std::vector<IndexRange>& draws) {
+		if (lod.meshletCount == 0) {
+			draws.push_back({lod.firstIndex, lod.indexCount});
+			return;
+		}
+
+		for (uint32_t id = lod.firstMeshlet; id < lod.firstMeshlet + lod.meshletCount; id++) {
+			const Meshlet& meshlet = meshlets[id];
+			if (!isInFrustum(view.frustum, meshlet.boundingSphere) || isBackFacing(meshlet, view)) continue;
+
+			if (!draws.empty() && draws.back().firstIndex + draws.back().indexCount == meshlet.firstIndex) {
+				draws.back().indexCount += meshlet.indexCount;
+			} else {
+				draws.push_back({meshlet.firstIndex, meshlet.indexCount});
+			}
+		}
+	}
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "../culling/Frustum.hpp"
+
+namespace mesh
+{
+	// What LOD selection and meshlet culling need from the camera, derived once per frame.
+	struct LodView {
+		glm::mat4 viewProjection;
+		culling::Frustum frustum;
+		// Camera position with w = 1 for perspective projections, the direction it looks in with w = 0 for orthographic ones.
+		glm::vec4 eye;
+		// Clip space y per unit of length, times half the viewport height, turns lengths into pixels once divided by w.
+		float pixelScale;
+		// 1 when triangles with counter clockwise normals facing away from the eye are the front faces, -1 otherwise.
+		float frontFacing;
+	};
+
+	struct IndexRange {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+	};
+
+	// clockwiseFrontFace has to match the frontFace of the pipeline the meshes are drawn with.
+	LodView makeLodView(const glm::mat4& viewProjection, float viewportHeight, bool clockwiseFrontFace);
+
+	// The coarsest LOD whose error covers at most maxPixelError pixels on screen, measured at the nearest point of the
+	// bounding sphere. Meshes without LODs and spheres crossing the eye plane get LOD 0.
+	uint32_t selectLod(const std::vector<Lod>& lods, const glm::vec4& boundingSphere, const LodView& view,
+	                   float maxPixelError);
+
+	// Appends the index ranges of the meshlets of lod that are inside the frustum and not entirely back facing,
+	// neighbouring survivors are merged into one range. Without meshlets the whole LOD is appended.
+	void cullMeshlets(const Lod& lod, const std::vector<Meshlet>& meshlets, const LodView& view,
+	                  std::vector<IndexRange>& draws);
+}
@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "VertexLayout.hpp"
+
+namespace mesh
+{
+	// Working format of the loader and every geometry pass after it.
+	struct Vertex {
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv; // Top left origin, OBJ texture coordinates are flipped on load.
+	};
+
+	// What is uploaded, 16 bytes instead of 32. Positions are half floats, normals octahedral and texture coordinates
+	// clamped to [0, 1], shader.vert decodes the normal.
+	struct QuantizedVertex {
+		Half4 position; // w is always 1.
+		Snorm16x2 normal;
+		Unorm16x2 uv;
+	};
+
+	template<>
+	struct VertexFields<Vertex> {
+		static constexpr std::array FIELDS = {
+			VERTEX_FIELD(Vertex, position),
+			VERTEX_FIELD(Vertex, normal),
+			VERTEX_FIELD(Vertex, uv),
+		};
+	};
+
+	template<>
+	struct VertexFields<QuantizedVertex> {
+		static constexpr std::array FIELDS = {
+			VERTEX_FIELD(QuantizedVertex, position),
+			VERTEX_FIELD(QuantizedVertex, normal),
+			VERTEX_FIELD(QuantizedVertex, uv),
+		};
+	};
+
+	// A run of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles of one LOD, culled as a whole. Without mesh
+	// shaders it is drawn as a range of the index buffer.
+	struct Meshlet {
+		static constexpr uint32_t MAX_VERTICES = 64;
+		static constexpr uint32_t MAX_TRIANGLES = 124;
+
+		glm::vec4 boundingSphere;
+		// Contains the counter clockwise normals of every triangle. A cutoff of 1 means the normals spread too far to cull.
+		glm::vec3 coneAxis;
+		float coneCutoff;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+	};
+
+	struct Lod {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		float error; // Upper bound of how far the surface moved from LOD 0, in mesh units.
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+	};
+
+	// Indexed triangle list, every vertex unique. Every LOD reuses the same vertices, their index ranges follow each
+	// other in indices. Without generateLods() there are no LODs and no meshlets, indices is LOD 0.
+	struct MeshData {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		glm::vec4 boundingSphere = glm::vec4(0.0f); // xyz center, w radius.
+
+		std::vector<Lod> lods; // From full detail to coarsest.
+		std::vector<Meshlet> meshlets;
+	};
+
+	struct LoadStats {
+		size_t fileBytes = 0;
+		size_t triangleCount = 0;
+		size_t inputVertexCount = 0; // Triangle corners before deduplication.
+		size_t vertexCount = 0;
+		uint32_t threadCount = 1;
+
+		double parseSeconds = 0.0; // Includes deduplication.
+		double optimizeSeconds = 0.0;
+		double quantizeSeconds = 0.0; // This and the rest are filled in by uploadMesh().
+		double uploadSeconds = 0.0;
+		size_t bytesPerVertex = 0;
+
+		// Average cache miss ratio, vertex shader invocations per triangle in a 16 entry FIFO cache.
+		float acmrBefore = 0.0f;
+		float acmrAfter = 0.0f;
+	};
+
+	// Prints MB/s over the file size and triangles/s, for parsing alone and for the whole load.
+	void logLoadStats(const std::string& name, const LoadStats& stats);
+
+	glm::vec4 computeBoundingSphere(const std::vector<Vertex>& vertices);
+}
@@ -0,0 +1,122 @@
+﻿#include "MeshLoader.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+#include "VertexCache.hpp"
+#include "../../utils/MappedFile.hpp"
+#include "../../utils/log.hpp"
+
+namespace mesh
+{
+	namespace
+	{
+		double secondsSince(const std::chrono::steady_clock::time_point start) {
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		std::string lowercaseExtension(const std::string& fileName) {
+			std::string extension = std::filesystem::path(fileName).extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char character) {
+				return static_cast<char>(std::tolower(character));
+			});
+			return extension;
+		}
+	}
+
+	void generateMissingNormals(MeshData& mesh, const std::vector<bool>& missingNormal) {
+		// Area weighted, the cross product is already twice the triangle area long.
+		for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+			const Vertex& a = mesh.vertices[mesh.indices[i]];
+			const Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+			const Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+			const glm::vec3 faceNormal = glm::cross(b.position - a.position, c.position - a.position);
+
+			for (const uint32_t index : {mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]}) {
+				if (missingNormal[index]) mesh.vertices[index].normal += faceNormal;
+			}
+		}
+
+		for (size_t i = 0; i < mesh.vertices.size(); i++) {
+			const float length = glm::length(mesh.vertices[i].normal);
+			if (missingNormal[i] && length > 0.0f) mesh.vertices[i].normal /= length;
+		}
+	}
+
+	MeshData loadMesh(const std::string& fileName, LoadStats& stats, utils::JobSystem& jobSystem) {
+		const std::string extension = lowercaseExtension(fileName);
+		if (extension != ".obj" && extension != ".glb") {
+			UTIL_THROW("Unsupported mesh format " + extension + " of " + fileName + ", expected .obj or .glb");
+		}
+
+		const utils::io::MappedFile file(fileName);
+		stats = {};
+		stats.fileBytes = file.GetSize();
+		stats.threadCount = jobSystem.GetThreadCount();
+
+		const auto parseStart = std::chrono::steady_clock::now();
+		MeshData mesh = extension == ".obj"
+			                ? parseObj(file.GetView(), jobSystem, stats.inputVertexCount)
+			                : parseGlb(file.GetView(), jobSystem, stats.inputVertexCount);
+		stats.parseSeconds = secondsSince(parseStart);
+
+		const auto optimizeStart = std::chrono::steady_clock::now();
+		stats.acmrBefore = computeAcmr(mesh.indices, mesh.vertices.size());
+		optimizeVertexCache(mesh.indices, mesh.vertices.size());
+		optimizeVertexFetch(mesh.vertices, mesh.indices);
+		stats.acmrAfter = computeAcmr(mesh.indices, mesh.vertices.size());
+		mesh.boundingSphere = computeBoundingSphere(mesh.vertices);
+		stats.optimizeSeconds = secondsSince(optimizeStart);
+
+		stats.triangleCount = mesh.indices.size() / 3;
+		stats.vertexCount = mesh.vertices.size();
+		return mesh;
+	}
+
+	void logLoadStats(const std::string& name, const LoadStats& stats) {
+		const double megabytes = static_cast<double>(stats.fileBytes) / (1024.0 * 1024.0);
+		const double triangles = static_cast<double>(stats.triangleCount);
+		const double totalSeconds = stats.parseSeconds + stats.optimizeSeconds + stats.quantizeSeconds + stats.uploadSeconds;
+
+		const auto perSecond = [](const double amount, const double seconds) {
+			return std::to_string(static_cast<int64_t>(seconds > 0.0 ? amount / seconds : 0.0));
+		};
+
+		UTIL_LOG("Loaded " + name + ": " + std::to_string(stats.triangleCount) + " triangles, " +
+			std::to_string(stats.inputVertexCount) + " corners deduplicated to " + std::to_string(stats.vertexCount) +
+			" vertices on " + std::to_string(stats.threadCount) + " threads");
+		UTIL_LOG("  parse " + std::to_string(stats.parseSeconds * 1000.0) + " ms (" + perSecond(megabytes, stats.parseSeconds) +
+			" MB/s, " + perSecond(triangles, stats.parseSeconds) + " triangles/s), optimize " +
+			std::to_string(stats.optimizeSeconds * 1000.0) + " ms (ACMR " + std::to_string(stats.acmrBefore) + " -> " +
+			std::to_string(stats.acmrAfter) + "), quantize " + std::to_string(stats.quantizeSeconds * 1000.0) + " ms (" +
+			std::to_string(stats.bytesPerVertex) + " bytes/vertex instead of " + std::to_string(sizeof(Vertex)) + "), upload " +
+			std::to_string(stats.uploadSeconds * 1000.0) + " ms (" +
+			perSecond(static_cast<double>(stats.vertexCount * stats.bytesPerVertex) / (1024.0 * 1024.0), stats.uploadSeconds) +
+			" MB/s of vertices)");
+		UTIL_LOG("  total " + std::to_string(totalSeconds * 1000.0) + " ms (" + perSecond(megabytes, totalSeconds) +
+			" MB/s, " + perSecond(triangles, totalSeconds) + " triangles/s)");
+	}
+
+	glm::vec4 computeBoundingSphere(const std::vector<Vertex>& vertices) {
+		if (vertices.empty()) return glm::vec4(0.0f);
+
+		// Around the box center, not minimal but never off by more than the box is from a sphere.
+		glm::vec3 min = vertices[0].position;
+		glm::vec3 max = vertices[0].position;
+		for (const Vertex& vertex : vertices) {
+			min = glm::min(min, vertex.position);
+			max = glm::max(max, vertex.position);
+		}
+
+		const glm::vec3 center = (min + max) * 0.5f;
+		float radius = 0.0f;
+		for (const Vertex& vertex : vertices) {
+			radius = std::max(radius, glm::distance(center, vertex.position));
+		}
+
+		return glm::vec4(center, radius);
+	}
+}
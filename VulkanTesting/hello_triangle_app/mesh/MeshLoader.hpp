@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "../../utils/JobSystem.hpp"
+
+namespace mesh
+{
+	// Maps the file, parses it on jobSystem into deduplicated indexed geometry,
+	// then optimizes the triangle order for the post transform cache and the vertex order for fetching.
+	// Supports Wavefront .obj and binary glTF .glb, by extension.
+	MeshData loadMesh(const std::string& fileName, LoadStats& stats,
+	                  utils::JobSystem& jobSystem = utils::JobSystem::GetShared());
+
+	// The parsing step of loadMesh() for data already in memory, inputVertexCount receives the corners before deduplication.
+	MeshData parseObj(std::string_view text, utils::JobSystem& jobSystem, size_t& inputVertexCount);
+	// Every triangle primitive of every mesh merged into one, node transforms are not applied.
+	MeshData parseGlb(std::string_view bytes, utils::JobSystem& jobSystem, size_t& inputVertexCount);
+	// Smooth, area weighted normals for the vertices flagged in missingNormal, from the triangles using them.
+	void generateMissingNormals(MeshData& mesh, const std::vector<bool>& missingNormal);
+}
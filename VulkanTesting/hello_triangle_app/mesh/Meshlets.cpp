@@ -0,0 +1,98 @@
+﻿#include "Meshlets.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mesh
+{
+	namespace
+	{
+		void computeBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, Meshlet& meshlet) {
+			const uint32_t* first = &indices[meshlet.firstIndex];
+			const uint32_t* last = first + meshlet.indexCount;
+
+			glm::vec3 min = vertices[*first].position;
+			glm::vec3 max = min;
+			for (const uint32_t* index = first; index != last; index++) {
+				min = glm::min(min, vertices[*index].position);
+				max = glm::max(max, vertices[*index].position);
+			}
+
+			const glm::vec3 center = (min + max) * 0.5f;
+			float radius = 0.0f;
+			for (const uint32_t* index = first; index != last; index++) {
+				radius = std::max(radius, glm::distance(center, vertices[*index].position));
+			}
+			meshlet.boundingSphere = glm::vec4(center, radius);
+
+			// Averaged unit normals as the cone axis, the widest normal decides the opening.
+			glm::vec3 normalSum(0.0f);
+			for (const uint32_t* index = first; index != last; index += 3) {
+				const glm::vec3 a = vertices[index[0]].position;
+				const glm::vec3 normal = glm::cross(vertices[index[1]].position - a, vertices[index[2]].position - a);
+				const float length = glm::length(normal);
+				if (length > 0.0f) normalSum += normal / length;
+			}
+
+			const float axisLength = glm::length(normalSum);
+			meshlet.coneAxis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+			meshlet.coneCutoff = 1.0f;
+			if (axisLength == 0.0f) return;
+
+			float minDot = 1.0f;
+			for (const uint32_t* index = first; index != last; index += 3) {
+				const glm::vec3 a = vertices[index[0]].position;
+				const glm::vec3 normal = glm::cross(vertices[index[1]].position - a, vertices[index[2]].position - a);
+				const float length = glm::length(normal);
+				if (length > 0.0f) minDot = std::min(minDot, glm::dot(normal / length, meshlet.coneAxis));
+			}
+
+			// Past roughly 84 degrees the cone would almost never cull anything, keep the test from running at all.
+			if (minDot <= 0.1f) return;
+			// Sine of the opening, the view direction has to be within 90 degrees minus the opening of the axis.
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	void buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const uint32_t firstIndex,
+	                   const uint32_t indexCount, std::vector<Meshlet>& meshlets) {
+		// Index of the meshlet that last used a vertex, so membership is one lookup instead of a search.
+		std::vector<uint32_t> lastMeshlet(vertices.size(), UINT32_MAX);
+
+		Meshlet meshlet = {};
+		meshlet.firstIndex = firstIndex;
+		uint32_t meshletVertexCount = 0;
+		uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+
+		for (uint32_t corner = firstIndex; corner < firstIndex + indexCount; corner += 3) {
+			uint32_t newVertices = 0;
+			for (uint32_t i = 0; i < 3; i++) {
+				if (lastMeshlet[indices[corner + i]] != meshletId) newVertices++;
+			}
+
+			if (meshletVertexCount + newVertices > Meshlet::MAX_VERTICES ||
+			    meshlet.indexCount / 3 == Meshlet::MAX_TRIANGLES) {
+				computeBounds(vertices, indices, meshlet);
+				meshlets.push_back(meshlet);
+
+				meshlet = {};
+				meshlet.firstIndex = corner;
+				meshletVertexCount = 0;
+				meshletId++;
+			}
+
+			for (uint32_t i = 0; i < 3; i++) {
+				uint32_t& last = lastMeshlet[indices[corner + i]];
+				if (last == meshletId) continue;
+				last = meshletId;
+				meshletVertexCount++;
+			}
+			meshlet.indexCount += 3;
+		}
+
+		if (meshlet.indexCount > 0) {
+			computeBounds(vertices, indices, meshlet);
+			meshlets.push_back(meshlet);
+		}
+	}
+}
@@ -0,0 +1,15 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.hpp"
+
+namespace mesh
+{
+	// Splits indices[firstIndex, firstIndex + indexCount) into meshlets of consecutive triangles, closing one as soon
+	// as the next triangle would exceed a limit. Run it on cache optimized indices, neighbouring triangles then land
+	// in the same meshlet and its bounds stay tight.
+	void buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t firstIndex,
+	                   uint32_t indexCount, std::vector<Meshlet>& meshlets);
+}
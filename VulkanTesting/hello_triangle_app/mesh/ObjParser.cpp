@@ -0,0 +1,296 @@
+﻿#include "MeshLoader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <string>
+
+#include "Deduplicator.hpp"
+#include "../../utils/log.hpp"
+
+namespace mesh
+{
+	namespace
+	{
+		enum Attribute : uint32_t {
+			POSITION,
+			UV,
+			NORMAL,
+			ATTRIBUTE_COUNT,
+		};
+
+		// Positive OBJ indices are absolute, negative ones count back from the last element read so far. Relative indices
+		// are resolved against the chunk first and get the element count of earlier chunks added once those are known.
+		struct Corner {
+			int32_t indices[ATTRIBUTE_COUNT];
+			uint8_t relativeMask = 0;
+			uint8_t presentMask = 0;
+		};
+
+		struct Chunk {
+			std::string_view text;
+
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec2> uvs;
+			std::vector<glm::vec3> normals;
+			std::vector<Corner> corners; // Three per triangle, polygons are fanned.
+			bool parsed = false;
+			size_t lineNumber = 0; // Of the first failing line, for the error message.
+		};
+
+		struct CornerKey {
+			uint32_t indices[ATTRIBUTE_COUNT];
+
+			bool operator==(const CornerKey& other) const {
+				return indices[POSITION] == other.indices[POSITION] && indices[UV] == other.indices[UV] &&
+				       indices[NORMAL] == other.indices[NORMAL];
+			}
+		};
+
+		struct CornerKeyHasher {
+			size_t operator()(const CornerKey& key) const {
+				const uint64_t packed = static_cast<uint64_t>(key.indices[POSITION]) << 32 | key.indices[UV];
+				return mixHash(packed ^ key.indices[NORMAL] * 0x9E3779B97F4A7C15ull);
+			}
+		};
+
+		constexpr uint32_t MISSING = UINT32_MAX;
+
+		class LineReader {
+		private: // Member Variables
+			const char* current;
+			const char* end;
+
+		public: // Public Functions
+			LineReader(const char* begin, const char* end) : current(begin), end(end) {}
+
+			bool AtEnd() const {
+				return current >= end;
+			}
+
+			void SkipSpaces() {
+				while (current < end && (*current == ' ' || *current == '\t')) current++;
+			}
+
+			bool AtLineEnd() const {
+				return current >= end || *current == '\n' || *current == '\r' || *current == '#';
+			}
+
+			void NextLine() {
+				while (current < end && *current != '\n') current++;
+				if (current < end) current++;
+			}
+
+			char Peek() const {
+				return current < end ? *current : '\0';
+			}
+
+			void Skip(const size_t count) {
+				current += count;
+			}
+
+			bool ReadFloat(float& value) {
+				SkipSpaces();
+				const auto [pointer, error] = std::from_chars(current, end, value);
+				if (error != std::errc()) return false;
+
+				current = pointer;
+				return true;
+			}
+
+			bool ReadIndex(int32_t& value) {
+				const auto [pointer, error] = std::from_chars(current, end, value);
+				if (error != std::errc() || value == 0) return false;
+
+				current = pointer;
+				return true;
+			}
+		};
+
+		bool parseCorner(LineReader& reader, const Chunk& chunk, Corner& corner) {
+			const size_t counts[ATTRIBUTE_COUNT] = {chunk.positions.size(), chunk.uvs.size(), chunk.normals.size()};
+
+			// p, p/t, p//n or p/t/n.
+			for (uint32_t attribute = POSITION; attribute < ATTRIBUTE_COUNT; attribute++) {
+				if (attribute != POSITION) {
+					if (reader.Peek() != '/') break;
+					reader.Skip(1);
+					if (reader.Peek() == '/') continue; // No texture coordinate.
+				}
+
+				int32_t index;
+				if (!reader.ReadIndex(index)) return false;
+
+				if (index < 0) {
+					corner.indices[attribute] = static_cast<int32_t>(counts[attribute]) + index;
+					corner.relativeMask |= 1 << attribute;
+				} else {
+					corner.indices[attribute] = index - 1;
+				}
+				corner.presentMask |= 1 << attribute;
+			}
+
+			return true;
+		}
+
+		bool parseChunk(Chunk& chunk) {
+			LineReader reader(chunk.text.data(), chunk.text.data() + chunk.text.size());
+			std::vector<Corner> polygon;
+
+			for (; !reader.AtEnd(); reader.NextLine(), chunk.lineNumber++) {
+				reader.SkipSpaces();
+
+				if (reader.Peek() == 'v') {
+					reader.Skip(1);
+					const char kind = reader.Peek();
+
+					if (kind == ' ' || kind == '\t') {
+						glm::vec3& position = chunk.positions.emplace_back();
+						if (!reader.ReadFloat(position.x) || !reader.ReadFloat(position.y) || !reader.ReadFloat(position.z)) return false;
+					} else if (kind == 't') {
+						reader.Skip(1);
+						glm::vec2& uv = chunk.uvs.emplace_back();
+						if (!reader.ReadFloat(uv.x) || !reader.ReadFloat(uv.y)) return false;
+						uv.y = 1.0f - uv.y;
+					} else if (kind == 'n') {
+						reader.Skip(1);
+						glm::vec3& normal = chunk.normals.emplace_back();
+						if (!reader.ReadFloat(normal.x) || !reader.ReadFloat(normal.y) || !reader.ReadFloat(normal.z)) return false;
+					}
+				} else if (reader.Peek() == 'f') {
+					reader.Skip(1);
+					polygon.clear();
+
+					while (true) {
+						reader.SkipSpaces();
+						if (reader.AtLineEnd()) break;
+						if (!parseCorner(reader, chunk, polygon.emplace_back())) return false;
+					}
+
+					if (polygon.size() < 3) return false;
+
+					for (size_t i = 2; i < polygon.size(); i++) {
+						chunk.corners.push_back(polygon[0]);
+						chunk.corners.push_back(polygon[i - 1]);
+						chunk.corners.push_back(polygon[i]);
+					}
+				}
+				// Groups, objects, materials and smoothing groups do not change the geometry.
+			}
+
+			return true;
+		}
+
+		void splitIntoChunks(const std::string_view text, std::vector<Chunk>& chunks) {
+			size_t begin = 0;
+
+			for (size_t i = 0; i < chunks.size(); i++) {
+				size_t end = i + 1 == chunks.size() ? text.size() : text.size() * (i + 1) / chunks.size();
+				end = std::max(end, begin);
+
+				// Chunks end after a newline, so no line is split between two of them.
+				while (end < text.size() && text[end - 1] != '\n') end++;
+
+				chunks[i].text = text.substr(begin, end - begin);
+				begin = end;
+			}
+		}
+	}
+
+	MeshData parseObj(const std::string_view text, utils::JobSystem& jobSystem, size_t& inputVertexCount) {
+		// Small files are not worth the jobs, every chunk gets at least a megabyte.
+		constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+		const size_t chunkCount = std::clamp<size_t>(text.size() / MIN_CHUNK_SIZE, 1, jobSystem.GetThreadCount());
+
+		std::vector<Chunk> chunks(chunkCount);
+		splitIntoChunks(text, chunks);
+
+		jobSystem.ParallelFor(static_cast<uint32_t>(chunkCount), 1, [&chunks](const uint32_t begin, const uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				chunks[i].parsed = parseChunk(chunks[i]);
+			}
+		});
+
+		// Absolute indices are global, relative ones still need the element counts of the chunks before them.
+		size_t lineOffset = 1;
+		size_t cornerCount = 0;
+		size_t counts[ATTRIBUTE_COUNT] = {};
+		std::vector<std::array<size_t, ATTRIBUTE_COUNT>> chunkOffsets(chunkCount);
+
+		for (size_t i = 0; i < chunkCount; i++) {
+			if (!chunks[i].parsed) {
+				UTIL_THROW("Malformed OBJ data on line " + std::to_string(lineOffset + chunks[i].lineNumber));
+			}
+
+			lineOffset += static_cast<size_t>(std::count(chunks[i].text.begin(), chunks[i].text.end(), '\n'));
+			chunkOffsets[i] = {counts[POSITION], counts[UV], counts[NORMAL]};
+			counts[POSITION] += chunks[i].positions.size();
+			counts[UV] += chunks[i].uvs.size();
+			counts[NORMAL] += chunks[i].normals.size();
+			cornerCount += chunks[i].corners.size();
+		}
+
+		inputVertexCount = cornerCount;
+
+		MeshData mesh;
+		mesh.indices.reserve(cornerCount);
+		Deduplicator<CornerKey, CornerKeyHasher> deduplicator(cornerCount);
+
+		for (size_t i = 0; i < chunkCount; i++) {
+			for (const Corner& corner : chunks[i].corners) {
+				CornerKey key{};
+
+				for (uint32_t attribute = POSITION; attribute < ATTRIBUTE_COUNT; attribute++) {
+					if (!(corner.presentMask & 1 << attribute)) {
+						if (attribute == POSITION) UTIL_THROW("OBJ face corner without a position");
+						key.indices[attribute] = MISSING;
+						continue;
+					}
+
+					int64_t index = corner.indices[attribute];
+					if (corner.relativeMask & 1 << attribute) index += static_cast<int64_t>(chunkOffsets[i][attribute]);
+
+					if (index < 0 || index >= static_cast<int64_t>(counts[attribute])) {
+						UTIL_THROW("OBJ face references element " + std::to_string(index + 1) + " of " + std::to_string(counts[attribute]));
+					}
+					key.indices[attribute] = static_cast<uint32_t>(index);
+				}
+
+				mesh.indices.push_back(deduplicator.Insert(key));
+			}
+		}
+
+		// Flattening the per chunk attribute arrays is cheaper than looking up which chunk each index falls in.
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		positions.reserve(counts[POSITION]);
+		uvs.reserve(counts[UV]);
+		normals.reserve(counts[NORMAL]);
+
+		for (const Chunk& chunk : chunks) {
+			positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+			uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+			normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		}
+
+		const std::vector<CornerKey>& keys = deduplicator.GetKeys();
+		mesh.vertices.resize(keys.size());
+		std::vector<bool> missingNormal(keys.size(), false);
+		bool anyMissingNormal = false;
+
+		for (size_t i = 0; i < keys.size(); i++) {
+			Vertex& vertex = mesh.vertices[i];
+			vertex.position = positions[keys[i].indices[POSITION]];
+			vertex.uv = keys[i].indices[UV] != MISSING ? uvs[keys[i].indices[UV]] : glm::vec2(0.0f);
+			vertex.normal = keys[i].indices[NORMAL] != MISSING ? normals[keys[i].indices[NORMAL]] : glm::vec3(0.0f);
+
+			missingNormal[i] = keys[i].indices[NORMAL] == MISSING;
+			anyMissingNormal |= missingNormal[i];
+		}
+
+		if (anyMissingNormal) generateMissingNormals(mesh, missingNormal);
+
+		return mesh;
+	}
+}
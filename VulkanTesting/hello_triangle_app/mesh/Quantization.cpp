@@ -0,0 +1,248 @@
+﻿#include "Quantization.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MESH_QUANTIZATION_SSE
+#endif
+
+namespace mesh
+{
+	namespace
+	{
+		static_assert(sizeof(Vertex) == 8 * sizeof(float), "The SSE path loads a vertex as two rows of four floats");
+		static_assert(sizeof(QuantizedVertex) == 4 * sizeof(uint32_t), "The SSE path stores a vertex as one row of four words");
+
+		constexpr uint32_t FLOAT_INFINITY_BITS = 0x7F800000;
+		constexpr uint32_t HALF_OVERFLOW_BITS = (127 + 16) << 23; // Smallest float that rounds to half infinity.
+		constexpr uint32_t HALF_NORMAL_BITS = 113 << 23; // Smallest float that is a normal half.
+		constexpr uint32_t DENORMAL_MAGIC_BITS = ((127 - 15) + (23 - 10) + 1) << 23;
+		constexpr uint32_t REBIAS = (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF; // Exponent bias change plus rounding.
+		constexpr uint16_t HALF_ONE = 0x3C00;
+
+		constexpr float SNORM16_MAX = 32767.0f;
+		constexpr float UNORM16_MAX = 65535.0f;
+
+		int32_t roundToInt(const float value) {
+			return static_cast<int32_t>(std::nearbyint(value));
+		}
+
+		float signNotZero(const float value) {
+			return value >= 0.0f ? 1.0f : -1.0f;
+		}
+
+		QuantizedVertex quantizeVertex(const Vertex& vertex, bool& clamped) {
+			QuantizedVertex quantized;
+			quantized.position.values[0] = floatToHalf(vertex.position.x);
+			quantized.position.values[1] = floatToHalf(vertex.position.y);
+			quantized.position.values[2] = floatToHalf(vertex.position.z);
+			quantized.position.values[3] = HALF_ONE;
+			quantized.normal = encodeOctahedral(vertex.normal);
+
+			const glm::vec2 uv = glm::clamp(vertex.uv, 0.0f, 1.0f);
+			clamped = uv.x != vertex.uv.x || uv.y != vertex.uv.y;
+			quantized.uv.values[0] = static_cast<uint16_t>(roundToInt(uv.x * UNORM16_MAX));
+			quantized.uv.values[1] = static_cast<uint16_t>(roundToInt(uv.y * UNORM16_MAX));
+			return quantized;
+		}
+
+#ifdef MESH_QUANTIZATION_SSE
+		__m128i select(const __m128i mask, const __m128i whenSet, const __m128i whenClear) {
+			return _mm_or_si128(_mm_and_si128(mask, whenSet), _mm_andnot_si128(mask, whenClear));
+		}
+
+		__m128 select(const __m128 mask, const __m128 whenSet, const __m128 whenClear) {
+			return _mm_or_ps(_mm_and_ps(mask, whenSet), _mm_andnot_ps(mask, whenClear));
+		}
+
+		__m128 absolute(const __m128 value) {
+			return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+		}
+
+		// floatToHalf() on four lanes, results in the low 16 bits.
+		__m128i floatToHalf4(const __m128 value) {
+			__m128i bits = _mm_castps_si128(value);
+			const __m128i sign = _mm_and_si128(bits, _mm_set1_epi32(static_cast<int32_t>(0x80000000u)));
+			bits = _mm_xor_si128(bits, sign);
+
+			// Without the sign every bit pattern is a non negative int, so signed compares order them like the floats.
+			const __m128i overflow = _mm_cmpgt_epi32(bits, _mm_set1_epi32(HALF_OVERFLOW_BITS - 1));
+			const __m128i isNan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(FLOAT_INFINITY_BITS));
+			const __m128i infinityOrNan = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNan, _mm_set1_epi32(0x0200)));
+
+			const __m128i isDenormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(HALF_NORMAL_BITS));
+			const __m128 denormalMagic = _mm_castsi128_ps(_mm_set1_epi32(DENORMAL_MAGIC_BITS));
+			const __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), denormalMagic)),
+			                                       _mm_set1_epi32(DENORMAL_MAGIC_BITS));
+
+			const __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+			__m128i normal = _mm_add_epi32(bits, _mm_set1_epi32(static_cast<int32_t>(REBIAS)));
+			normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+			__m128i half = select(isDenormal, denormal, normal);
+			half = select(overflow, infinityOrNan, half);
+			return _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+		}
+
+		// Four vertices per iteration: transposed into one register per component, converted, packed back per vertex.
+		// count has to be a multiple of four.
+		size_t quantizeVerticesSse(const Vertex* vertices, const size_t count, QuantizedVertex* quantized) {
+			size_t clampedCount = 0;
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128i lowHalf = _mm_set1_epi32(0xFFFF);
+
+			for (size_t i = 0; i < count; i += 4) {
+				const float* source = &vertices[i].position.x;
+				__m128 px = _mm_loadu_ps(source);
+				__m128 py = _mm_loadu_ps(source + 8);
+				__m128 pz = _mm_loadu_ps(source + 16);
+				__m128 nx = _mm_loadu_ps(source + 24);
+				_MM_TRANSPOSE4_PS(px, py, pz, nx);
+
+				__m128 ny = _mm_loadu_ps(source + 4);
+				__m128 nz = _mm_loadu_ps(source + 12);
+				__m128 u = _mm_loadu_ps(source + 20);
+				__m128 v = _mm_loadu_ps(source + 28);
+				_MM_TRANSPOSE4_PS(ny, nz, u, v);
+
+				// Octahedral normal, see encodeOctahedral().
+				const __m128 l1 = _mm_max_ps(_mm_add_ps(_mm_add_ps(absolute(nx), absolute(ny)), absolute(nz)), _mm_set1_ps(FLT_MIN));
+				__m128 ox = _mm_div_ps(nx, l1);
+				__m128 oy = _mm_div_ps(ny, l1);
+
+				const __m128 lowerHalf = _mm_cmplt_ps(nz, zero);
+				const __m128 foldedX = _mm_sub_ps(one, absolute(oy));
+				const __m128 foldedY = _mm_sub_ps(one, absolute(ox));
+				const __m128 signBit = _mm_set1_ps(-0.0f);
+				const __m128 foldX = select(_mm_cmpge_ps(ox, zero), foldedX, _mm_xor_ps(foldedX, signBit));
+				const __m128 foldY = select(_mm_cmpge_ps(oy, zero), foldedY, _mm_xor_ps(foldedY, signBit));
+				ox = select(lowerHalf, foldX, ox);
+				oy = select(lowerHalf, foldY, oy);
+
+				const __m128 snormScale = _mm_set1_ps(SNORM16_MAX);
+				const __m128i octX = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(ox, _mm_set1_ps(-1.0f)), one), snormScale));
+				const __m128i octY = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(oy, _mm_set1_ps(-1.0f)), one), snormScale));
+
+				const __m128 clampedU = _mm_min_ps(_mm_max_ps(u, zero), one);
+				const __m128 clampedV = _mm_min_ps(_mm_max_ps(v, zero), one);
+				const __m128 wasClamped = _mm_or_ps(_mm_cmpneq_ps(clampedU, u), _mm_cmpneq_ps(clampedV, v));
+
+				const __m128 unormScale = _mm_set1_ps(UNORM16_MAX);
+				const __m128i unormU = _mm_cvtps_epi32(_mm_mul_ps(clampedU, unormScale));
+				const __m128i unormV = _mm_cvtps_epi32(_mm_mul_ps(clampedV, unormScale));
+
+				// Two 16 bit values per word, in the member order of QuantizedVertex.
+				__m128 word0 = _mm_castsi128_ps(_mm_or_si128(floatToHalf4(px), _mm_slli_epi32(floatToHalf4(py), 16)));
+				__m128 word1 = _mm_castsi128_ps(_mm_or_si128(floatToHalf4(pz), _mm_set1_epi32(HALF_ONE << 16)));
+				__m128 word2 = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(octX, lowHalf), _mm_slli_epi32(octY, 16)));
+				__m128 word3 = _mm_castsi128_ps(_mm_or_si128(unormU, _mm_slli_epi32(unormV, 16)));
+				_MM_TRANSPOSE4_PS(word0, word1, word2, word3);
+
+				float* destination = reinterpret_cast<float*>(&quantized[i]);
+				_mm_storeu_ps(destination, word0);
+				_mm_storeu_ps(destination + 4, word1);
+				_mm_storeu_ps(destination + 8, word2);
+				_mm_storeu_ps(destination + 12, word3);
+
+				clampedCount += std::popcount(static_cast<uint32_t>(_mm_movemask_ps(wasClamped)));
+			}
+
+			return clampedCount;
+		}
+#endif
+	}
+
+	size_t quantizeVertices(const std::vector<Vertex>& vertices, std::vector<QuantizedVertex>& quantized, const bool useSimd) {
+		quantized.resize(vertices.size());
+		size_t clampedCount = 0;
+		size_t first = 0;
+
+#ifdef MESH_QUANTIZATION_SSE
+		// The last group of four would read past the end of the array, it goes through the scalar path.
+		if (useSimd) {
+			first = vertices.size() & ~static_cast<size_t>(3);
+			clampedCount += quantizeVerticesSse(vertices.data(), first, quantized.data());
+		}
+#endif
+
+		for (size_t i = first; i < vertices.size(); i++) {
+			bool clamped;
+			quantized[i] = quantizeVertex(vertices[i], clamped);
+			clampedCount += clamped;
+		}
+
+		return clampedCount;
+	}
+
+	// Round to nearest even, after Fabian Giesen's float_to_half_fast3_rtne. Overflow becomes infinity, NaN a quiet NaN.
+	uint16_t floatToHalf(const float value) {
+		uint32_t bits = std::bit_cast<uint32_t>(value);
+		const uint32_t sign = bits & 0x80000000u;
+		bits ^= sign;
+
+		uint32_t half;
+		if (bits >= HALF_OVERFLOW_BITS) {
+			half = bits > FLOAT_INFINITY_BITS ? 0x7E00 : 0x7C00;
+		} else if (bits < HALF_NORMAL_BITS) {
+			// Adding the magic number shifts the mantissa into place, with the FPU doing the rounding.
+			const float shifted = std::bit_cast<float>(bits) + std::bit_cast<float>(DENORMAL_MAGIC_BITS);
+			half = std::bit_cast<uint32_t>(shifted) - DENORMAL_MAGIC_BITS;
+		} else {
+			const uint32_t mantissaOdd = bits >> 13 & 1;
+			half = (bits + REBIAS + mantissaOdd) >> 13;
+		}
+
+		return static_cast<uint16_t>(half | sign >> 16);
+	}
+
+	float halfToFloat(const uint16_t half) {
+		const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+		const uint32_t exponent = half >> 10 & 0x1F;
+		const uint32_t mantissa = half & 0x3FF;
+
+		if (exponent == 0) {
+			return std::bit_cast<float>(sign) + (sign ? -1.0f : 1.0f) * std::ldexp(static_cast<float>(mantissa), -24);
+		}
+		if (exponent == 0x1F) {
+			return std::bit_cast<float>(sign | FLOAT_INFINITY_BITS | mantissa << 13);
+		}
+
+		return std::bit_cast<float>(sign | (exponent + 127 - 15) << 23 | mantissa << 13);
+	}
+
+	Snorm16x2 encodeOctahedral(const glm::vec3& normal) {
+		const float l1 = std::max(std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z), FLT_MIN);
+		float x = normal.x / l1;
+		float y = normal.y / l1;
+
+		if (normal.z < 0.0f) {
+			const float foldedX = (1.0f - std::fabs(y)) * signNotZero(x);
+			const float foldedY = (1.0f - std::fabs(x)) * signNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		Snorm16x2 encoded;
+		encoded.values[0] = static_cast<int16_t>(roundToInt(std::clamp(x, -1.0f, 1.0f) * SNORM16_MAX));
+		encoded.values[1] = static_cast<int16_t>(roundToInt(std::clamp(y, -1.0f, 1.0f) * SNORM16_MAX));
+		return encoded;
+	}
+
+	glm::vec3 decodeOctahedral(const Snorm16x2& encoded) {
+		// Same as decodeOctahedral() in shader.vert.
+		const float x = std::max(static_cast<float>(encoded.values[0]) / SNORM16_MAX, -1.0f);
+		const float y = std::max(static_cast<float>(encoded.values[1]) / SNORM16_MAX, -1.0f);
+
+		glm::vec3 normal(x, y, 1.0f - std::fabs(x) - std::fabs(y));
+		const float t = std::max(-normal.z, 0.0f);
+		normal.x += normal.x >= 0.0f ? -t : t;
+		normal.y += normal.y >= 0.0f ? -t : t;
+		return glm::normalize(normal);
+	}
+}
@@ -0,0 +1,22 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+
+namespace mesh
+{
+	// Converts to the upload format, four vertices at a time with SSE where available. Both paths round to nearest even
+	// and give bit identical results. Returns how many vertices had texture coordinates outside [0, 1] clamped.
+	size_t quantizeVertices(const std::vector<Vertex>& vertices, std::vector<QuantizedVertex>& quantized, bool useSimd = true);
+
+	uint16_t floatToHalf(float value);
+	float halfToFloat(uint16_t half);
+
+	// Folds the unit sphere onto the [-1, 1] square: the upper half as the inner diamond, the lower half into the corners.
+	Snorm16x2 encodeOctahedral(const glm::vec3& normal);
+	glm::vec3 decodeOctahedral(const Snorm16x2& encoded);
+}
@@ -0,0 +1,280 @@
+﻿#include "Simplifier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "Deduplicator.hpp"
+
+namespace mesh
+{
+	namespace
+	{
+		// Sum of squared distances to a set of planes, as the symmetric matrix of (a, b, c, d) outer products.
+		struct Quadric {
+			double a2, ab, ac, ad;
+			double b2, bc, bd;
+			double c2, cd;
+			double d2;
+
+			void AddPlane(const double a, const double b, const double c, const double d) {
+				a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+				b2 += b * b; bc += b * c; bd += b * d;
+				c2 += c * c; cd += c * d;
+				d2 += d * d;
+			}
+
+			void Add(const Quadric& other) {
+				a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+				b2 += other.b2; bc += other.bc; bd += other.bd;
+				c2 += other.c2; cd += other.cd;
+				d2 += other.d2;
+			}
+
+			double Evaluate(const glm::vec3& point) const {
+				const double x = point.x;
+				const double y = point.y;
+				const double z = point.z;
+				const double error = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x +
+					b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y +
+					c2 * z * z + 2.0 * cd * z +
+					d2;
+				return std::max(error, 0.0);
+			}
+		};
+
+		struct Collapse {
+			uint32_t from;
+			uint32_t to;
+			double cost;
+		};
+
+		// Bit patterns, so equal positions hash alike. Adding zero turns -0 into 0 first.
+		using PositionKey = std::array<uint32_t, 3>;
+
+		PositionKey positionKey(const glm::vec3& position) {
+			const float components[3] = {position.x + 0.0f, position.y + 0.0f, position.z + 0.0f};
+			PositionKey key;
+			std::memcpy(key.data(), components, sizeof(components));
+			return key;
+		}
+
+		struct PositionHasher {
+			size_t operator()(const PositionKey& key) const {
+				return static_cast<size_t>(mixHash((static_cast<uint64_t>(key[0]) << 32 | key[1]) ^ mixHash(key[2])));
+			}
+		};
+
+		struct EdgeHasher {
+			size_t operator()(const uint64_t edge) const {
+				return static_cast<size_t>(mixHash(edge));
+			}
+		};
+
+		uint64_t edgeKey(const uint32_t a, const uint32_t b) {
+			return a < b ? static_cast<uint64_t>(a) << 32 | b : static_cast<uint64_t>(b) << 32 | a;
+		}
+
+		// Seam vertices share their position with another vertex, border vertices have an edge only one triangle uses.
+		std::vector<bool> findLockedVertices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+			std::vector<bool> locked(vertices.size(), false);
+
+			Deduplicator<PositionKey, PositionHasher> positions(vertices.size());
+			std::vector<uint32_t> positionOwner;
+			positionOwner.reserve(vertices.size());
+			for (uint32_t vertex = 0; vertex < vertices.size(); vertex++) {
+				const uint32_t position = positions.Insert(positionKey(vertices[vertex].position));
+				if (position == positionOwner.size()) {
+					positionOwner.push_back(vertex);
+				} else {
+					locked[vertex] = true;
+					locked[positionOwner[position]] = true;
+				}
+			}
+
+			Deduplicator<uint64_t, EdgeHasher> edges(indices.size());
+			std::vector<uint32_t> edgeUses;
+			edgeUses.reserve(indices.size());
+			for (size_t corner = 0; corner < indices.size(); corner++) {
+				const size_t next = corner % 3 == 2 ? corner - 2 : corner + 1;
+				const uint32_t edge = edges.Insert(edgeKey(indices[corner], indices[next]));
+				if (edge == edgeUses.size()) edgeUses.push_back(0);
+				edgeUses[edge]++;
+			}
+
+			const std::vector<uint64_t>& edgeKeys = edges.GetKeys();
+			for (size_t edge = 0; edge < edgeKeys.size(); edge++) {
+				if (edgeUses[edge] != 1) continue;
+				locked[static_cast<uint32_t>(edgeKeys[edge] >> 32)] = true;
+				locked[static_cast<uint32_t>(edgeKeys[edge])] = true;
+			}
+
+			return locked;
+		}
+
+		std::vector<Quadric> computeQuadrics(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+			std::vector<Quadric> quadrics(vertices.size(), Quadric{});
+
+			for (size_t corner = 0; corner < indices.size(); corner += 3) {
+				const glm::vec3 a = vertices[indices[corner + 0]].position;
+				const glm::vec3 b = vertices[indices[corner + 1]].position;
+				const glm::vec3 c = vertices[indices[corner + 2]].position;
+
+				const glm::vec3 normal = glm::cross(b - a, c - a);
+				const float length = glm::length(normal);
+				if (length == 0.0f) continue;
+
+				// Unweighted unit planes, so the error stays a squared distance whatever the triangle size.
+				const glm::vec3 unitNormal = normal / length;
+				const float distance = -glm::dot(unitNormal, a);
+				for (uint32_t i = 0; i < 3; i++) {
+					quadrics[indices[corner + i]].AddPlane(unitNormal.x, unitNormal.y, unitNormal.z, distance);
+				}
+			}
+
+			return quadrics;
+		}
+
+		// Triangles around each vertex as offsets into indices, in compressed row storage.
+		void buildAdjacency(const std::vector<uint32_t>& indices, const size_t vertexCount,
+		                    std::vector<uint32_t>& offsets, std::vector<uint32_t>& triangles) {
+			offsets.assign(vertexCount + 1, 0);
+			for (const uint32_t index : indices) {
+				offsets[index + 1]++;
+			}
+			for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+				offsets[vertex + 1] += offsets[vertex];
+			}
+
+			triangles.resize(indices.size());
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t corner = 0; corner < indices.size(); corner++) {
+				triangles[fill[indices[corner]]++] = static_cast<uint32_t>(corner / 3 * 3);
+			}
+		}
+
+		// Moving from onto to must not turn any remaining triangle around from over to its back.
+		bool flipsTriangle(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		                   const uint32_t* triangles, const uint32_t triangleCount, const uint32_t from, const uint32_t to) {
+			for (uint32_t i = 0; i < triangleCount; i++) {
+				const uint32_t* triangle = &indices[triangles[i]];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to) continue; // Removed by the collapse.
+
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (uint32_t corner = 0; corner < 3; corner++) {
+					before[corner] = vertices[triangle[corner]].position;
+					after[corner] = vertices[triangle[corner] == from ? to : triangle[corner]].position;
+				}
+
+				const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(normalBefore, normalAfter) <= 0.0f) return true;
+			}
+
+			return false;
+		}
+	}
+
+	std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	                               const size_t targetIndexCount, float& error) {
+		std::vector<uint32_t> result = indices;
+		error = 0.0f;
+
+		const std::vector<bool> locked = findLockedVertices(vertices, indices);
+		std::vector<Quadric> quadrics = computeQuadrics(vertices, indices);
+
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> remap(vertices.size());
+		std::vector<bool> touched(vertices.size());
+		double maxCost = 0.0;
+
+		// Each pass collapses a batch of independent edges and compacts the triangle list, so the adjacency is only
+		// rebuilt once per pass instead of being patched after every collapse.
+		while (result.size() > targetIndexCount) {
+			buildAdjacency(result, vertices.size(), offsets, triangles);
+
+			// Cheapest collapse per vertex, the vertex itself is the one that disappears.
+			collapses.clear();
+			std::vector<size_t> bestCollapse(vertices.size(), SIZE_MAX);
+			for (size_t corner = 0; corner < result.size(); corner++) {
+				const uint32_t from = result[corner];
+				const uint32_t to = result[corner % 3 == 2 ? corner - 2 : corner + 1];
+
+				for (const auto& [source, target] : {std::pair{from, to}, std::pair{to, from}}) {
+					if (locked[source]) continue;
+
+					Quadric combined = quadrics[source];
+					combined.Add(quadrics[target]);
+					const double cost = combined.Evaluate(vertices[target].position);
+
+					size_t& best = bestCollapse[source];
+					if (best == SIZE_MAX) {
+						best = collapses.size();
+						collapses.push_back({source, target, cost});
+					} else if (cost < collapses[best].cost) {
+						collapses[best] = {source, target, cost};
+					}
+				}
+			}
+
+			if (collapses.empty()) break;
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& left, const Collapse& right) {
+				return left.cost < right.cost;
+			});
+
+			for (uint32_t vertex = 0; vertex < remap.size(); vertex++) {
+				remap[vertex] = vertex;
+			}
+			std::fill(touched.begin(), touched.end(), false);
+
+			// Each collapse removes the two triangles along its edge, a closed surface loses about two per collapse.
+			const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+			size_t removedTriangles = 0;
+			for (const Collapse& collapse : collapses) {
+				if (removedTriangles >= trianglesToRemove) break;
+				if (touched[collapse.from] || touched[collapse.to]) continue;
+
+				const uint32_t* fromTriangles = &triangles[offsets[collapse.from]];
+				const uint32_t fromTriangleCount = offsets[collapse.from + 1] - offsets[collapse.from];
+				if (flipsTriangle(vertices, result, fromTriangles, fromTriangleCount, collapse.from, collapse.to)) continue;
+
+				// Freezing the whole ring keeps the flip test above valid, no neighbour moves in this pass.
+				for (uint32_t i = 0; i < fromTriangleCount; i++) {
+					const uint32_t* triangle = &result[fromTriangles[i]];
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+						removedTriangles++;
+					}
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].Add(quadrics[collapse.from]);
+				maxCost = std::max(maxCost, collapse.cost);
+			}
+
+			const size_t sizeBefore = result.size();
+			size_t kept = 0;
+			for (size_t corner = 0; corner < result.size(); corner += 3) {
+				const uint32_t a = remap[result[corner + 0]];
+				const uint32_t b = remap[result[corner + 1]];
+				const uint32_t c = remap[result[corner + 2]];
+				if (a == b || b == c || c == a) continue;
+
+				result[kept + 0] = a;
+				result[kept + 1] = b;
+				result[kept + 2] = c;
+				kept += 3;
+			}
+			result.resize(kept);
+
+			if (result.size() == sizeBefore) break;
+		}
+
+		error = static_cast<float>(std::sqrt(maxCost));
+		return result;
+	}
+}
@@ -0,0 +1,16 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.hpp"
+
+namespace mesh
+{
+	// Removes triangles by collapsing edges onto one of their vertices, ordered by quadric error, until at most
+	// targetIndexCount indices remain or no collapse is left. The vertex buffer is reused, only indices change.
+	// Vertices on open borders or attribute seams never move so the silhouette and UV charts keep their shape.
+	// error receives how far, at most, the surface moved in mesh units.
+	std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	                               size_t targetIndexCount, float& error);
+}
@@ -0,0 +1,186 @@
+﻿#include "VertexCache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace mesh
+{
+	namespace
+	{
+		constexpr uint32_t CACHE_SIZE = 32;
+		constexpr uint32_t MAX_VALENCE = 32; // Vertices with more triangles score like this many.
+
+		constexpr float CACHE_DECAY_POWER = 1.5f;
+		constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+		constexpr float VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+		struct ScoreTables {
+			std::array<float, CACHE_SIZE + 1> cache{}; // Indexed by cache position + 1, 0 is not cached.
+			std::array<float, MAX_VALENCE + 1> valence{};
+
+			ScoreTables() {
+				for (uint32_t position = 0; position < CACHE_SIZE; position++) {
+					// The three vertices of the last triangle get a fixed score, so the next one does not just reuse them.
+					if (position < 3) {
+						cache[position + 1] = LAST_TRIANGLE_SCORE;
+					} else {
+						const float scaler = 1.0f / static_cast<float>(CACHE_SIZE - 3);
+						cache[position + 1] = std::pow(1.0f - static_cast<float>(position - 3) * scaler, CACHE_DECAY_POWER);
+					}
+				}
+
+				// Vertices with few triangles left are worth finishing, so they do not have to be loaded again later.
+				for (uint32_t remaining = 1; remaining <= MAX_VALENCE; remaining++) {
+					valence[remaining] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+				}
+			}
+		};
+
+		const ScoreTables SCORES;
+
+		float vertexScore(const int32_t cachePosition, const uint32_t remainingTriangles) {
+			if (remainingTriangles == 0) return -1.0f; // Nothing left to draw with it.
+			return SCORES.cache[cachePosition + 1] + SCORES.valence[std::min(remainingTriangles, MAX_VALENCE)];
+		}
+	}
+
+	void optimizeVertexCache(std::vector<uint32_t>& indices, const size_t vertexCount) {
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) return;
+
+		// Triangles per vertex as one flat array, the live ones of each vertex are kept at the front of its range.
+		std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+		for (const uint32_t index : indices) {
+			remainingTriangles[index]++;
+		}
+
+		std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+			triangleOffsets[vertex + 1] = triangleOffsets[vertex] + remainingTriangles[vertex];
+		}
+
+		std::vector<uint32_t> vertexTriangles(indices.size());
+		{
+			std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++) {
+				vertexTriangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<int32_t> cachePositions(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+			vertexScores[vertex] = vertexScore(-1, remainingTriangles[vertex]);
+		}
+
+		std::vector<float> triangleScores(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+			triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] +
+			                           vertexScores[indices[triangle * 3 + 2]];
+		}
+
+		// Three slots past the end catch the vertices a new triangle pushes out.
+		std::array<uint32_t, CACHE_SIZE + 3> cache{};
+		std::array<uint32_t, CACHE_SIZE + 3> newCache{};
+		uint32_t cacheCount = 0;
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+
+		size_t inputCursor = 0; // Where to continue looking when nothing in the cache has triangles left.
+		size_t bestTriangle = 0;
+
+		while (result.size() < indices.size()) {
+			const uint32_t* corners = &indices[bestTriangle * 3];
+			result.insert(result.end(), corners, corners + 3);
+			emitted[bestTriangle] = true;
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				const uint32_t vertex = corners[corner];
+				uint32_t* begin = &vertexTriangles[triangleOffsets[vertex]];
+				uint32_t* end = begin + remainingTriangles[vertex];
+				*std::find(begin, end, static_cast<uint32_t>(bestTriangle)) = *(end - 1);
+				remainingTriangles[vertex]--;
+			}
+
+			// The emitted triangle moves to the front, the rest keeps its order.
+			uint32_t newCacheCount = 0;
+			for (uint32_t corner = 0; corner < 3; corner++) {
+				newCache[newCacheCount++] = corners[corner];
+			}
+			for (uint32_t i = 0; i < cacheCount; i++) {
+				const uint32_t vertex = cache[i];
+				if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+					newCache[newCacheCount++] = vertex;
+				}
+			}
+
+			float bestScore = -1.0f;
+			for (uint32_t i = 0; i < newCacheCount; i++) {
+				const uint32_t vertex = newCache[i];
+				cachePositions[vertex] = i < CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+				const float score = vertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+				const float scoreDelta = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+
+				const uint32_t* begin = &vertexTriangles[triangleOffsets[vertex]];
+				for (const uint32_t* triangle = begin; triangle != begin + remainingTriangles[vertex]; triangle++) {
+					triangleScores[*triangle] += scoreDelta;
+
+					if (i < CACHE_SIZE && triangleScores[*triangle] > bestScore) {
+						bestScore = triangleScores[*triangle];
+						bestTriangle = *triangle;
+					}
+				}
+			}
+
+			cache = newCache;
+			cacheCount = std::min(newCacheCount, CACHE_SIZE);
+
+			if (bestScore < 0.0f) {
+				while (inputCursor < triangleCount && emitted[inputCursor]) inputCursor++;
+				bestTriangle = inputCursor;
+			}
+		}
+
+		indices = std::move(result);
+	}
+
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+		std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+		std::vector<Vertex> reordered;
+		reordered.reserve(vertices.size());
+
+		for (uint32_t& index : indices) {
+			if (remap[index] == UINT32_MAX) {
+				remap[index] = static_cast<uint32_t>(reordered.size());
+				reordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		// Vertices no triangle uses are dropped.
+		vertices = std::move(reordered);
+	}
+
+	float computeAcmr(const std::vector<uint32_t>& indices, const size_t vertexCount, const uint32_t cacheSize) {
+		if (indices.empty()) return 0.0f;
+
+		// Time each vertex entered the cache, it is still in a FIFO of this size when fewer misses happened since.
+		std::vector<size_t> enteredAt(vertexCount, 0);
+		size_t misses = 0;
+
+		for (const uint32_t index : indices) {
+			if (enteredAt[index] == 0 || misses - enteredAt[index] >= cacheSize) {
+				misses++;
+				enteredAt[index] = misses;
+			}
+		}
+
+		return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	}
+}
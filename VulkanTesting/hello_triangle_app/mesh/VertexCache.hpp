@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.hpp"
+
+namespace mesh
+{
+	// Reorders triangles so consecutive ones share vertices still in the post transform cache (Forsyth's linear speed
+	// optimizer). The vertex order is left alone, run optimizeVertexFetch() afterwards.
+	void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	// Renumbers vertices in the order the index buffer first uses them, so vertex fetches walk memory forwards.
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Vertex shader invocations per triangle with a FIFO cache of the given size, 0.5 is the best a grid can get.
+	float computeAcmr(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+}
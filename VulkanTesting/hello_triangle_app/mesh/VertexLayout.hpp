@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+// Vertex input state generated from the member types of a vertex struct. A vertex type lists its members once with
+// VERTEX_FIELD in a VertexFields specialization; locations follow that order and the formats follow the member types.
+namespace mesh
+{
+	// Packed attribute types, only ever touched by the quantizer and the vertex fetch hardware.
+	struct Half4 {
+		uint16_t values[4];
+	};
+
+	struct Snorm16x2 {
+		int16_t values[2];
+	};
+
+	struct Unorm16x2 {
+		uint16_t values[2];
+	};
+
+	template<typename T>
+	struct AttributeFormat;
+
+	template<>
+	struct AttributeFormat<glm::vec2> {
+		static constexpr VkFormat FORMAT = VK_FORMAT_R32G32_SFLOAT;
+	};
+
+	template<>
+	struct AttributeFormat<glm::vec3> {
+		static constexpr VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+	};
+
+	template<>
+	struct AttributeFormat<glm::vec4> {
+		static constexpr VkFormat FORMAT = VK_FORMAT_R32G32B32A32_SFLOAT;
+	};
+
+	// Three component 16 bit formats are rarely supported for vertex input, positions carry a fourth one.
+	template<>
+	struct AttributeFormat<Half4> {
+		static constexpr VkFormat FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+	};
+
+	template<>
+	struct AttributeFormat<Snorm16x2> {
+		static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_SNORM;
+	};
+
+	template<>
+	struct AttributeFormat<Unorm16x2> {
+		static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_UNORM;
+	};
+
+	struct VertexField {
+		VkFormat format;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	template<typename T>
+	constexpr VertexField makeVertexField(const size_t offset) {
+		return {AttributeFormat<T>::FORMAT, static_cast<uint32_t>(offset), static_cast<uint32_t>(sizeof(T))};
+	}
+
+	// Specialized next to each vertex type with a static constexpr std::array FIELDS of VERTEX_FIELD entries.
+	template<typename Vertex>
+	struct VertexFields;
+
+	template<typename Vertex>
+	constexpr bool fieldsAreValid() {
+		const auto& fields = VertexFields<Vertex>::FIELDS;
+
+		for (size_t i = 0; i < fields.size(); i++) {
+			if (fields[i].offset % 4 != 0) return false; // Vulkan wants attribute offsets 4 byte aligned.
+			if (fields[i].offset + fields[i].size > sizeof(Vertex)) return false;
+
+			for (size_t j = i + 1; j < fields.size(); j++) {
+				const bool overlap = fields[i].offset < fields[j].offset + fields[j].size &&
+				                     fields[j].offset < fields[i].offset + fields[i].size;
+				if (overlap) return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Per instance data like transforms goes through the same path with VK_VERTEX_INPUT_RATE_INSTANCE.
+	template<typename Vertex>
+	constexpr VkVertexInputBindingDescription makeBindingDescription(const uint32_t binding = 0,
+	                                                                 const VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX) {
+		return {binding, static_cast<uint32_t>(sizeof(Vertex)), inputRate};
+	}
+
+	// Locations count up from firstLocation, so several bindings can share one vertex input state.
+	template<typename Vertex>
+	constexpr auto makeAttributeDescriptions(const uint32_t binding = 0, const uint32_t firstLocation = 0) {
+		static_assert(fieldsAreValid<Vertex>(), "Vertex fields have to be 4 byte aligned, inside the vertex and not overlap");
+
+		constexpr auto& fields = VertexFields<Vertex>::FIELDS;
+		std::array<VkVertexInputAttributeDescription, VertexFields<Vertex>::FIELDS.size()> attributeDescriptions{};
+
+		for (size_t i = 0; i < fields.size(); i++) {
+			attributeDescriptions[i].location = firstLocation + static_cast<uint32_t>(i);
+			attributeDescriptions[i].binding = binding;
+			attributeDescriptions[i].format = fields[i].format;
+			attributeDescriptions[i].offset = fields[i].offset;
+		}
+
+		return attributeDescriptions;
+	}
+}
+
+#define VERTEX_FIELD(Vertex, member) ::mesh::makeVertexField<decltype(Vertex::member)>(offsetof(Vertex, member))
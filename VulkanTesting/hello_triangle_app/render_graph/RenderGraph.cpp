@@ -0,0 +1,806 @@
+﻿#include "RenderGraph.hpp"
+
+#include <algorithm>
+
+#include "../gpu/Memory.hpp"
+#include "../../utils/log.hpp"
+
+RenderGraph::RenderGraph(const VkPhysicalDevice physicalDevice, const VkDevice device, const PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2,
+                         const VkAllocationCallbacks* allocator)
+	: physicalDevice(physicalDevice), device(device), cmdPipelineBarrier2(cmdPipelineBarrier2), allocator(allocator) {}
+
+RenderGraph::~RenderGraph() {
+	destroyTransients();
+}
+
+RenderGraph::ResourceId RenderGraph::ImportImage(const std::string& name, const ImageDesc& desc,
+                                                 const VkImageLayout initialLayout, const VkPipelineStageFlags2KHR initialStages,
+                                                 const std::optional<Access> finalAccess) {
+	Resource resource;
+	resource.name = name;
+	resource.imageDesc = desc;
+
+	ResourceState initialState;
+	initialState.writeStages = initialStages;
+	initialState.layout = initialLayout;
+	resource.importedState = initialState;
+	resource.finalAccess = finalAccess;
+
+	resources.emplace_back(std::move(resource));
+	compiled = false;
+	return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::ImportBuffer(const std::string& name, const BufferDesc& desc) {
+	Resource resource;
+	resource.name = name;
+	resource.isImage = false;
+	resource.isConcurrent = desc.isConcurrent;
+	resource.bufferSize = desc.size;
+
+	// Every frame starts on a buffer nothing in flight touches anymore.
+	if (desc.isPerFrame) {
+		resource.importedState = ResourceState{};
+	}
+
+	resources.emplace_back(std::move(resource));
+	compiled = false;
+	return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::CreateImage(const std::string& name, const ImageDesc& desc) {
+	Resource resource;
+	resource.name = name;
+	resource.isTransient = true;
+	resource.imageDesc = desc;
+
+	resources.emplace_back(std::move(resource));
+	compiled = false;
+	return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::PassId RenderGraph::AddPass(const std::string& name, ExecuteCallback execute, const bool hasSideEffects,
+                                         const Queue queue) {
+	passes.push_back({name, {}, std::move(execute), hasSideEffects, queue});
+	compiled = false;
+	return static_cast<PassId>(passes.size() - 1);
+}
+
+void RenderGraph::Read(const PassId pass, const ResourceId resource, const Access access) {
+	addUse(pass, resource, access, false);
+}
+
+void RenderGraph::Write(const PassId pass, const ResourceId resource, const Access access) {
+	addUse(pass, resource, access, true);
+}
+
+void RenderGraph::SetImage(const ResourceId resource, const VkImage image, const VkImageView imageView) {
+	resources[resource].image = image;
+	resources[resource].imageView = imageView;
+}
+
+void RenderGraph::SetBuffer(const ResourceId resource, const VkBuffer buffer) {
+	resources[resource].buffer = buffer;
+}
+
+VkImage RenderGraph::GetImage(const ResourceId resource) const {
+	return resources[resource].image;
+}
+
+VkImageView RenderGraph::GetImageView(const ResourceId resource) const {
+	return resources[resource].imageView;
+}
+
+VkBuffer RenderGraph::GetBuffer(const ResourceId resource) const {
+	return resources[resource].buffer;
+}
+
+void RenderGraph::SetQueueFamilies(const uint32_t graphicsFamily, const uint32_t asyncComputeFamily) {
+	queueFamilies[static_cast<size_t>(Queue::Graphics)] = graphicsFamily;
+	queueFamilies[static_cast<size_t>(Queue::AsyncCompute)] = asyncComputeFamily;
+	compiled = false;
+}
+
+void RenderGraph::Compile() {
+	destroyTransients();
+	stats = {};
+	stats.declaredPassCount = static_cast<uint32_t>(passes.size());
+
+	cullPasses();
+
+	for (const PassId pass : executionOrder) {
+		stats.asyncComputePassCount += passes[pass].queue == Queue::AsyncCompute ? 1 : 0;
+	}
+
+	if (stats.asyncComputePassCount > 0 &&
+	    std::find(queueFamilies.begin(), queueFamilies.end(), VK_QUEUE_FAMILY_IGNORED) != queueFamilies.end()) {
+		UTIL_THROW("Render graph has async compute passes, but no queue families were set!");
+	}
+
+	computeLifetimes();
+	allocateTransients();
+
+	// Dry run from empty states to learn what a frame leaves behind for the next one.
+	std::vector<ResourceState> states(resources.size());
+	for (size_t i = 0; i < resources.size(); i++) {
+		if (resources[i].importedState.has_value()) {
+			states[i] = resources[i].importedState.value();
+		}
+	}
+
+	planBarriers(states);
+	const std::vector<ResourceState> endStates = states;
+
+	for (size_t i = 0; i < resources.size(); i++) {
+		const Resource& resource = resources[i];
+
+		if (resource.importedState.has_value()) {
+			states[i] = resource.importedState.value();
+			continue;
+		}
+
+		// Buffers keep their contents, so the next frame continues where this one stopped.
+		states[i] = endStates[i];
+		states[i].isCurrentFrame = false;
+
+		// Transients start undefined, but their memory may still be in use by the previous frame.
+		if (resource.isTransient) {
+			states[i].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			for (const ResourceId alias : resource.aliases) {
+				states[i].writeStages |= endStates[alias].writeStages | endStates[alias].readStages;
+				states[i].writeAccess |= endStates[alias].writeAccess;
+			}
+		}
+	}
+
+	plan = planBarriers(states);
+
+	for (const Pass& pass : passes) {
+		stats.naiveBarrierCount += static_cast<uint32_t>(pass.uses.size());
+		stats.naiveBarrierCallCount += pass.uses.empty() ? 0 : 1;
+		stats.culledPassCount += pass.culled ? 1 : 0;
+	}
+
+	uint32_t naiveFinalBarrierCount = 0;
+	for (const Resource& resource : resources) {
+		naiveFinalBarrierCount += resource.finalAccess.has_value() ? 1 : 0;
+	}
+	stats.naiveBarrierCount += naiveFinalBarrierCount;
+	stats.naiveBarrierCallCount += naiveFinalBarrierCount > 0 ? 1 : 0;
+
+	for (const auto& barriers : plan.passBarriers) {
+		stats.barrierCount += static_cast<uint32_t>(barriers.size());
+		stats.barrierCallCount += barriers.empty() ? 0 : 1;
+	}
+
+	for (const auto& releases : plan.passReleases) {
+		stats.barrierCount += static_cast<uint32_t>(releases.size());
+		stats.barrierCallCount += releases.empty() ? 0 : 1;
+		stats.ownershipTransferCount += static_cast<uint32_t>(releases.size());
+	}
+
+	stats.barrierCount += static_cast<uint32_t>(plan.finalBarriers.size());
+	stats.barrierCallCount += plan.finalBarriers.empty() ? 0 : 1;
+
+	compiled = true;
+}
+
+void RenderGraph::Execute(const VkCommandBuffer commandBuffer, const VkCommandBuffer asyncComputeCommandBuffer) {
+	if (!compiled) {
+		UTIL_THROW("Render graph has to be compiled before it can be executed!");
+	}
+
+	if (stats.asyncComputePassCount > 0 && asyncComputeCommandBuffer == VK_NULL_HANDLE) {
+		UTIL_THROW("Render graph has async compute passes, but no command buffer to record them into!");
+	}
+
+	for (size_t i = 0; i < executionOrder.size(); i++) {
+		const Pass& pass = passes[executionOrder[i]];
+		const VkCommandBuffer queueCommandBuffer = pass.queue == Queue::AsyncCompute ? asyncComputeCommandBuffer : commandBuffer;
+
+		recordBarriers(queueCommandBuffer, plan.passBarriers[i]);
+		pass.execute(queueCommandBuffer);
+		recordBarriers(queueCommandBuffer, plan.passReleases[i]);
+	}
+
+	recordBarriers(commandBuffer, plan.finalBarriers);
+}
+
+const RenderGraph::QueueSync& RenderGraph::GetQueueSync(const Queue queue) const {
+	return plan.queueSync[static_cast<size_t>(queue)];
+}
+
+const RenderGraph::Stats& RenderGraph::GetStats() const {
+	return stats;
+}
+
+void RenderGraph::LogStats() const {
+	UTIL_LOG("Render graph: " + std::to_string(stats.declaredPassCount - stats.culledPassCount) + "/" +
+		std::to_string(stats.declaredPassCount) + " passes alive");
+	UTIL_LOG("Render graph barriers: " + std::to_string(stats.naiveBarrierCount) + " in " +
+		std::to_string(stats.naiveBarrierCallCount) + " calls before, " + std::to_string(stats.barrierCount) + " in " +
+		std::to_string(stats.barrierCallCount) + " calls after");
+	UTIL_LOG("Render graph transient memory: " + std::to_string(stats.unaliasedTransientMemory) + " bytes before, " +
+		std::to_string(stats.transientMemory) + " bytes after aliasing");
+	UTIL_LOG("Render graph queues: " + std::to_string(stats.asyncComputePassCount) + " passes on async compute, " +
+		std::to_string(stats.ownershipTransferCount) + " ownership transfers");
+}
+
+RenderGraph::AccessInfo RenderGraph::getAccessInfo(const Access access, const bool write) {
+	// Only stage and access bits that also exist in the original enums, so they survive the legacy fallback.
+	switch (access) {
+		case Access::ColorAttachment:
+			return {
+				VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+				write ? VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR : VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+			};
+		case Access::DepthAttachment:
+			return {
+				VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+				write ? VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR : VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR,
+				write ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+			};
+		case Access::FragmentSampled:
+			return {
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR,
+				write ? VK_ACCESS_2_NONE_KHR : VK_ACCESS_2_SHADER_READ_BIT_KHR,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			};
+		case Access::ComputeSampled:
+			return {
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+				write ? VK_ACCESS_2_NONE_KHR : VK_ACCESS_2_SHADER_READ_BIT_KHR,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			};
+		case Access::ComputeStorage:
+			return {
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+				write ? VK_ACCESS_2_SHADER_WRITE_BIT_KHR : VK_ACCESS_2_SHADER_READ_BIT_KHR,
+				VK_IMAGE_LAYOUT_GENERAL
+			};
+		case Access::TransferSrc:
+			return {
+				VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+				write ? VK_ACCESS_2_NONE_KHR : VK_ACCESS_2_TRANSFER_READ_BIT_KHR,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+			};
+		case Access::TransferDst:
+			return {
+				VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+				write ? VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR : VK_ACCESS_2_NONE_KHR,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+			};
+		case Access::IndirectBuffer:
+			return {
+				VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR,
+				write ? VK_ACCESS_2_NONE_KHR : VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR,
+				VK_IMAGE_LAYOUT_UNDEFINED
+			};
+		case Access::VertexBuffer:
+			return {
+				VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT_KHR,
+				write ? VK_ACCESS_2_NONE_KHR : VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR | VK_ACCESS_2_INDEX_READ_BIT_KHR,
+				VK_IMAGE_LAYOUT_UNDEFINED
+			};
+		case Access::Present:
+			// The present semaphore takes care of visibility, only the layout matters.
+			return {VK_PIPELINE_STAGE_2_NONE_KHR, VK_ACCESS_2_NONE_KHR, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR};
+		default:
+			UTIL_THROW("Unknown render graph access!");
+	}
+}
+
+VkImageUsageFlags RenderGraph::getImageUsage(const Access access) {
+	switch (access) {
+		case Access::ColorAttachment:
+			return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case Access::DepthAttachment:
+			return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		case Access::FragmentSampled:
+		case Access::ComputeSampled:
+			return VK_IMAGE_USAGE_SAMPLED_BIT;
+		case Access::ComputeStorage:
+			return VK_IMAGE_USAGE_STORAGE_BIT;
+		case Access::TransferSrc:
+			return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		case Access::TransferDst:
+			return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		default:
+			return 0;
+	}
+}
+
+void RenderGraph::addUse(const PassId pass, const ResourceId resource, const Access access, const bool write) {
+	if (pass >= passes.size() || resource >= resources.size()) {
+		UTIL_THROW("Invalid render graph pass or resource id!");
+	}
+
+	if (access == Access::Present) {
+		UTIL_THROW("Present can only be the final access of an imported image, used by pass " + passes[pass].name);
+	}
+
+	if (getAccessInfo(access, write).access == 0) {
+		UTIL_THROW("Pass " + passes[pass].name + " cannot " + (write ? "write " : "read ") + resources[resource].name + " with this access!");
+	}
+
+	resources[resource].usage |= getImageUsage(access);
+
+	// One barrier per resource per pass, so reading and writing the same resource is folded into a single use.
+	for (Use& use : passes[pass].uses) {
+		if (use.resource != resource) continue;
+
+		if (use.access != access) {
+			UTIL_THROW("Pass " + passes[pass].name + " uses " + resources[resource].name + " with two different accesses!");
+		}
+
+		use.read = use.read || !write;
+		use.write = use.write || write;
+		compiled = false;
+		return;
+	}
+
+	passes[pass].uses.push_back({resource, access, !write, write});
+	compiled = false;
+}
+
+void RenderGraph::cullPasses() {
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t i = 0; i < resources.size(); i++) {
+		needed[i] = resources[i].finalAccess.has_value();
+	}
+
+	// Walking backwards, a pass lives when it produces something a living pass or the frame output consumes.
+	for (size_t i = passes.size(); i-- > 0;) {
+		Pass& pass = passes[i];
+
+		bool alive = pass.hasSideEffects;
+		for (const Use& use : pass.uses) {
+			alive = alive || (use.write && needed[use.resource]);
+		}
+
+		pass.culled = !alive;
+		if (!alive) continue;
+
+		// A plain write fully produces the resource, earlier writers are no longer needed for it.
+		for (const Use& use : pass.uses) {
+			if (use.write && !use.read) {
+				needed[use.resource] = false;
+			}
+		}
+
+		for (const Use& use : pass.uses) {
+			if (use.read) {
+				needed[use.resource] = true;
+			}
+		}
+	}
+
+	executionOrder.clear();
+	for (size_t i = 0; i < passes.size(); i++) {
+		if (!passes[i].culled) {
+			executionOrder.emplace_back(static_cast<PassId>(i));
+		}
+	}
+}
+
+void RenderGraph::computeLifetimes() {
+	for (Resource& resource : resources) {
+		resource.firstUse.reset();
+		resource.lastUse = 0;
+		resource.isUsedOnAsyncCompute = false;
+		resource.aliases.clear();
+	}
+
+	for (uint32_t position = 0; position < executionOrder.size(); position++) {
+		const Pass& pass = passes[executionOrder[position]];
+		for (const Use& use : pass.uses) {
+			Resource& resource = resources[use.resource];
+			if (!resource.firstUse.has_value()) {
+				resource.firstUse = position;
+			}
+			resource.lastUse = position;
+			resource.isUsedOnAsyncCompute |= pass.queue == Queue::AsyncCompute;
+		}
+	}
+}
+
+void RenderGraph::allocateTransients() {
+	std::vector<ResourceId> transients;
+	uint32_t memoryTypeBits = ~0u;
+
+	for (ResourceId id = 0; id < resources.size(); id++) {
+		Resource& resource = resources[id];
+		if (!resource.isTransient || !resource.firstUse.has_value()) continue;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = resource.imageDesc.format;
+		imageInfo.extent = {resource.imageDesc.extent.width, resource.imageDesc.extent.height, 1};
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = resource.usage | resource.imageDesc.extraUsage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(device, &imageInfo, allocator, &resource.image) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create transient image " + resource.name + "!");
+		}
+
+		vkGetImageMemoryRequirements(device, resource.image, &resource.memoryRequirements);
+		memoryTypeBits &= resource.memoryRequirements.memoryTypeBits;
+		stats.unaliasedTransientMemory += resource.memoryRequirements.size;
+		transients.emplace_back(id);
+	}
+
+	if (transients.empty()) return;
+
+	if (memoryTypeBits == 0) {
+		UTIL_THROW("Transient images of the render graph share no memory type!");
+	}
+
+	// Largest first, each one at the lowest offset not overlapping anything alive at the same time.
+	std::sort(transients.begin(), transients.end(), [this](const ResourceId a, const ResourceId b) {
+		return resources[a].memoryRequirements.size > resources[b].memoryRequirements.size;
+	});
+
+	// Positions only order the passes of one queue. Async compute runs alongside the graphics work of this frame and the
+	// previous one, so what it touches counts as alive for the whole frame and is never aliased.
+	const auto lifetimesOverlap = [this](const ResourceId a, const ResourceId b) {
+		if (resources[a].isUsedOnAsyncCompute || resources[b].isUsedOnAsyncCompute) return true;
+		return resources[a].firstUse.value() <= resources[b].lastUse && resources[b].firstUse.value() <= resources[a].lastUse;
+	};
+
+	const auto memoryOverlaps = [this](const ResourceId a, const ResourceId b) {
+		const Resource& resourceA = resources[a];
+		const Resource& resourceB = resources[b];
+		return resourceA.memoryOffset < resourceB.memoryOffset + resourceB.memoryRequirements.size &&
+			resourceB.memoryOffset < resourceA.memoryOffset + resourceA.memoryRequirements.size;
+	};
+
+	std::vector<ResourceId> placed;
+	VkDeviceSize memorySize = 0;
+
+	for (const ResourceId id : transients) {
+		Resource& resource = resources[id];
+		const VkDeviceSize alignment = resource.memoryRequirements.alignment;
+
+		std::vector<VkDeviceSize> candidates = {0};
+		for (const ResourceId other : placed) {
+			if (lifetimesOverlap(id, other)) {
+				const VkDeviceSize end = resources[other].memoryOffset + resources[other].memoryRequirements.size;
+				candidates.emplace_back((end + alignment - 1) / alignment * alignment);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		for (const VkDeviceSize candidate : candidates) {
+			resource.memoryOffset = candidate;
+
+			const bool fits = std::none_of(placed.begin(), placed.end(), [&](const ResourceId other) {
+				return lifetimesOverlap(id, other) && memoryOverlaps(id, other);
+			});
+
+			if (fits) break;
+		}
+
+		memorySize = std::max(memorySize, resource.memoryOffset + resource.memoryRequirements.size);
+		placed.emplace_back(id);
+	}
+
+	for (const ResourceId a : placed) {
+		for (const ResourceId b : placed) {
+			if (a != b && memoryOverlaps(a, b)) {
+				resources[a].aliases.emplace_back(b);
+			}
+		}
+	}
+
+	VkMemoryAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = memorySize;
+	allocateInfo.memoryTypeIndex = gpu::findMemoryType(physicalDevice, memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(device, &allocateInfo, allocator, &transientMemory) != VK_SUCCESS) {
+		UTIL_THROW("Failed to allocate render graph transient memory!");
+	}
+	stats.transientMemory = memorySize;
+
+	for (const ResourceId id : placed) {
+		Resource& resource = resources[id];
+		if (vkBindImageMemory(device, resource.image, transientMemory, resource.memoryOffset) != VK_SUCCESS) {
+			UTIL_THROW("Failed to bind transient image " + resource.name + "!");
+		}
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = resource.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = resource.imageDesc.format;
+		viewInfo.subresourceRange.aspectMask = resource.imageDesc.aspectMask;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(device, &viewInfo, allocator, &resource.imageView) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create image view for transient image " + resource.name + "!");
+		}
+	}
+}
+
+RenderGraph::BarrierPlan RenderGraph::planBarriers(std::vector<ResourceState>& states) const {
+	BarrierPlan result;
+	result.passBarriers.assign(executionOrder.size(), {});
+	result.passReleases.assign(executionOrder.size(), {});
+
+	for (uint32_t position = 0; position < executionOrder.size(); position++) {
+		const Pass& pass = passes[executionOrder[position]];
+
+		for (const Use& use : pass.uses) {
+			const Resource& resource = resources[use.resource];
+			ResourceState& state = states[use.resource];
+
+			// Aliased memory was last used by whatever transient lived there before within this frame.
+			if (resource.isTransient && resource.firstUse == position) {
+				for (const ResourceId alias : resource.aliases) {
+					if (resources[alias].lastUse < position) {
+						state.writeStages |= states[alias].writeStages | states[alias].readStages;
+						state.writeAccess |= states[alias].writeAccess;
+					}
+				}
+			}
+
+			AccessInfo info = getAccessInfo(use.access, use.write);
+			if (use.write && use.read) {
+				info.access |= getAccessInfo(use.access, false).access;
+			}
+
+			// Across queues a semaphore orders the work, barriers on either side cannot see each other.
+			bool transferred = false;
+			if (state.queue.has_value() && state.queue.value() != pass.queue) {
+				if (pass.queue == Queue::AsyncCompute && state.isCurrentFrame) {
+					UTIL_THROW("Async compute pass " + pass.name + " uses " + resource.name +
+						" after a graphics pass of the same frame, but is submitted before it!");
+				}
+
+				// Graphics waits on the compute work of its own frame, which the queue finished after any earlier frame.
+				QueueSync& sync = result.queueSync[static_cast<size_t>(pass.queue)];
+				if (pass.queue == Queue::Graphics) {
+					sync.sameFrameStages |= info.stages;
+				} else {
+					sync.previousFrameStages |= info.stages;
+				}
+
+				if (resource.isConcurrent || !use.read) {
+					// The semaphore already makes all writes visible, exclusive contents that are not read can be dropped.
+					const VkImageLayout layout = resource.isConcurrent ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+					state = {};
+					state.layout = layout;
+				} else {
+					// The release goes after the last use on the old queue, in the previous frame's recording when the
+					// last use was there. As every frame records the same plan, that is the same pass.
+					PlannedBarrier release{};
+					release.resource = use.resource;
+					release.srcStages = state.writeStages | state.readStages;
+					release.srcAccess = state.writeAccess;
+					release.oldLayout = state.layout;
+					release.newLayout = resource.isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+					release.srcQueueFamily = queueFamilies[static_cast<size_t>(state.queue.value())];
+					release.dstQueueFamily = queueFamilies[static_cast<size_t>(pass.queue)];
+					result.passReleases[state.lastPosition.value()].emplace_back(release);
+
+					// Chained to the semaphore wait, which waits at the same stages.
+					PlannedBarrier acquire = release;
+					acquire.srcStages = info.stages;
+					acquire.srcAccess = 0;
+					acquire.dstStages = info.stages;
+					acquire.dstAccess = info.access;
+					result.passBarriers[position].emplace_back(acquire);
+
+					transferred = true;
+				}
+			}
+
+			const bool layoutChange = resource.isImage && state.layout != info.layout;
+
+			PlannedBarrier barrier{};
+			barrier.resource = use.resource;
+			barrier.dstStages = info.stages;
+			barrier.dstAccess = info.access;
+			barrier.oldLayout = state.layout;
+			barrier.newLayout = resource.isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+			bool needed;
+			if (transferred) {
+				// The acquire already is the barrier.
+				needed = false;
+			} else if (layoutChange || use.write) {
+				// Write after read only needs the readers done, write after write also needs their memory available.
+				barrier.srcStages = state.writeStages | state.readStages;
+				barrier.srcAccess = state.writeAccess;
+				needed = layoutChange || barrier.srcStages != 0;
+			} else {
+				// Readers already made to wait on the last write can be skipped.
+				const bool covered = (info.stages & ~state.readStages) == 0 && (info.access & ~state.visibleAccess) == 0;
+				barrier.srcStages = state.writeStages;
+				barrier.srcAccess = state.writeAccess;
+				needed = state.writeStages != 0 && !covered;
+			}
+
+			if (needed) {
+				result.passBarriers[position].emplace_back(barrier);
+			}
+
+			if (use.write) {
+				state.writeStages = info.stages;
+				state.writeAccess = getAccessInfo(use.access, true).access;
+				state.readStages = 0;
+				state.visibleAccess = 0;
+			} else if (layoutChange || transferred) {
+				// The transition happens before the reading stages, later readers chain onto those.
+				state.writeStages = info.stages;
+				state.writeAccess = 0;
+				state.readStages = info.stages;
+				state.visibleAccess = info.access;
+			} else {
+				state.readStages |= info.stages;
+				state.visibleAccess |= info.access;
+			}
+
+			state.layout = barrier.newLayout;
+			state.queue = pass.queue;
+			state.lastPosition = position;
+			state.isCurrentFrame = true;
+		}
+	}
+
+	for (ResourceId id = 0; id < resources.size(); id++) {
+		const Resource& resource = resources[id];
+		if (!resource.finalAccess.has_value()) continue;
+
+		ResourceState& state = states[id];
+		const AccessInfo info = getAccessInfo(resource.finalAccess.value(), false);
+
+		if (state.queue == Queue::AsyncCompute) {
+			UTIL_THROW("Resource " + resource.name + " has a final access, so its last pass has to run on the graphics queue!");
+		}
+
+		if (resource.isImage && state.layout != info.layout) {
+			result.finalBarriers.push_back({
+				id,
+				state.writeStages | state.readStages, state.writeAccess,
+				info.stages, info.access,
+				state.layout, info.layout
+			});
+
+			state.layout = info.layout;
+		}
+	}
+
+	return result;
+}
+
+void RenderGraph::recordBarriers(const VkCommandBuffer commandBuffer, const std::vector<PlannedBarrier>& barriers) {
+	if (barriers.empty()) return;
+
+	const auto subresourceRange = [](const Resource& resource) {
+		VkImageSubresourceRange range{};
+		range.aspectMask = resource.imageDesc.aspectMask;
+		range.baseMipLevel = 0;
+		range.levelCount = VK_REMAINING_MIP_LEVELS;
+		range.baseArrayLayer = 0;
+		range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		return range;
+	};
+
+	if (cmdPipelineBarrier2 != nullptr) {
+		imageBarriers.clear();
+		bufferBarriers.clear();
+
+		for (const PlannedBarrier& planned : barriers) {
+			const Resource& resource = resources[planned.resource];
+
+			if (resource.isImage) {
+				VkImageMemoryBarrier2KHR barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+				barrier.srcStageMask = planned.srcStages;
+				barrier.srcAccessMask = planned.srcAccess;
+				barrier.dstStageMask = planned.dstStages;
+				barrier.dstAccessMask = planned.dstAccess;
+				barrier.oldLayout = planned.oldLayout;
+				barrier.newLayout = planned.newLayout;
+				barrier.srcQueueFamilyIndex = planned.srcQueueFamily;
+				barrier.dstQueueFamilyIndex = planned.dstQueueFamily;
+				barrier.image = resource.image;
+				barrier.subresourceRange = subresourceRange(resource);
+				imageBarriers.emplace_back(barrier);
+			} else {
+				VkBufferMemoryBarrier2KHR barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+				barrier.srcStageMask = planned.srcStages;
+				barrier.srcAccessMask = planned.srcAccess;
+				barrier.dstStageMask = planned.dstStages;
+				barrier.dstAccessMask = planned.dstAccess;
+				barrier.srcQueueFamilyIndex = planned.srcQueueFamily;
+				barrier.dstQueueFamilyIndex = planned.dstQueueFamily;
+				barrier.buffer = resource.buffer;
+				barrier.offset = 0;
+				barrier.size = VK_WHOLE_SIZE;
+				bufferBarriers.emplace_back(barrier);
+			}
+		}
+
+		VkDependencyInfoKHR dependencyInfo{};
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+		dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+		dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+		dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+		dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+
+		cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		return;
+	}
+
+	// Legacy path: stage masks are per call instead of per barrier, so they are merged.
+	legacyImageBarriers.clear();
+	legacyBufferBarriers.clear();
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+
+	for (const PlannedBarrier& planned : barriers) {
+		const Resource& resource = resources[planned.resource];
+		srcStages |= static_cast<VkPipelineStageFlags>(planned.srcStages);
+		dstStages |= static_cast<VkPipelineStageFlags>(planned.dstStages);
+
+		if (resource.isImage) {
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = static_cast<VkAccessFlags>(planned.srcAccess);
+			barrier.dstAccessMask = static_cast<VkAccessFlags>(planned.dstAccess);
+			barrier.oldLayout = planned.oldLayout;
+			barrier.newLayout = planned.newLayout;
+			barrier.srcQueueFamilyIndex = planned.srcQueueFamily;
+			barrier.dstQueueFamilyIndex = planned.dstQueueFamily;
+			barrier.image = resource.image;
+			barrier.subresourceRange = subresourceRange(resource);
+			legacyImageBarriers.emplace_back(barrier);
+		} else {
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = static_cast<VkAccessFlags>(planned.srcAccess);
+			barrier.dstAccessMask = static_cast<VkAccessFlags>(planned.dstAccess);
+			barrier.srcQueueFamilyIndex = planned.srcQueueFamily;
+			barrier.dstQueueFamilyIndex = planned.dstQueueFamily;
+			barrier.buffer = resource.buffer;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+			legacyBufferBarriers.emplace_back(barrier);
+		}
+	}
+
+	vkCmdPipelineBarrier(commandBuffer,
+	                     srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+	                     dstStages != 0 ? dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+	                     0, 0, nullptr,
+	                     static_cast<uint32_t>(legacyBufferBarriers.size()), legacyBufferBarriers.data(),
+	                     static_cast<uint32_t>(legacyImageBarriers.size()), legacyImageBarriers.data());
+}
+
+void RenderGraph::destroyTransients() {
+	for (Resource& resource : resources) {
+		if (!resource.isTransient) continue;
+
+		vkDestroyImageView(device, resource.imageView, allocator);
+		vkDestroyImage(device, resource.image, allocator);
+		resource.imageView = VK_NULL_HANDLE;
+		resource.image = VK_NULL_HANDLE;
+	}
+
+	vkFreeMemory(device, transientMemory, allocator);
+	transientMemory = VK_NULL_HANDLE;
+	compiled = false;
+}
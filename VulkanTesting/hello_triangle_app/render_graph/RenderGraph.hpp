@@ -0,0 +1,244 @@
+﻿#pragma once
+
+#include <array>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Describes a frame as passes that declare which resources they read and write.
+// Compile() culls passes that contribute to nothing, plans one batched barrier per pass from the declared
+// accesses and places transient images with non-overlapping lifetimes in the same device memory.
+// Execute() only replays that plan, so the graph is built once and recompiled when the swap chain changes.
+// Passes may run on an async compute queue, the graph then adds the queue family ownership transfers and reports which
+// stages each queue has to wait on the other one with, the caller turns that into semaphore waits.
+class RenderGraph {
+public: // Properties
+	using ResourceId = uint32_t;
+	using PassId = uint32_t;
+	using ExecuteCallback = std::function<void(VkCommandBuffer commandBuffer)>;
+
+	// How a pass uses a resource, whether it reads or writes it comes from Read() or Write().
+	enum class Access {
+		ColorAttachment,
+		DepthAttachment,
+		FragmentSampled,
+		ComputeSampled,
+		ComputeStorage,
+		TransferSrc,
+		TransferDst,
+		IndirectBuffer,
+		VertexBuffer,
+		Present, // Only valid as the final access of an imported image.
+	};
+
+	// Async compute work of a frame is submitted before its graphics work, so it can only depend on graphics work of
+	// earlier frames.
+	enum class Queue {
+		Graphics,
+		AsyncCompute,
+	};
+	static constexpr size_t QUEUE_COUNT = 2;
+
+	// Stages of a queue that have to wait on the other queue, 0 when no wait is needed.
+	struct QueueSync {
+		VkPipelineStageFlags2KHR sameFrameStages = 0; // On the other queue's work of the same frame.
+		VkPipelineStageFlags2KHR previousFrameStages = 0; // On the other queue's work of the previous frame.
+	};
+
+	struct ImageDesc {
+		VkFormat format;
+		VkExtent2D extent;
+		VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		VkImageUsageFlags extraUsage = 0; // Transient images already get the usage their accesses need.
+	};
+
+	struct BufferDesc {
+		VkDeviceSize size;
+		// A different buffer is set every frame, each one guarded by its frame's fence, so frames do not wait on each other.
+		bool isPerFrame = false;
+		// Created with VK_SHARING_MODE_CONCURRENT, so using it on another queue needs no ownership transfer.
+		bool isConcurrent = false;
+	};
+
+	struct Stats {
+		uint32_t declaredPassCount = 0;
+		uint32_t culledPassCount = 0;
+
+		// Before: a barrier for every declared access, as when written by hand without tracking any state. Recorded in
+		// one call in front of each pass, and one more for the final transitions.
+		uint32_t naiveBarrierCount = 0;
+		uint32_t naiveBarrierCallCount = 0;
+		// After: only barriers that resolve an actual hazard or layout change, one call per pass at most.
+		uint32_t barrierCount = 0;
+		uint32_t barrierCallCount = 0;
+
+		uint32_t asyncComputePassCount = 0;
+		uint32_t ownershipTransferCount = 0; // Release and acquire pairs.
+
+		VkDeviceSize unaliasedTransientMemory = 0;
+		VkDeviceSize transientMemory = 0;
+	};
+
+private: // Member Variables
+	struct AccessInfo {
+		VkPipelineStageFlags2KHR stages;
+		VkAccessFlags2KHR access;
+		VkImageLayout layout;
+	};
+
+	// What the last accesses to a resource left behind that the next one has to wait on.
+	struct ResourceState {
+		VkPipelineStageFlags2KHR writeStages = 0;
+		VkAccessFlags2KHR writeAccess = 0;
+		VkPipelineStageFlags2KHR readStages = 0; // Readers already synchronized with the last write.
+		VkAccessFlags2KHR visibleAccess = 0;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		std::optional<Queue> queue; // Of the last access.
+		std::optional<uint32_t> lastPosition;
+		bool isCurrentFrame = false; // False while the last access belongs to the previous frame.
+	};
+
+	struct Resource {
+		std::string name;
+		bool isImage = true;
+		bool isTransient = false;
+		bool isConcurrent = false;
+
+		ImageDesc imageDesc{};
+		VkImageUsageFlags usage = 0;
+		VkDeviceSize bufferSize = 0;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+
+		std::optional<ResourceState> importedState; // Frame start state of resources coming from outside.
+		std::optional<Access> finalAccess;
+
+		// Compile results
+		std::optional<uint32_t> firstUse;
+		uint32_t lastUse = 0;
+		bool isUsedOnAsyncCompute = false;
+		VkDeviceSize memoryOffset = 0;
+		VkMemoryRequirements memoryRequirements{};
+		std::vector<ResourceId> aliases; // Transients sharing part of this one's memory.
+	};
+
+	struct Use {
+		ResourceId resource;
+		Access access;
+		bool read;
+		bool write;
+	};
+
+	struct Pass {
+		std::string name;
+		std::vector<Use> uses;
+		ExecuteCallback execute;
+		bool hasSideEffects;
+		Queue queue;
+		bool culled = false;
+	};
+
+	struct PlannedBarrier {
+		ResourceId resource;
+		VkPipelineStageFlags2KHR srcStages;
+		VkAccessFlags2KHR srcAccess;
+		VkPipelineStageFlags2KHR dstStages;
+		VkAccessFlags2KHR dstAccess;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+		uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+		uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+	};
+
+	struct BarrierPlan {
+		std::vector<std::vector<PlannedBarrier>> passBarriers; // Indexed like executionOrder, recorded before the pass.
+		std::vector<std::vector<PlannedBarrier>> passReleases; // Ownership releases, recorded after the pass.
+		std::vector<PlannedBarrier> finalBarriers;
+		std::array<QueueSync, QUEUE_COUNT> queueSync{};
+	};
+
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2;
+	const VkAllocationCallbacks* allocator;
+	std::array<uint32_t, QUEUE_COUNT> queueFamilies = {VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED};
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+
+	bool compiled = false;
+	std::vector<PassId> executionOrder;
+	BarrierPlan plan;
+	VkDeviceMemory transientMemory = VK_NULL_HANDLE;
+	Stats stats;
+
+	// Reused every Execute() to keep recording free of allocations.
+	std::vector<VkImageMemoryBarrier2KHR> imageBarriers;
+	std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers;
+	std::vector<VkImageMemoryBarrier> legacyImageBarriers;
+	std::vector<VkBufferMemoryBarrier> legacyBufferBarriers;
+
+public: // Public Functions
+	// Without cmdPipelineBarrier2 (no synchronization2) the planned barriers are recorded with vkCmdPipelineBarrier.
+	RenderGraph(VkPhysicalDevice physicalDevice, VkDevice device, PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2,
+	            const VkAllocationCallbacks* allocator = nullptr);
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph(RenderGraph&&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// initialLayout and initialStages describe the image at the start of every frame, e.g. after the acquire semaphore.
+	ResourceId ImportImage(const std::string& name, const ImageDesc& desc,
+	                       VkImageLayout initialLayout, VkPipelineStageFlags2KHR initialStages,
+	                       std::optional<Access> finalAccess = std::nullopt);
+	// Buffers living across frames, each frame waits on the accesses of the previous one unless desc.isPerFrame is set.
+	ResourceId ImportBuffer(const std::string& name, const BufferDesc& desc);
+	// Owned by the graph, contents do not survive the frame.
+	ResourceId CreateImage(const std::string& name, const ImageDesc& desc);
+
+	// Passes execute in the order they are added, hasSideEffects keeps them alive without consumers.
+	PassId AddPass(const std::string& name, ExecuteCallback execute, bool hasSideEffects = false,
+	               Queue queue = Queue::Graphics);
+	void Read(PassId pass, ResourceId resource, Access access);
+	void Write(PassId pass, ResourceId resource, Access access);
+
+	void SetImage(ResourceId resource, VkImage image, VkImageView imageView);
+	void SetBuffer(ResourceId resource, VkBuffer buffer);
+	VkImage GetImage(ResourceId resource) const;
+	VkImageView GetImageView(ResourceId resource) const;
+	VkBuffer GetBuffer(ResourceId resource) const;
+
+	// Only needed with async compute passes, the families end up in the ownership transfer barriers.
+	void SetQueueFamilies(uint32_t graphicsFamily, uint32_t asyncComputeFamily);
+
+	void Compile();
+	// Async compute passes are recorded into asyncComputeCommandBuffer, which has to be submitted before commandBuffer.
+	void Execute(VkCommandBuffer commandBuffer, VkCommandBuffer asyncComputeCommandBuffer = VK_NULL_HANDLE);
+
+	// Valid after Compile(), the same every frame.
+	const QueueSync& GetQueueSync(Queue queue) const;
+
+	const Stats& GetStats() const;
+	void LogStats() const;
+
+private: // Private Methods
+	static AccessInfo getAccessInfo(Access access, bool write);
+	static VkImageUsageFlags getImageUsage(Access access);
+
+	void addUse(PassId pass, ResourceId resource, Access access, bool write);
+
+	void cullPasses();
+	void computeLifetimes();
+	void allocateTransients();
+	BarrierPlan planBarriers(std::vector<ResourceState>& states) const;
+
+	void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<PlannedBarrier>& barriers);
+	void destroyTransients();
+};
@@ -0,0 +1,294 @@
+﻿#include "CommandStream.hpp"
+
+namespace replay
+{
+	CommandStreamWriter::CommandStreamWriter(const std::string& fileName, const uint32_t framesInFlight, const uint32_t frameCount)
+		: file(fileName, std::ios::binary | std::ios::trunc), framesLeft(frameCount) {
+		if (!file.is_open()) {
+			UTIL_THROW("Failed to open capture file " + fileName);
+		}
+
+		FileHeader header{};
+		header.framesInFlight = framesInFlight;
+		append(header);
+	}
+
+	CommandStreamWriter::~CommandStreamWriter() {
+		flush();
+	}
+
+	bool CommandStreamWriter::IsCapturing() const {
+		return framesLeft > 0;
+	}
+
+	uint64_t CommandStreamWriter::GetWrittenBytes() const {
+		return writtenBytes;
+	}
+
+	void CommandStreamWriter::AddPipeline(const VkPipeline pipeline, const PipelineDesc& desc) {
+		if (!IsCapturing()) return;
+
+		PipelineRecord record{};
+		record.id = nextPipelineId++;
+		record.colorFormat = desc.colorFormat;
+		record.topology = desc.topology;
+		record.cullMode = desc.cullMode;
+		record.frontFace = desc.frontFace;
+		record.pushConstantStages = desc.pushConstantStages;
+		record.pushConstantSize = desc.pushConstantSize;
+		record.textureStages = desc.textureStages;
+		record.bindingCount = static_cast<uint32_t>(desc.bindings.size());
+		record.attributeCount = static_cast<uint32_t>(desc.attributes.size());
+		record.vertexShaderSize = static_cast<uint32_t>(desc.vertexShader.size());
+		record.fragmentShaderSize = static_cast<uint32_t>(desc.fragmentShader.size());
+		pipelineIds[pipeline] = record.id;
+
+		const size_t bindingsSize = desc.bindings.size() * sizeof(VkVertexInputBindingDescription);
+		const size_t attributesSize = desc.attributes.size() * sizeof(VkVertexInputAttributeDescription);
+		beginRecord(RecordType::Pipeline, static_cast<uint32_t>(sizeof(record) + bindingsSize + attributesSize +
+			desc.vertexShader.size() + desc.fragmentShader.size()));
+		append(record);
+		append(desc.bindings.data(), bindingsSize);
+		append(desc.attributes.data(), attributesSize);
+		append(desc.vertexShader.data(), desc.vertexShader.size());
+		append(desc.fragmentShader.data(), desc.fragmentShader.size());
+	}
+
+	void CommandStreamWriter::WriteBufferData(const VkBuffer buffer, const VkDeviceSize bufferSize, const bool hostVisible,
+	                                          const void* data, const VkDeviceSize size, const VkDeviceSize offset) {
+		if (!IsCapturing()) return;
+
+		auto found = bufferIds.find(buffer);
+		if (found == bufferIds.end()) {
+			BufferRecord record{};
+			record.id = nextBufferId++;
+			record.hostVisible = hostVisible;
+			record.size = bufferSize;
+			found = bufferIds.emplace(buffer, record.id).first;
+
+			beginRecord(RecordType::Buffer, sizeof(record));
+			append(record);
+		}
+
+		BufferDataRecord record{};
+		record.id = found->second;
+		record.offset = offset;
+		beginRecord(RecordType::BufferData, static_cast<uint32_t>(sizeof(record) + size));
+		append(record);
+		append(data, size);
+	}
+
+	void CommandStreamWriter::BeginFrame(const uint32_t frameInFlight, const VkExtent2D extent, const VkClearColorValue& clearColor) {
+		if (!IsCapturing()) return;
+
+		BeginFrameRecord record{};
+		record.frameInFlight = frameInFlight;
+		record.extent = extent;
+		record.clearColor = clearColor;
+		beginRecord(RecordType::BeginFrame, sizeof(record));
+		append(record);
+		inFrame = true;
+	}
+
+	void CommandStreamWriter::EndFrame() {
+		if (!inFrame) return;
+
+		beginRecord(RecordType::EndFrame, 0);
+		inFrame = false;
+		framesLeft--;
+		flush();
+	}
+
+	void CommandStreamWriter::BindPipeline(const VkPipeline pipeline) {
+		if (!inFrame) return;
+
+		const auto found = pipelineIds.find(pipeline);
+		if (found == pipelineIds.end()) {
+			UTIL_THROW("Bound a pipeline the capture does not know!");
+		}
+
+		beginRecord(RecordType::BindPipeline, sizeof(uint32_t));
+		append(found->second);
+	}
+
+	void CommandStreamWriter::SetViewport(const VkViewport& viewport) {
+		if (!inFrame) return;
+
+		beginRecord(RecordType::SetViewport, sizeof(viewport));
+		append(viewport);
+	}
+
+	void CommandStreamWriter::SetScissor(const VkRect2D& scissor) {
+		if (!inFrame) return;
+
+		beginRecord(RecordType::SetScissor, sizeof(scissor));
+		append(scissor);
+	}
+
+	void CommandStreamWriter::PushConstants(const VkShaderStageFlags stages, const uint32_t offset, const uint32_t size,
+	                                        const void* data) {
+		if (!inFrame) return;
+
+		const PushConstantsRecord record{stages, offset};
+		beginRecord(RecordType::PushConstants, sizeof(record) + size);
+		append(record);
+		append(data, size);
+	}
+
+	void CommandStreamWriter::BindVertexBuffers(const uint32_t firstBinding, const uint32_t count, const VkBuffer* buffers,
+	                                            const VkDeviceSize* offsets) {
+		if (!inFrame) return;
+
+		beginRecord(RecordType::BindVertexBuffers, static_cast<uint32_t>(2 * sizeof(uint32_t) + count * sizeof(BufferBinding)));
+		append(firstBinding);
+		append(count);
+		for (uint32_t i = 0; i < count; i++) {
+			BufferBinding binding{};
+			binding.id = getBufferId(buffers[i]);
+			binding.offset = offsets[i];
+			append(binding);
+		}
+	}
+
+	void CommandStreamWriter::BindIndexBuffer(const VkBuffer buffer, const VkDeviceSize offset, const VkIndexType indexType) {
+		if (!inFrame) return;
+
+		BufferBinding binding{};
+		binding.id = getBufferId(buffer);
+		binding.offset = offset;
+		beginRecord(RecordType::BindIndexBuffer, sizeof(binding) + sizeof(indexType));
+		append(binding);
+		append(indexType);
+	}
+
+	void CommandStreamWriter::DrawIndexed(const VkDrawIndexedIndirectCommand& draw) {
+		if (!inFrame) return;
+
+		beginRecord(RecordType::DrawIndexed, sizeof(draw));
+		append(draw);
+	}
+
+	void CommandStreamWriter::beginRecord(const RecordType type, const uint32_t size) {
+		append(RecordHeader{type, size});
+	}
+
+	void CommandStreamWriter::append(const void* data, const size_t size) {
+		const char* bytes = static_cast<const char*>(data);
+		pending.insert(pending.end(), bytes, bytes + size);
+	}
+
+	void CommandStreamWriter::flush() {
+		if (pending.empty()) return;
+
+		file.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+		file.flush();
+		writtenBytes += pending.size();
+		pending.clear();
+	}
+
+	uint32_t CommandStreamWriter::getBufferId(const VkBuffer buffer) const {
+		const auto found = bufferIds.find(buffer);
+		if (found == bufferIds.end()) {
+			UTIL_THROW("Bound a buffer the capture has no contents for!");
+		}
+		return found->second;
+	}
+
+	CommandStreamReader::CommandStreamReader(const std::string& fileName)
+		: file(std::make_unique<utils::io::MappedFile>(fileName)) {
+		const char* data = file->GetData();
+		const size_t size = file->GetSize();
+
+		if (size < sizeof(FileHeader)) {
+			UTIL_THROW(fileName + " is not a command stream capture!");
+		}
+		memcpy(&header, data, sizeof(header));
+		if (memcmp(header.magic, FileHeader{}.magic, sizeof(header.magic)) != 0 || header.version != FileHeader{}.version) {
+			UTIL_THROW(fileName + " is not a command stream capture of version " + std::to_string(FileHeader{}.version) + "!");
+		}
+
+		bool inFrame = false;
+		size_t position = sizeof(FileHeader);
+		while (position + sizeof(RecordHeader) <= size) {
+			RecordHeader recordHeader;
+			memcpy(&recordHeader, data + position, sizeof(recordHeader));
+			position += sizeof(recordHeader);
+
+			if (position + recordHeader.size > size) {
+				UTIL_THROW(fileName + " ends in the middle of a record!");
+			}
+
+			const Record record = {recordHeader.type, data + position, recordHeader.size};
+			position += recordHeader.size;
+
+			if (record.type == RecordType::BeginFrame) {
+				frameBegins.push_back(record.Read<BeginFrameRecord>());
+				frames.emplace_back();
+				inFrame = true;
+			} else if (record.type == RecordType::EndFrame) {
+				inFrame = false;
+			} else if (inFrame && record.type != RecordType::Pipeline && record.type != RecordType::Buffer) {
+				frames.back().push_back(record);
+			} else {
+				loadRecords.push_back(record);
+			}
+		}
+
+		// A capture cut off mid frame still replays the frames before.
+		if (inFrame) {
+			frames.pop_back();
+			frameBegins.pop_back();
+		}
+	}
+
+	uint32_t CommandStreamReader::GetFramesInFlight() const {
+		return header.framesInFlight;
+	}
+
+	const std::vector<CommandStreamReader::Record>& CommandStreamReader::GetLoadRecords() const {
+		return loadRecords;
+	}
+
+	uint32_t CommandStreamReader::GetFrameCount() const {
+		return static_cast<uint32_t>(frames.size());
+	}
+
+	const BeginFrameRecord& CommandStreamReader::GetFrameBegin(const uint32_t frame) const {
+		return frameBegins[frame];
+	}
+
+	const std::vector<CommandStreamReader::Record>& CommandStreamReader::GetFrameRecords(const uint32_t frame) const {
+		return frames[frame];
+	}
+
+	PipelineDesc CommandStreamReader::ReadPipeline(const Record& record, uint32_t& id) {
+		const PipelineRecord pipeline = record.Read<PipelineRecord>();
+		id = pipeline.id;
+
+		PipelineDesc desc;
+		desc.colorFormat = pipeline.colorFormat;
+		desc.topology = pipeline.topology;
+		desc.cullMode = pipeline.cullMode;
+		desc.frontFace = pipeline.frontFace;
+		desc.pushConstantStages = pipeline.pushConstantStages;
+		desc.pushConstantSize = pipeline.pushConstantSize;
+		desc.textureStages = pipeline.textureStages;
+
+		size_t offset = sizeof(PipelineRecord);
+		for (uint32_t i = 0; i < pipeline.bindingCount; i++, offset += sizeof(VkVertexInputBindingDescription)) {
+			desc.bindings.push_back(record.Read<VkVertexInputBindingDescription>(offset));
+		}
+		for (uint32_t i = 0; i < pipeline.attributeCount; i++, offset += sizeof(VkVertexInputAttributeDescription)) {
+			desc.attributes.push_back(record.Read<VkVertexInputAttributeDescription>(offset));
+		}
+
+		if (offset + pipeline.vertexShaderSize + pipeline.fragmentShaderSize > record.size) {
+			UTIL_THROW("Pipeline record " + std::to_string(id) + " is too short for its shaders!");
+		}
+		desc.vertexShader.assign(record.payload + offset, record.payload + offset + pipeline.vertexShaderSize);
+		offset += pipeline.vertexShaderSize;
+		desc.fragmentShader.assign(record.payload + offset, record.payload + offset + pipeline.fragmentShaderSize);
+
+		return desc;
+	}
+}
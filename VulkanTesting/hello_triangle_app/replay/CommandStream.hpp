@@ -0,0 +1,212 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "../../utils/MappedFile.hpp"
+#include "../../utils/log.hpp"
+
+namespace replay
+{
+	// A capture file is a FileHeader followed by records, each a RecordHeader and size bytes of payload. Payloads are
+	// the structs below, some followed by arrays or raw bytes. Handles are replaced by ids numbered in capture order.
+	// Everything before the first BeginFrame is loaded once, the frames in between BeginFrame and EndFrame are replayed.
+	// Pipeline and Buffer records are loaded once wherever they are, a buffer first written by a frame is added in it.
+	enum class RecordType : uint32_t {
+		Pipeline, // PipelineRecord, bindings, attributes, vertex SPIR-V, fragment SPIR-V
+		Buffer, // BufferRecord
+		BufferData, // BufferDataRecord, contents
+		BeginFrame, // BeginFrameRecord
+		EndFrame,
+		BindPipeline, // uint32_t id
+		SetViewport, // VkViewport
+		SetScissor, // VkRect2D
+		PushConstants, // PushConstantsRecord, contents
+		BindVertexBuffers, // uint32_t first binding, uint32_t count, count BufferBinding
+		BindIndexBuffer, // BufferBinding, VkIndexType
+		DrawIndexed, // VkDrawIndexedIndirectCommand
+	};
+
+	struct FileHeader {
+		char magic[4] = {'V', 'K', 'C', 'S'};
+		uint32_t version = 2;
+		uint32_t framesInFlight = 0;
+	};
+
+	struct RecordHeader {
+		RecordType type;
+		uint32_t size;
+	};
+
+	struct PipelineRecord {
+		uint32_t id;
+		VkFormat colorFormat;
+		VkPrimitiveTopology topology;
+		VkCullModeFlags cullMode;
+		VkFrontFace frontFace;
+		VkShaderStageFlags pushConstantStages;
+		uint32_t pushConstantSize;
+		VkShaderStageFlags textureStages;
+		uint32_t bindingCount;
+		uint32_t attributeCount;
+		uint32_t vertexShaderSize;
+		uint32_t fragmentShaderSize;
+	};
+
+	struct BufferRecord {
+		uint32_t id;
+		uint32_t hostVisible; // Written by the CPU every frame, device local otherwise.
+		uint64_t size;
+	};
+
+	struct BufferDataRecord {
+		uint32_t id;
+		uint32_t padding = 0;
+		uint64_t offset;
+	};
+
+	struct BeginFrameRecord {
+		uint32_t frameInFlight;
+		VkExtent2D extent;
+		VkClearColorValue clearColor;
+	};
+
+	struct PushConstantsRecord {
+		VkShaderStageFlags stages;
+		uint32_t offset;
+	};
+
+	struct BufferBinding {
+		uint32_t id;
+		uint32_t padding = 0;
+		uint64_t offset;
+	};
+
+	// The state of a graphics pipeline that differs between pipelines, the replay fills in the rest the way the app
+	// does: fill mode, no blending, no depth, viewport and scissor as dynamic state, push constants only.
+	struct PipelineDesc {
+		std::vector<char> vertexShader; // SPIR-V
+		std::vector<char> fragmentShader;
+		VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+		VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+		VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+		VkShaderStageFlags pushConstantStages = 0;
+		uint32_t pushConstantSize = 0;
+		// Of a combined image sampler at set 0 binding 0, none without stages. Textures are not captured, the replay
+		// samples plain white.
+		VkShaderStageFlags textureStages = 0;
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+	};
+
+	// Records what the app uploads and draws into a capture file, next to the real Vulkan calls. Records of a frame are
+	// gathered in memory and written out at its end, so capturing adds no small writes to the frame.
+	class CommandStreamWriter {
+	public: // Properties
+
+	private: // Member Variables
+		std::ofstream file;
+		std::vector<char> pending;
+
+		std::map<VkPipeline, uint32_t> pipelineIds;
+		std::map<VkBuffer, uint32_t> bufferIds;
+		uint32_t nextPipelineId = 0;
+		uint32_t nextBufferId = 0;
+
+		uint32_t framesLeft;
+		bool inFrame = false;
+		uint64_t writtenBytes = 0;
+
+	public: // Public Functions
+		// Captures the first frameCount frames, calls after those are ignored.
+		CommandStreamWriter(const std::string& fileName, uint32_t framesInFlight, uint32_t frameCount);
+		~CommandStreamWriter();
+
+		CommandStreamWriter(const CommandStreamWriter&) = delete;
+		CommandStreamWriter(CommandStreamWriter&&) = delete;
+		CommandStreamWriter& operator=(const CommandStreamWriter&) = delete;
+
+		bool IsCapturing() const;
+		uint64_t GetWrittenBytes() const;
+
+		void AddPipeline(VkPipeline pipeline, const PipelineDesc& desc);
+		// Buffers are added the first time data is written to them, so every buffer a draw uses needs contents first.
+		void WriteBufferData(VkBuffer buffer, VkDeviceSize bufferSize, bool hostVisible, const void* data, VkDeviceSize size,
+		                     VkDeviceSize offset);
+
+		void BeginFrame(uint32_t frameInFlight, VkExtent2D extent, const VkClearColorValue& clearColor);
+		void EndFrame();
+
+		void BindPipeline(VkPipeline pipeline);
+		void SetViewport(const VkViewport& viewport);
+		void SetScissor(const VkRect2D& scissor);
+		void PushConstants(VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data);
+		void BindVertexBuffers(uint32_t firstBinding, uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets);
+		void BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+		void DrawIndexed(const VkDrawIndexedIndirectCommand& draw);
+
+	private: // Private Methods
+		void beginRecord(RecordType type, uint32_t size);
+		void append(const void* data, size_t size);
+		template<typename T>
+		void append(const T& value) { append(&value, sizeof(T)); }
+		void flush();
+		uint32_t getBufferId(VkBuffer buffer) const;
+	};
+
+	// Reads a capture file back, split into the records loaded once and the records of each frame.
+	class CommandStreamReader {
+	public: // Properties
+		struct Record {
+			RecordType type;
+			const char* payload;
+			uint32_t size;
+
+			// The payload struct at offset, copied out as records are not aligned.
+			template<typename T>
+			T Read(size_t offset = 0) const;
+		};
+
+	private: // Member Variables
+		std::unique_ptr<utils::io::MappedFile> file;
+		FileHeader header;
+		std::vector<Record> loadRecords;
+		std::vector<std::vector<Record>> frames; // Without their BeginFrame and EndFrame.
+		std::vector<BeginFrameRecord> frameBegins;
+
+	public: // Public Functions
+		// Throws on files that are not a complete capture.
+		explicit CommandStreamReader(const std::string& fileName);
+
+		CommandStreamReader(const CommandStreamReader&) = delete;
+		CommandStreamReader(CommandStreamReader&&) = delete;
+		CommandStreamReader& operator=(const CommandStreamReader&) = delete;
+
+		uint32_t GetFramesInFlight() const;
+		const std::vector<Record>& GetLoadRecords() const;
+		uint32_t GetFrameCount() const;
+		const BeginFrameRecord& GetFrameBegin(uint32_t frame) const;
+		const std::vector<Record>& GetFrameRecords(uint32_t frame) const;
+
+		static PipelineDesc ReadPipeline(const Record& record, uint32_t& id);
+	};
+
+	template<typename T>
+	T CommandStreamReader::Record::Read(const size_t offset) const {
+		if (offset + sizeof(T) > size) {
+			UTIL_THROW("Capture record of type " + std::to_string(static_cast<uint32_t>(type)) + " is too short!");
+		}
+
+		T value;
+		memcpy(&value, payload + offset, sizeof(T));
+		return value;
+	}
+}
@@ -0,0 +1,698 @@
+﻿#include "Replayer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include "../gpu/Memory.hpp"
+
+namespace replay
+{
+	Replayer::Replayer(const CommandStreamReader& stream) : stream(stream) {
+		if (stream.GetFrameCount() == 0) {
+			UTIL_THROW("The capture holds no complete frame!");
+		}
+
+		createDevice();
+		loadResources();
+		createTarget();
+		createFrameSlots();
+	}
+
+	Replayer::~Replayer() {
+		vkDeviceWaitIdle(device);
+
+		profiler.reset();
+		for (const FrameSlot& slot : slots) {
+			vkDestroyFence(device, slot.fence, nullptr);
+		}
+
+		vkDestroyFramebuffer(device, framebuffer, nullptr);
+		vkDestroyImageView(device, colorView, nullptr);
+		vkDestroyImage(device, colorImage, nullptr);
+		vkFreeMemory(device, colorMemory, nullptr);
+		vkDestroyRenderPass(device, renderPass, nullptr);
+
+		for (gpu::Buffer& buffer : buffers) {
+			if (buffer.buffer != VK_NULL_HANDLE) gpu::destroyBuffer(getGpuContext(), buffer);
+		}
+		for (size_t i = 0; i < pipelines.size(); i++) {
+			vkDestroyPipeline(device, pipelines[i], nullptr);
+			vkDestroyPipelineLayout(device, pipelineLayouts[i], nullptr);
+		}
+		vkDestroyDescriptorPool(device, textureDescriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(device, textureSetLayout, nullptr);
+		texture::destroyPlaceholder(getGpuContext(), placeholder);
+
+		vkDestroyCommandPool(device, commandPool, nullptr);
+		vkDestroyDevice(device, nullptr);
+		vkDestroyInstance(instance, nullptr);
+	}
+
+	std::vector<Replayer::FrameTiming> Replayer::Run(const uint32_t loopCount) {
+		const uint32_t frameCount = stream.GetFrameCount();
+		std::vector<FrameTiming> timings(static_cast<size_t>(loopCount) * frameCount, FrameTiming{0.0, -1.0});
+
+		const auto collectGpuTiming = [&](const FrameSlot& slot) {
+			if (slot.timingIndex < 0) return;
+			for (const gpu::GpuProfiler::ScopeTiming& timing : profiler->GetLatestTimings()) {
+				if (timing.name == "Frame") timings[slot.timingIndex].gpuMilliseconds = timing.milliseconds;
+			}
+		};
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		for (size_t index = 0; index < timings.size(); index++) {
+			const uint32_t frame = static_cast<uint32_t>(index % frameCount);
+			const uint32_t slotIndex = stream.GetFrameBegin(frame).frameInFlight % static_cast<uint32_t>(slots.size());
+			FrameSlot& slot = slots[slotIndex];
+
+			vkWaitForFences(device, 1, &slot.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			vkResetFences(device, 1, &slot.fence);
+
+			const auto start = std::chrono::steady_clock::now();
+
+			vkResetCommandBuffer(slot.commandBuffer, 0);
+			if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS) {
+				UTIL_THROW("Failed to begin recording replay command buffer!");
+			}
+
+			// Reads back the timestamps of the frame this slot ran before.
+			profiler->BeginFrame(slot.commandBuffer, slotIndex);
+			collectGpuTiming(slot);
+
+			profiler->BeginScope(slot.commandBuffer, "Frame");
+			recordFrame(slot.commandBuffer, frame);
+			profiler->EndScope(slot.commandBuffer);
+
+			if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS) {
+				UTIL_THROW("Failed to end recording replay command buffer!");
+			}
+
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &slot.commandBuffer;
+			if (vkQueueSubmit(queue, 1, &submitInfo, slot.fence) != VK_SUCCESS) {
+				UTIL_THROW("Failed to submit replay command buffer!");
+			}
+
+			timings[index].cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			slot.timingIndex = static_cast<int64_t>(index);
+		}
+
+		// The last frame of every slot is only read back when the slot comes around again, which it does not anymore.
+		// Beginning a frame reads them, the command buffer is never submitted.
+		vkDeviceWaitIdle(device);
+		for (uint32_t slotIndex = 0; slotIndex < slots.size(); slotIndex++) {
+			FrameSlot& slot = slots[slotIndex];
+			vkResetCommandBuffer(slot.commandBuffer, 0);
+			vkBeginCommandBuffer(slot.commandBuffer, &beginInfo);
+			profiler->BeginFrame(slot.commandBuffer, slotIndex);
+			collectGpuTiming(slot);
+			vkEndCommandBuffer(slot.commandBuffer);
+			slot.timingIndex = -1;
+		}
+
+		return timings;
+	}
+
+	std::string Replayer::GetDeviceName() const {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		return properties.deviceName;
+	}
+
+	gpu::Context Replayer::getGpuContext() const {
+		return {physicalDevice, device, commandPool, queue};
+	}
+
+	void Replayer::createDevice() {
+		VkApplicationInfo applicationInfo{};
+		applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		applicationInfo.pApplicationName = "Replay";
+		applicationInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+		applicationInfo.pEngineName = "No Engine";
+		applicationInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+		applicationInfo.apiVersion = VK_API_VERSION_1_0;
+
+		// No surface and no validation, nothing but the captured work should cost time.
+		VkInstanceCreateInfo instanceInfo{};
+		instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceInfo.pApplicationInfo = &applicationInfo;
+		if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create Vulkan instance!");
+		}
+
+		uint32_t deviceCount = 0;
+		vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+		std::vector<VkPhysicalDevice> devices(deviceCount);
+		vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+		// The first discrete GPU with a graphics queue, any GPU with one otherwise.
+		int32_t bestScore = -1;
+		for (const VkPhysicalDevice candidate : devices) {
+			uint32_t familyCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+			std::vector<VkQueueFamilyProperties> families(familyCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+
+			const auto graphics = std::find_if(families.begin(), families.end(), [](const VkQueueFamilyProperties& family) {
+				return (family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+			});
+			if (graphics == families.end()) continue;
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(candidate, &properties);
+			const int32_t score = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? 1 : 0;
+			if (score > bestScore) {
+				bestScore = score;
+				physicalDevice = candidate;
+				queueFamily = static_cast<uint32_t>(graphics - families.begin());
+			}
+		}
+
+		if (physicalDevice == VK_NULL_HANDLE) {
+			UTIL_THROW("Failed to find a GPU with a graphics queue!");
+		}
+
+		constexpr float QUEUE_PRIORITY = 1.0f;
+		VkDeviceQueueCreateInfo queueInfo{};
+		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex = queueFamily;
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &QUEUE_PRIORITY;
+
+		VkDeviceCreateInfo deviceInfo{};
+		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.queueCreateInfoCount = 1;
+		deviceInfo.pQueueCreateInfos = &queueInfo;
+		if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create logical device!");
+		}
+		vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		poolInfo.queueFamilyIndex = queueFamily;
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create command pool!");
+		}
+	}
+
+	void Replayer::loadResources() {
+		for (const CommandStreamReader::Record& record : stream.GetLoadRecords()) {
+			switch (record.type) {
+				case RecordType::Pipeline: {
+					uint32_t id;
+					const PipelineDesc desc = CommandStreamReader::ReadPipeline(record, id);
+					createPipeline(id, desc);
+					break;
+				}
+				case RecordType::Buffer: {
+					const BufferRecord bufferRecord = record.Read<BufferRecord>();
+					if (bufferRecord.id >= buffers.size()) buffers.resize(bufferRecord.id + 1);
+
+					// Every usage a draw can bind the buffer with.
+					constexpr VkBufferUsageFlags USAGE =
+						VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+					buffers[bufferRecord.id] = gpu::createBuffer(getGpuContext(), bufferRecord.size, USAGE,
+					                                             bufferRecord.hostVisible
+						                                             ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+						                                             : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+					break;
+				}
+				case RecordType::BufferData: {
+					BufferDataRecord dataRecord;
+					const gpu::Buffer& buffer = readBufferData(record, dataRecord);
+					const char* data = record.payload + sizeof(BufferDataRecord);
+					const VkDeviceSize size = record.size - sizeof(BufferDataRecord);
+
+					if (buffer.mapped != nullptr) {
+						memcpy(static_cast<char*>(buffer.mapped) + dataRecord.offset, data, size);
+					} else {
+						gpu::uploadBuffer(getGpuContext(), buffer, data, size, dataRecord.offset);
+					}
+					break;
+				}
+				default:
+					UTIL_THROW("Capture record of type " + std::to_string(static_cast<uint32_t>(record.type)) +
+						" outside of a frame!");
+			}
+		}
+	}
+
+	void Replayer::createPipeline(const uint32_t id, const PipelineDesc& desc) {
+		// All pipelines draw into the same target, so they have to agree on its format.
+		if (colorFormat == VK_FORMAT_UNDEFINED) {
+			colorFormat = desc.colorFormat;
+
+			VkAttachmentDescription colorAttachment{};
+			colorAttachment.format = colorFormat;
+			colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+			colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			VkAttachmentReference colorAttachmentRef{};
+			colorAttachmentRef.attachment = 0;
+			colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			VkSubpassDescription subpass{};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &colorAttachmentRef;
+
+			// Frames in flight share the target, each waits for the previous one's writes.
+			VkSubpassDependency dependency{};
+			dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+			dependency.dstSubpass = 0;
+			dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+			VkRenderPassCreateInfo renderPassInfo{};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			renderPassInfo.attachmentCount = 1;
+			renderPassInfo.pAttachments = &colorAttachment;
+			renderPassInfo.subpassCount = 1;
+			renderPassInfo.pSubpasses = &subpass;
+			renderPassInfo.dependencyCount = 1;
+			renderPassInfo.pDependencies = &dependency;
+			if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+				UTIL_THROW("Failed to create render pass!");
+			}
+		} else if (desc.colorFormat != colorFormat) {
+			UTIL_THROW("Pipeline " + std::to_string(id) + " renders to a different format than the ones before it!");
+		}
+
+		const auto createShaderModule = [this](const std::vector<char>& code) {
+			VkShaderModuleCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			createInfo.codeSize = code.size();
+			createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+			VkShaderModule shaderModule;
+			if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+				UTIL_THROW("Failed to create captured shader module!");
+			}
+			return shaderModule;
+		};
+
+		const VkShaderModule vertShaderModule = createShaderModule(desc.vertexShader);
+		const VkShaderModule fragShaderModule = createShaderModule(desc.fragmentShader);
+
+		VkPipelineShaderStageCreateInfo shaderStages[2]{};
+		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shaderStages[0].module = vertShaderModule;
+		shaderStages[0].pName = "main";
+		shaderStages[1] = shaderStages[0];
+		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shaderStages[1].module = fragShaderModule;
+
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.bindings.size());
+		vertexInputInfo.pVertexBindingDescriptions = desc.bindings.data();
+		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.attributes.size());
+		vertexInputInfo.pVertexAttributeDescriptions = desc.attributes.data();
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = desc.topology;
+
+		VkPipelineViewportStateCreateInfo viewportState{};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.scissorCount = 1;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer{};
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer.lineWidth = 1.0f;
+		rasterizer.cullMode = desc.cullMode;
+		rasterizer.frontFace = desc.frontFace;
+
+		VkPipelineMultisampleStateCreateInfo multisampling{};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+		VkPipelineColorBlendStateCreateInfo colorBlending{};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.attachmentCount = 1;
+		colorBlending.pAttachments = &colorBlendAttachment;
+
+		const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+		VkPipelineDynamicStateCreateInfo dynamicState{};
+		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicState.dynamicStateCount = 2;
+		dynamicState.pDynamicStates = dynamicStates;
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = desc.pushConstantStages;
+		pushConstantRange.size = desc.pushConstantSize;
+
+		const bool textured = desc.textureStages != 0;
+		if (textured && textureSet == VK_NULL_HANDLE) {
+			createTextureSet();
+		}
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = textured ? 1 : 0;
+		pipelineLayoutInfo.pSetLayouts = &textureSetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = desc.pushConstantSize > 0 ? 1 : 0;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (id >= pipelines.size()) {
+			pipelines.resize(id + 1, VK_NULL_HANDLE);
+			pipelineLayouts.resize(id + 1, VK_NULL_HANDLE);
+			texturedPipelines.resize(id + 1, false);
+		}
+		texturedPipelines[id] = textured;
+
+		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayouts[id]) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create pipeline layout!");
+		}
+
+		VkGraphicsPipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = shaderStages;
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDynamicState = &dynamicState;
+		pipelineInfo.layout = pipelineLayouts[id];
+		pipelineInfo.renderPass = renderPass;
+		pipelineInfo.subpass = 0;
+
+		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipelines[id]) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create captured graphics pipeline " + std::to_string(id) + "!");
+		}
+
+		vkDestroyShaderModule(device, fragShaderModule, nullptr);
+		vkDestroyShaderModule(device, vertShaderModule, nullptr);
+	}
+
+	void Replayer::createTextureSet() {
+		placeholder = texture::createPlaceholder(getGpuContext());
+
+		// Every graphics stage, so one layout fits whichever stages the captured pipelines sample in.
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+
+		if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &textureSetLayout) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create texture descriptor set layout!");
+		}
+
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSize.descriptorCount = 1;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &textureDescriptorPool) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create texture descriptor pool!");
+		}
+
+		VkDescriptorSetAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = textureDescriptorPool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &textureSetLayout;
+
+		if (vkAllocateDescriptorSets(device, &allocateInfo, &textureSet) != VK_SUCCESS) {
+			UTIL_THROW("Failed to allocate texture descriptor set!");
+		}
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.sampler = placeholder.sampler;
+		imageInfo.imageView = placeholder.view;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = textureSet;
+		write.dstBinding = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &imageInfo;
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	}
+
+	void Replayer::createTarget() {
+		if (renderPass == VK_NULL_HANDLE) {
+			UTIL_THROW("The capture holds no pipeline!");
+		}
+
+		VkExtent2D extent = {1, 1};
+		for (uint32_t frame = 0; frame < stream.GetFrameCount(); frame++) {
+			extent.width = std::max(extent.width, stream.GetFrameBegin(frame).extent.width);
+			extent.height = std::max(extent.height, stream.GetFrameBegin(frame).extent.height);
+		}
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = colorFormat;
+		imageInfo.extent = {extent.width, extent.height, 1};
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(device, &imageInfo, nullptr, &colorImage) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create replay target!");
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(device, colorImage, &memoryRequirements);
+
+		VkMemoryAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = memoryRequirements.size;
+		allocateInfo.memoryTypeIndex = gpu::findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits,
+		                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (vkAllocateMemory(device, &allocateInfo, nullptr, &colorMemory) != VK_SUCCESS) {
+			UTIL_THROW("Failed to allocate replay target memory!");
+		}
+		vkBindImageMemory(device, colorImage, colorMemory, 0);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = colorImage;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = colorFormat;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.layerCount = 1;
+		if (vkCreateImageView(device, &viewInfo, nullptr, &colorView) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create replay target view!");
+		}
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &colorView;
+		framebufferInfo.width = extent.width;
+		framebufferInfo.height = extent.height;
+		framebufferInfo.layers = 1;
+		if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create replay framebuffer!");
+		}
+	}
+
+	void Replayer::createFrameSlots() {
+		const uint32_t framesInFlight = std::max(stream.GetFramesInFlight(), 1u);
+		slots.resize(framesInFlight);
+
+		std::vector<VkCommandBuffer> commandBuffers(framesInFlight);
+		VkCommandBufferAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = framesInFlight;
+		if (vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers.data()) != VK_SUCCESS) {
+			UTIL_THROW("Failed to allocate replay command buffers!");
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+		for (uint32_t i = 0; i < framesInFlight; i++) {
+			slots[i].commandBuffer = commandBuffers[i];
+			if (vkCreateFence(device, &fenceInfo, nullptr, &slots[i].fence) != VK_SUCCESS) {
+				UTIL_THROW("Failed to create replay fence!");
+			}
+		}
+
+		profiler = std::make_unique<gpu::GpuProfiler>(physicalDevice, device, queueFamily, framesInFlight);
+		if (!profiler->IsSupported()) {
+			UTIL_WARN("The graphics queue has no timestamps, replay only reports CPU times");
+		}
+	}
+
+	void Replayer::recordFrame(const VkCommandBuffer commandBuffer, const uint32_t frame) {
+		const BeginFrameRecord& begin = stream.GetFrameBegin(frame);
+
+		// Host visible contents come first, the draws of the frame read them.
+		for (const CommandStreamReader::Record& record : stream.GetFrameRecords(frame)) {
+			if (record.type != RecordType::BufferData) continue;
+
+			BufferDataRecord dataRecord;
+			const gpu::Buffer& buffer = readBufferData(record, dataRecord);
+			if (buffer.mapped == nullptr) {
+				UTIL_THROW("Frame " + std::to_string(frame) + " writes to a device local buffer!");
+			}
+			memcpy(static_cast<char*>(buffer.mapped) + dataRecord.offset, record.payload + sizeof(BufferDataRecord),
+			       record.size - sizeof(BufferDataRecord));
+		}
+
+		VkClearValue clearValue{};
+		clearValue.color = begin.clearColor;
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = framebuffer;
+		renderPassInfo.renderArea.extent = begin.extent;
+		renderPassInfo.clearValueCount = 1;
+		renderPassInfo.pClearValues = &clearValue;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+		for (const CommandStreamReader::Record& record : stream.GetFrameRecords(frame)) {
+			switch (record.type) {
+				case RecordType::BufferData:
+					break;
+				case RecordType::BindPipeline: {
+					const uint32_t id = getPipelineId(record);
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[id]);
+					boundLayout = pipelineLayouts[id];
+					if (texturedPipelines[id]) {
+						vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundLayout, 0, 1, &textureSet,
+						                        0, nullptr);
+					}
+					break;
+				}
+				case RecordType::SetViewport: {
+					const VkViewport viewport = record.Read<VkViewport>();
+					vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+					break;
+				}
+				case RecordType::SetScissor: {
+					const VkRect2D scissor = record.Read<VkRect2D>();
+					vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+					break;
+				}
+				case RecordType::PushConstants: {
+					if (boundLayout == VK_NULL_HANDLE) {
+						UTIL_THROW("Frame " + std::to_string(frame) + " pushes constants before binding a pipeline!");
+					}
+					const PushConstantsRecord pushRecord = record.Read<PushConstantsRecord>();
+					vkCmdPushConstants(commandBuffer, boundLayout, pushRecord.stages, pushRecord.offset,
+					                   record.size - sizeof(PushConstantsRecord), record.payload + sizeof(PushConstantsRecord));
+					break;
+				}
+				case RecordType::BindVertexBuffers: {
+					const uint32_t firstBinding = record.Read<uint32_t>();
+					const uint32_t count = record.Read<uint32_t>(sizeof(uint32_t));
+
+					VkBuffer vertexBuffers[16];
+					VkDeviceSize offsets[16];
+					if (count > 16) {
+						UTIL_THROW("Frame " + std::to_string(frame) + " binds more than 16 vertex buffers!");
+					}
+					for (uint32_t i = 0; i < count; i++) {
+						const BufferBinding binding = record.Read<BufferBinding>(2 * sizeof(uint32_t) + i * sizeof(BufferBinding));
+						vertexBuffers[i] = getBuffer(binding.id).buffer;
+						offsets[i] = binding.offset;
+					}
+					vkCmdBindVertexBuffers(commandBuffer, firstBinding, count, vertexBuffers, offsets);
+					break;
+				}
+				case RecordType::BindIndexBuffer: {
+					const BufferBinding binding = record.Read<BufferBinding>();
+					const VkIndexType indexType = record.Read<VkIndexType>(sizeof(BufferBinding));
+					vkCmdBindIndexBuffer(commandBuffer, getBuffer(binding.id).buffer, binding.offset, indexType);
+					break;
+				}
+				case RecordType::DrawIndexed: {
+					if (boundLayout == VK_NULL_HANDLE) {
+						UTIL_THROW("Frame " + std::to_string(frame) + " draws before binding a pipeline!");
+					}
+					const VkDrawIndexedIndirectCommand draw = record.Read<VkDrawIndexedIndirectCommand>();
+					vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset,
+					                 draw.firstInstance);
+					break;
+				}
+				default:
+					UTIL_THROW("Capture record of type " + std::to_string(static_cast<uint32_t>(record.type)) +
+						" inside of a frame!");
+			}
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	const gpu::Buffer& Replayer::getBuffer(const uint32_t id) const {
+		if (id >= buffers.size() || buffers[id].buffer == VK_NULL_HANDLE) {
+			UTIL_THROW("The capture uses buffer " + std::to_string(id) + " without creating it!");
+		}
+		return buffers[id];
+	}
+
+	uint32_t Replayer::getPipelineId(const CommandStreamReader::Record& record) const {
+		const uint32_t id = record.Read<uint32_t>();
+		if (id >= pipelines.size() || pipelines[id] == VK_NULL_HANDLE) {
+			UTIL_THROW("The capture binds pipeline " + std::to_string(id) + " without creating it!");
+		}
+		return id;
+	}
+
+	const gpu::Buffer& Replayer::readBufferData(const CommandStreamReader::Record& record, BufferDataRecord& dataRecord) const {
+		if (record.size < sizeof(BufferDataRecord)) {
+			UTIL_THROW("Capture buffer data record is too short!");
+		}
+		dataRecord = record.Read<BufferDataRecord>();
+
+		const gpu::Buffer& buffer = getBuffer(dataRecord.id);
+		const VkDeviceSize size = record.size - sizeof(BufferDataRecord);
+		if (dataRecord.offset > buffer.size || size > buffer.size - dataRecord.offset) {
+			UTIL_THROW("The capture writes " + std::to_string(size) + " bytes at " + std::to_string(dataRecord.offset) +
+				" into buffer " + std::to_string(dataRecord.id) + " of " + std::to_string(buffer.size) + " bytes!");
+		}
+		return buffer;
+	}
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "CommandStream.hpp"
+#include "../gpu/Buffer.hpp"
+#include "../gpu/GpuProfiler.hpp"
+#include "../texture/Placeholder.hpp"
+
+namespace replay
+{
+	// Plays a capture back without a window or presentation, frame after frame as fast as the GPU takes them, into an
+	// offscreen image of the captured format. Keeps the captured number of frames in flight, so the CPU and GPU overlap
+	// the way they did in the app.
+	class Replayer {
+	public: // Properties
+		struct FrameTiming {
+			double cpuMilliseconds; // Recording and submitting, without waiting for the frame in flight.
+			double gpuMilliseconds; // Negative when the queue has no timestamps.
+		};
+
+	private: // Member Variables
+		struct FrameSlot {
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			int64_t timingIndex = -1; // Of the frame last submitted with it, -1 before the first one.
+		};
+
+		const CommandStreamReader& stream;
+
+		VkInstance instance = VK_NULL_HANDLE;
+		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+		VkDevice device = VK_NULL_HANDLE;
+		uint32_t queueFamily = 0;
+		VkQueue queue = VK_NULL_HANDLE;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+
+		std::vector<VkPipelineLayout> pipelineLayouts; // By capture id.
+		std::vector<VkPipeline> pipelines;
+		std::vector<bool> texturedPipelines; // By capture id, those bind textureSet.
+
+		// Shared by every pipeline that samples a texture, created along with the first of them.
+		texture::Placeholder placeholder;
+		VkDescriptorSetLayout textureSetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool textureDescriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSet textureSet = VK_NULL_HANDLE;
+		std::vector<gpu::Buffer> buffers;
+
+		VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		// Sized for the largest frame, smaller ones render into its corner like dynamic resolution does.
+		VkImage colorImage = VK_NULL_HANDLE;
+		VkDeviceMemory colorMemory = VK_NULL_HANDLE;
+		VkImageView colorView = VK_NULL_HANDLE;
+		VkFramebuffer framebuffer = VK_NULL_HANDLE;
+
+		std::vector<FrameSlot> slots;
+		std::unique_ptr<gpu::GpuProfiler> profiler;
+
+	public: // Public Functions
+		// Creates everything the capture loads up front, stream has to outlive the replayer.
+		explicit Replayer(const CommandStreamReader& stream);
+		~Replayer();
+
+		Replayer(const Replayer&) = delete;
+		Replayer(Replayer&&) = delete;
+		Replayer& operator=(const Replayer&) = delete;
+
+		// Replays every frame loopCount times, one timing per frame replayed.
+		std::vector<FrameTiming> Run(uint32_t loopCount);
+		std::string GetDeviceName() const;
+
+	private: // Private Methods
+		gpu::Context getGpuContext() const;
+		void createDevice();
+		void loadResources();
+		void createPipeline(uint32_t id, const PipelineDesc& desc);
+		void createTextureSet();
+		void createTarget();
+		void createFrameSlots();
+		void recordFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+		// Ids and ranges come from the file, they are checked before anything is indexed or written with them.
+		const gpu::Buffer& getBuffer(uint32_t id) const;
+		uint32_t getPipelineId(const CommandStreamReader::Record& record) const;
+		const gpu::Buffer& readBufferData(const CommandStreamReader::Record& record, BufferDataRecord& dataRecord) const;
+	};
+}
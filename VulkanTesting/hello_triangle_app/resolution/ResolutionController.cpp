@@ -0,0 +1,83 @@
+﻿#include "ResolutionController.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "../../utils/log.hpp"
+
+ResolutionController::ResolutionController(const Settings& settings)
+	: settings(settings), scale(settings.maxScale) {
+	if (settings.targetMilliseconds <= 0.0 || settings.minScale <= 0.0f || settings.minScale > settings.maxScale) {
+		UTIL_THROW("Invalid dynamic resolution settings!");
+	}
+
+	stats.minScale = scale;
+}
+
+float ResolutionController::Update(const double gpuMilliseconds) {
+	stats.frameCount++;
+	stats.overBudgetCount += gpuMilliseconds > settings.targetMilliseconds ? 1 : 0;
+	stats.totalScale += scale;
+	stats.minScale = std::min(stats.minScale, scale);
+
+	if (framesToSkip > 0) {
+		framesToSkip--;
+		return scale;
+	}
+
+	smoothedMilliseconds = sampleCount == 0 ? gpuMilliseconds : smoothedMilliseconds + SMOOTHING * (gpuMilliseconds - smoothedMilliseconds);
+	sampleCount++;
+
+	// A spike over budget is acted on right away, headroom has to show in the average first.
+	const double measured = gpuMilliseconds > settings.targetMilliseconds ? std::max(gpuMilliseconds, smoothedMilliseconds) : smoothedMilliseconds;
+	const bool overBudget = measured > settings.targetMilliseconds;
+	const bool hasHeadroom = measured < settings.targetMilliseconds * settings.headroom;
+	if (!overBudget && (!hasHeadroom || scale >= settings.maxScale)) return scale;
+
+	const float idealScale = scale * static_cast<float>(std::sqrt(settings.targetMilliseconds / std::max(measured, 1e-3)));
+	const float gain = overBudget ? settings.decreaseGain : settings.increaseGain;
+	float nextScale = scale + gain * (idealScale - scale);
+
+	// Rounded away from the current scale, so a step is always taken once the controller decided to move.
+	nextScale = overBudget ? std::floor(nextScale / settings.scaleStep) * settings.scaleStep
+	                       : std::ceil(nextScale / settings.scaleStep) * settings.scaleStep;
+	nextScale = std::clamp(nextScale, settings.minScale, settings.maxScale);
+
+	if (nextScale != scale) {
+		scale = nextScale;
+		sampleCount = 0;
+		framesToSkip = settings.latencyFrames;
+		stats.changeCount++;
+	}
+
+	return scale;
+}
+
+float ResolutionController::GetScale() const {
+	return scale;
+}
+
+VkExtent2D ResolutionController::GetRenderExtent(const VkExtent2D outputExtent) const {
+	return {
+		std::max(1u, static_cast<uint32_t>(std::lround(outputExtent.width * scale))),
+		std::max(1u, static_cast<uint32_t>(std::lround(outputExtent.height * scale)))
+	};
+}
+
+const ResolutionController::Stats& ResolutionController::GetStats() const {
+	return stats;
+}
+
+std::string ResolutionController::ReportStats() {
+	if (stats.frameCount == 0) return "";
+
+	const std::string line = "Dynamic resolution: scale " + std::to_string(stats.totalScale / stats.frameCount) + " on average, " +
+		std::to_string(stats.minScale) + " at least, " + std::to_string(stats.changeCount) + " changes, " +
+		std::to_string(stats.overBudgetCount) + "/" + std::to_string(stats.frameCount) + " frames over " +
+		std::to_string(settings.targetMilliseconds) + " ms";
+
+	stats = {};
+	stats.minScale = scale;
+	return line;
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.h>
+
+// Picks the fraction of the output resolution to render at, so the GPU time of a frame stays within a budget.
+// GPU time is assumed to grow with the pixel count, so the scale follows the square root of budget over measured time.
+// Measurements lag the frames in flight behind, so after every change the controller waits for frames rendered at the
+// new scale instead of reacting to the old ones again. It drops quickly when over budget and climbs back slowly and
+// only with clear headroom, otherwise it oscillates around the edge of the budget.
+class ResolutionController {
+public: // Properties
+	struct Settings {
+		double targetMilliseconds;
+		float minScale = 0.5f;
+		float maxScale = 1.0f;
+		// Scales snap to multiples of this, small corrections would only make the image shimmer.
+		float scaleStep = 1.0f / 32.0f;
+		// Climbs only below this fraction of the budget.
+		double headroom = 0.85;
+		// Fraction of the way to the ideal scale taken per change.
+		float decreaseGain = 0.75f;
+		float increaseGain = 0.25f;
+		// Frames whose measurements still belong to the previous scale, at least the frames in flight.
+		uint32_t latencyFrames = 3;
+	};
+
+	struct Stats {
+		uint32_t frameCount = 0;
+		uint32_t overBudgetCount = 0;
+		uint32_t changeCount = 0;
+		double totalScale = 0.0;
+		float minScale = 1.0f;
+	};
+
+private: // Member Variables
+	// Exponential moving average over frames at the current scale, single frames are too noisy.
+	static constexpr double SMOOTHING = 0.3;
+
+	Settings settings;
+	float scale;
+	double smoothedMilliseconds = 0.0;
+	uint32_t sampleCount = 0;
+	uint32_t framesToSkip = 0;
+
+	Stats stats;
+
+public: // Public Functions
+	explicit ResolutionController(const Settings& settings);
+
+	// Takes the GPU time of the newest completed frame and returns the scale for the frame about to be recorded.
+	float Update(double gpuMilliseconds);
+
+	float GetScale() const;
+	// outputExtent scaled and rounded to whole pixels, never 0.
+	VkExtent2D GetRenderExtent(VkExtent2D outputExtent) const;
+
+	const Stats& GetStats() const;
+	// The stats since the last call as one line, empty without any, and starts over.
+	std::string ReportStats();
+};
@@ -1,2 +0,0 @@
-C:/VulkanSDK/1.3.296.0/Bin/glslc.exe shader.vert -o ../shader.vert
-C:/VulkanSDK/1.3.296.0/Bin/glslc.exe shader.frag -o ../shader.frag
\ No newline at end of file
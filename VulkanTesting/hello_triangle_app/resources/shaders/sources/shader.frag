@@ -1,9 +1,13 @@
 #version 450
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUV;
+
+// Whatever levels of the streamed texture are resident, plain white until its first upload.
+layout(set = 0, binding = 0) uniform sampler2D baseColor;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    outColor = vec4(fragColor * texture(baseColor, fragUV).rgb, 1.0);
 }
\ No newline at end of file
@@ -1,20 +1,43 @@
 #version 450
 
-vec2 positions[3] = vec2[](
-vec2(0.0,-0.5),
-vec2(0.5,0.5),
-vec2(-0.5,0.5)
-);
-
-vec3 colors[3] = vec3[](
-vec3(1.0, 0.0, 0.0),
-vec3(0.0, 1.0, 0.0),
-vec3(0.0, 0.0, 1.0)
-);
+// Matches mesh::QuantizedVertex, the fetch unit expands the half and 16 bit normalized formats to floats.
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal; // Octahedral.
+layout(location = 2) in vec2 inUV;
+
+// Matches the rows of Scene::Instance, advanced once per instance.
+layout(location = 3) in vec4 inModelRow0;
+layout(location = 4) in vec4 inModelRow1;
+layout(location = 5) in vec4 inModelRow2;
+
+layout(push_constant) uniform Camera {
+    mat4 viewProjection;
+};
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV;
+
+// Same as mesh::decodeOctahedral().
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+    return normalize(normal);
+}
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0,1.0);
-    fragColor = colors[gl_VertexIndex];
+    vec4 position = vec4(inPosition.xyz, 1.0);
+    vec3 worldPosition = vec3(dot(inModelRow0, position), dot(inModelRow1, position), dot(inModelRow2, position));
+    gl_Position = viewProjection * vec4(worldPosition, 1.0);
+
+    // Ignores non uniform scale, which would need the inverse transpose.
+    vec3 normal = decodeOctahedral(inNormal);
+    vec3 worldNormal = normalize(vec3(dot(inModelRow0.xyz, normal), dot(inModelRow1.xyz, normal), dot(inModelRow2.xyz, normal)));
+
+    // Lit from the viewer, so geometry facing the screen keeps its plain color.
+    float diffuse = max(dot(worldNormal, vec3(0.0, 0.0, -1.0)), 0.0);
+    // triangle.obj lays its texture coordinates out so this gives its corners red, green and blue, tinting the texture.
+    fragColor = vec3(inUV, 1.0 - inUV.x - inUV.y) * (0.25 + 0.75 * diffuse);
+    fragUV = inUV;
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace scene
+{
+	// Rotation times scale with the translation in the last column, without going through full matrix products.
+	inline glm::mat4 composeTransform(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+		const float xx = rotation.x * rotation.x;
+		const float yy = rotation.y * rotation.y;
+		const float zz = rotation.z * rotation.z;
+		const float xy = rotation.x * rotation.y;
+		const float xz = rotation.x * rotation.z;
+		const float yz = rotation.y * rotation.z;
+		const float wx = rotation.w * rotation.x;
+		const float wy = rotation.w * rotation.y;
+		const float wz = rotation.w * rotation.z;
+
+		glm::mat4 matrix;
+		matrix[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f) * scale.x;
+		matrix[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f) * scale.y;
+		matrix[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f) * scale.z;
+		matrix[3] = glm::vec4(position, 1.0f);
+		return matrix;
+	}
+
+	// Both are affine, so the bottom rows never need multiplying.
+	inline glm::mat4 multiplyAffine(const glm::mat4& parent, const glm::mat4& local) {
+		glm::mat4 result;
+		for (int column = 0; column < 4; column++) {
+			result[column] = parent[0] * local[column].x + parent[1] * local[column].y + parent[2] * local[column].z;
+		}
+		result[3] += parent[3];
+		return result;
+	}
+}
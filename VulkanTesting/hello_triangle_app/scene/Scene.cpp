@@ -0,0 +1,234 @@
+﻿#include "Scene.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "AffineTransform.hpp"
+#include "../../utils/log.hpp"
+
+namespace
+{
+	template<typename T>
+	void moveElements(std::vector<T>& values, const std::vector<uint32_t>& newIndices, const size_t newCount) {
+		std::vector<T> moved(newCount);
+		for (size_t i = 0; i < values.size(); i++) {
+			if (newIndices[i] != UINT32_MAX) moved[newIndices[i]] = values[i];
+		}
+		values.swap(moved);
+	}
+}
+
+Scene::Handle Scene::CreateNode(const Transform& transform, const Handle parent, const uint32_t mesh,
+                                const glm::vec4& localBounds) {
+	const bool isRoot = parent.slot == UINT32_MAX;
+	const uint32_t parentNode = isRoot ? NO_NODE : getNode(parent);
+	const uint32_t depth = isRoot ? 0 : depths[parentNode] + 1;
+
+	const uint32_t node = static_cast<uint32_t>(positions.size());
+	if (!depths.empty() && depth < depths.back()) isSorted = false;
+
+	Handle handle;
+	if (freeSlots.empty()) {
+		handle.slot = static_cast<uint32_t>(nodes.size());
+		nodes.push_back(node);
+		generations.push_back(0);
+	} else {
+		handle.slot = freeSlots.back();
+		freeSlots.pop_back();
+		nodes[handle.slot] = node;
+	}
+	handle.generation = generations[handle.slot];
+
+	positions.push_back(transform.position);
+	rotations.push_back(transform.rotation);
+	scales.push_back(transform.scale);
+	this->localBounds.push_back(localBounds);
+	meshes.push_back(mesh);
+	parents.push_back(parentNode);
+	depths.push_back(depth);
+	worldMatrices.push_back(glm::mat4(1.0f));
+	worldBounds.push_back(glm::vec4(0.0f));
+	slots.push_back(handle.slot);
+
+	if (isSorted) {
+		if (levelStarts.size() < depth + 2) levelStarts.resize(depth + 2, node);
+		levelStarts[depth + 1] = node + 1;
+	}
+
+	return handle;
+}
+
+void Scene::DestroyNode(const Handle handle) {
+	const uint32_t destroyed = getNode(handle);
+
+	// Descendants always come after their parent, one forward pass finds the whole subtree.
+	newIndices.resize(positions.size());
+	uint32_t kept = 0;
+	for (uint32_t node = 0; node < positions.size(); node++) {
+		const bool isDestroyed = node == destroyed ||
+		                         (node > destroyed && parents[node] != NO_NODE && newIndices[parents[node]] == NO_NODE);
+		newIndices[node] = isDestroyed ? NO_NODE : kept++;
+	}
+
+	reorder(kept);
+}
+
+bool Scene::IsAlive(const Handle handle) const {
+	return handle.slot < nodes.size() && generations[handle.slot] == handle.generation && nodes[handle.slot] != NO_NODE;
+}
+
+void Scene::SetTransform(const Handle handle, const Transform& transform) {
+	const uint32_t node = getNode(handle);
+	positions[node] = transform.position;
+	rotations[node] = transform.rotation;
+	scales[node] = transform.scale;
+}
+
+void Scene::SetPosition(const Handle handle, const glm::vec3& position) {
+	positions[getNode(handle)] = position;
+}
+
+void Scene::SetRotation(const Handle handle, const glm::quat& rotation) {
+	rotations[getNode(handle)] = rotation;
+}
+
+Scene::Transform Scene::GetTransform(const Handle handle) const {
+	const uint32_t node = getNode(handle);
+	return {positions[node], rotations[node], scales[node]};
+}
+
+const glm::mat4& Scene::GetWorldMatrix(const Handle handle) const {
+	return worldMatrices[getNode(handle)];
+}
+
+void Scene::UpdateTransforms(Instance* instances, utils::JobSystem& jobSystem) {
+	if (!isSorted) sortByDepth();
+
+	// Every depth reads the world matrices the one before it wrote, so only nodes of the same depth run in parallel.
+	for (size_t level = 0; level + 1 < levelStarts.size(); level++) {
+		const uint32_t begin = levelStarts[level];
+		const uint32_t count = levelStarts[level + 1] - begin;
+		jobSystem.ParallelFor(count, NODES_PER_JOB, [this, begin, instances](const uint32_t first, const uint32_t last) {
+			updateRange(begin + first, begin + last, instances);
+		});
+	}
+}
+
+size_t Scene::GetNodeCount() const {
+	return positions.size();
+}
+
+uint32_t Scene::GetDepthCount() const {
+	return depths.empty() ? 0 : *std::max_element(depths.begin(), depths.end()) + 1;
+}
+
+uint32_t Scene::GetInstanceIndex(const Handle handle) {
+	if (!isSorted) sortByDepth();
+	return getNode(handle);
+}
+
+const std::vector<uint32_t>& Scene::GetMeshes() {
+	if (!isSorted) sortByDepth();
+	return meshes;
+}
+
+const std::vector<glm::mat4>& Scene::GetWorldMatrices() const {
+	return worldMatrices;
+}
+
+const std::vector<glm::vec4>& Scene::GetWorldBounds() const {
+	return worldBounds;
+}
+
+uint32_t Scene::getNode(const Handle handle) const {
+	if (!IsAlive(handle)) {
+		UTIL_THROW("Scene node " + std::to_string(handle.slot) + " generation " + std::to_string(handle.generation) +
+			" does not exist anymore");
+	}
+	return nodes[handle.slot];
+}
+
+void Scene::sortByDepth() {
+	// Counting sort, stable so parents stay before their children within a depth as well.
+	std::vector<uint32_t> depthOffsets(GetDepthCount() + 1, 0);
+	for (const uint32_t depth : depths) {
+		depthOffsets[depth + 1]++;
+	}
+	for (size_t depth = 1; depth < depthOffsets.size(); depth++) {
+		depthOffsets[depth] += depthOffsets[depth - 1];
+	}
+
+	newIndices.resize(positions.size());
+	for (uint32_t node = 0; node < positions.size(); node++) {
+		newIndices[node] = depthOffsets[depths[node]]++;
+	}
+
+	isSorted = true;
+	reorder(positions.size());
+}
+
+void Scene::rebuildLevels() {
+	levelStarts.assign(GetDepthCount() + 1, 0);
+	for (const uint32_t depth : depths) {
+		levelStarts[depth + 1]++;
+	}
+	for (size_t level = 1; level < levelStarts.size(); level++) {
+		levelStarts[level] += levelStarts[level - 1];
+	}
+}
+
+void Scene::reorder(const size_t newCount) {
+	for (uint32_t node = 0; node < positions.size(); node++) {
+		if (newIndices[node] != NO_NODE) continue;
+		nodes[slots[node]] = NO_NODE;
+		generations[slots[node]]++;
+		freeSlots.push_back(slots[node]);
+	}
+
+	for (uint32_t& parent : parents) {
+		if (parent != NO_NODE) parent = newIndices[parent];
+	}
+
+	moveElements(positions, newIndices, newCount);
+	moveElements(rotations, newIndices, newCount);
+	moveElements(scales, newIndices, newCount);
+	moveElements(localBounds, newIndices, newCount);
+	moveElements(meshes, newIndices, newCount);
+	moveElements(parents, newIndices, newCount);
+	moveElements(depths, newIndices, newCount);
+	moveElements(worldMatrices, newIndices, newCount);
+	moveElements(worldBounds, newIndices, newCount);
+	moveElements(slots, newIndices, newCount);
+
+	for (uint32_t node = 0; node < newCount; node++) {
+		nodes[slots[node]] = node;
+	}
+
+	if (isSorted) rebuildLevels();
+}
+
+void Scene::updateRange(const uint32_t begin, const uint32_t end, Instance* instances) {
+	for (uint32_t node = begin; node < end; node++) {
+		const glm::mat4 local = scene::composeTransform(positions[node], rotations[node], scales[node]);
+		const glm::mat4 world = parents[node] == NO_NODE ? local : scene::multiplyAffine(worldMatrices[parents[node]], local);
+		worldMatrices[node] = world;
+
+		const glm::vec4& bounds = localBounds[node];
+		const float maxScale = std::sqrt(std::max({
+			glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+			glm::dot(glm::vec3(world[1]), glm::vec3(world[1])),
+			glm::dot(glm::vec3(world[2]), glm::vec3(world[2])),
+		}));
+
+		const glm::vec4 sphere(glm::vec3(world * glm::vec4(glm::vec3(bounds), 1.0f)), bounds.w * maxScale);
+		worldBounds[node] = sphere;
+
+		// Written whole and in order, instances usually lives in write combined memory.
+		Instance& instance = instances[node];
+		instance.modelRow0 = glm::vec4(world[0].x, world[1].x, world[2].x, world[3].x);
+		instance.modelRow1 = glm::vec4(world[0].y, world[1].y, world[2].y, world[3].y);
+		instance.modelRow2 = glm::vec4(world[0].z, world[1].z, world[2].z, world[3].z);
+		instance.boundingSphere = sphere;
+	}
+}
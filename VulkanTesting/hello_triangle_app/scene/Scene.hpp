@@ -0,0 +1,127 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../mesh/VertexLayout.hpp"
+#include "../../utils/JobSystem.hpp"
+
+// Names a scene node, outside of Scene so it can be a default argument of its member functions.
+struct SceneHandle {
+	uint32_t slot = UINT32_MAX;
+	uint32_t generation = 0;
+};
+
+// Transform hierarchy stored as structure of arrays. Nodes are kept sorted by depth, so every parent comes before its
+// children and each depth is one contiguous range: propagating world matrices is a linear pass per depth that splits
+// across threads without any locking, and writes straight into the caller's (mapped) instance array.
+// Handles stay valid while nodes move around in the arrays, and become invalid once their node is destroyed.
+class Scene {
+public: // Properties
+	using Handle = SceneHandle;
+
+	struct Transform {
+		glm::vec3 position = glm::vec3(0.0f);
+		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		glm::vec3 scale = glm::vec3(1.0f);
+	};
+
+	// Per node output of UpdateTransforms(). The rows are the top three of the world matrix, read as per instance
+	// vertex attributes, the world space bounding sphere is read by culling.
+	struct Instance {
+		glm::vec4 modelRow0;
+		glm::vec4 modelRow1;
+		glm::vec4 modelRow2;
+		glm::vec4 boundingSphere;
+	};
+
+	static constexpr uint32_t NO_MESH = UINT32_MAX;
+	// Smaller ranges are not worth a job of their own.
+	static constexpr uint32_t NODES_PER_JOB = 4096;
+
+private: // Member Variables
+	static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+	// Indexed by node, in depth order.
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::vec4> localBounds;
+	std::vector<uint32_t> meshes;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> depths;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<glm::vec4> worldBounds;
+	std::vector<uint32_t> slots;
+
+	// Indexed by handle slot.
+	std::vector<uint32_t> nodes;
+	std::vector<uint32_t> generations;
+	std::vector<uint32_t> freeSlots;
+
+	// Nodes of depth d are levelStarts[d] up to levelStarts[d + 1].
+	std::vector<uint32_t> levelStarts;
+	// Creating a node shallower than the last one breaks the depth order, restored before it is needed. Parents come
+	// before their children either way, as nodes are only ever appended and reordering keeps that.
+	bool isSorted = true;
+
+	// Where reorder() moves each node, NO_NODE for dropped ones.
+	std::vector<uint32_t> newIndices;
+
+public: // Public Functions
+	Scene() = default;
+
+	Scene(const Scene&) = delete;
+	Scene(Scene&&) = delete;
+	Scene& operator=(const Scene&) = delete;
+
+	// Roots pass a default handle as parent. Nodes without a mesh only carry transforms for their children.
+	Handle CreateNode(const Transform& transform, Handle parent = {}, uint32_t mesh = NO_MESH,
+	                  const glm::vec4& localBounds = glm::vec4(0.0f));
+	// Destroys the whole subtree below the node as well.
+	void DestroyNode(Handle handle);
+	bool IsAlive(Handle handle) const;
+
+	void SetTransform(Handle handle, const Transform& transform);
+	void SetPosition(Handle handle, const glm::vec3& position);
+	void SetRotation(Handle handle, const glm::quat& rotation);
+	Transform GetTransform(Handle handle) const;
+	// As of the last UpdateTransforms().
+	const glm::mat4& GetWorldMatrix(Handle handle) const;
+
+	// Restores the depth order if needed, then writes one Instance per node into instances, which has to hold
+	// GetNodeCount() of them. Depths with more than NODES_PER_JOB nodes are split into jobs on jobSystem.
+	void UpdateTransforms(Instance* instances, utils::JobSystem& jobSystem = utils::JobSystem::GetShared());
+
+	size_t GetNodeCount() const;
+	uint32_t GetDepthCount() const;
+	// Node indices are instance indices in the UpdateTransforms() output. They change whenever nodes are created or
+	// destroyed, so draw lists built from them have to be rebuilt then as well.
+	uint32_t GetInstanceIndex(Handle handle);
+	// Indexed by instance, NO_MESH for nodes that draw nothing.
+	const std::vector<uint32_t>& GetMeshes();
+	const std::vector<glm::mat4>& GetWorldMatrices() const;
+	// Copies of the Instance bounding spheres, for CPU culling without reading back from mapped memory.
+	const std::vector<glm::vec4>& GetWorldBounds() const;
+
+private: // Private Methods
+	uint32_t getNode(Handle handle) const;
+	void sortByDepth();
+	void rebuildLevels();
+	// Moves every node to newIndices[node] and drops the ones mapped to NO_NODE, their handles become invalid.
+	void reorder(size_t newCount);
+	void updateRange(uint32_t begin, uint32_t end, Instance* instances);
+};
+
+template<>
+struct mesh::VertexFields<Scene::Instance> {
+	static constexpr std::array FIELDS = {
+		VERTEX_FIELD(Scene::Instance, modelRow0),
+		VERTEX_FIELD(Scene::Instance, modelRow1),
+		VERTEX_FIELD(Scene::Instance, modelRow2),
+	};
+};
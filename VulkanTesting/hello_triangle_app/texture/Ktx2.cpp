@@ -0,0 +1,171 @@
+﻿#include "Ktx2.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../../utils/log.hpp"
+
+namespace texture
+{
+	namespace
+	{
+		constexpr uint8_t IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+		// Everything after the identifier up to the level index, little endian like the file.
+		struct Header {
+			uint32_t vkFormat;
+			uint32_t typeSize;
+			uint32_t pixelWidth;
+			uint32_t pixelHeight;
+			uint32_t pixelDepth;
+			uint32_t layerCount;
+			uint32_t faceCount;
+			uint32_t levelCount;
+			uint32_t supercompressionScheme;
+			uint32_t dfdByteOffset;
+			uint32_t dfdByteLength;
+			uint32_t kvdByteOffset;
+			uint32_t kvdByteLength;
+			// Unaligned 64 bit fields, split so the struct matches the 68 bytes in the file.
+			uint32_t sgdByteOffset[2];
+			uint32_t sgdByteLength[2];
+		};
+		static_assert(sizeof(Header) == 68);
+
+		struct LevelIndex {
+			uint64_t byteOffset;
+			uint64_t byteLength;
+			uint64_t uncompressedByteLength;
+		};
+
+		// Consecutive color formats sharing a block, in the order of VkFormat.
+		struct FormatRange {
+			VkFormat first;
+			VkFormat last;
+			Ktx2Block block;
+		};
+
+		constexpr FormatRange FORMAT_RANGES[] = {
+			{VK_FORMAT_R4G4_UNORM_PACK8, VK_FORMAT_R4G4_UNORM_PACK8, {1, 1, 1}},
+			{VK_FORMAT_R4G4B4A4_UNORM_PACK16, VK_FORMAT_A1R5G5B5_UNORM_PACK16, {2, 1, 1}},
+			{VK_FORMAT_R8_UNORM, VK_FORMAT_R8_SRGB, {1, 1, 1}},
+			{VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8_SRGB, {2, 1, 1}},
+			{VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_B8G8R8_SRGB, {3, 1, 1}},
+			{VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_A2B10G10R10_SINT_PACK32, {4, 1, 1}},
+			{VK_FORMAT_R16_UNORM, VK_FORMAT_R16_SFLOAT, {2, 1, 1}},
+			{VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16_SFLOAT, {4, 1, 1}},
+			{VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_R16G16B16_SFLOAT, {6, 1, 1}},
+			{VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16B16A16_SFLOAT, {8, 1, 1}},
+			{VK_FORMAT_R32_UINT, VK_FORMAT_R32_SFLOAT, {4, 1, 1}},
+			{VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32_SFLOAT, {8, 1, 1}},
+			{VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32_SFLOAT, {12, 1, 1}},
+			{VK_FORMAT_R32G32B32A32_UINT, VK_FORMAT_R32G32B32A32_SFLOAT, {16, 1, 1}},
+			{VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, {4, 1, 1}},
+			{VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK, {8, 4, 4}},
+			{VK_FORMAT_BC2_UNORM_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK, {16, 4, 4}},
+			{VK_FORMAT_BC4_UNORM_BLOCK, VK_FORMAT_BC4_SNORM_BLOCK, {8, 4, 4}},
+			{VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK, {16, 4, 4}},
+			{VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK, {8, 4, 4}},
+			{VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, {16, 4, 4}},
+			{VK_FORMAT_EAC_R11_UNORM_BLOCK, VK_FORMAT_EAC_R11_SNORM_BLOCK, {8, 4, 4}},
+			{VK_FORMAT_EAC_R11G11_UNORM_BLOCK, VK_FORMAT_EAC_R11G11_SNORM_BLOCK, {16, 4, 4}},
+			{VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_SRGB_BLOCK, {16, 4, 4}},
+			{VK_FORMAT_ASTC_5x4_UNORM_BLOCK, VK_FORMAT_ASTC_5x4_SRGB_BLOCK, {16, 5, 4}},
+			{VK_FORMAT_ASTC_5x5_UNORM_BLOCK, VK_FORMAT_ASTC_5x5_SRGB_BLOCK, {16, 5, 5}},
+			{VK_FORMAT_ASTC_6x5_UNORM_BLOCK, VK_FORMAT_ASTC_6x5_SRGB_BLOCK, {16, 6, 5}},
+			{VK_FORMAT_ASTC_6x6_UNORM_BLOCK, VK_FORMAT_ASTC_6x6_SRGB_BLOCK, {16, 6, 6}},
+			{VK_FORMAT_ASTC_8x5_UNORM_BLOCK, VK_FORMAT_ASTC_8x5_SRGB_BLOCK, {16, 8, 5}},
+			{VK_FORMAT_ASTC_8x6_UNORM_BLOCK, VK_FORMAT_ASTC_8x6_SRGB_BLOCK, {16, 8, 6}},
+			{VK_FORMAT_ASTC_8x8_UNORM_BLOCK, VK_FORMAT_ASTC_8x8_SRGB_BLOCK, {16, 8, 8}},
+			{VK_FORMAT_ASTC_10x5_UNORM_BLOCK, VK_FORMAT_ASTC_10x5_SRGB_BLOCK, {16, 10, 5}},
+			{VK_FORMAT_ASTC_10x6_UNORM_BLOCK, VK_FORMAT_ASTC_10x6_SRGB_BLOCK, {16, 10, 6}},
+			{VK_FORMAT_ASTC_10x8_UNORM_BLOCK, VK_FORMAT_ASTC_10x8_SRGB_BLOCK, {16, 10, 8}},
+			{VK_FORMAT_ASTC_10x10_UNORM_BLOCK, VK_FORMAT_ASTC_10x10_SRGB_BLOCK, {16, 10, 10}},
+			{VK_FORMAT_ASTC_12x10_UNORM_BLOCK, VK_FORMAT_ASTC_12x10_SRGB_BLOCK, {16, 12, 10}},
+			{VK_FORMAT_ASTC_12x12_UNORM_BLOCK, VK_FORMAT_ASTC_12x12_SRGB_BLOCK, {16, 12, 12}},
+		};
+
+		// Depth, stencil, 64 bit and multi-planar formats are left out, nothing samples them as a color texture.
+		const Ktx2Block* findBlock(const VkFormat format) {
+			for (const FormatRange& range : FORMAT_RANGES) {
+				if (format >= range.first && format <= range.last) return &range.block;
+			}
+			return nullptr;
+		}
+
+		uint64_t levelByteLength(const Ktx2Block& block, const uint32_t width, const uint32_t height, const uint32_t level) {
+			const uint64_t columns = (std::max(width >> level, 1u) + block.width - 1) / block.width;
+			const uint64_t rows = (std::max(height >> level, 1u) + block.height - 1) / block.height;
+			return columns * rows * block.byteSize;
+		}
+	}
+
+	Ktx2File parseKtx2(const std::string_view data, const std::string& name) {
+		if (data.size() < sizeof(IDENTIFIER) + sizeof(Header) || std::memcmp(data.data(), IDENTIFIER, sizeof(IDENTIFIER)) != 0) {
+			UTIL_THROW(name + " is not a KTX2 file");
+		}
+
+		Header header;
+		std::memcpy(&header, data.data() + sizeof(IDENTIFIER), sizeof(Header));
+
+		if (header.vkFormat == VK_FORMAT_UNDEFINED) {
+			UTIL_THROW(name + ": formats only described by the data format descriptor are not supported");
+		}
+		const Ktx2Block* block = findBlock(static_cast<VkFormat>(header.vkFormat));
+		if (block == nullptr) {
+			UTIL_THROW(name + ": format " + std::to_string(header.vkFormat) + " is not supported");
+		}
+		if (header.supercompressionScheme != 0) {
+			UTIL_THROW(name + ": supercompression scheme " + std::to_string(header.supercompressionScheme) + " is not supported");
+		}
+		if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1) {
+			UTIL_THROW(name + ": only single layer 2D textures are supported");
+		}
+
+		// A level count of 0 asks for the mips to be generated, only the base level is stored.
+		const uint32_t storedCount = std::max(header.levelCount, 1u);
+		if (storedCount > fullMipCount(header.pixelWidth, header.pixelHeight)) {
+			UTIL_THROW(name + " has more levels than its size allows");
+		}
+
+		const size_t indexOffset = sizeof(IDENTIFIER) + sizeof(Header);
+		if (data.size() < indexOffset + storedCount * sizeof(LevelIndex)) {
+			UTIL_THROW(name + ": level index is truncated");
+		}
+
+		Ktx2File file{};
+		file.format = static_cast<VkFormat>(header.vkFormat);
+		file.block = *block;
+		file.width = header.pixelWidth;
+		file.height = header.pixelHeight;
+		file.levels.resize(storedCount);
+
+		for (uint32_t level = 0; level < storedCount; level++) {
+			LevelIndex index;
+			std::memcpy(&index, data.data() + indexOffset + level * sizeof(LevelIndex), sizeof(LevelIndex));
+
+			if (index.byteLength == 0 || index.byteOffset > data.size() || index.byteLength > data.size() - index.byteOffset) {
+				UTIL_THROW(name + ": level " + std::to_string(level) + " lies outside the file");
+			}
+			// The copy reads exactly this much, whatever the index says.
+			const uint64_t expectedLength = levelByteLength(*block, file.width, file.height, level);
+			if (index.byteLength != expectedLength) {
+				UTIL_THROW(name + ": level " + std::to_string(level) + " holds " + std::to_string(index.byteLength) +
+				           " bytes instead of " + std::to_string(expectedLength));
+			}
+			file.levels[level] = {index.byteOffset, index.byteLength};
+		}
+
+		return file;
+	}
+
+	uint32_t fullMipCount(uint32_t width, uint32_t height) {
+		uint32_t count = 1;
+		while (width > 1 || height > 1) {
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+			count++;
+		}
+		return count;
+	}
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace texture
+{
+	// Where one mip level's data sits in the file. Level i is (width >> i) x (height >> i), at least 1 x 1.
+	struct Ktx2Level {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+	};
+
+	// The smallest unit of a format's data, a single texel for uncompressed formats.
+	struct Ktx2Block {
+		uint32_t byteSize;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	// Only what streaming a 2D texture needs. The level data is not copied, it stays in the file's memory.
+	struct Ktx2File {
+		VkFormat format;
+		Ktx2Block block;
+		uint32_t width;
+		uint32_t height;
+		// Finest first. May stop before 1 x 1, the coarser levels are then generated from the last one.
+		std::vector<Ktx2Level> levels;
+	};
+
+	// Throws for anything but a single layer 2D texture with a color format, and for levels that reach past the end of
+	// the data or do not hold exactly what their extent needs. Basis Universal and Zstandard supercompression are not
+	// supported.
+	Ktx2File parseKtx2(std::string_view data, const std::string& name);
+
+	uint32_t fullMipCount(uint32_t width, uint32_t height);
+}
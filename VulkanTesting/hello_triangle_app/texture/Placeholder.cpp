@@ -0,0 +1,104 @@
+﻿#include "Placeholder.hpp"
+
+#include "../gpu/Memory.hpp"
+#include "../../utils/log.hpp"
+
+namespace texture
+{
+	Placeholder createPlaceholder(const gpu::Context& context) {
+		Placeholder placeholder{};
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+		imageInfo.extent = {1, 1, 1};
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(context.device, &imageInfo, context.allocator, &placeholder.image) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create placeholder texture image!");
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(context.device, placeholder.image, &requirements);
+
+		VkMemoryAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = requirements.size;
+		allocateInfo.memoryTypeIndex = gpu::findMemoryType(context.physicalDevice, requirements.memoryTypeBits,
+		                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		if (vkAllocateMemory(context.device, &allocateInfo, context.allocator, &placeholder.memory) != VK_SUCCESS) {
+			UTIL_THROW("Failed to allocate placeholder texture memory!");
+		}
+		vkBindImageMemory(context.device, placeholder.image, placeholder.memory, 0);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = placeholder.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = imageInfo.format;
+		viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+		if (vkCreateImageView(context.device, &viewInfo, context.allocator, &placeholder.view) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create placeholder texture image view!");
+		}
+
+		// A single texel, filtering makes no difference.
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+		if (vkCreateSampler(context.device, &samplerInfo, context.allocator, &placeholder.sampler) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create placeholder texture sampler!");
+		}
+
+		const VkCommandBuffer commandBuffer = gpu::beginOneTimeCommands(context);
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = placeholder.image;
+		barrier.subresourceRange = viewInfo.subresourceRange;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+		                     0, nullptr, 1, &barrier);
+
+		const VkClearColorValue white = {{1.0f, 1.0f, 1.0f, 1.0f}};
+		vkCmdClearColorImage(commandBuffer, placeholder.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1,
+		                     &viewInfo.subresourceRange);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+		                     0, nullptr, 1, &barrier);
+
+		gpu::endOneTimeCommands(context, commandBuffer);
+		return placeholder;
+	}
+
+	void destroyPlaceholder(const gpu::Context& context, Placeholder& placeholder) {
+		vkDestroySampler(context.device, placeholder.sampler, context.allocator);
+		vkDestroyImageView(context.device, placeholder.view, context.allocator);
+		vkDestroyImage(context.device, placeholder.image, context.allocator);
+		vkFreeMemory(context.device, placeholder.memory, context.allocator);
+		placeholder = {};
+	}
+}
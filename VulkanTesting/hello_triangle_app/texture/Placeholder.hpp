@@ -0,0 +1,21 @@
+﻿#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "../gpu/Context.hpp"
+
+namespace texture
+{
+	// A 1x1 opaque white image and a sampler for it, for descriptors that have to point at something while their texture
+	// is not uploaded yet or there is none. Sampling it leaves what it is multiplied with unchanged.
+	struct Placeholder {
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkSampler sampler = VK_NULL_HANDLE;
+	};
+
+	// Cleared through one time commands, in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL once this returns.
+	Placeholder createPlaceholder(const gpu::Context& context);
+	void destroyPlaceholder(const gpu::Context& context, Placeholder& placeholder);
+}
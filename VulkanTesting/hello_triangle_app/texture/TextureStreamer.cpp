@@ -0,0 +1,517 @@
+﻿#include "TextureStreamer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+
+#include "../gpu/Memory.hpp"
+#include "../../utils/log.hpp"
+
+namespace
+{
+	VkExtent3D levelExtent(const texture::Ktx2File& file, const uint32_t level) {
+		return {std::max(file.width >> level, 1u), std::max(file.height >> level, 1u), 1};
+	}
+
+	void imageBarrier(const VkCommandBuffer commandBuffer, const VkImage image, const uint32_t baseLevel,
+	                  const uint32_t levelCount, const VkImageLayout oldLayout, const VkImageLayout newLayout,
+	                  const VkPipelineStageFlags srcStage, const VkAccessFlags srcAccess, const VkPipelineStageFlags dstStage,
+	                  const VkAccessFlags dstAccess) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1};
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	// Made readable for whatever samples the texture in the frames submitted after.
+	void makeReadable(const VkCommandBuffer commandBuffer, const VkImage image, const uint32_t baseLevel,
+	                  const uint32_t levelCount, const VkImageLayout oldLayout, const VkAccessFlags srcAccess) {
+		imageBarrier(commandBuffer, image, baseLevel, levelCount, oldLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		             VK_PIPELINE_STAGE_TRANSFER_BIT, srcAccess, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+
+	std::string toKib(const VkDeviceSize bytes) {
+		return std::to_string((bytes + 1023) / 1024) + " KiB";
+	}
+}
+
+TextureStreamer::TextureStreamer(const gpu::Context& context, const Settings& settings)
+	: context(context), settings(settings), batches(settings.framesInFlight) {
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(context.device, &samplerInfo, context.allocator, &sampler) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create texture sampler!");
+	}
+
+	VkCommandBufferAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = context.commandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	for (Batch& batch : batches) {
+		batch.staging = gpu::createBuffer(context, settings.uploadBudget, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		if (vkAllocateCommandBuffers(context.device, &allocateInfo, &batch.commandBuffer) != VK_SUCCESS) {
+			UTIL_THROW("Failed to allocate texture streaming command buffer!");
+		}
+
+		if (vkCreateFence(context.device, &fenceInfo, context.allocator, &batch.fence) != VK_SUCCESS) {
+			UTIL_THROW("Failed to create texture streaming fence!");
+		}
+	}
+}
+
+TextureStreamer::~TextureStreamer() {
+	for (Batch& batch : batches) {
+		if (batch.submitted) {
+			vkWaitForFences(context.device, 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			finishBatch(batch);
+		}
+
+		vkDestroyFence(context.device, batch.fence, context.allocator);
+		vkFreeCommandBuffers(context.device, context.commandPool, 1, &batch.commandBuffer);
+		gpu::destroyBuffer(context, batch.staging);
+	}
+
+	for (Texture& texture : textures) {
+		destroyImage(texture.resident);
+	}
+
+	vkDestroySampler(context.device, sampler, context.allocator);
+}
+
+TextureStreamer::TextureId TextureStreamer::Load(const std::string& fileName) {
+	if (textures.empty()) {
+		firstLoad = std::chrono::steady_clock::now();
+	}
+
+	Texture texture{};
+	texture.name = std::filesystem::path(fileName).filename().string();
+	texture.file = std::make_unique<utils::io::MappedFile>(fileName);
+	texture.ktx2 = texture::parseKtx2(texture.file->GetView(), texture.name);
+
+	const uint32_t storedCount = static_cast<uint32_t>(texture.ktx2.levels.size());
+	const uint32_t fullCount = texture::fullMipCount(texture.ktx2.width, texture.ktx2.height);
+	texture.mipCount = storedCount;
+	if (storedCount < fullCount) {
+		if (canGenerateMips(texture.ktx2.format)) {
+			texture.mipCount = fullCount;
+		} else {
+			UTIL_WARN(texture.name + ": format " + std::to_string(texture.ktx2.format) + " can not be blitted, only its " +
+				std::to_string(storedCount) + " stored levels are used");
+		}
+	}
+
+	texture.tailLevel = texture.mipCount - 1;
+	for (uint32_t level = 0; level < texture.mipCount; level++) {
+		const VkExtent3D extent = levelExtent(texture.ktx2, level);
+		if (std::max(extent.width, extent.height) <= settings.minResidentSize) {
+			texture.tailLevel = level;
+			break;
+		}
+	}
+	texture.residentLevel = texture.mipCount;
+
+	textures.push_back(std::move(texture));
+	stats.textureCount++;
+	return static_cast<TextureId>(textures.size() - 1);
+}
+
+void TextureStreamer::Update(const uint64_t frameNumber) {
+	for (Batch& batch : batches) {
+		if (batch.submitted && vkGetFenceStatus(context.device, batch.fence) == VK_SUCCESS) {
+			finishBatch(batch);
+		}
+	}
+
+	// Its staging buffer is still being read from.
+	if (batches[currentBatch].submitted) return;
+
+	// Textures with nothing resident first, then the more recently used, the coarser first among equals.
+	streamOrder.clear();
+	for (TextureId id = 0; id < textures.size(); id++) {
+		if (textures[id].residentLevel > 0) streamOrder.push_back(id);
+	}
+	std::sort(streamOrder.begin(), streamOrder.end(), [&](const TextureId a, const TextureId b) {
+		const Texture& first = textures[a];
+		const Texture& second = textures[b];
+		const bool firstEmpty = first.residentLevel == first.mipCount;
+		const bool secondEmpty = second.residentLevel == second.mipCount;
+		if (firstEmpty != secondEmpty) return firstEmpty;
+		if (first.lastUsedFrame != second.lastUsedFrame) return first.lastUsedFrame > second.lastUsedFrame;
+		return first.residentLevel > second.residentLevel;
+	});
+
+	VkDeviceSize budgetLeft = settings.uploadBudget;
+	for (const TextureId id : streamOrder) {
+		// Possibly evicted from for another one already.
+		if (!textures[id].changed) {
+			streamLevel(id, budgetLeft, frameNumber);
+		}
+	}
+
+	if (recording) submitBatch();
+
+	for (Texture& texture : textures) {
+		texture.changed = false;
+	}
+}
+
+void TextureStreamer::MarkUsed(const TextureId texture, const uint64_t frameNumber) {
+	textures[texture].lastUsedFrame = frameNumber;
+}
+
+VkImageView TextureStreamer::GetImageView(const TextureId texture) const {
+	return textures[texture].resident.view;
+}
+
+VkSampler TextureStreamer::GetSampler() const {
+	return sampler;
+}
+
+const TextureStreamer::Stats& TextureStreamer::GetStats() const {
+	return stats;
+}
+
+std::string TextureStreamer::ReportStats() {
+	if (stats.uploadedBytes == lastReportedUploadedBytes) return "";
+	lastReportedUploadedBytes = stats.uploadedBytes;
+
+	std::string line = "Textures: " + std::to_string(stats.usableCount) + " of " + std::to_string(stats.textureCount) +
+		" usable, " + std::to_string(stats.completeCount) + " complete, " + toKib(stats.residentBytes) + " resident (peak " +
+		toKib(stats.peakBytes) + ") of " + toKib(settings.residencyBudget) + ", " + toKib(stats.uploadedBytes) +
+		" uploaded, " + std::to_string(stats.evictedLevels) + " levels evicted";
+	if (stats.firstTextureMilliseconds >= 0.0) {
+		line += ", first texture after " + std::to_string(stats.firstTextureMilliseconds) + " ms";
+	}
+	if (stats.allCompleteMilliseconds >= 0.0) {
+		line += ", all complete after " + std::to_string(stats.allCompleteMilliseconds) + " ms";
+	}
+
+	return line;
+}
+
+bool TextureStreamer::canGenerateMips(const VkFormat format) const {
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(context.physicalDevice, format, &properties);
+
+	constexpr VkFormatFeatureFlags REQUIRED = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+		VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (properties.optimalTilingFeatures & REQUIRED) == REQUIRED;
+}
+
+TextureStreamer::Image TextureStreamer::createImage(const Texture& texture, const uint32_t finestLevel) {
+	Image image{};
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = texture.ktx2.format;
+	imageInfo.extent = levelExtent(texture.ktx2, finestLevel);
+	imageInfo.mipLevels = texture.mipCount - finestLevel;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(context.device, &imageInfo, context.allocator, &image.image) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create image for texture " + texture.name);
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(context.device, image.image, &requirements);
+
+	VkMemoryAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = requirements.size;
+	allocateInfo.memoryTypeIndex = gpu::findMemoryType(context.physicalDevice, requirements.memoryTypeBits,
+	                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(context.device, &allocateInfo, context.allocator, &image.memory) != VK_SUCCESS) {
+		UTIL_THROW("Failed to allocate memory for texture " + texture.name);
+	}
+	if (vkBindImageMemory(context.device, image.image, image.memory, 0) != VK_SUCCESS) {
+		UTIL_THROW("Failed to bind memory for texture " + texture.name);
+	}
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = texture.ktx2.format;
+	viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, imageInfo.mipLevels, 0, 1};
+
+	if (vkCreateImageView(context.device, &viewInfo, context.allocator, &image.view) != VK_SUCCESS) {
+		UTIL_THROW("Failed to create image view for texture " + texture.name);
+	}
+
+	image.size = requirements.size;
+	liveBytes += image.size;
+	stats.peakBytes = std::max(stats.peakBytes, liveBytes);
+	return image;
+}
+
+void TextureStreamer::destroyImage(Image& image) {
+	if (image.image == VK_NULL_HANDLE) return;
+
+	vkDestroyImageView(context.device, image.view, context.allocator);
+	vkDestroyImage(context.device, image.image, context.allocator);
+	vkFreeMemory(context.device, image.memory, context.allocator);
+	liveBytes -= image.size;
+	image = {};
+}
+
+void TextureStreamer::beginBatch() {
+	Batch& batch = batches[currentBatch];
+
+	vkResetFences(context.device, 1, &batch.fence);
+	vkResetCommandBuffer(batch.commandBuffer, 0);
+	batch.stagingUsed = 0;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+		UTIL_THROW("Failed to begin recording texture streaming command buffer!");
+	}
+
+	recording = true;
+}
+
+void TextureStreamer::submitBatch() {
+	Batch& batch = batches[currentBatch];
+
+	if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+		UTIL_THROW("Failed to end recording texture streaming command buffer!");
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+	if (vkQueueSubmit(context.queue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+		UTIL_THROW("Failed to submit texture streaming command buffer!");
+	}
+
+	batch.submitted = true;
+	recording = false;
+	currentBatch = (currentBatch + 1) % static_cast<uint32_t>(batches.size());
+}
+
+void TextureStreamer::finishBatch(Batch& batch) {
+	// The fence also covers every submission before the batch, no frame samples the replaced images anymore.
+	for (Image& image : batch.retired) {
+		destroyImage(image);
+	}
+	batch.retired.clear();
+
+	for (gpu::Buffer& buffer : batch.largeStaging) {
+		gpu::destroyBuffer(context, buffer);
+	}
+	batch.largeStaging.clear();
+
+	const double milliseconds =
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - firstLoad).count();
+	if (!batch.firstUploads.empty() && stats.firstTextureMilliseconds < 0.0) {
+		stats.firstTextureMilliseconds = milliseconds;
+	}
+	stats.usableCount += static_cast<uint32_t>(batch.firstUploads.size());
+	batch.firstUploads.clear();
+	batch.submitted = false;
+
+	stats.completeCount = static_cast<uint32_t>(std::count_if(textures.begin(), textures.end(), [](const Texture& texture) {
+		return texture.residentLevel == 0;
+	}));
+	const bool idle = std::none_of(batches.begin(), batches.end(), [](const Batch& other) { return other.submitted; });
+	if (idle && stats.completeCount == textures.size() && stats.allCompleteMilliseconds < 0.0) {
+		stats.allCompleteMilliseconds = milliseconds;
+	}
+}
+
+bool TextureStreamer::streamLevel(const TextureId id, VkDeviceSize& budgetLeft, const uint64_t frameNumber) {
+	Texture& texture = textures[id];
+	const bool firstUpload = texture.residentLevel == texture.mipCount;
+	const uint32_t level = firstUpload ? static_cast<uint32_t>(texture.ktx2.levels.size()) - 1 : texture.residentLevel - 1;
+	const texture::Ktx2Level& source = texture.ktx2.levels[level];
+
+	// A level larger than the whole budget still goes, alone, or it would never arrive.
+	if (source.byteLength > budgetLeft && budgetLeft < settings.uploadBudget) return false;
+
+	// Known when the level did not fit before, saves creating an image only to find that out again.
+	if (texture.nextImageSize != 0 && !makeRoom(texture.nextImageSize - texture.resident.size, id, frameNumber)) {
+		return false;
+	}
+
+	Image image = createImage(texture, level);
+	if (!makeRoom(image.size - texture.resident.size, id, frameNumber)) {
+		texture.nextImageSize = image.size;
+		destroyImage(image);
+		return false;
+	}
+
+	replaceImage(texture, image, level);
+	const VkCommandBuffer commandBuffer = batches[currentBatch].commandBuffer;
+
+	VkBuffer stagingBuffer;
+	VkBufferImageCopy region{};
+	region.bufferOffset = stage(texture.file->GetData() + source.byteOffset, source.byteLength,
+	                            texture.ktx2.block.byteSize, stagingBuffer);
+	region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	region.imageExtent = levelExtent(texture.ktx2, level);
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	const uint32_t levelCount = texture.mipCount - level;
+	if (firstUpload && levelCount > 1) {
+		// The levels below the coarsest stored one, each blitted from the level before.
+		for (uint32_t target = 1; target < levelCount; target++) {
+			imageBarrier(commandBuffer, image.image, target - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+			const VkExtent3D sourceExtent = levelExtent(texture.ktx2, level + target - 1);
+			const VkExtent3D targetExtent = levelExtent(texture.ktx2, level + target);
+
+			VkImageBlit blit{};
+			blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, target - 1, 0, 1};
+			blit.srcOffsets[1] = {static_cast<int32_t>(sourceExtent.width), static_cast<int32_t>(sourceExtent.height), 1};
+			blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, target, 0, 1};
+			blit.dstOffsets[1] = {static_cast<int32_t>(targetExtent.width), static_cast<int32_t>(targetExtent.height), 1};
+
+			vkCmdBlitImage(commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image,
+			               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+		}
+
+		makeReadable(commandBuffer, image.image, 0, levelCount - 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		             VK_ACCESS_TRANSFER_READ_BIT);
+		makeReadable(commandBuffer, image.image, levelCount - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		             VK_ACCESS_TRANSFER_WRITE_BIT);
+	} else {
+		makeReadable(commandBuffer, image.image, 0, levelCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		             VK_ACCESS_TRANSFER_WRITE_BIT);
+	}
+
+	if (firstUpload) {
+		batches[currentBatch].firstUploads.push_back(id);
+	}
+	stats.uploadedBytes += source.byteLength;
+	budgetLeft -= std::min(budgetLeft, source.byteLength);
+	return true;
+}
+
+bool TextureStreamer::makeRoom(const VkDeviceSize bytes, const TextureId id, const uint64_t frameNumber) {
+	const uint64_t lastUsedFrame = textures[id].lastUsedFrame;
+
+	while (stats.residentBytes + bytes > settings.residencyBudget) {
+		// Only textures used less recently than the one asking, and not for a while, or two would take turns.
+		Texture* victim = nullptr;
+		for (Texture& candidate : textures) {
+			if (candidate.changed || candidate.residentLevel >= candidate.tailLevel) continue;
+			if (candidate.lastUsedFrame >= lastUsedFrame || candidate.lastUsedFrame + settings.evictionAge > frameNumber) continue;
+
+			if (victim == nullptr || candidate.lastUsedFrame < victim->lastUsedFrame) {
+				victim = &candidate;
+			}
+		}
+
+		if (victim == nullptr) return false;
+		evictLevel(*victim);
+	}
+
+	return true;
+}
+
+void TextureStreamer::evictLevel(Texture& texture) {
+	const uint32_t finestLevel = texture.residentLevel + 1;
+	Image image = createImage(texture, finestLevel);
+	replaceImage(texture, image, finestLevel);
+
+	makeReadable(batches[currentBatch].commandBuffer, image.image, 0, texture.mipCount - finestLevel,
+	             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+	stats.evictedLevels++;
+}
+
+void TextureStreamer::replaceImage(Texture& texture, Image& image, const uint32_t finestLevel) {
+	if (!recording) beginBatch();
+	Batch& batch = batches[currentBatch];
+
+	imageBarrier(batch.commandBuffer, image.image, 0, texture.mipCount - finestLevel, VK_IMAGE_LAYOUT_UNDEFINED,
+	             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	             VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	if (texture.resident.image != VK_NULL_HANDLE) {
+		// Frames submitted earlier may still sample the old image, the transition waits for them.
+		imageBarrier(batch.commandBuffer, texture.resident.image, 0, texture.mipCount - texture.residentLevel,
+		             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+		std::vector<VkImageCopy> regions;
+		for (uint32_t level = std::max(finestLevel, texture.residentLevel); level < texture.mipCount; level++) {
+			VkImageCopy region{};
+			region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - texture.residentLevel, 0, 1};
+			region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - finestLevel, 0, 1};
+			region.extent = levelExtent(texture.ktx2, level);
+			regions.push_back(region);
+		}
+
+		vkCmdCopyImage(batch.commandBuffer, texture.resident.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image,
+		               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+		stats.residentBytes -= texture.resident.size;
+		batch.retired.push_back(texture.resident);
+	}
+
+	stats.residentBytes += image.size;
+	texture.resident = image;
+	texture.residentLevel = finestLevel;
+	texture.nextImageSize = 0;
+	texture.changed = true;
+}
+
+VkDeviceSize TextureStreamer::stage(const void* data, const VkDeviceSize size, const uint32_t blockSize,
+                                    VkBuffer& buffer) {
+	Batch& batch = batches[currentBatch];
+
+	// Copies need a multiple of the texel block size, 3, 6, 12 and 24 byte texels included. 16 keeps the memcpy aligned.
+	const VkDeviceSize alignment = std::lcm(VkDeviceSize{16}, VkDeviceSize{blockSize});
+	const VkDeviceSize offset = (batch.stagingUsed + alignment - 1) / alignment * alignment;
+	if (offset + size <= batch.staging.size) {
+		std::memcpy(static_cast<char*>(batch.staging.mapped) + offset, data, size);
+		batch.stagingUsed = offset + size;
+		buffer = batch.staging.buffer;
+		return offset;
+	}
+
+	gpu::Buffer& staging = batch.largeStaging.emplace_back(
+		gpu::createBuffer(context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+	std::memcpy(staging.mapped, data, size);
+	buffer = staging.buffer;
+	return 0;
+}
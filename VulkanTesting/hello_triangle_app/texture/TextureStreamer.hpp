@@ -0,0 +1,140 @@
+﻿#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Ktx2.hpp"
+#include "../gpu/Buffer.hpp"
+#include "../gpu/Context.hpp"
+#include "../../utils/MappedFile.hpp"
+
+// Streams KTX2 textures in from their coarsest level to their finest, a little every frame. The first upload of a
+// texture is its coarsest stored level, with the levels below it generated by vkCmdBlitImage, so it can be sampled right
+// away. Finer levels follow one at a time within the upload budget. When the images would outgrow the residency budget,
+// the finest levels of textures used less recently are evicted again.
+// An image can not give back part of its memory, so every change copies the resident levels into a new image.
+// The copies are submitted to the context's queue by Update(), ahead of the frame that follows.
+class TextureStreamer {
+public: // Properties
+	using TextureId = uint32_t;
+
+	struct Settings {
+		VkDeviceSize uploadBudget = 4 * 1024 * 1024; // Bytes per Update(), one level larger than this goes on its own.
+		VkDeviceSize residencyBudget = 64 * 1024 * 1024; // Device memory of all texture images together.
+		uint64_t evictionAge = 120; // Frames after MarkUsed() before a texture can lose levels.
+		// Levels no larger than this are never evicted, so a texture stays usable once it was.
+		uint32_t minResidentSize = 64;
+		uint32_t framesInFlight = 2;
+	};
+
+	struct Stats {
+		uint32_t textureCount = 0;
+		uint32_t usableCount = 0;
+		uint32_t completeCount = 0; // With every level resident.
+		VkDeviceSize residentBytes = 0;
+		VkDeviceSize peakBytes = 0; // Including replaced images that were not destroyed yet.
+		VkDeviceSize uploadedBytes = 0;
+		uint32_t evictedLevels = 0;
+		// From the first Load() until the first upload of a texture finished on the GPU, and until every texture was
+		// complete. Negative until then.
+		double firstTextureMilliseconds = -1.0;
+		double allCompleteMilliseconds = -1.0;
+	};
+
+private: // Member Variables
+	struct Image {
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+	};
+
+	struct Texture {
+		std::string name;
+		std::unique_ptr<utils::io::MappedFile> file;
+		texture::Ktx2File ktx2;
+		uint32_t mipCount; // The stored levels plus those generated from the last of them.
+		uint32_t tailLevel; // The first level no larger than minResidentSize, never evicted.
+
+		Image resident; // Holds levels residentLevel to mipCount - 1.
+		uint32_t residentLevel; // mipCount while nothing is resident.
+		VkDeviceSize nextImageSize = 0; // Of the image with one more level, once known.
+		uint64_t lastUsedFrame = 0;
+		bool changed = false; // By the batch being recorded, which changes each texture at most once.
+	};
+
+	struct Batch {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		gpu::Buffer staging;
+		VkDeviceSize stagingUsed = 0;
+		std::vector<gpu::Buffer> largeStaging; // For single levels larger than the upload budget.
+		std::vector<Image> retired; // Replaced images, destroyed once the batch is done.
+		std::vector<TextureId> firstUploads;
+		bool submitted = false;
+	};
+
+	gpu::Context context;
+	Settings settings;
+	VkSampler sampler;
+
+	std::vector<Texture> textures;
+	std::vector<TextureId> streamOrder;
+	std::vector<Batch> batches;
+	uint32_t currentBatch = 0;
+	bool recording = false;
+
+	VkDeviceSize liveBytes = 0;
+	Stats stats;
+	VkDeviceSize lastReportedUploadedBytes = 0;
+	std::chrono::steady_clock::time_point firstLoad;
+
+public: // Public Functions
+	TextureStreamer(const gpu::Context& context, const Settings& settings);
+	// Waits for the uploads still in flight.
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer(TextureStreamer&&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Maps the file and reads its header, nothing is uploaded before the next Update().
+	TextureId Load(const std::string& fileName);
+	// Once per frame, after waiting on the frame in flight. Never waits on the GPU, with every batch still in flight it
+	// only picks up those that finished.
+	void Update(uint64_t frameNumber);
+	// Textures used more recently stream first and lose their levels last.
+	void MarkUsed(TextureId texture, uint64_t frameNumber);
+
+	// VK_NULL_HANDLE until the first upload was submitted, in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL after. Changes
+	// whenever levels arrive or are evicted, descriptors have to be written after Update() every frame.
+	VkImageView GetImageView(TextureId texture) const;
+	// A view only ever covers resident levels, so sampling clamps to the finest one there is.
+	VkSampler GetSampler() const;
+	const Stats& GetStats() const;
+	// One line, empty unless something was uploaded since the last call.
+	std::string ReportStats();
+
+private: // Private Methods
+	bool canGenerateMips(VkFormat format) const;
+	Image createImage(const Texture& texture, uint32_t finestLevel);
+	void destroyImage(Image& image);
+
+	void beginBatch();
+	void submitBatch();
+	void finishBatch(Batch& batch);
+
+	// Returns false when the level does not fit the budgets this frame.
+	bool streamLevel(TextureId id, VkDeviceSize& budgetLeft, uint64_t frameNumber);
+	// Evicts levels of textures used less recently than the given one until bytes more fit the residency budget.
+	bool makeRoom(VkDeviceSize bytes, TextureId id, uint64_t frameNumber);
+	void evictLevel(Texture& texture);
+	// Copies the levels both images hold and retires the texture's resident image in favour of the new one.
+	void replaceImage(Texture& texture, Image& image, uint32_t finestLevel);
+	// Returns the offset of the data in buffer, a multiple of blockSize.
+	VkDeviceSize stage(const void* data, VkDeviceSize size, uint32_t blockSize, VkBuffer& buffer);
+};
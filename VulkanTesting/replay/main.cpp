@@ -0,0 +1,72 @@
+﻿#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "../hello_triangle_app/replay/Replayer.hpp"
+
+// Replay <capture> [loops]
+// Plays a command stream capture back headless as fast as possible, then prints the CPU and GPU time of every frame
+// and a summary, so two builds can be compared on the same workload.
+
+namespace
+{
+	struct Summary {
+		double mean = 0.0;
+		double median = 0.0;
+		double p95 = 0.0;
+		double max = 0.0;
+	};
+
+	Summary summarize(std::vector<double> values) {
+		Summary summary;
+		if (values.empty()) return summary;
+
+		std::sort(values.begin(), values.end());
+		for (const double value : values) summary.mean += value;
+		summary.mean /= static_cast<double>(values.size());
+		summary.median = values[values.size() / 2];
+		summary.p95 = values[std::min(values.size() - 1, values.size() * 95 / 100)];
+		summary.max = values.back();
+		return summary;
+	}
+
+	void printSummary(const char* name, const Summary& summary) {
+		std::printf("%6s %10.3f %10.3f %10.3f %10.3f\n", name, summary.mean, summary.median, summary.p95, summary.max);
+	}
+}
+
+int main(const int argc, char** argv) {
+	if (argc < 2) {
+		std::printf("Usage: Replay <capture> [loops]\n");
+		return 1;
+	}
+
+	try {
+		const uint32_t loopCount = argc > 2 ? static_cast<uint32_t>(std::max(1, std::stoi(argv[2]))) : 1;
+
+		const replay::CommandStreamReader stream(argv[1]);
+		replay::Replayer replayer(stream);
+		const std::vector<replay::Replayer::FrameTiming> timings = replayer.Run(loopCount);
+
+		std::vector<double> cpuMilliseconds;
+		std::vector<double> gpuMilliseconds;
+		std::printf("%8s %10s %10s\n", "frame", "cpu ms", "gpu ms");
+		for (size_t frame = 0; frame < timings.size(); frame++) {
+			std::printf("%8zu %10.3f %10.3f\n", frame, timings[frame].cpuMilliseconds, timings[frame].gpuMilliseconds);
+			cpuMilliseconds.push_back(timings[frame].cpuMilliseconds);
+			if (timings[frame].gpuMilliseconds >= 0.0) gpuMilliseconds.push_back(timings[frame].gpuMilliseconds);
+		}
+
+		std::printf("\n%s, %u captured frames x %u loops\n", replayer.GetDeviceName().c_str(), stream.GetFrameCount(), loopCount);
+		std::printf("%6s %10s %10s %10s %10s\n", "", "mean", "median", "p95", "max");
+		printSummary("cpu", summarize(cpuMilliseconds));
+		if (!gpuMilliseconds.empty()) printSummary("gpu", summarize(gpuMilliseconds));
+	} catch (const std::exception& exception) {
+		std::fprintf(stderr, "%s\n", exception.what());
+		return 1;
+	}
+
+	return 0;
+}
@@ -9,6 +9,8 @@
 namespace utils::io
 {
 	inline static std::string path = std::string(BINARY_DIR) + "/resources/"; 
+	// Compiled by the build from resources/shaders/sources, never copied from the resources.
+	inline static std::string shaderPath = std::string(BINARY_DIR) + "/shaders/";
 	
 	inline std::vector<char> readToBytes(const std::string& fileName) {
 		std::ifstream file(fileName, std::ios::ate | std::ios::binary);
@@ -0,0 +1,248 @@
+﻿#include "JobSystem.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace utils
+{
+	namespace
+	{
+		// Which system and deque the current thread works for, if any.
+		thread_local JobSystem* currentSystem = nullptr;
+		thread_local uint32_t currentWorker = 0;
+		thread_local uint32_t stealSeed = 0x9e3779b9u;
+
+		// Jobs come back to the free list of whichever thread ran them, the cap keeps one thread from hoarding them.
+		struct JobFreeList {
+			static constexpr size_t MAX_JOBS = 4096;
+			std::vector<Job*> jobs;
+
+			~JobFreeList() {
+				for (const Job* job : jobs) {
+					delete job;
+				}
+			}
+		};
+
+		thread_local JobFreeList freeList;
+
+		// Xorshift, cheap enough to pick a new victim on every steal attempt.
+		uint32_t nextRandom() {
+			stealSeed ^= stealSeed << 13;
+			stealSeed ^= stealSeed >> 17;
+			stealSeed ^= stealSeed << 5;
+			return stealSeed;
+		}
+	}
+
+	bool JobCounter::IsDone() const {
+		return pending.load(std::memory_order_acquire) == 0;
+	}
+
+	JobSystem::JobSystem(uint32_t threadCount, const bool pinThreads) {
+		const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		if (threadCount == 0) threadCount = hardwareThreads;
+		this->threadCount = threadCount;
+
+		for (uint32_t worker = 0; worker + 1 < threadCount; worker++) {
+			workers.push_back(std::make_unique<Worker>());
+		}
+
+		// All deques exist before any worker starts stealing from them.
+		for (uint32_t worker = 0; worker < workers.size(); worker++) {
+			threads.emplace_back(&JobSystem::workerLoop, this, worker);
+			if (pinThreads) pinThread(threads.back(), (worker + 1) % hardwareThreads);
+		}
+	}
+
+	JobSystem::~JobSystem() {
+		{
+			std::lock_guard lock(sleepMutex);
+			isStopping.store(true);
+		}
+		wakeUp.notify_all();
+
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+
+		for (const Job* job : injectedJobs) {
+			delete job;
+		}
+	}
+
+	JobSystem& JobSystem::GetShared() {
+		static JobSystem shared;
+		return shared;
+	}
+
+	void JobSystem::Wait(JobCounter& counter) {
+		while (!counter.IsDone()) {
+			if (Job* job = findJob()) {
+				execute(job);
+			} else {
+				std::this_thread::yield();
+			}
+		}
+
+		// The last job may still hold the lock it dropped the counter to zero under, the counter must outlive that.
+		std::lock_guard lock(counter.mutex);
+		if (counter.exception) std::rethrow_exception(std::exchange(counter.exception, nullptr));
+	}
+
+	uint32_t JobSystem::GetThreadCount() const {
+		return threadCount;
+	}
+
+	Job* JobSystem::allocateJob() {
+		if (freeList.jobs.empty()) return new Job();
+
+		Job* job = freeList.jobs.back();
+		freeList.jobs.pop_back();
+		return job;
+	}
+
+	void JobSystem::releaseJob(Job* job) {
+		if (freeList.jobs.size() >= JobFreeList::MAX_JOBS) {
+			delete job;
+			return;
+		}
+		freeList.jobs.push_back(job);
+	}
+
+	void JobSystem::schedule(Job* job) {
+		if (currentSystem == this) {
+			workers[currentWorker]->deque.Push(job);
+		} else {
+			std::lock_guard lock(injectedMutex);
+			injectedJobs.push_back(job);
+		}
+
+		// Sequentially consistent with the sleeping side, either it sees the job or this sees it sleeping.
+		queuedJobs.fetch_add(1);
+		if (sleepingWorkers.load() > 0) {
+			std::lock_guard lock(sleepMutex);
+			wakeUp.notify_one();
+		}
+	}
+
+	void JobSystem::finish(Job* job) {
+		JobCounter* counter = job->counter;
+		releaseJob(job);
+		if (counter == nullptr) return;
+
+		// Only the last job takes the lock, everything before it just counts down.
+		uint32_t pending = counter->pending.load(std::memory_order_relaxed);
+		while (pending > 1) {
+			if (counter->pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel)) return;
+		}
+
+		std::vector<Job*> continuations;
+		{
+			std::lock_guard lock(counter->mutex);
+			if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) continuations.swap(counter->continuations);
+		}
+
+		for (Job* continuation : continuations) {
+			schedule(continuation);
+		}
+	}
+
+	Job* JobSystem::findJob() {
+		Job* job = nullptr;
+
+		if (currentSystem == this && workers[currentWorker]->deque.Pop(job)) {
+			queuedJobs.fetch_sub(1);
+			return job;
+		}
+
+		if (queuedJobs.load(std::memory_order_relaxed) <= 0) return nullptr;
+
+		{
+			std::lock_guard lock(injectedMutex);
+			if (!injectedJobs.empty()) {
+				job = injectedJobs.front();
+				injectedJobs.pop_front();
+				queuedJobs.fetch_sub(1);
+				return job;
+			}
+		}
+
+		const uint32_t workerCount = static_cast<uint32_t>(workers.size());
+		const uint32_t firstVictim = workerCount > 0 ? nextRandom() % workerCount : 0;
+		for (uint32_t i = 0; i < workerCount; i++) {
+			const uint32_t victim = (firstVictim + i) % workerCount;
+			if (currentSystem == this && victim == currentWorker) continue;
+
+			if (workers[victim]->deque.Steal(job)) {
+				queuedJobs.fetch_sub(1);
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void JobSystem::execute(Job* job) {
+		try {
+			job->invoke(*job);
+		} catch (...) {
+			// Without a counter nobody could ever see it, same as an exception escaping a std::thread.
+			if (job->counter == nullptr) std::terminate();
+
+			std::lock_guard lock(job->counter->mutex);
+			if (!job->counter->exception) job->counter->exception = std::current_exception();
+		}
+
+		job->destroy(*job);
+		finish(job);
+	}
+
+	void JobSystem::workerLoop(const uint32_t workerIndex) {
+		constexpr uint32_t SPIN_ATTEMPTS = 64;
+
+		currentSystem = this;
+		currentWorker = workerIndex;
+		stealSeed = 0x9e3779b9u * (workerIndex + 1);
+
+		uint32_t failedAttempts = 0;
+		while (!isStopping.load(std::memory_order_relaxed)) {
+			if (Job* job = findJob()) {
+				execute(job);
+				failedAttempts = 0;
+				continue;
+			}
+
+			// Jobs often come in bursts, a short spin avoids the cost of sleeping and waking between them.
+			if (++failedAttempts < SPIN_ATTEMPTS) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock lock(sleepMutex);
+			sleepingWorkers.fetch_add(1);
+			wakeUp.wait(lock, [this] { return queuedJobs.load() > 0 || isStopping.load(); });
+			sleepingWorkers.fetch_sub(1);
+			failedAttempts = 0;
+		}
+
+		currentSystem = nullptr;
+	}
+
+	void JobSystem::pinThread(std::thread& thread, const uint32_t core) {
+#ifdef _WIN32
+		SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#else
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(core, &cpuSet);
+		pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet);
+#endif
+	}
+}
@@ -0,0 +1,197 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "WorkStealingDeque.hpp"
+
+namespace utils
+{
+	class JobSystem;
+
+	// A callable with its storage inline, recycled through per thread free lists so scheduling does not allocate.
+	struct Job {
+		static constexpr size_t STORAGE_SIZE = 48;
+
+		void (*invoke)(Job& job) = nullptr;
+		void (*destroy)(Job& job) = nullptr;
+		class JobCounter* counter = nullptr;
+		alignas(std::max_align_t) unsigned char storage[STORAGE_SIZE];
+	};
+
+	// Counts the unfinished jobs started with it. Jobs can be held back until a counter drops to zero, and any thread
+	// can wait for it while helping with other jobs. Reusable once it reached zero.
+	class JobCounter {
+	public: // Properties
+
+	private: // Member Variables
+		friend class JobSystem;
+
+		std::atomic<uint32_t> pending = 0;
+		std::mutex mutex;
+		std::vector<Job*> continuations; // Scheduled once pending drops to zero.
+		std::exception_ptr exception; // The first one a job of this counter threw, rethrown by JobSystem::Wait().
+
+	public: // Public Functions
+		JobCounter() = default;
+
+		JobCounter(const JobCounter&) = delete;
+		JobCounter(JobCounter&&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool IsDone() const;
+	};
+
+	// Work stealing scheduler. Every worker owns a Chase-Lev deque: jobs it spawns go to the bottom and are taken back
+	// newest first while they are still in cache, idle workers steal the oldest, and usually largest, job from the top of
+	// someone else's. Threads that are not workers submit through a shared queue, and help run jobs while they wait.
+	class JobSystem {
+	public: // Properties
+
+	private: // Member Variables
+		struct Worker {
+			WorkStealingDeque<Job*> deque;
+		};
+
+		uint32_t threadCount;
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::vector<std::thread> threads;
+
+		// Submissions of threads that are not workers of this system.
+		std::mutex injectedMutex;
+		std::deque<Job*> injectedJobs;
+
+		// Jobs pushed but not yet taken, lets idle workers sleep without missing a push.
+		std::atomic<int64_t> queuedJobs = 0;
+		std::atomic<uint32_t> sleepingWorkers = 0;
+		std::mutex sleepMutex;
+		std::condition_variable wakeUp;
+		std::atomic<bool> isStopping = false;
+
+	public: // Public Functions
+		// Starts threadCount - 1 workers (0 for one per hardware thread in total), the thread waiting on a counter makes
+		// up the last one. With a single thread every job runs inside Wait(). Pinned workers stay on one core each,
+		// skipping core 0 which is left to the thread that created the system.
+		explicit JobSystem(uint32_t threadCount = 0, bool pinThreads = false);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// Process wide instance with one thread per hardware thread, created on first use.
+		static JobSystem& GetShared();
+
+		// Schedules function, counter (when given) stays above zero until it returned.
+		template<typename Function>
+		void Run(Function&& function, JobCounter* counter = nullptr);
+		// Schedules function once dependency dropped to zero, right away when it already has.
+		template<typename Function>
+		void RunAfter(JobCounter& dependency, Function&& function, JobCounter* counter = nullptr);
+
+		// Runs other jobs until counter drops to zero, then rethrows the first exception of its jobs.
+		void Wait(JobCounter& counter);
+
+		// Calls function(begin, end) over [0, count) in ranges of at most grainSize and returns once all are done.
+		// Ranges are split in halves, so thieves take the large remainders and the caller keeps working locally.
+		template<typename Function>
+		void ParallelFor(uint32_t count, uint32_t grainSize, const Function& function);
+
+		uint32_t GetThreadCount() const;
+
+	private: // Private Methods
+		static Job* allocateJob();
+		static void releaseJob(Job* job);
+		template<typename Function>
+		static Job* makeJob(Function&& function, JobCounter* counter);
+
+		void schedule(Job* job);
+		void finish(Job* job);
+		Job* findJob();
+		void execute(Job* job);
+		void workerLoop(uint32_t workerIndex);
+		static void pinThread(std::thread& thread, uint32_t core);
+	};
+
+	template<typename Function>
+	Job* JobSystem::makeJob(Function&& function, JobCounter* counter) {
+		using Callable = std::decay_t<Function>;
+
+		Job* job = allocateJob();
+		job->counter = counter;
+
+		if constexpr (sizeof(Callable) <= Job::STORAGE_SIZE && alignof(Callable) <= alignof(std::max_align_t)) {
+			new (job->storage) Callable(std::forward<Function>(function));
+			job->invoke = [](Job& self) { (*std::launder(reinterpret_cast<Callable*>(self.storage)))(); };
+			job->destroy = [](Job& self) { std::launder(reinterpret_cast<Callable*>(self.storage))->~Callable(); };
+		} else {
+			// Too big to store inline, the rare case pays for an allocation.
+			new (job->storage) Callable*(new Callable(std::forward<Function>(function)));
+			job->invoke = [](Job& self) { (**std::launder(reinterpret_cast<Callable**>(self.storage)))(); };
+			job->destroy = [](Job& self) { delete *std::launder(reinterpret_cast<Callable**>(self.storage)); };
+		}
+
+		return job;
+	}
+
+	template<typename Function>
+	void JobSystem::Run(Function&& function, JobCounter* counter) {
+		if (counter != nullptr) counter->pending.fetch_add(1, std::memory_order_relaxed);
+		schedule(makeJob(std::forward<Function>(function), counter));
+	}
+
+	template<typename Function>
+	void JobSystem::RunAfter(JobCounter& dependency, Function&& function, JobCounter* counter) {
+		if (counter != nullptr) counter->pending.fetch_add(1, std::memory_order_relaxed);
+		Job* job = makeJob(std::forward<Function>(function), counter);
+
+		{
+			// The last job of dependency takes the same lock before it moves the continuations out.
+			std::lock_guard lock(dependency.mutex);
+			if (dependency.pending.load(std::memory_order_acquire) != 0) {
+				dependency.continuations.push_back(job);
+				return;
+			}
+		}
+
+		schedule(job);
+	}
+
+	template<typename Function>
+	void JobSystem::ParallelFor(const uint32_t count, uint32_t grainSize, const Function& function) {
+		if (count == 0) return;
+		grainSize = std::max(grainSize, 1u);
+
+		if (count <= grainSize || threadCount == 1) {
+			function(0u, count);
+			return;
+		}
+
+		JobCounter counter;
+		// Lives on this stack frame until Wait() returns, so the jobs can refer to it.
+		const auto split = [this, &function, &counter, grainSize](const auto& self, const uint32_t begin, uint32_t end) -> void {
+			while (end - begin > grainSize) {
+				const uint32_t middle = begin + (end - begin) / 2;
+				Run([&self, middle, end] { self(self, middle, end); }, &counter);
+				end = middle;
+			}
+			function(begin, end);
+		};
+
+		// The caller's own share counts as a job as well, so a throwing function still waits for the others.
+		Run([&split, count] { split(split, 0u, count); }, &counter);
+		Wait(counter);
+	}
+}
@@ -0,0 +1,108 @@
+﻿#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "log.hpp"
+
+namespace utils::io
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& fileName) {
+		fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE) {
+			fileHandle = nullptr;
+			UTIL_THROW("Failed to open file " + fileName);
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize)) {
+			close();
+			UTIL_THROW("Failed to get the size of file " + fileName);
+		}
+
+		size = static_cast<size_t>(fileSize.QuadPart);
+		if (size == 0) return; // Empty files can not be mapped.
+
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr) {
+			close();
+			UTIL_THROW("Failed to create a mapping for file " + fileName);
+		}
+
+		data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (data == nullptr) {
+			close();
+			UTIL_THROW("Failed to map file " + fileName);
+		}
+	}
+
+	void MappedFile::close() {
+		if (data != nullptr) UnmapViewOfFile(data);
+		if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+		if (fileHandle != nullptr) CloseHandle(fileHandle);
+
+		data = nullptr;
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+	}
+#else
+	MappedFile::MappedFile(const std::string& fileName) {
+		fileDescriptor = open(fileName.c_str(), O_RDONLY);
+		if (fileDescriptor < 0) {
+			UTIL_THROW("Failed to open file " + fileName);
+		}
+
+		struct stat fileStat{};
+		if (fstat(fileDescriptor, &fileStat) != 0) {
+			close();
+			UTIL_THROW("Failed to get the size of file " + fileName);
+		}
+
+		size = static_cast<size_t>(fileStat.st_size);
+		if (size == 0) return; // Empty files can not be mapped.
+
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (mapping == MAP_FAILED) {
+			close();
+			UTIL_THROW("Failed to map file " + fileName);
+		}
+
+		madvise(mapping, size, MADV_SEQUENTIAL);
+		data = static_cast<const char*>(mapping);
+	}
+
+	void MappedFile::close() {
+		if (data != nullptr) munmap(const_cast<char*>(data), size);
+		if (fileDescriptor >= 0) ::close(fileDescriptor);
+
+		data = nullptr;
+		fileDescriptor = -1;
+	}
+#endif
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+	const char* MappedFile::GetData() const {
+		return data;
+	}
+
+	size_t MappedFile::GetSize() const {
+		return size;
+	}
+
+	std::string_view MappedFile::GetView() const {
+		return {data, size};
+	}
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace utils::io
+{
+	// Read only view of a whole file through the OS page cache, for inputs too big to copy with readToBytes().
+	// Pages are faulted in on first touch, so parsing different ranges on different threads also reads them in parallel.
+	class MappedFile {
+	public: // Properties
+
+	private: // Member Variables
+		const char* data = nullptr;
+		size_t size = 0;
+
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+
+	public: // Public Functions
+		explicit MappedFile(const std::string& fileName);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* GetData() const;
+		size_t GetSize() const;
+		std::string_view GetView() const;
+
+	private: // Private Methods
+		void close();
+	};
+}
@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace utils
+{
+	// Chase-Lev deque with the memory orders of Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+	// The owning thread pushes and pops at the bottom without contention, other threads steal from the top and only
+	// race the owner for the very last item. Grows on demand, outgrown arrays stay alive until destruction as
+	// thieves may still be reading them.
+	template<typename T>
+	class WorkStealingDeque {
+	public: // Properties
+
+	private: // Member Variables
+		struct Array {
+			int64_t capacity;
+			std::unique_ptr<std::atomic<T>[]> items;
+
+			explicit Array(const int64_t capacity)
+				: capacity(capacity), items(std::make_unique<std::atomic<T>[]>(static_cast<size_t>(capacity))) {}
+
+			T Get(const int64_t index) const {
+				return items[static_cast<size_t>(index & (capacity - 1))].load(std::memory_order_relaxed);
+			}
+
+			void Put(const int64_t index, const T item) {
+				items[static_cast<size_t>(index & (capacity - 1))].store(item, std::memory_order_relaxed);
+			}
+		};
+
+		// Apart, so thieves hammering top do not slow down the owner's bottom.
+		alignas(64) std::atomic<int64_t> top = 0;
+		alignas(64) std::atomic<int64_t> bottom = 0;
+		std::atomic<Array*> array;
+		std::vector<std::unique_ptr<Array>> arrays; // Owned by the owning thread, the last one is current.
+
+	public: // Public Functions
+		explicit WorkStealingDeque(const int64_t initialCapacity = 1024) {
+			arrays.push_back(std::make_unique<Array>(initialCapacity));
+			array.store(arrays.back().get(), std::memory_order_relaxed);
+		}
+
+		WorkStealingDeque(const WorkStealingDeque&) = delete;
+		WorkStealingDeque(WorkStealingDeque&&) = delete;
+		WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+		// Owner only.
+		void Push(const T item) {
+			const int64_t currentBottom = bottom.load(std::memory_order_relaxed);
+			const int64_t currentTop = top.load(std::memory_order_acquire);
+			Array* current = array.load(std::memory_order_relaxed);
+
+			if (currentBottom - currentTop > current->capacity - 1) {
+				arrays.push_back(std::make_unique<Array>(current->capacity * 2));
+				for (int64_t index = currentTop; index < currentBottom; index++) {
+					arrays.back()->Put(index, current->Get(index));
+				}
+				current = arrays.back().get();
+				array.store(current, std::memory_order_release);
+			}
+
+			current->Put(currentBottom, item);
+			std::atomic_thread_fence(std::memory_order_release);
+			bottom.store(currentBottom + 1, std::memory_order_relaxed);
+		}
+
+		// Owner only, takes the most recently pushed item.
+		bool Pop(T& item) {
+			const int64_t currentBottom = bottom.load(std::memory_order_relaxed) - 1;
+			const Array* current = array.load(std::memory_order_relaxed);
+			bottom.store(currentBottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t currentTop = top.load(std::memory_order_relaxed);
+
+			if (currentTop > currentBottom) {
+				bottom.store(currentBottom + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			item = current->Get(currentBottom);
+			if (currentTop != currentBottom) return true;
+
+			// The last item, whoever moves top first gets it.
+			const bool won = top.compare_exchange_strong(currentTop, currentTop + 1, std::memory_order_seq_cst,
+			                                             std::memory_order_relaxed);
+			bottom.store(currentBottom + 1, std::memory_order_relaxed);
+			return won;
+		}
+
+		// Any thread, takes the oldest item. Fails spuriously when racing another thief or the owner.
+		bool Steal(T& item) {
+			int64_t currentTop = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t currentBottom = bottom.load(std::memory_order_acquire);
+
+			if (currentTop >= currentBottom) return false;
+
+			const Array* current = array.load(std::memory_order_acquire);
+			item = current->Get(currentTop);
+			return top.compare_exchange_strong(currentTop, currentTop + 1, std::memory_order_seq_cst,
+			                                   std::memory_order_relaxed);
+		}
+
+		// A snapshot, only a hint while other threads work on the deque.
+		bool IsEmpty() const {
+			return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+		}
+	};
+}
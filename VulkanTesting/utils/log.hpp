@@ -1,7 +1,17 @@
 ﻿#pragma once
 #include <iostream>
+#include <string>
+
+// Changing the console color spawns a shell, only Windows has the command.
+#ifdef _WIN32
+#define UTIL_COLOR(color) system("Color " color)
+#else
+#define UTIL_COLOR(color)
+#endif
 
 #define UTIL_THROW(message) throw std::runtime_error(std::string(__FILE__) + "[" + std::to_string(__LINE__) + "]: " + message + "\n")
-#define UTIL_LOG(message) system("Color 0A"); std::cout << __FILE__ << " " << __LINE__ << ": " << std::string("") + message << std::endl
+#define UTIL_LOG(message) UTIL_COLOR("0A"); std::cout << __FILE__ << " " << __LINE__ << ": " << std::string("") + message << std::endl
+// Formatted first and handed to the stream in one write, without changing the color, for the frame loop.
+#define UTIL_REPORT(message) do { const std::string utilReport = std::string(__FILE__) + " " + std::to_string(__LINE__) + ": " + message + "\n"; std::cout.write(utilReport.data(), static_cast<std::streamsize>(utilReport.size())).flush(); } while (false)
 #define UTIL_ERR(message) std::cerr << __FILE__ << " " << __LINE__ << ": " << std::string("") + message << std::endl
-#define UTIL_WARN(message) system("Color 06"); std::cout << __FILE__ << " " << __LINE__ << ": " << std::string("") + message << std::endl
+#define UTIL_WARN(message) UTIL_COLOR("06"); std::cout << __FILE__ << " " << __LINE__ << ": " << std::string("") + message << std::endl